@@ -0,0 +1,253 @@
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "annotations/adapter/yac.h"
+#include "annotations/adapter.h"
+#include "annotations/adapterinterface.h"
+#include "annotations/reflection.h"
+#include "annotations/exception.h"
+#include "cache/yac.h"
+#include "cache/yac/storage.h"
+
+#include "kernel/main.h"
+#include "kernel/memory.h"
+#include "kernel/array.h"
+#include "kernel/object.h"
+#include "kernel/fcall.h"
+#include "kernel/file.h"
+#include "kernel/string.h"
+#include "kernel/operators.h"
+
+/**
+ * Phalcon\Annotations\Adapter\Yac
+ *
+ * Stores the parsed annotations in the Yac shared memory, so every worker reuses
+ * the reflection data without parsing the class or including a cache file.
+ * Entries are tagged with the mtime of the file declaring the class and are
+ * ignored once the file changes. This adapter is suitable for production
+ *
+ *<code>
+ * $annotations = new \Phalcon\Annotations\Adapter\Yac(array(
+ *    'prefix'   => '_PHAN',
+ *    'lifetime' => 0,
+ *    'stat'     => true
+ * ));
+ *</code>
+ */
+zend_class_entry *phalcon_annotations_adapter_yac_ce;
+
+PHP_METHOD(Phalcon_Annotations_Adapter_Yac, __construct);
+PHP_METHOD(Phalcon_Annotations_Adapter_Yac, read);
+PHP_METHOD(Phalcon_Annotations_Adapter_Yac, write);
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_annotations_adapter_yac___construct, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, options, IS_ARRAY, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_annotations_adapter_yac_read, 0, 0, 1)
+	ZEND_ARG_INFO(0, key)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_annotations_adapter_yac_write, 0, 0, 2)
+	ZEND_ARG_INFO(0, key)
+	ZEND_ARG_INFO(0, data)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry phalcon_annotations_adapter_yac_method_entry[] = {
+	PHP_ME(Phalcon_Annotations_Adapter_Yac, __construct, arginfo_phalcon_annotations_adapter_yac___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+	PHP_ME(Phalcon_Annotations_Adapter_Yac, read, arginfo_phalcon_annotations_adapter_yac_read, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Annotations_Adapter_Yac, write, arginfo_phalcon_annotations_adapter_yac_write, ZEND_ACC_PUBLIC)
+	PHP_FE_END
+};
+
+/**
+ * Phalcon\Annotations\Adapter\Yac initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Annotations_Adapter_Yac){
+
+	PHALCON_REGISTER_CLASS_EX(Phalcon\\Annotations\\Adapter, Yac, annotations_adapter_yac, phalcon_annotations_adapter_ce, phalcon_annotations_adapter_yac_method_entry, 0);
+
+	zend_declare_property_string(phalcon_annotations_adapter_yac_ce, SL("_prefix"), "_PHAN", ZEND_ACC_PROTECTED);
+	zend_declare_property_long(phalcon_annotations_adapter_yac_ce, SL("_lifetime"), 0, ZEND_ACC_PROTECTED);
+	zend_declare_property_bool(phalcon_annotations_adapter_yac_ce, SL("_stat"), 1, ZEND_ACC_PROTECTED);
+	zend_declare_property_null(phalcon_annotations_adapter_yac_ce, SL("_yac"), ZEND_ACC_PROTECTED);
+
+	zend_class_implements(phalcon_annotations_adapter_yac_ce, 1, phalcon_annotations_adapterinterface_ce);
+
+	return SUCCESS;
+}
+
+/**
+ * Returns the Phalcon\Cache\Yac instance used as storage, creating it on first use
+ */
+static void phalcon_annotations_adapter_yac_storage(zval *return_value, zval *object)
+{
+	zval prefix = {};
+
+	phalcon_read_property(return_value, object, SL("_yac"), PH_READONLY);
+	if (Z_TYPE_P(return_value) == IS_OBJECT) {
+		return;
+	}
+
+	phalcon_read_property(&prefix, object, SL("_prefix"), PH_READONLY);
+
+	object_init_ex(return_value, phalcon_cache_yac_ce);
+	PHALCON_CALL_METHOD(NULL, return_value, "__construct", &prefix);
+
+	phalcon_update_property(object, SL("_yac"), return_value);
+	zval_ptr_dtor(return_value);
+
+	phalcon_read_property(return_value, object, SL("_yac"), PH_READONLY);
+}
+
+/**
+ * Yac keys are limited to PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN bytes (prefix included),
+ * long class names are replaced by their md5
+ */
+static void phalcon_annotations_adapter_yac_key(zval *return_value, zval *object, zval *key)
+{
+	zval prefix = {}, lower_key = {};
+
+	phalcon_read_property(&prefix, object, SL("_prefix"), PH_READONLY);
+	phalcon_fast_strtolower(&lower_key, key);
+
+	if (Z_STRLEN(lower_key) + (Z_TYPE(prefix) == IS_STRING ? Z_STRLEN(prefix) : 0) > PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN) {
+		phalcon_md5(return_value, &lower_key);
+		zval_ptr_dtor(&lower_key);
+	} else {
+		ZVAL_COPY_VALUE(return_value, &lower_key);
+	}
+}
+
+/**
+ * Returns the mtime of the file where the class is declared, 0 for internal or unknown classes
+ */
+static zend_long phalcon_annotations_adapter_yac_mtime(zval *class_name)
+{
+	zend_class_entry *ce;
+	zval filename = {}, mtime = {};
+
+	ce = phalcon_fetch_class(class_name, ZEND_FETCH_CLASS_DEFAULT | ZEND_FETCH_CLASS_SILENT);
+	if (!ce || ce->type != ZEND_USER_CLASS || !ce->info.user.filename) {
+		return 0;
+	}
+
+	ZVAL_STR(&filename, ce->info.user.filename);
+	phalcon_filemtime(&mtime, &filename);
+
+	return Z_TYPE(mtime) == IS_LONG ? Z_LVAL(mtime) : 0;
+}
+
+/**
+ * Phalcon\Annotations\Adapter\Yac constructor
+ *
+ * @param array $options
+ */
+PHP_METHOD(Phalcon_Annotations_Adapter_Yac, __construct){
+
+	zval *options = NULL, prefix = {}, lifetime = {}, stat = {};
+
+	phalcon_fetch_params(0, 0, 1, &options);
+
+	if (options && Z_TYPE_P(options) == IS_ARRAY) {
+		if (phalcon_array_isset_fetch_str(&prefix, options, SL("prefix"), PH_READONLY) && Z_TYPE(prefix) == IS_STRING) {
+			phalcon_update_property(getThis(), SL("_prefix"), &prefix);
+		}
+
+		if (phalcon_array_isset_fetch_str(&lifetime, options, SL("lifetime"), PH_READONLY)) {
+			phalcon_update_property_long(getThis(), SL("_lifetime"), phalcon_get_intval(&lifetime));
+		}
+
+		if (phalcon_array_isset_fetch_str(&stat, options, SL("stat"), PH_READONLY)) {
+			phalcon_update_property_bool(getThis(), SL("_stat"), zend_is_true(&stat));
+		}
+	}
+}
+
+/**
+ * Reads parsed annotations from the shared memory
+ *
+ * @param string $key
+ * @return Phalcon\Annotations\Reflection
+ */
+PHP_METHOD(Phalcon_Annotations_Adapter_Yac, read){
+
+	zval *key, yac = {}, yac_key = {}, cached = {}, stat = {}, mtime = {}, reflection_data = {};
+
+	phalcon_fetch_params(0, 1, 0, &key);
+	PHALCON_ENSURE_IS_STRING(key);
+
+	phalcon_annotations_adapter_yac_storage(&yac, getThis());
+	phalcon_annotations_adapter_yac_key(&yac_key, getThis(), key);
+
+	PHALCON_CALL_METHOD(&cached, &yac, "get", &yac_key);
+	zval_ptr_dtor(&yac_key);
+
+	if (Z_TYPE(cached) != IS_ARRAY
+		|| !phalcon_array_isset_fetch_long(&mtime, &cached, 0, PH_READONLY)
+		|| !phalcon_array_isset_fetch_long(&reflection_data, &cached, 1, PH_READONLY)) {
+		zval_ptr_dtor(&cached);
+		RETURN_NULL();
+	}
+
+	/**
+	 * Entries created before the last change of the class file are stale
+	 */
+	phalcon_read_property(&stat, getThis(), SL("_stat"), PH_READONLY);
+	if (zend_is_true(&stat) && phalcon_get_intval(&mtime) != phalcon_annotations_adapter_yac_mtime(key)) {
+		zval_ptr_dtor(&cached);
+		RETURN_NULL();
+	}
+
+	object_init_ex(return_value, phalcon_annotations_reflection_ce);
+	PHALCON_CALL_METHOD(NULL, return_value, "__construct", &reflection_data);
+	zval_ptr_dtor(&cached);
+}
+
+/**
+ * Writes parsed annotations to the shared memory
+ *
+ * @param string $key
+ * @param Phalcon\Annotations\Reflection $data
+ */
+PHP_METHOD(Phalcon_Annotations_Adapter_Yac, write){
+
+	zval *key, *data, yac = {}, yac_key = {}, reflection_data = {}, entry = {}, lifetime = {};
+
+	phalcon_fetch_params(0, 2, 0, &key, &data);
+	PHALCON_ENSURE_IS_STRING(key);
+	PHALCON_VERIFY_CLASS_EX(data, phalcon_annotations_reflection_ce, phalcon_annotations_exception_ce);
+
+	/**
+	 * Only the raw reflection data is stored, the collections are rebuilt lazily on read
+	 */
+	PHALCON_CALL_METHOD(&reflection_data, data, "getreflectiondata");
+
+	array_init_size(&entry, 2);
+	add_next_index_long(&entry, phalcon_annotations_adapter_yac_mtime(key));
+	add_next_index_zval(&entry, &reflection_data);
+
+	phalcon_annotations_adapter_yac_storage(&yac, getThis());
+	phalcon_annotations_adapter_yac_key(&yac_key, getThis(), key);
+	phalcon_read_property(&lifetime, getThis(), SL("_lifetime"), PH_READONLY);
+
+	PHALCON_CALL_METHOD(NULL, &yac, "set", &yac_key, &entry, &lifetime);
+	zval_ptr_dtor(&yac_key);
+	zval_ptr_dtor(&entry);
+}
@@ -0,0 +1,756 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "cache/backend/shm.h"
+#include "cache/backend.h"
+#include "cache/backendinterface.h"
+#include "cache/exception.h"
+#include "cache/frontend/none.h"
+#include "cache/yac/storage.h"
+#include "cache/yac/serializer.h"
+
+#include <ext/standard/php_rand.h>
+#include "zend_smart_str.h"
+
+#include "kernel/main.h"
+#include "kernel/memory.h"
+#include "kernel/array.h"
+#include "kernel/fcall.h"
+#include "kernel/object.h"
+#include "kernel/exception.h"
+#include "kernel/operators.h"
+
+/**
+ * Phalcon\Cache\Backend\Shm
+ *
+ * Allows to cache output fragments, PHP data or raw data in the shared memory
+ * of the built-in yac storage, without going through Phalcon\Cache\Yac
+ *
+ * Keys are found by scanning the storage slots, so queryKeys() needs no
+ * tracking entry. Entries can be tagged when saved and every entry of a tag is
+ * invalidated at once with deleteByTag(). Scalars and strings are stored as is,
+ * with Phalcon\Cache\Frontend\None they are read back without any decoding.
+ *
+ *<code>
+ *
+ * $frontCache = new Phalcon\Cache\Frontend\Data(array(
+ *    "lifetime" => 172800
+ * ));
+ *
+ * $cache = new Phalcon\Cache\Backend\Shm($frontCache, array(
+ *     'prefix' => 'app-data'
+ * ));
+ *
+ * $cache->save('user-1', $user, null, true, array('users'));
+ * $cache->save('user-2', $user, null, true, array('users'));
+ *
+ * // Both entries are gone
+ * $cache->deleteByTag('users');
+ *
+ *</code>
+ */
+zend_class_entry *phalcon_cache_backend_shm_ce;
+
+PHP_METHOD(Phalcon_Cache_Backend_Shm, __construct);
+PHP_METHOD(Phalcon_Cache_Backend_Shm, get);
+PHP_METHOD(Phalcon_Cache_Backend_Shm, save);
+PHP_METHOD(Phalcon_Cache_Backend_Shm, delete);
+PHP_METHOD(Phalcon_Cache_Backend_Shm, deleteByTag);
+PHP_METHOD(Phalcon_Cache_Backend_Shm, queryKeys);
+PHP_METHOD(Phalcon_Cache_Backend_Shm, exists);
+PHP_METHOD(Phalcon_Cache_Backend_Shm, increment);
+PHP_METHOD(Phalcon_Cache_Backend_Shm, decrement);
+PHP_METHOD(Phalcon_Cache_Backend_Shm, flush);
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_cache_backend_shm___construct, 0, 0, 1)
+	ZEND_ARG_INFO(0, frontend)
+	ZEND_ARG_TYPE_INFO(0, options, IS_ARRAY, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_cache_backend_shm_save, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, keyName, IS_STRING, 1)
+	ZEND_ARG_INFO(0, value)
+	ZEND_ARG_TYPE_INFO(0, lifetime, IS_LONG, 1)
+	ZEND_ARG_TYPE_INFO(0, stopBuffer, _IS_BOOL, 1)
+	ZEND_ARG_INFO(0, tags)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_cache_backend_shm_deletebytag, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, tag, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry phalcon_cache_backend_shm_method_entry[] = {
+	PHP_ME(Phalcon_Cache_Backend_Shm, __construct, arginfo_phalcon_cache_backend_shm___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+	PHP_ME(Phalcon_Cache_Backend_Shm, get, arginfo_phalcon_cache_backendinterface_get, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Cache_Backend_Shm, save, arginfo_phalcon_cache_backend_shm_save, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Cache_Backend_Shm, delete, arginfo_phalcon_cache_backendinterface_delete, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Cache_Backend_Shm, deleteByTag, arginfo_phalcon_cache_backend_shm_deletebytag, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Cache_Backend_Shm, queryKeys, arginfo_phalcon_cache_backendinterface_querykeys, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Cache_Backend_Shm, exists, arginfo_phalcon_cache_backendinterface_exists, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Cache_Backend_Shm, increment, arginfo_phalcon_cache_backendinterface_increment, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Cache_Backend_Shm, decrement, arginfo_phalcon_cache_backendinterface_decrement, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Cache_Backend_Shm, flush, NULL, ZEND_ACC_PUBLIC)
+	PHP_FE_END
+};
+
+/*
+ * An entry is | tag count (4) | tag id (4) | tag version (4) | ... | payload |
+ *
+ * The payload is the value itself for scalars and strings and its serialized
+ * form for arrays and objects, the storage flag holds the type. Tag versions
+ * live in their own entries, an entry whose tags moved on (or were evicted)
+ * reads as a miss, so deleting a tag never has to visit its entries.
+ */
+typedef struct {
+	uint32_t id;
+	uint32_t version;
+} phalcon_cache_backend_shm_tag;
+
+#define PHALCON_CACHE_BACKEND_SHM_PREFIX     "_PHCS"
+#define PHALCON_CACHE_BACKEND_SHM_TAG_PREFIX "_PHCT"
+
+static int phalcon_cache_backend_shm_key(char *buf, zval *prefix, zval *key_name)
+{
+	zend_string *p, *k;
+	size_t len;
+
+	p = zval_get_string(prefix);
+	k = zval_get_string(key_name);
+
+	len = sizeof(PHALCON_CACHE_BACKEND_SHM_PREFIX) - 1 + ZSTR_LEN(p) + ZSTR_LEN(k);
+	if (len > PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN) {
+		zend_string_release(p);
+		zend_string_release(k);
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_cache_exception_ce, "Key (including prefix) can not be longer than %d bytes",
+			PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN - (int)(sizeof(PHALCON_CACHE_BACKEND_SHM_PREFIX) - 1));
+		return 0;
+	}
+
+	memcpy(buf, PHALCON_CACHE_BACKEND_SHM_PREFIX, sizeof(PHALCON_CACHE_BACKEND_SHM_PREFIX) - 1);
+	memcpy(buf + sizeof(PHALCON_CACHE_BACKEND_SHM_PREFIX) - 1, ZSTR_VAL(p), ZSTR_LEN(p));
+	memcpy(buf + sizeof(PHALCON_CACHE_BACKEND_SHM_PREFIX) - 1 + ZSTR_LEN(p), ZSTR_VAL(k), ZSTR_LEN(k));
+
+	zend_string_release(p);
+	zend_string_release(k);
+
+	return (int) len;
+}
+
+static uint32_t phalcon_cache_backend_shm_tag_id(zval *prefix, zval *tag)
+{
+	smart_str buf = {0};
+	zend_string *p, *t;
+	uint32_t id;
+
+	p = zval_get_string(prefix);
+	t = zval_get_string(tag);
+
+	/* tags of different prefixes are different tags */
+	smart_str_append(&buf, p);
+	smart_str_appendc(&buf, '\0');
+	smart_str_append(&buf, t);
+	smart_str_0(&buf);
+
+	id = (uint32_t) zend_inline_hash_func(ZSTR_VAL(buf.s), ZSTR_LEN(buf.s));
+
+	smart_str_free(&buf);
+	zend_string_release(p);
+	zend_string_release(t);
+
+	return id;
+}
+
+static int phalcon_cache_backend_shm_tag_version(uint32_t id, uint32_t *version, int create, time_t tv)
+{
+	char key[sizeof(PHALCON_CACHE_BACKEND_SHM_TAG_PREFIX) + 8], *data;
+	unsigned int size, flag;
+	int len;
+
+	len = snprintf(key, sizeof(key), PHALCON_CACHE_BACKEND_SHM_TAG_PREFIX "%08x", id);
+
+	if (phalcon_cache_yac_storage_find(key, len, &data, &size, &flag, tv)) {
+		if (size == sizeof(uint32_t)) {
+			memcpy(version, data, sizeof(uint32_t));
+			efree(data);
+			return 1;
+		}
+		efree(data);
+	}
+
+	if (!create) {
+		return 0;
+	}
+
+	/* a fresh random version, never one the entries of an evicted tag could still carry */
+	*version = (uint32_t) php_mt_rand();
+
+	return phalcon_cache_yac_storage_update(key, len, (char *) version, sizeof(uint32_t), IS_STRING, 0, 0, tv);
+}
+
+static int phalcon_cache_backend_shm_tag_bump(uint32_t id, time_t tv)
+{
+	char key[sizeof(PHALCON_CACHE_BACKEND_SHM_TAG_PREFIX) + 8];
+	uint32_t current = 0, version;
+	int len;
+
+	phalcon_cache_backend_shm_tag_version(id, &current, 0, tv);
+
+	do {
+		version = (uint32_t) php_mt_rand();
+	} while (version == current);
+
+	len = snprintf(key, sizeof(key), PHALCON_CACHE_BACKEND_SHM_TAG_PREFIX "%08x", id);
+
+	return phalcon_cache_yac_storage_update(key, len, (char *) &version, sizeof(uint32_t), IS_STRING, 0, 0, tv);
+}
+
+static int phalcon_cache_backend_shm_header(smart_str *header, zval *tags, zval *prefix, time_t tv)
+{
+	phalcon_cache_backend_shm_tag tag;
+	uint32_t count = 0;
+	zval *t;
+
+	smart_str_appendl(header, (char *) &count, sizeof(uint32_t));
+
+	if (!tags || Z_TYPE_P(tags) == IS_NULL) {
+		return 1;
+	}
+
+	if (Z_TYPE_P(tags) != IS_ARRAY) {
+		tag.id = phalcon_cache_backend_shm_tag_id(prefix, tags);
+		if (!phalcon_cache_backend_shm_tag_version(tag.id, &tag.version, 1, tv)) {
+			return 0;
+		}
+		smart_str_appendl(header, (char *) &tag, sizeof(tag));
+		count = 1;
+	} else {
+		ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(tags), t) {
+			tag.id = phalcon_cache_backend_shm_tag_id(prefix, t);
+			if (!phalcon_cache_backend_shm_tag_version(tag.id, &tag.version, 1, tv)) {
+				return 0;
+			}
+			smart_str_appendl(header, (char *) &tag, sizeof(tag));
+			count++;
+		} ZEND_HASH_FOREACH_END();
+	}
+
+	memcpy(ZSTR_VAL(header->s), &count, sizeof(uint32_t));
+	return 1;
+}
+
+/*
+ * Appends the value to the header and stores the entry, the header is freed
+ */
+static int phalcon_cache_backend_shm_store(char *key, int len, zval *value, smart_str *header, int ttl, time_t tv)
+{
+	char *msg;
+	int ret = 0;
+
+	switch (Z_TYPE_P(value)) {
+		case IS_NULL:
+		case IS_TRUE:
+		case IS_FALSE:
+			break;
+		case IS_LONG:
+			smart_str_appendl(header, (char *) &Z_LVAL_P(value), sizeof(zend_long));
+			break;
+		case IS_DOUBLE:
+			smart_str_appendl(header, (char *) &Z_DVAL_P(value), sizeof(double));
+			break;
+		case IS_STRING:
+			smart_str_appendl(header, Z_STRVAL_P(value), Z_STRLEN_P(value));
+			break;
+		case IS_ARRAY:
+		case IS_OBJECT:
+			if (!phalcon_cache_yac_serializer_php_pack(value, header, &msg)) {
+				php_error_docref(NULL, E_WARNING, "Serialization failed");
+				smart_str_free(header);
+				return 0;
+			}
+			break;
+		default:
+			php_error_docref(NULL, E_WARNING, "Type '%s' cannot be stored", zend_get_type_by_const(Z_TYPE_P(value)));
+			smart_str_free(header);
+			return 0;
+	}
+
+	if (ZSTR_LEN(header->s) > PHALCON_CACHE_YAC_STORAGE_MAX_ENTRY_LEN) {
+		php_error_docref(NULL, E_WARNING, "Value is too big to be stored");
+	} else {
+		ret = phalcon_cache_yac_storage_update(key, len, ZSTR_VAL(header->s), ZSTR_LEN(header->s), Z_TYPE_P(value), ttl, 0, tv);
+	}
+
+	smart_str_free(header);
+	return ret;
+}
+
+/*
+ * Reads an entry whose tags are all current, rv may be NULL to only check it,
+ * header (when given) receives the tags to store the entry again with
+ */
+static int phalcon_cache_backend_shm_fetch(char *key, int len, zval *rv, smart_str *header, time_t tv)
+{
+	phalcon_cache_backend_shm_tag tag;
+	char *data, *payload, *msg;
+	unsigned int size, flag;
+	uint32_t count, version, i;
+	int ret = 0;
+
+	if (!phalcon_cache_yac_storage_find(key, len, &data, &size, &flag, tv)) {
+		return 0;
+	}
+
+	if (size < sizeof(uint32_t)) {
+		goto done;
+	}
+
+	memcpy(&count, data, sizeof(uint32_t));
+	if ((size - sizeof(uint32_t)) / sizeof(tag) < count) {
+		goto done;
+	}
+
+	payload = data + sizeof(uint32_t);
+	for (i = 0; i < count; i++, payload += sizeof(tag)) {
+		memcpy(&tag, payload, sizeof(tag));
+		if (!phalcon_cache_backend_shm_tag_version(tag.id, &version, 0, tv) || version != tag.version) {
+			goto done;
+		}
+	}
+	size -= (unsigned int) (payload - data);
+
+	if (!rv) {
+		ret = 1;
+		goto done;
+	}
+
+	switch (flag) {
+		case IS_NULL:
+			ZVAL_NULL(rv);
+			ret = 1;
+			break;
+		case IS_TRUE:
+			ZVAL_TRUE(rv);
+			ret = 1;
+			break;
+		case IS_FALSE:
+			ZVAL_FALSE(rv);
+			ret = 1;
+			break;
+		case IS_LONG:
+			if (size == sizeof(zend_long)) {
+				zend_long l;
+				memcpy(&l, payload, sizeof(zend_long));
+				ZVAL_LONG(rv, l);
+				ret = 1;
+			}
+			break;
+		case IS_DOUBLE:
+			if (size == sizeof(double)) {
+				double d;
+				memcpy(&d, payload, sizeof(double));
+				ZVAL_DOUBLE(rv, d);
+				ret = 1;
+			}
+			break;
+		case IS_STRING:
+			ZVAL_STRINGL(rv, payload, size);
+			ret = 1;
+			break;
+		case IS_ARRAY:
+		case IS_OBJECT:
+			if (phalcon_cache_yac_serializer_php_unpack(payload, size, &msg, rv)) {
+				ret = 1;
+			} else {
+				php_error_docref(NULL, E_WARNING, "Unserialization failed, %s", msg);
+				efree(msg);
+			}
+			break;
+	}
+
+	if (ret && header) {
+		smart_str_appendl(header, data, (size_t) (payload - data));
+	}
+
+done:
+	efree(data);
+	return ret;
+}
+
+/*
+ * Values handed to the storage without going through the frontend
+ */
+static int phalcon_cache_backend_shm_is_raw(zval *frontend, zval *value)
+{
+	if (Z_TYPE_P(frontend) == IS_OBJECT && instanceof_function(Z_OBJCE_P(frontend), phalcon_cache_frontend_none_ce)) {
+		return 1;
+	}
+
+	return phalcon_is_numeric(value);
+}
+
+static void phalcon_cache_backend_shm_add(INTERNAL_FUNCTION_PARAMETERS, int negative)
+{
+	zval *key_name, *value = NULL, prefix = {}, cached_content = {}, lifetime = {};
+	char key[PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN];
+	smart_str header = {0};
+	zend_long step;
+	time_t tv;
+	int len;
+
+	phalcon_fetch_params(0, 1, 1, &key_name, &value);
+
+	step = value && Z_TYPE_P(value) != IS_NULL ? phalcon_get_intval(value) : 1;
+	if (negative) {
+		step = -step;
+	}
+
+	phalcon_read_property(&prefix, getThis(), SL("_prefix"), PH_READONLY);
+	if (!(len = phalcon_cache_backend_shm_key(key, &prefix, key_name))) {
+		return;
+	}
+
+	PHALCON_CALL_METHOD(&lifetime, getThis(), "getlifetime");
+
+	tv = time(NULL);
+	if (!phalcon_cache_backend_shm_fetch(key, len, &cached_content, &header, tv) || Z_TYPE(cached_content) != IS_LONG) {
+		zval_ptr_dtor(&cached_content);
+		zval_ptr_dtor(&lifetime);
+		smart_str_free(&header);
+		RETURN_FALSE;
+	}
+
+	ZVAL_LONG(return_value, Z_LVAL(cached_content) + step);
+
+	/* the tags come along, the counter stays in its groups */
+	phalcon_cache_backend_shm_store(key, len, return_value, &header, (int) phalcon_get_intval(&lifetime), tv);
+	zval_ptr_dtor(&lifetime);
+}
+
+/**
+ * Phalcon\Cache\Backend\Shm initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Cache_Backend_Shm)
+{
+	PHALCON_REGISTER_CLASS_EX(Phalcon\\Cache\\Backend, Shm, cache_backend_shm, phalcon_cache_backend_ce, phalcon_cache_backend_shm_method_entry, 0);
+
+	zend_class_implements(phalcon_cache_backend_shm_ce, 1, phalcon_cache_backendinterface_ce);
+
+	return SUCCESS;
+}
+
+/**
+ * Phalcon\Cache\Backend\Shm constructor
+ *
+ * @param Phalcon\Cache\FrontendInterface $frontend
+ * @param array $options
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, __construct){
+
+	zval *frontend, *options = NULL;
+
+	phalcon_fetch_params(0, 1, 1, &frontend, &options);
+
+	if (!PHALCON_GLOBAL(cache).enable_yac) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_cache_exception_ce, "The shared memory storage is disabled, check phalcon.cache.enable_yac");
+		return;
+	}
+
+	if (!options) {
+		options = &PHALCON_GLOBAL(z_null);
+	}
+
+	PHALCON_CALL_PARENT(NULL, phalcon_cache_backend_shm_ce, getThis(), "__construct", frontend, options);
+}
+
+/**
+ * Returns a cached content
+ *
+ * @param string $keyName
+ * @param long $lifetime
+ * @return mixed
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, get){
+
+	zval *key_name, *lifetime = NULL, prefix = {}, frontend = {}, cached_content = {};
+	char key[PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN];
+	int len;
+
+	phalcon_fetch_params(0, 1, 1, &key_name, &lifetime);
+
+	phalcon_read_property(&prefix, getThis(), SL("_prefix"), PH_READONLY);
+	if (!(len = phalcon_cache_backend_shm_key(key, &prefix, key_name))) {
+		return;
+	}
+
+	if (!phalcon_cache_backend_shm_fetch(key, len, &cached_content, NULL, time(NULL))) {
+		RETURN_NULL();
+	}
+
+	phalcon_read_property(&frontend, getThis(), SL("_frontend"), PH_NOISY|PH_READONLY);
+	if (phalcon_cache_backend_shm_is_raw(&frontend, &cached_content)) {
+		RETURN_ZVAL(&cached_content, 0, 0);
+	}
+
+	PHALCON_RETURN_CALL_METHOD(&frontend, "afterretrieve", &cached_content);
+	zval_ptr_dtor(&cached_content);
+}
+
+/**
+ * Stores cached content into the shared memory and stops the frontend
+ *
+ *<code>
+ *  $cache->save('my-key', $data, 3600, true, array('users', 'user-1'));
+ *</code>
+ *
+ * @param string $keyName
+ * @param string $content
+ * @param long $lifetime
+ * @param boolean $stopBuffer
+ * @param string|array $tags
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, save){
+
+	zval *key_name = NULL, *content = NULL, *lifetime = NULL, *stop_buffer = NULL, *tags = NULL, last_key = {}, prefix = {}, frontend = {};
+	zval cached_content = {}, prepared_content = {}, ttl = {}, is_buffering = {};
+	char key[PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN];
+	smart_str header = {0};
+	time_t tv;
+	int len, ret = 0;
+
+	phalcon_fetch_params(0, 0, 5, &key_name, &content, &lifetime, &stop_buffer, &tags);
+
+	if (!key_name || Z_TYPE_P(key_name) == IS_NULL) {
+		phalcon_read_property(&last_key, getThis(), SL("_lastKey"), PH_READONLY);
+		key_name = &last_key;
+	}
+
+	if (!zend_is_true(key_name)) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_cache_exception_ce, "The cache must be started first");
+		return;
+	}
+
+	phalcon_read_property(&prefix, getThis(), SL("_prefix"), PH_READONLY);
+	if (!(len = phalcon_cache_backend_shm_key(key, &prefix, key_name))) {
+		return;
+	}
+
+	phalcon_read_property(&frontend, getThis(), SL("_frontend"), PH_NOISY|PH_READONLY);
+	if (!content || Z_TYPE_P(content) == IS_NULL) {
+		PHALCON_CALL_METHOD(&cached_content, &frontend, "getcontent");
+	} else {
+		ZVAL_COPY(&cached_content, content);
+	}
+
+	if (phalcon_cache_backend_shm_is_raw(&frontend, &cached_content)) {
+		ZVAL_COPY(&prepared_content, &cached_content);
+	} else {
+		PHALCON_CALL_METHOD(&prepared_content, &frontend, "beforestore", &cached_content);
+	}
+
+	/**
+	 * Take the lifetime from the frontend or read it from the set in start()
+	 */
+	if (!lifetime || Z_TYPE_P(lifetime) != IS_LONG) {
+		PHALCON_CALL_METHOD(&ttl, getThis(), "getlifetime");
+	} else {
+		ZVAL_COPY(&ttl, lifetime);
+	}
+
+	tv = time(NULL);
+	if (phalcon_cache_backend_shm_header(&header, tags, &prefix, tv)) {
+		ret = phalcon_cache_backend_shm_store(key, len, &prepared_content, &header, (int) phalcon_get_intval(&ttl), tv);
+	} else {
+		smart_str_free(&header);
+	}
+	zval_ptr_dtor(&ttl);
+	zval_ptr_dtor(&prepared_content);
+
+	PHALCON_CALL_METHOD(&is_buffering, &frontend, "isbuffering");
+	if (!stop_buffer || PHALCON_IS_TRUE(stop_buffer)) {
+		PHALCON_CALL_METHOD(NULL, &frontend, "stop");
+	}
+
+	if (PHALCON_IS_TRUE(&is_buffering)) {
+		zend_print_zval(&cached_content, 0);
+	}
+	zval_ptr_dtor(&cached_content);
+
+	phalcon_update_property_bool(getThis(), SL("_started"), 0);
+
+	RETURN_BOOL(ret);
+}
+
+/**
+ * Deletes a value from the cache by its key
+ *
+ * @param string $keyName
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, delete){
+
+	zval *key_name, prefix = {};
+	char key[PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN];
+	int len;
+
+	phalcon_fetch_params(0, 1, 0, &key_name);
+
+	phalcon_read_property(&prefix, getThis(), SL("_prefix"), PH_READONLY);
+	if (!(len = phalcon_cache_backend_shm_key(key, &prefix, key_name))) {
+		return;
+	}
+
+	phalcon_cache_yac_storage_delete(key, len, 0, 0);
+	RETURN_TRUE;
+}
+
+/**
+ * Invalidates every entry saved with the tag
+ *
+ *<code>
+ *  $cache->save('user-1', $user, null, true, 'users');
+ *  $cache->deleteByTag('users');
+ *</code>
+ *
+ * @param string $tag
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, deleteByTag){
+
+	zval *tag, prefix = {};
+
+	phalcon_fetch_params(0, 1, 0, &tag);
+
+	phalcon_read_property(&prefix, getThis(), SL("_prefix"), PH_READONLY);
+
+	RETURN_BOOL(phalcon_cache_backend_shm_tag_bump(phalcon_cache_backend_shm_tag_id(&prefix, tag), time(NULL)));
+}
+
+/**
+ * Query the existing cached keys
+ *
+ * @param string $prefix
+ * @return array
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, queryKeys){
+
+	zval *key_prefix = NULL, prefix = {}, empty = {};
+	char key[PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN];
+	phalcon_cache_yac_item_list *list, *item;
+	int len, skip;
+
+	phalcon_fetch_params(0, 0, 1, &key_prefix);
+
+	array_init(return_value);
+
+	phalcon_read_property(&prefix, getThis(), SL("_prefix"), PH_READONLY);
+
+	ZVAL_EMPTY_STRING(&empty);
+	if (!(skip = phalcon_cache_backend_shm_key(key, &prefix, &empty))) {
+		return;
+	}
+
+	if (!key_prefix || Z_TYPE_P(key_prefix) == IS_NULL) {
+		len = skip;
+	} else if (!(len = phalcon_cache_backend_shm_key(key, &prefix, key_prefix))) {
+		return;
+	}
+
+	list = phalcon_cache_yac_storage_keys(key, len, time(NULL));
+	for (item = list; item; item = item->next) {
+		phalcon_array_append_str(return_value, (char *) item->key + skip, item->k_len - skip, 0);
+	}
+	phalcon_cache_yac_storage_free_list(list);
+}
+
+/**
+ * Checks if cache exists and it hasn't expired
+ *
+ * @param string $keyName
+ * @param long $lifetime
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, exists){
+
+	zval *key_name, *lifetime = NULL, prefix = {};
+	char key[PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN];
+	int len;
+
+	phalcon_fetch_params(0, 1, 1, &key_name, &lifetime);
+
+	phalcon_read_property(&prefix, getThis(), SL("_prefix"), PH_READONLY);
+	if (!(len = phalcon_cache_backend_shm_key(key, &prefix, key_name))) {
+		return;
+	}
+
+	RETURN_BOOL(phalcon_cache_backend_shm_fetch(key, len, NULL, NULL, time(NULL)));
+}
+
+/**
+ * Increment of a given key, by number $value
+ *
+ * @param string $keyName
+ * @param long $value
+ * @return mixed
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, increment){
+
+	phalcon_cache_backend_shm_add(INTERNAL_FUNCTION_PARAM_PASSTHRU, 0);
+}
+
+/**
+ * Decrement of a given key, by number $value
+ *
+ * @param string $keyName
+ * @param long $value
+ * @return mixed
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, decrement){
+
+	phalcon_cache_backend_shm_add(INTERNAL_FUNCTION_PARAM_PASSTHRU, 1);
+}
+
+/**
+ * Immediately invalidates all the entries of the prefix
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Cache_Backend_Shm, flush){
+
+	zval prefix = {}, empty = {};
+	char key[PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN];
+	phalcon_cache_yac_item_list *list, *item;
+	int len;
+
+	phalcon_read_property(&prefix, getThis(), SL("_prefix"), PH_READONLY);
+
+	ZVAL_EMPTY_STRING(&empty);
+	if (!(len = phalcon_cache_backend_shm_key(key, &prefix, &empty))) {
+		return;
+	}
+
+	list = phalcon_cache_yac_storage_keys(key, len, time(NULL));
+	for (item = list; item; item = item->next) {
+		phalcon_cache_yac_storage_delete((char *) item->key, item->k_len, 0, 0);
+	}
+	phalcon_cache_yac_storage_free_list(list);
+
+	RETURN_TRUE;
+}
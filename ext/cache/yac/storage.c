@@ -602,6 +602,41 @@ phalcon_cache_yac_item_list * phalcon_cache_yac_storage_dump(unsigned int limit)
 }
 /* }}} */
 
+phalcon_cache_yac_item_list * phalcon_cache_yac_storage_keys(char *prefix, unsigned int len, unsigned long tv) /* {{{ */ {
+	phalcon_cache_yac_kv_key k;
+	phalcon_cache_yac_item_list *item, *list = NULL;
+	unsigned int i;
+
+	/* the slots are the index, there is no shared key list to keep in sync */
+	for (i = 0; i < PHALCON_CACHE_YAC_SG(slots_size); i++) {
+		k = PHALCON_CACHE_YAC_SG(slots)[i];
+		if (!k.val || PHALCON_CACHE_YAC_KEY_KLEN(k) < len || memcmp(k.key, prefix, len)) {
+			continue;
+		}
+
+		/* deleted, expired or being rewritten */
+		if ((k.ttl && k.ttl <= tv) || k.len != k.val->len) {
+			continue;
+		}
+
+		item = emalloc(sizeof(phalcon_cache_yac_item_list));
+		item->index = i;
+		item->h = k.h;
+		item->crc = k.crc;
+		item->ttl = k.ttl;
+		item->k_len = PHALCON_CACHE_YAC_KEY_KLEN(k);
+		item->v_len = PHALCON_CACHE_YAC_KEY_VLEN(k);
+		item->flag = k.flag;
+		item->size = k.size;
+		memcpy(item->key, k.key, PHALCON_CACHE_YAC_STORAGE_MAX_KEY_LEN);
+		item->next = list;
+		list = item;
+	}
+
+	return list;
+}
+/* }}} */
+
 void phalcon_cache_yac_storage_free_list(phalcon_cache_yac_item_list *list) /* {{{ */ {
 	phalcon_cache_yac_item_list *l;
 	while (list) {
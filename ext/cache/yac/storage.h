@@ -109,6 +109,7 @@ const char * phalcon_cache_yac_storage_shared_yac_name(void);
 phalcon_cache_yac_storage_info * phalcon_cache_yac_storage_get_info(void);
 void phalcon_cache_yac_storage_free_info(phalcon_cache_yac_storage_info *info);
 phalcon_cache_yac_item_list * phalcon_cache_yac_storage_dump(unsigned int limit);
+phalcon_cache_yac_item_list * phalcon_cache_yac_storage_keys(char *prefix, unsigned int len, unsigned long tv);
 void phalcon_cache_yac_storage_free_list(phalcon_cache_yac_item_list *list);
 #define phalcon_cache_yac_storage_exists(ht, key, len)  phalcon_cache_yac_storage_find(ht, key, len, NULL)
 
@@ -173,6 +173,15 @@ else
 	AC_MSG_RESULT([no])
 fi
 
+PHP_ARG_ENABLE(coroutine, whether to enable coroutine support,
+[  --enable-coroutine   Enable coroutine support], no, no)
+
+if test "$PHP_COROUTINE" = "yes"; then
+	AC_MSG_RESULT([yes, coroutine])
+else
+	AC_MSG_RESULT([no])
+fi
+
 PHP_ARG_ENABLE(python, for python support,
 [  --enable-python   Include python support], no, no)
 
@@ -466,8 +475,11 @@ kernel/mpool.c \
 kernel/avltree.c \
 kernel/rbtree.c \
 kernel/bloomfilter.c \
+kernel/blockedbloomfilter.c \
 kernel/countingbloomfilter.c \
+kernel/cuckoofilter.c \
 kernel/datrie/trie.c \
+kernel/datrie/acmatcher.c \
 kernel/datrie/alpha-map.c \
 kernel/datrie/darray.c \
 kernel/datrie/dstring.c \
@@ -549,6 +561,7 @@ forms/exception.c \
 forms/element.c \
 forms/elementinterface.c \
 http/parser/http_parser.c \
+http/parser/multipart.c \
 http/parser.c \
 http/response.c \
 http/requestinterface.c \
@@ -784,6 +797,7 @@ session/adapterinterface.c \
 session/adapter.c \
 session/adapter/memcached.c \
 session/adapter/cache.c \
+session/adapter/shm.c \
 diinterface.c \
 escaper.c \
 crypt/exception.c \
@@ -886,7 +900,7 @@ server/simple.c \
 server/exception.c"
 
 	if test "$PHP_CACHE_YAC" = "yes"; then
-		phalcon_sources="$phalcon_sources cache/yac/allocators/mmap.c cache/yac/allocators/shm.c cache/yac/serializer.c cache/yac/storage.c cache/yac/allocator.c cache/yac.c"
+		phalcon_sources="$phalcon_sources cache/yac/allocators/mmap.c cache/yac/allocators/shm.c cache/yac/serializer.c cache/yac/storage.c cache/yac/allocator.c cache/yac.c cache/backend/shm.c annotations/adapter/yac.c"
 	fi
 
 	if test "$PHP_CHART" = "yes"; then
@@ -902,7 +916,7 @@ server/exception.c"
 	fi
 
 	if test "$PHP_STORAGE_BTREE" = "yes"; then
-		phalcon_sources="$phalcon_sources storage/btree/bplus.c storage/btree/pages.c storage/btree/utils.c storage/btree/values.c storage/btree/writer.c storage/btree.c"
+		phalcon_sources="$phalcon_sources storage/btree/bplus.c storage/btree/pages.c storage/btree/utils.c storage/btree/values.c storage/btree/writer.c storage/btree/cache.c storage/btree/iterator.c storage/btree.c"
 	fi
 
 	old_CPPFLAGS=$CPPFLAGS
@@ -1267,6 +1281,44 @@ server/exception.c"
 		phalcon_sources="$phalcon_sources assets/filters/nojsminifier.c assets/filters/nocssminifier.c "
 	fi
 
+	if test "$PHP_STORAGE_BTREE" = "yes"; then
+		AC_MSG_CHECKING([checking liblz4 support for storage btree])
+		for i in /usr/local /usr; do
+			if test -r $i/include/lz4.h; then
+				AC_MSG_RESULT([yes, found in $i])
+				PHP_ADD_INCLUDE($i/include)
+				PHP_CHECK_LIBRARY(lz4, LZ4_compress_default,
+				[
+					PHP_ADD_LIBRARY_WITH_PATH(lz4, $i/$PHP_LIBDIR, PHALCON_SHARED_LIBADD)
+					AC_DEFINE(PHALCON_USE_LZ4, 1, [Have lz4 support])
+				],[
+					AC_MSG_WARN([Wrong lz4 version, btree pages will not be compressed with lz4])
+				],[
+					-L$i/$PHP_LIBDIR
+				])
+				break
+			fi
+		done
+
+		AC_MSG_CHECKING([checking libzstd support for storage btree])
+		for i in /usr/local /usr; do
+			if test -r $i/include/zstd.h; then
+				AC_MSG_RESULT([yes, found in $i])
+				PHP_ADD_INCLUDE($i/include)
+				PHP_CHECK_LIBRARY(zstd, ZSTD_compress,
+				[
+					PHP_ADD_LIBRARY_WITH_PATH(zstd, $i/$PHP_LIBDIR, PHALCON_SHARED_LIBADD)
+					AC_DEFINE(PHALCON_USE_ZSTD, 1, [Have zstd support])
+				],[
+					AC_MSG_WARN([Wrong zstd version, btree pages will not be compressed with zstd])
+				],[
+					-L$i/$PHP_LIBDIR
+				])
+				break
+			fi
+		done
+	fi
+
 	if test "$PHP_STORAGE_WIREDTIGER" = "yes"; then
 		AC_MSG_CHECKING([checking libwiredtiger support])
 		for i in /usr/local /usr; do
@@ -1296,7 +1348,7 @@ server/exception.c"
 
 	if test "$PHP_STORAGE_LMDB" = "yes"; then
 		AC_DEFINE(PHALCON_USE_LMDB, 1, [Have lmdb support])
-		phalcon_sources="$phalcon_sources storage/lmdb.c storage/lmdb/cursor.c storage/lmdb/mdb.c storage/lmdb/midl.c cache/backend/lmdb.c "
+		phalcon_sources="$phalcon_sources storage/lmdb.c storage/lmdb/cursor.c storage/lmdb/view.c storage/lmdb/mdb.c storage/lmdb/midl.c cache/backend/lmdb.c "
 	fi
 
 	if test "$PHP_STORAGE_LIBMDBX" = "yes"; then
@@ -1309,7 +1361,7 @@ server/exception.c"
 				[
 					PHP_ADD_LIBRARY_WITH_PATH(mdbx, $i/$PHP_LIBDIR, PHALCON_SHARED_LIBADD)
 					AC_DEFINE(PHALCON_USE_LIBMDBX, 1, [Have libmdbx support])
-					phalcon_sources="$phalcon_sources storage/libmdbx.c storage/libmdbx/cursor.c "
+					phalcon_sources="$phalcon_sources storage/libmdbx.c storage/libmdbx/cursor.c storage/libmdbx/view.c "
 				],[
 					AC_MSG_ERROR([Wrong mdbx version or library not found])
 				],[
@@ -1355,7 +1407,7 @@ server/exception.c"
 
 	if test "$PHP_STORAGE_BLOOMFILTER" = "yes"; then
 		AC_DEFINE(PHALCON_USE_BLOOMFILTER, 1, [Have bloomfilter support])
-		phalcon_sources="$phalcon_sources storage/bloomfilter.c storage/bloomfilter/counting.c "
+		phalcon_sources="$phalcon_sources storage/bloomfilter.c storage/bloomfilter/counting.c storage/bloomfilter/blocked.c "
 	fi
 
 	if test "$PHP_STORAGE_DATRIE" = "yes"; then
@@ -1391,7 +1443,24 @@ server/exception.c"
 		], [
 			AC_DEFINE([PHALCON_USE_SERVER], 1, [Have epoll support])
 			AC_MSG_RESULT([yes])
-			phalcon_sources="$phalcon_sources server/utils.c server/core.c server.c server/http.c"
+			phalcon_sources="$phalcon_sources server/utils.c server/core.c server/static.c server.c server/http.c"
+		], [
+			AC_MSG_RESULT([no])
+		])
+	fi
+
+	if test "$PHP_COROUTINE" = "yes"; then
+		AC_MSG_CHECKING([for coroutine context switch support])
+		AC_TRY_COMPILE(
+		[
+		], [
+			#if !defined(__x86_64__) && !defined(__i386__)
+			#error lthread switches contexts for x86 only
+			#endif
+		], [
+			AC_DEFINE([PHALCON_USE_COROUTINE], 1, [Have coroutine support])
+			AC_MSG_RESULT([yes])
+			phalcon_sources="$phalcon_sources kernel/lthread/lthread.c kernel/lthread/lthread_sched.c kernel/lthread/lthread_socket.c kernel/lthread/lthread_io.c kernel/lthread/lthread_compute.c kernel/lthread/lthread_poller.c coroutine.c coroutine/exception.c coroutine/channel.c coroutine/socket.c coroutine/client.c"
 		], [
 			AC_MSG_RESULT([no])
 		])
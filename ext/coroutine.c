@@ -0,0 +1,483 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "coroutine.h"
+#include "coroutine/exception.h"
+
+#include <Zend/zend_exceptions.h>
+#include <ext/standard/basic_functions.h>
+
+#include <errno.h>
+#include <time.h>
+
+#include "kernel/main.h"
+#include "kernel/fcall.h"
+#include "kernel/operators.h"
+#include "kernel/exception.h"
+
+/**
+ * Phalcon\Coroutine
+ *
+ * Runs callables as coroutines on the bundled lthread scheduler. A coroutine
+ * switches out whenever it waits on a Phalcon\Coroutine\Channel, a
+ * Phalcon\Coroutine\Socket or sleep(), so many I/O bound tasks share one worker.
+ *
+ *<code>
+ *	$channel = new Phalcon\Coroutine\Channel(16);
+ *
+ *	foreach ($hosts as $host) {
+ *		Phalcon\Coroutine::go(function($host) use ($channel) {
+ *			$client = new Phalcon\Coroutine\Client($host, 80);
+ *			$client->connect(1.5);
+ *			$client->send("HEAD / HTTP/1.0\r\nHost: " . $host . "\r\n\r\n");
+ *			$channel->push([$host, $client->readLine()]);
+ *		}, [$host]);
+ *	}
+ *
+ *	Phalcon\Coroutine::go(function() use ($channel, $hosts) {
+ *		foreach ($hosts as $host) {
+ *			list($host, $status) = $channel->pop();
+ *			echo $host, ': ', $status, PHP_EOL;
+ *		}
+ *	});
+ *
+ *	Phalcon\Coroutine::wait();
+ *</code>
+ *
+ * Coroutines created outside of a coroutine start when wait() is called, when
+ * the script ends, or once a Phalcon\Server\Http handler has returned.
+ *
+ * Each coroutine runs on a C stack of phalcon.coroutine.stack_size bytes (256K
+ * by default), the pages it never touches are not backed by memory. Its PHP
+ * frames live on a VM stack that starts at 16K and grows as calls nest.
+ */
+zend_class_entry *phalcon_coroutine_ce;
+
+PHP_METHOD(Phalcon_Coroutine, go);
+PHP_METHOD(Phalcon_Coroutine, wait);
+PHP_METHOD(Phalcon_Coroutine, run);
+PHP_METHOD(Phalcon_Coroutine, sleep);
+PHP_METHOD(Phalcon_Coroutine, getId);
+PHP_METHOD(Phalcon_Coroutine, count);
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_go, 0, 0, 1)
+	ZEND_ARG_INFO(0, callback)
+	ZEND_ARG_TYPE_INFO(0, arguments, IS_ARRAY, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_sleep, 0, 0, 1)
+	ZEND_ARG_INFO(0, seconds)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry phalcon_coroutine_method_entry[] = {
+	PHP_ME(Phalcon_Coroutine, go, arginfo_phalcon_coroutine_go, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+	PHP_ME(Phalcon_Coroutine, wait, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+	PHP_ME(Phalcon_Coroutine, run, arginfo_phalcon_coroutine_go, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+	PHP_ME(Phalcon_Coroutine, sleep, arginfo_phalcon_coroutine_sleep, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+	PHP_ME(Phalcon_Coroutine, getId, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+	PHP_ME(Phalcon_Coroutine, count, NULL, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+	PHP_FE_END
+};
+
+void phalcon_coroutine_save(phalcon_coroutine_context *ctx)
+{
+	ctx->coroutine = PHALCON_GLOBAL(coroutine).current;
+	ctx->vm_stack = EG(vm_stack);
+	ctx->vm_stack_top = EG(vm_stack_top);
+	ctx->vm_stack_end = EG(vm_stack_end);
+#if PHP_VERSION_ID >= 70300
+	ctx->vm_stack_page_size = EG(vm_stack_page_size);
+#endif
+	ctx->current_execute_data = EG(current_execute_data);
+#if PHP_VERSION_ID >= 70100
+	ctx->fake_scope = EG(fake_scope);
+#endif
+	ctx->bailout = EG(bailout);
+}
+
+void phalcon_coroutine_restore(phalcon_coroutine_context *ctx)
+{
+	PHALCON_GLOBAL(coroutine).current = ctx->coroutine;
+	EG(vm_stack) = ctx->vm_stack;
+	EG(vm_stack_top) = ctx->vm_stack_top;
+	EG(vm_stack_end) = ctx->vm_stack_end;
+#if PHP_VERSION_ID >= 70300
+	EG(vm_stack_page_size) = ctx->vm_stack_page_size;
+#endif
+	EG(current_execute_data) = ctx->current_execute_data;
+#if PHP_VERSION_ID >= 70100
+	EG(fake_scope) = ctx->fake_scope;
+#endif
+	EG(bailout) = ctx->bailout;
+}
+
+static void phalcon_coroutine_free(phalcon_coroutine *co)
+{
+	if (co->prev) {
+		co->prev->next = co->next;
+	} else {
+		PHALCON_GLOBAL(coroutine).head = co->next;
+	}
+
+	if (co->next) {
+		co->next->prev = co->prev;
+	}
+
+	PHALCON_GLOBAL(coroutine).count--;
+
+	zval_ptr_dtor(&co->callable);
+	zval_ptr_dtor(&co->arguments);
+	efree(co);
+}
+
+/* Same as zend_vm_stack_init() with a smaller first page, the engine adds pages as it needs them */
+static void phalcon_coroutine_vm_stack_init(void)
+{
+	zend_vm_stack page = (zend_vm_stack) emalloc(PHALCON_COROUTINE_VM_STACK_SIZE);
+
+	page->top = ZEND_VM_STACK_ELEMENTS(page);
+	page->end = (zval *) ((char *) page + PHALCON_COROUTINE_VM_STACK_SIZE);
+	page->prev = NULL;
+
+	EG(vm_stack) = page;
+	EG(vm_stack_top) = page->top;
+	EG(vm_stack_end) = page->end;
+#if PHP_VERSION_ID >= 70300
+	EG(vm_stack_page_size) = PHALCON_COROUTINE_VM_STACK_SIZE;
+#endif
+}
+
+static void phalcon_coroutine_entry(void *arg)
+{
+	phalcon_coroutine *co = arg;
+	zval retval = {}, exception = {};
+
+	/* every coroutine gets its own VM stack, a fatal error unwinds to wait() */
+	EG(bailout) = PHALCON_GLOBAL(coroutine).bailout;
+	EG(current_execute_data) = NULL;
+#if PHP_VERSION_ID >= 70100
+	EG(fake_scope) = NULL;
+#endif
+	phalcon_coroutine_vm_stack_init();
+
+	PHALCON_GLOBAL(coroutine).current = co;
+
+	phalcon_call_user_func_array(&retval, &co->callable, &co->arguments);
+	zval_ptr_dtor(&retval);
+
+	if (EG(exception)) {
+		if (!PHALCON_GLOBAL(coroutine).exception) {
+			ZVAL_OBJ(&exception, EG(exception));
+			Z_ADDREF(exception);
+			PHALCON_GLOBAL(coroutine).exception = Z_OBJ(exception);
+		}
+		zend_clear_exception();
+	}
+
+	phalcon_coroutine_free(co);
+	zend_vm_stack_destroy();
+
+	PHALCON_GLOBAL(coroutine).current = NULL;
+}
+
+zend_long phalcon_coroutine_create(zval *callable, zval *arguments)
+{
+	phalcon_coroutine *co;
+	php_shutdown_function_entry entry;
+	zend_long stack_size;
+
+	/* lthread_run() frees the scheduler once everything has finished */
+	if (!PHALCON_GLOBAL(coroutine).head && !PHALCON_GLOBAL(coroutine).running) {
+		stack_size = PHALCON_GLOBAL(coroutine).stack_size;
+		if (stack_size < PHALCON_COROUTINE_MIN_STACK_SIZE) {
+			stack_size = PHALCON_COROUTINE_MIN_STACK_SIZE;
+		}
+		if (lthread_init((size_t) stack_size) != 0) {
+			return -1;
+		}
+	}
+
+	co = ecalloc(1, sizeof(phalcon_coroutine));
+	ZVAL_COPY(&co->callable, callable);
+	if (arguments && Z_TYPE_P(arguments) == IS_ARRAY) {
+		ZVAL_COPY(&co->arguments, arguments);
+	} else {
+		ZVAL_NULL(&co->arguments);
+	}
+
+	if (lthread_create(&co->lt, phalcon_coroutine_entry, co) != 0) {
+		zval_ptr_dtor(&co->callable);
+		zval_ptr_dtor(&co->arguments);
+		efree(co);
+		return -1;
+	}
+
+	lthread_detach2(co->lt);
+
+	co->id = ++PHALCON_GLOBAL(coroutine).last_id;
+	co->next = PHALCON_GLOBAL(coroutine).head;
+	if (co->next) {
+		co->next->prev = co;
+	}
+	PHALCON_GLOBAL(coroutine).head = co;
+	PHALCON_GLOBAL(coroutine).count++;
+
+	/* coroutines nobody waits for still run before the script ends */
+	if (!PHALCON_GLOBAL(coroutine).running && !PHALCON_GLOBAL(coroutine).shutdown) {
+		entry.arg_count = 1;
+		entry.arguments = (zval *) safe_emalloc(sizeof(zval), 1, 0);
+		ZVAL_STRING(&entry.arguments[0], "Phalcon\\Coroutine::wait");
+
+		if (append_user_shutdown_function(entry)) {
+			PHALCON_GLOBAL(coroutine).shutdown = 1;
+		} else {
+			zval_ptr_dtor(&entry.arguments[0]);
+			efree(entry.arguments);
+		}
+	}
+
+	return co->id;
+}
+
+int phalcon_coroutine_wait(void)
+{
+	phalcon_coroutine_context ctx;
+	zval exception = {};
+	int bailout = 0;
+
+	if (PHALCON_GLOBAL(coroutine).running) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Coroutines cannot be waited for inside a coroutine, use a channel");
+		return FAILURE;
+	}
+
+	if (PHALCON_GLOBAL(coroutine).head) {
+		phalcon_coroutine_save(&ctx);
+		PHALCON_GLOBAL(coroutine).running = 1;
+
+		zend_try {
+			PHALCON_GLOBAL(coroutine).bailout = EG(bailout);
+			lthread_run();
+		} zend_catch {
+			bailout = 1;
+		} zend_end_try();
+
+		phalcon_coroutine_restore(&ctx);
+		PHALCON_GLOBAL(coroutine).running = 0;
+		PHALCON_GLOBAL(coroutine).bailout = NULL;
+
+		if (bailout) {
+			/* fatal error or exit() inside a coroutine, the others are never resumed */
+			phalcon_coroutine_shutdown();
+			zend_bailout();
+		}
+	}
+
+	if (PHALCON_GLOBAL(coroutine).exception) {
+		ZVAL_OBJ(&exception, PHALCON_GLOBAL(coroutine).exception);
+		PHALCON_GLOBAL(coroutine).exception = NULL;
+		zend_throw_exception_object(&exception);
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+int phalcon_coroutine_check(void)
+{
+	if (!PHALCON_GLOBAL(coroutine).current) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "This call has to wait and can only be made inside a coroutine");
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+void phalcon_coroutine_shutdown(void)
+{
+	phalcon_coroutine *co;
+
+	/* the scheduler was left behind by a longjmp */
+	if (PHALCON_GLOBAL(coroutine).head) {
+		while ((co = PHALCON_GLOBAL(coroutine).head) != NULL) {
+			lthread_free(co->lt);
+			phalcon_coroutine_free(co);
+		}
+		lthread_sched_free();
+	}
+
+	if (PHALCON_GLOBAL(coroutine).exception) {
+		OBJ_RELEASE(PHALCON_GLOBAL(coroutine).exception);
+		PHALCON_GLOBAL(coroutine).exception = NULL;
+	}
+
+	PHALCON_GLOBAL(coroutine).current = NULL;
+	PHALCON_GLOBAL(coroutine).running = 0;
+	PHALCON_GLOBAL(coroutine).count = 0;
+	PHALCON_GLOBAL(coroutine).last_id = 0;
+	/* the shutdown function is registered again by the next request */
+	PHALCON_GLOBAL(coroutine).shutdown = 0;
+}
+
+/**
+ * Phalcon\Coroutine initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Coroutine){
+
+	PHALCON_REGISTER_CLASS(Phalcon, Coroutine, coroutine, phalcon_coroutine_method_entry, 0);
+
+	return SUCCESS;
+}
+
+/**
+ * Creates a coroutine, it starts once the scheduler runs
+ *
+ * @param callable $callback
+ * @param array $arguments
+ * @return int the id of the coroutine
+ */
+PHP_METHOD(Phalcon_Coroutine, go){
+
+	zval *callback, *arguments = NULL;
+	zend_long id;
+
+	phalcon_fetch_params(0, 1, 1, &callback, &arguments);
+
+	if (!zend_is_callable(callback, 0, NULL)) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Callback must be callable");
+		return;
+	}
+
+	id = phalcon_coroutine_create(callback, arguments);
+	if (id < 0) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Unable to create a coroutine");
+		return;
+	}
+
+	RETURN_LONG(id);
+}
+
+/**
+ * Runs the scheduler until every coroutine has finished, the first exception
+ * a coroutine left uncaught is thrown afterwards
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Coroutine, wait){
+
+	if (phalcon_coroutine_wait() == FAILURE) {
+		return;
+	}
+
+	RETURN_TRUE;
+}
+
+/**
+ * Creates a coroutine and waits for every coroutine, inside a coroutine it is the same as go()
+ *
+ *<code>
+ *	Phalcon\Coroutine::run(function() {
+ *		Phalcon\Coroutine::go(function() { ... });
+ *		Phalcon\Coroutine::go(function() { ... });
+ *	});
+ *</code>
+ *
+ * @param callable $callback
+ * @param array $arguments
+ * @return int the id of the coroutine
+ */
+PHP_METHOD(Phalcon_Coroutine, run){
+
+	zval *callback, *arguments = NULL;
+	zend_long id;
+
+	phalcon_fetch_params(0, 1, 1, &callback, &arguments);
+
+	if (!zend_is_callable(callback, 0, NULL)) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Callback must be callable");
+		return;
+	}
+
+	id = phalcon_coroutine_create(callback, arguments);
+	if (id < 0) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Unable to create a coroutine");
+		return;
+	}
+
+	if (!PHALCON_GLOBAL(coroutine).running && phalcon_coroutine_wait() == FAILURE) {
+		return;
+	}
+
+	RETURN_LONG(id);
+}
+
+/**
+ * Suspends the current coroutine, 0 lets the other ready coroutines run first.
+ * Outside of a coroutine the process sleeps.
+ *
+ * @param float $seconds
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Coroutine, sleep){
+
+	zval *seconds;
+	struct timespec ts;
+	double value;
+	uint64_t msecs;
+
+	phalcon_fetch_params(0, 1, 0, &seconds);
+
+	value = phalcon_get_doubleval(seconds);
+	msecs = value > 0 ? (uint64_t) ceil(value * 1000) : 0;
+
+	if (!PHALCON_GLOBAL(coroutine).current) {
+		ts.tv_sec = msecs / 1000;
+		ts.tv_nsec = (msecs % 1000) * 1000000;
+		while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+		RETURN_TRUE;
+	}
+
+	PHALCON_COROUTINE_YIELD(lthread_sleep(msecs));
+
+	RETURN_TRUE;
+}
+
+/**
+ * Returns the id of the current coroutine, -1 outside of a coroutine
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Coroutine, getId){
+
+	if (PHALCON_GLOBAL(coroutine).current) {
+		RETURN_LONG(PHALCON_GLOBAL(coroutine).current->id);
+	}
+
+	RETURN_LONG(-1);
+}
+
+/**
+ * Returns the number of coroutines not finished yet
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Coroutine, count){
+
+	RETURN_LONG(PHALCON_GLOBAL(coroutine).count);
+}
@@ -0,0 +1,114 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_COROUTINE_H
+#define PHALCON_COROUTINE_H
+
+#include "php_phalcon.h"
+
+#ifdef PHALCON_USE_COROUTINE
+
+#include "kernel/lthread/lthread.h"
+#include "kernel/operators.h"
+
+#include <math.h>
+
+/* lthreads run PHP frames, internal calls recurse on the C stack */
+#define PHALCON_COROUTINE_MIN_STACK_SIZE (64 * 1024)
+
+/* first page of the VM stack of a coroutine, ZEND_VM_STACK_PAGE_SIZE is 256K */
+#define PHALCON_COROUTINE_VM_STACK_SIZE (16 * 1024)
+
+typedef struct _phalcon_coroutine {
+	lthread_t *lt;
+	zend_long id;
+	zval callable;
+	zval arguments;
+	struct _phalcon_coroutine *prev;
+	struct _phalcon_coroutine *next;
+} phalcon_coroutine;
+
+/* Executor state of a coroutine while it is switched out */
+typedef struct _phalcon_coroutine_context {
+	phalcon_coroutine *coroutine;
+	zend_vm_stack vm_stack;
+	zval *vm_stack_top;
+	zval *vm_stack_end;
+#if PHP_VERSION_ID >= 70300
+	size_t vm_stack_page_size;
+#endif
+	zend_execute_data *current_execute_data;
+#if PHP_VERSION_ID >= 70100
+	zend_class_entry *fake_scope;
+#endif
+	JMP_BUF *bailout;
+} phalcon_coroutine_context;
+
+/* Wraps a call that may switch to another coroutine */
+#define PHALCON_COROUTINE_YIELD(call) \
+	do { \
+		phalcon_coroutine_context _ctx; \
+		phalcon_coroutine_save(&_ctx); \
+		call; \
+		phalcon_coroutine_restore(&_ctx); \
+	} while (0)
+
+void phalcon_coroutine_save(phalcon_coroutine_context *ctx);
+void phalcon_coroutine_restore(phalcon_coroutine_context *ctx);
+
+zend_long phalcon_coroutine_create(zval *callable, zval *arguments);
+int phalcon_coroutine_wait(void);
+int phalcon_coroutine_check(void);
+void phalcon_coroutine_shutdown(void);
+
+/*
+ * Converts a timeout in seconds to lthread milliseconds, where 0 waits forever.
+ * NULL or a negative value waits forever, returns 0 when the call must not wait at all.
+ */
+static inline int phalcon_coroutine_timeout(zval *timeout, uint64_t *msecs)
+{
+	double seconds;
+
+	*msecs = 0;
+
+	if (!timeout || Z_TYPE_P(timeout) == IS_NULL) {
+		return 1;
+	}
+
+	seconds = phalcon_get_doubleval(timeout);
+	if (seconds < 0) {
+		return 1;
+	}
+
+	if (seconds == 0) {
+		return 0;
+	}
+
+	*msecs = (uint64_t) ceil(seconds * 1000);
+	return 1;
+}
+
+extern zend_class_entry *phalcon_coroutine_ce;
+
+PHALCON_INIT_CLASS(Phalcon_Coroutine);
+
+#endif
+
+#endif /* PHALCON_COROUTINE_H */
@@ -0,0 +1,343 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "coroutine/channel.h"
+#include "coroutine/exception.h"
+#include "coroutine.h"
+
+#include <stdlib.h>
+
+#include "kernel/main.h"
+#include "kernel/operators.h"
+#include "kernel/exception.h"
+
+/**
+ * Phalcon\Coroutine\Channel
+ *
+ * A bounded queue between coroutines, push() waits while it is full and pop()
+ * while it is empty, letting the other coroutines run meanwhile.
+ *
+ * When every coroutine waits on a channel without a timeout, and none sleeps or
+ * waits on a socket, nothing can wake them up anymore. The waits then throw a
+ * Phalcon\Coroutine\Exception instead of blocking the scheduler forever.
+ *
+ *<code>
+ *	$channel = new Phalcon\Coroutine\Channel(64);
+ *
+ *	Phalcon\Coroutine::go(function() use ($channel) {
+ *		while (($job = $channel->pop()) !== false) {
+ *			process($job);
+ *		}
+ *	});
+ *
+ *	Phalcon\Coroutine::go(function() use ($channel, $jobs) {
+ *		foreach ($jobs as $job) {
+ *			$channel->push($job);
+ *		}
+ *		$channel->close();
+ *	});
+ *</code>
+ */
+zend_class_entry *phalcon_coroutine_channel_ce;
+
+PHP_METHOD(Phalcon_Coroutine_Channel, __construct);
+PHP_METHOD(Phalcon_Coroutine_Channel, push);
+PHP_METHOD(Phalcon_Coroutine_Channel, pop);
+PHP_METHOD(Phalcon_Coroutine_Channel, close);
+PHP_METHOD(Phalcon_Coroutine_Channel, isClosed);
+PHP_METHOD(Phalcon_Coroutine_Channel, length);
+PHP_METHOD(Phalcon_Coroutine_Channel, getCapacity);
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_channel___construct, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, capacity, IS_LONG, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_channel_push, 0, 0, 1)
+	ZEND_ARG_INFO(0, value)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_channel_pop, 0, 0, 0)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry phalcon_coroutine_channel_method_entry[] = {
+	PHP_ME(Phalcon_Coroutine_Channel, __construct, arginfo_phalcon_coroutine_channel___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+	PHP_ME(Phalcon_Coroutine_Channel, push, arginfo_phalcon_coroutine_channel_push, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Channel, pop, arginfo_phalcon_coroutine_channel_pop, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Channel, close, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Channel, isClosed, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Channel, length, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Channel, getCapacity, NULL, ZEND_ACC_PUBLIC)
+	PHP_FE_END
+};
+
+zend_object_handlers phalcon_coroutine_channel_object_handlers;
+zend_object* phalcon_coroutine_channel_object_create_handler(zend_class_entry *ce)
+{
+	phalcon_coroutine_channel_object *intern = ecalloc(1, sizeof(phalcon_coroutine_channel_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_coroutine_channel_object_handlers;
+
+	return &intern->std;
+}
+
+void phalcon_coroutine_channel_object_free_handler(zend_object *object)
+{
+	phalcon_coroutine_channel_object *intern = phalcon_coroutine_channel_object_from_obj(object);
+	zend_long i;
+
+	if (intern->buffer) {
+		for (i = 0; i < intern->length; i++) {
+			zval_ptr_dtor(&intern->buffer[(intern->head + i) % intern->capacity]);
+		}
+		efree(intern->buffer);
+	}
+
+	/* a coroutine waiting on the channel holds a reference, so nobody is blocked here */
+	if (intern->readers) {
+		free(intern->readers);
+	}
+
+	if (intern->writers) {
+		free(intern->writers);
+	}
+
+	zend_object_std_dtor(object);
+}
+
+/**
+ * Phalcon\Coroutine\Channel initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Coroutine_Channel){
+
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT(Phalcon\\Coroutine, Channel, coroutine_channel, phalcon_coroutine_channel_method_entry, 0);
+
+	return SUCCESS;
+}
+
+/**
+ * Phalcon\Coroutine\Channel constructor
+ *
+ * @param int $capacity
+ */
+PHP_METHOD(Phalcon_Coroutine_Channel, __construct){
+
+	zval *capacity = NULL;
+	phalcon_coroutine_channel_object *intern;
+	zend_long size = 1;
+
+	phalcon_fetch_params(0, 0, 1, &capacity);
+
+	if (capacity && Z_TYPE_P(capacity) != IS_NULL) {
+		size = phalcon_get_intval(capacity);
+	}
+
+	if (size < 1) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "The capacity of a channel must be at least 1");
+		return;
+	}
+
+	intern = phalcon_coroutine_channel_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->buffer) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "The channel is already constructed");
+		return;
+	}
+
+	if (lthread_cond_create(&intern->readers) != 0 || lthread_cond_create(&intern->writers) != 0) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Unable to create the channel");
+		return;
+	}
+
+	intern->buffer = safe_emalloc(size, sizeof(zval), 0);
+	intern->capacity = size;
+}
+
+/**
+ * Appends a value, waiting up to $timeout seconds while the channel is full
+ *
+ * @param mixed $value
+ * @param float $timeout NULL waits until there is room, 0 does not wait
+ * @return boolean false when the channel is closed or the timeout expired
+ * @throws Phalcon\Coroutine\Exception on a deadlock
+ */
+PHP_METHOD(Phalcon_Coroutine_Channel, push){
+
+	zval *value, *timeout = NULL;
+	phalcon_coroutine_channel_object *intern;
+	uint64_t msecs;
+	int wait, result = 0;
+
+	phalcon_fetch_params(0, 1, 1, &value, &timeout);
+
+	intern = phalcon_coroutine_channel_object_from_obj(Z_OBJ_P(getThis()));
+	if (!intern->buffer) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "The channel is not constructed");
+		return;
+	}
+
+	wait = phalcon_coroutine_timeout(timeout, &msecs);
+
+	while (!intern->closed && intern->length == intern->capacity) {
+		if (!wait) {
+			RETURN_FALSE;
+		}
+
+		if (phalcon_coroutine_check() == FAILURE) {
+			return;
+		}
+
+		PHALCON_COROUTINE_YIELD(result = lthread_cond_wait(intern->writers, msecs));
+		if (result == -3) {
+			PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Deadlock, every coroutine is waiting on a channel without a timeout");
+			return;
+		}
+		if (result == -2) {
+			RETURN_FALSE;
+		}
+	}
+
+	if (intern->closed) {
+		RETURN_FALSE;
+	}
+
+	ZVAL_COPY(&intern->buffer[(intern->head + intern->length) % intern->capacity], value);
+	intern->length++;
+
+	lthread_cond_signal(intern->readers);
+
+	RETURN_TRUE;
+}
+
+/**
+ * Removes the oldest value, waiting up to $timeout seconds while the channel is empty
+ *
+ * @param float $timeout NULL waits for a value, 0 does not wait
+ * @return mixed false when the channel is closed and drained or the timeout expired
+ * @throws Phalcon\Coroutine\Exception on a deadlock
+ */
+PHP_METHOD(Phalcon_Coroutine_Channel, pop){
+
+	zval *timeout = NULL;
+	phalcon_coroutine_channel_object *intern;
+	uint64_t msecs;
+	int wait, result = 0;
+
+	phalcon_fetch_params(0, 0, 1, &timeout);
+
+	intern = phalcon_coroutine_channel_object_from_obj(Z_OBJ_P(getThis()));
+	if (!intern->buffer) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "The channel is not constructed");
+		return;
+	}
+
+	wait = phalcon_coroutine_timeout(timeout, &msecs);
+
+	while (intern->length == 0) {
+		if (intern->closed || !wait) {
+			RETURN_FALSE;
+		}
+
+		if (phalcon_coroutine_check() == FAILURE) {
+			return;
+		}
+
+		PHALCON_COROUTINE_YIELD(result = lthread_cond_wait(intern->readers, msecs));
+		if (result == -3) {
+			PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Deadlock, every coroutine is waiting on a channel without a timeout");
+			return;
+		}
+		if (result == -2) {
+			RETURN_FALSE;
+		}
+	}
+
+	ZVAL_COPY_VALUE(return_value, &intern->buffer[intern->head]);
+	intern->head = (intern->head + 1) % intern->capacity;
+	intern->length--;
+
+	lthread_cond_signal(intern->writers);
+}
+
+/**
+ * Closes the channel, waiting coroutines are woken up, values already pushed can still be popped
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Coroutine_Channel, close){
+
+	phalcon_coroutine_channel_object *intern;
+
+	intern = phalcon_coroutine_channel_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->closed || !intern->buffer) {
+		RETURN_FALSE;
+	}
+
+	intern->closed = 1;
+	lthread_cond_broadcast(intern->readers);
+	lthread_cond_broadcast(intern->writers);
+
+	RETURN_TRUE;
+}
+
+/**
+ * Checks whether the channel is closed
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Coroutine_Channel, isClosed){
+
+	phalcon_coroutine_channel_object *intern;
+
+	intern = phalcon_coroutine_channel_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_BOOL(intern->closed);
+}
+
+/**
+ * Returns the number of values waiting in the channel
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Coroutine_Channel, length){
+
+	phalcon_coroutine_channel_object *intern;
+
+	intern = phalcon_coroutine_channel_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_LONG(intern->length);
+}
+
+/**
+ * Returns the capacity of the channel
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Coroutine_Channel, getCapacity){
+
+	phalcon_coroutine_channel_object *intern;
+
+	intern = phalcon_coroutine_channel_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_LONG(intern->capacity);
+}
@@ -0,0 +1,52 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_COROUTINE_CHANNEL_H
+#define PHALCON_COROUTINE_CHANNEL_H
+
+#include "php_phalcon.h"
+
+#ifdef PHALCON_USE_COROUTINE
+
+#include "kernel/lthread/lthread.h"
+
+typedef struct {
+	/* ring of capacity values, length of them from head */
+	zval *buffer;
+	zend_long capacity;
+	zend_long head;
+	zend_long length;
+	lthread_cond_t *readers;
+	lthread_cond_t *writers;
+	int closed;
+	zend_object std;
+} phalcon_coroutine_channel_object;
+
+static inline phalcon_coroutine_channel_object *phalcon_coroutine_channel_object_from_obj(zend_object *obj) {
+	return (phalcon_coroutine_channel_object*)((char*)(obj) - XtOffsetOf(phalcon_coroutine_channel_object, std));
+}
+
+extern zend_class_entry *phalcon_coroutine_channel_ce;
+
+PHALCON_INIT_CLASS(Phalcon_Coroutine_Channel);
+
+#endif
+
+#endif /* PHALCON_COROUTINE_CHANNEL_H */
@@ -0,0 +1,214 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "coroutine/client.h"
+#include "coroutine/socket.h"
+#include "coroutine/exception.h"
+#include "coroutine.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "kernel/main.h"
+#include "kernel/operators.h"
+#include "kernel/exception.h"
+
+/**
+ * Phalcon\Coroutine\Client
+ *
+ * A stream socket connected on construction, the host may be an address, a name,
+ * or a path (optionally prefixed with unix://) for a unix socket
+ *
+ *<code>
+ *	Phalcon\Coroutine::run(function() {
+ *		$client = new Phalcon\Coroutine\Client('127.0.0.1', 6379, 1.5);
+ *		$client->send("PING\r\n");
+ *		echo $client->readLine();
+ *	});
+ *</code>
+ */
+zend_class_entry *phalcon_coroutine_client_ce;
+
+PHP_METHOD(Phalcon_Coroutine_Client, __construct);
+PHP_METHOD(Phalcon_Coroutine_Client, readLine);
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_client___construct, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, host, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, port, IS_LONG, 1)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_client_readline, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, length, IS_LONG, 1)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry phalcon_coroutine_client_method_entry[] = {
+	PHP_ME(Phalcon_Coroutine_Client, __construct, arginfo_phalcon_coroutine_client___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+	PHP_ME(Phalcon_Coroutine_Client, readLine, arginfo_phalcon_coroutine_client_readline, ZEND_ACC_PUBLIC)
+	PHP_FE_END
+};
+
+/**
+ * Phalcon\Coroutine\Client initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Coroutine_Client){
+
+	PHALCON_REGISTER_CLASS_EX(Phalcon\\Coroutine, Client, coroutine_client, phalcon_coroutine_socket_ce, phalcon_coroutine_client_method_entry, 0);
+
+	return SUCCESS;
+}
+
+/**
+ * Phalcon\Coroutine\Client constructor
+ *
+ * @param string $host
+ * @param int $port
+ * @param float $timeout NULL waits until the connection is made or refused
+ */
+PHP_METHOD(Phalcon_Coroutine_Client, __construct){
+
+	zval *host, *port = NULL, *timeout = NULL;
+	phalcon_coroutine_socket_object *intern;
+	struct in6_addr in6;
+	const char *address;
+	int domain = AF_INET;
+
+	phalcon_fetch_params(0, 1, 2, &host, &port, &timeout);
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+	address = Z_STRVAL_P(host);
+
+	if (!strncmp(address, "unix://", sizeof("unix://") - 1)) {
+		address += sizeof("unix://") - 1;
+		domain = AF_UNIX;
+	} else if (*address == '/') {
+		domain = AF_UNIX;
+	} else if (inet_pton(AF_INET6, address, &in6) == 1) {
+		domain = AF_INET6;
+	}
+
+	if (phalcon_coroutine_socket_open(intern, domain, SOCK_STREAM, 0) == FAILURE) {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_coroutine_exception_ce, "Unable to create the socket: %s", strerror(intern->error));
+		return;
+	}
+
+	if (phalcon_coroutine_socket_connect(intern, address, port ? phalcon_get_intval(port) : 0, timeout) == FAILURE) {
+		if (!EG(exception)) {
+			PHALCON_THROW_EXCEPTION_FORMAT(phalcon_coroutine_exception_ce, "Unable to connect to %s: %s", Z_STRVAL_P(host), strerror(intern->error));
+		}
+		return;
+	}
+}
+
+/**
+ * Reads a line, the line ending included, waiting up to $timeout seconds for each chunk
+ *
+ * Returns the pending bytes when the peer closes the connection or $length bytes are read
+ * without a line ending, false once nothing is left
+ *
+ * @param int $length
+ * @param float $timeout NULL waits for data, 0 does not wait
+ * @return string|boolean
+ */
+PHP_METHOD(Phalcon_Coroutine_Client, readLine){
+
+	zval *length = NULL, *timeout = NULL;
+	phalcon_coroutine_socket_object *intern;
+	zend_long max = 8192;
+	size_t scanned = 0, size;
+	uint64_t msecs;
+	char *eol;
+	ssize_t n;
+	int wait;
+
+	phalcon_fetch_params(0, 0, 2, &length, &timeout);
+
+	if (length && Z_TYPE_P(length) != IS_NULL) {
+		max = phalcon_get_intval(length);
+	}
+
+	if (max <= 0) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Length must be greater than zero");
+		return;
+	}
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+	wait = phalcon_coroutine_timeout(timeout, &msecs);
+
+	while (1) {
+		if (intern->buffer.s && ZSTR_LEN(intern->buffer.s) > scanned) {
+			eol = memchr(ZSTR_VAL(intern->buffer.s) + scanned, '\n', ZSTR_LEN(intern->buffer.s) - scanned);
+			if (eol) {
+				size = eol - ZSTR_VAL(intern->buffer.s) + 1;
+				break;
+			}
+			scanned = ZSTR_LEN(intern->buffer.s);
+		}
+
+		if (scanned >= (size_t) max) {
+			size = scanned;
+			break;
+		}
+
+		if (intern->fd < 0) {
+			intern->error = EBADF;
+			RETURN_FALSE;
+		}
+
+		smart_str_alloc(&intern->buffer, 4096, 0);
+		n = recv(intern->fd, ZSTR_VAL(intern->buffer.s) + ZSTR_LEN(intern->buffer.s), 4096, 0);
+		if (n > 0) {
+			ZSTR_LEN(intern->buffer.s) += n;
+			continue;
+		}
+
+		if (n == 0) {
+			if (!scanned) {
+				RETURN_FALSE;
+			}
+			size = scanned;
+			break;
+		}
+
+		if (errno == EINTR) {
+			continue;
+		}
+
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			intern->error = errno;
+			RETURN_FALSE;
+		}
+
+		if (phalcon_coroutine_socket_wait(intern, 0, wait, msecs) == FAILURE) {
+			RETURN_FALSE;
+		}
+	}
+
+	if (size > (size_t) max) {
+		size = max;
+	}
+
+	RETVAL_STRINGL(ZSTR_VAL(intern->buffer.s), size);
+
+	memmove(ZSTR_VAL(intern->buffer.s), ZSTR_VAL(intern->buffer.s) + size, ZSTR_LEN(intern->buffer.s) - size);
+	ZSTR_LEN(intern->buffer.s) -= size;
+}
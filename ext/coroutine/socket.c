@@ -0,0 +1,688 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "coroutine/socket.h"
+#include "coroutine/exception.h"
+#include "coroutine.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "kernel/main.h"
+#include "kernel/operators.h"
+#include "kernel/exception.h"
+
+#ifndef MSG_NOSIGNAL
+# define MSG_NOSIGNAL 0
+#endif
+
+/**
+ * Phalcon\Coroutine\Socket
+ *
+ * A non-blocking socket, calls that would block switch to the other coroutines
+ * until the socket is ready. Host names are resolved with getaddrinfo(), which
+ * still blocks the worker.
+ *
+ *<code>
+ *	Phalcon\Coroutine::run(function() {
+ *		$server = new Phalcon\Coroutine\Socket(Phalcon\Coroutine\Socket::AF_INET, Phalcon\Coroutine\Socket::SOCK_STREAM);
+ *		$server->bind('127.0.0.1', 9501);
+ *		$server->listen();
+ *
+ *		while ($client = $server->accept()) {
+ *			Phalcon\Coroutine::go(function($client) {
+ *				while (($data = $client->recv()) != '') {
+ *					$client->send($data);
+ *				}
+ *				$client->close();
+ *			}, [$client]);
+ *		}
+ *	});
+ *</code>
+ */
+zend_class_entry *phalcon_coroutine_socket_ce;
+
+PHP_METHOD(Phalcon_Coroutine_Socket, __construct);
+PHP_METHOD(Phalcon_Coroutine_Socket, bind);
+PHP_METHOD(Phalcon_Coroutine_Socket, listen);
+PHP_METHOD(Phalcon_Coroutine_Socket, accept);
+PHP_METHOD(Phalcon_Coroutine_Socket, connect);
+PHP_METHOD(Phalcon_Coroutine_Socket, recv);
+PHP_METHOD(Phalcon_Coroutine_Socket, send);
+PHP_METHOD(Phalcon_Coroutine_Socket, close);
+PHP_METHOD(Phalcon_Coroutine_Socket, getFd);
+PHP_METHOD(Phalcon_Coroutine_Socket, getLastError);
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_socket___construct, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, domain, IS_LONG, 1)
+	ZEND_ARG_TYPE_INFO(0, type, IS_LONG, 1)
+	ZEND_ARG_TYPE_INFO(0, protocol, IS_LONG, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_socket_bind, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, address, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, port, IS_LONG, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_socket_listen, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, backlog, IS_LONG, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_socket_accept, 0, 0, 0)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_socket_connect, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, address, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, port, IS_LONG, 1)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_socket_recv, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, length, IS_LONG, 1)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_coroutine_socket_send, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry phalcon_coroutine_socket_method_entry[] = {
+	PHP_ME(Phalcon_Coroutine_Socket, __construct, arginfo_phalcon_coroutine_socket___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
+	PHP_ME(Phalcon_Coroutine_Socket, bind, arginfo_phalcon_coroutine_socket_bind, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Socket, listen, arginfo_phalcon_coroutine_socket_listen, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Socket, accept, arginfo_phalcon_coroutine_socket_accept, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Socket, connect, arginfo_phalcon_coroutine_socket_connect, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Socket, recv, arginfo_phalcon_coroutine_socket_recv, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Socket, send, arginfo_phalcon_coroutine_socket_send, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Socket, close, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Socket, getFd, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Coroutine_Socket, getLastError, NULL, ZEND_ACC_PUBLIC)
+	PHP_FE_END
+};
+
+/* lthread_close() wakes the coroutines waiting on the fd, it needs a running scheduler */
+static void phalcon_coroutine_socket_close(phalcon_coroutine_socket_object *intern)
+{
+	if (intern->fd < 0) {
+		return;
+	}
+
+	if (PHALCON_GLOBAL(coroutine).running) {
+		lthread_close(intern->fd);
+	} else {
+		close(intern->fd);
+	}
+
+	intern->fd = -1;
+}
+
+static int phalcon_coroutine_socket_address(int domain, int type, const char *host, zend_long port, struct sockaddr_storage *addr, socklen_t *len)
+{
+	struct addrinfo hints, *res;
+
+	memset(addr, 0, sizeof(struct sockaddr_storage));
+
+	if (domain == AF_UNIX) {
+		struct sockaddr_un *un = (struct sockaddr_un *) addr;
+
+		if (strlen(host) >= sizeof(un->sun_path)) {
+			return ENAMETOOLONG;
+		}
+
+		un->sun_family = AF_UNIX;
+		strcpy(un->sun_path, host);
+		*len = sizeof(struct sockaddr_un);
+		return 0;
+	}
+
+	if (domain == AF_INET6) {
+		struct sockaddr_in6 *in6 = (struct sockaddr_in6 *) addr;
+
+		in6->sin6_family = AF_INET6;
+		in6->sin6_port = htons((unsigned short) port);
+		*len = sizeof(struct sockaddr_in6);
+
+		if (inet_pton(AF_INET6, host, &in6->sin6_addr) == 1) {
+			return 0;
+		}
+	} else {
+		struct sockaddr_in *in = (struct sockaddr_in *) addr;
+
+		in->sin_family = AF_INET;
+		in->sin_port = htons((unsigned short) port);
+		*len = sizeof(struct sockaddr_in);
+
+		if (inet_pton(AF_INET, host, &in->sin_addr) == 1) {
+			return 0;
+		}
+	}
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = domain;
+	hints.ai_socktype = type;
+
+	if (getaddrinfo(host, NULL, &hints, &res) != 0 || !res) {
+		return EHOSTUNREACH;
+	}
+
+	memcpy(addr, res->ai_addr, res->ai_addrlen);
+	*len = res->ai_addrlen;
+	freeaddrinfo(res);
+
+	if (domain == AF_INET6) {
+		((struct sockaddr_in6 *) addr)->sin6_port = htons((unsigned short) port);
+	} else {
+		((struct sockaddr_in *) addr)->sin_port = htons((unsigned short) port);
+	}
+
+	return 0;
+}
+
+int phalcon_coroutine_socket_open(phalcon_coroutine_socket_object *intern, int domain, int type, int protocol)
+{
+	intern->fd = lthread_socket(domain, type, protocol);
+	if (intern->fd < 0) {
+		intern->error = errno;
+		return FAILURE;
+	}
+
+	intern->domain = domain;
+	intern->type = type;
+
+	return SUCCESS;
+}
+
+/*
+ * Waits until the socket is readable or writable, returns FAILURE with the error
+ * set on timeout, or with an exception thrown when the call cannot wait
+ */
+int phalcon_coroutine_socket_wait(phalcon_coroutine_socket_object *intern, int write, int wait, uint64_t msecs)
+{
+	int *busy = write ? &intern->writing : &intern->reading;
+	int result;
+
+	if (!wait) {
+		intern->error = EAGAIN;
+		return FAILURE;
+	}
+
+	if (phalcon_coroutine_check() == FAILURE) {
+		return FAILURE;
+	}
+
+	/* lthread keeps a single waiter per fd and event */
+	if (*busy) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Another coroutine is already waiting on this socket");
+		return FAILURE;
+	}
+
+	*busy = 1;
+	if (write) {
+		PHALCON_COROUTINE_YIELD(result = lthread_wait_write(intern->fd, (int) msecs));
+	} else {
+		PHALCON_COROUTINE_YIELD(result = lthread_wait_read(intern->fd, (int) msecs));
+	}
+	*busy = 0;
+
+	if (result == -2) {
+		intern->error = ETIMEDOUT;
+		return FAILURE;
+	}
+
+	/* -1 reports a hang up, the next call on the socket returns it */
+	return SUCCESS;
+}
+
+int phalcon_coroutine_socket_connect(phalcon_coroutine_socket_object *intern, const char *host, zend_long port, zval *timeout)
+{
+	struct sockaddr_storage addr;
+	socklen_t len, optlen;
+	uint64_t msecs;
+	int wait, error = 0;
+
+	if (intern->fd < 0) {
+		intern->error = EBADF;
+		return FAILURE;
+	}
+
+	if ((error = phalcon_coroutine_socket_address(intern->domain, intern->type, host, port, &addr, &len)) != 0) {
+		intern->error = error;
+		return FAILURE;
+	}
+
+	if (connect(intern->fd, (struct sockaddr *) &addr, len) == 0) {
+		return SUCCESS;
+	}
+
+	if (errno != EINPROGRESS && errno != EINTR) {
+		intern->error = errno;
+		return FAILURE;
+	}
+
+	wait = phalcon_coroutine_timeout(timeout, &msecs);
+	if (phalcon_coroutine_socket_wait(intern, 1, wait, msecs) == FAILURE) {
+		return FAILURE;
+	}
+
+	optlen = sizeof(error);
+	if (intern->fd < 0) {
+		error = EBADF;
+	} else if (getsockopt(intern->fd, SOL_SOCKET, SO_ERROR, &error, &optlen) != 0) {
+		error = errno;
+	}
+
+	if (error) {
+		intern->error = error;
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+zend_object_handlers phalcon_coroutine_socket_object_handlers;
+zend_object* phalcon_coroutine_socket_object_create_handler(zend_class_entry *ce)
+{
+	phalcon_coroutine_socket_object *intern = ecalloc(1, sizeof(phalcon_coroutine_socket_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_coroutine_socket_object_handlers;
+
+	intern->fd = -1;
+
+	return &intern->std;
+}
+
+void phalcon_coroutine_socket_object_free_handler(zend_object *object)
+{
+	phalcon_coroutine_socket_object *intern = phalcon_coroutine_socket_object_from_obj(object);
+
+	phalcon_coroutine_socket_close(intern);
+	smart_str_free(&intern->buffer);
+
+	zend_object_std_dtor(object);
+}
+
+/**
+ * Phalcon\Coroutine\Socket initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Coroutine_Socket){
+
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT(Phalcon\\Coroutine, Socket, coroutine_socket, phalcon_coroutine_socket_method_entry, 0);
+
+	zend_declare_class_constant_long(phalcon_coroutine_socket_ce, SL("AF_INET"), AF_INET);
+	zend_declare_class_constant_long(phalcon_coroutine_socket_ce, SL("AF_INET6"), AF_INET6);
+	zend_declare_class_constant_long(phalcon_coroutine_socket_ce, SL("AF_UNIX"), AF_UNIX);
+	zend_declare_class_constant_long(phalcon_coroutine_socket_ce, SL("SOCK_STREAM"), SOCK_STREAM);
+	zend_declare_class_constant_long(phalcon_coroutine_socket_ce, SL("SOCK_DGRAM"), SOCK_DGRAM);
+
+	return SUCCESS;
+}
+
+/**
+ * Phalcon\Coroutine\Socket constructor
+ *
+ * @param int $domain
+ * @param int $type
+ * @param int $protocol
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, __construct){
+
+	zval *domain = NULL, *type = NULL, *protocol = NULL;
+	phalcon_coroutine_socket_object *intern;
+
+	phalcon_fetch_params(0, 0, 3, &domain, &type, &protocol);
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (phalcon_coroutine_socket_open(intern,
+			domain && Z_TYPE_P(domain) != IS_NULL ? (int) phalcon_get_intval(domain) : AF_INET,
+			type && Z_TYPE_P(type) != IS_NULL ? (int) phalcon_get_intval(type) : SOCK_STREAM,
+			protocol && Z_TYPE_P(protocol) != IS_NULL ? (int) phalcon_get_intval(protocol) : 0) == FAILURE) {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_coroutine_exception_ce, "Unable to create the socket: %s", strerror(intern->error));
+		return;
+	}
+}
+
+/**
+ * Binds the socket to an address, a path for AF_UNIX
+ *
+ * @param string $address
+ * @param int $port
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, bind){
+
+	zval *address, *port = NULL;
+	phalcon_coroutine_socket_object *intern;
+	struct sockaddr_storage addr;
+	socklen_t len;
+	int error, reuse = 1;
+
+	phalcon_fetch_params(0, 1, 1, &address, &port);
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+
+	if ((error = phalcon_coroutine_socket_address(intern->domain, intern->type, Z_STRVAL_P(address), port ? phalcon_get_intval(port) : 0, &addr, &len)) != 0) {
+		intern->error = error;
+		RETURN_FALSE;
+	}
+
+	if (intern->domain != AF_UNIX) {
+		setsockopt(intern->fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	}
+
+	if (bind(intern->fd, (struct sockaddr *) &addr, len) != 0) {
+		intern->error = errno;
+		RETURN_FALSE;
+	}
+
+	RETURN_TRUE;
+}
+
+/**
+ * Listens for connections
+ *
+ * @param int $backlog
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, listen){
+
+	zval *backlog = NULL;
+	phalcon_coroutine_socket_object *intern;
+
+	phalcon_fetch_params(0, 0, 1, &backlog);
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (listen(intern->fd, backlog && Z_TYPE_P(backlog) != IS_NULL ? (int) phalcon_get_intval(backlog) : SOMAXCONN) != 0) {
+		intern->error = errno;
+		RETURN_FALSE;
+	}
+
+	RETURN_TRUE;
+}
+
+/**
+ * Accepts a connection, waiting up to $timeout seconds for one
+ *
+ * @param float $timeout NULL waits for a connection, 0 does not wait
+ * @return Phalcon\Coroutine\Socket|boolean
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, accept){
+
+	zval *timeout = NULL;
+	phalcon_coroutine_socket_object *intern, *client;
+	uint64_t msecs;
+	int wait, fd;
+
+	phalcon_fetch_params(0, 0, 1, &timeout);
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+	wait = phalcon_coroutine_timeout(timeout, &msecs);
+
+	while (1) {
+		if (intern->fd < 0) {
+			intern->error = EBADF;
+			RETURN_FALSE;
+		}
+
+		fd = accept(intern->fd, NULL, NULL);
+		if (fd >= 0) {
+			break;
+		}
+
+		if (errno == EINTR || errno == ECONNABORTED) {
+			continue;
+		}
+
+		if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			intern->error = errno;
+			RETURN_FALSE;
+		}
+
+		if (phalcon_coroutine_socket_wait(intern, 0, wait, msecs) == FAILURE) {
+			RETURN_FALSE;
+		}
+	}
+
+	if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1) {
+		intern->error = errno;
+		close(fd);
+		RETURN_FALSE;
+	}
+
+	object_init_ex(return_value, phalcon_coroutine_socket_ce);
+
+	client = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(return_value));
+	client->fd = fd;
+	client->domain = intern->domain;
+	client->type = intern->type;
+}
+
+/**
+ * Connects the socket, waiting up to $timeout seconds
+ *
+ * @param string $address
+ * @param int $port
+ * @param float $timeout NULL waits until the connection is made or refused
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, connect){
+
+	zval *address, *port = NULL, *timeout = NULL;
+	phalcon_coroutine_socket_object *intern;
+
+	phalcon_fetch_params(0, 1, 2, &address, &port, &timeout);
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (phalcon_coroutine_socket_connect(intern, Z_STRVAL_P(address), port ? phalcon_get_intval(port) : 0, timeout) == FAILURE) {
+		RETURN_FALSE;
+	}
+
+	RETURN_TRUE;
+}
+
+/**
+ * Receives up to $length bytes, waiting up to $timeout seconds for data
+ *
+ * @param int $length
+ * @param float $timeout NULL waits for data, 0 does not wait
+ * @return string|boolean an empty string once the peer has closed the connection
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, recv){
+
+	zval *length = NULL, *timeout = NULL;
+	phalcon_coroutine_socket_object *intern;
+	zend_string *data;
+	zend_long size = 65536;
+	uint64_t msecs;
+	ssize_t n;
+	int wait;
+
+	phalcon_fetch_params(0, 0, 2, &length, &timeout);
+
+	if (length && Z_TYPE_P(length) != IS_NULL) {
+		size = phalcon_get_intval(length);
+	}
+
+	if (size <= 0) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_coroutine_exception_ce, "Length must be greater than zero");
+		return;
+	}
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+
+	/* bytes read ahead come first */
+	if (intern->buffer.s && ZSTR_LEN(intern->buffer.s)) {
+		n = MIN((size_t) size, ZSTR_LEN(intern->buffer.s));
+		RETVAL_STRINGL(ZSTR_VAL(intern->buffer.s), n);
+
+		memmove(ZSTR_VAL(intern->buffer.s), ZSTR_VAL(intern->buffer.s) + n, ZSTR_LEN(intern->buffer.s) - n);
+		ZSTR_LEN(intern->buffer.s) -= n;
+		return;
+	}
+
+	wait = phalcon_coroutine_timeout(timeout, &msecs);
+	data = zend_string_alloc(size, 0);
+
+	while (1) {
+		if (intern->fd < 0) {
+			intern->error = EBADF;
+			zend_string_free(data);
+			RETURN_FALSE;
+		}
+
+		n = recv(intern->fd, ZSTR_VAL(data), size, 0);
+		if (n >= 0) {
+			break;
+		}
+
+		if (errno == EINTR) {
+			continue;
+		}
+
+		if ((errno != EAGAIN && errno != EWOULDBLOCK) || phalcon_coroutine_socket_wait(intern, 0, wait, msecs) == FAILURE) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				intern->error = errno;
+			}
+			zend_string_free(data);
+			RETURN_FALSE;
+		}
+	}
+
+	if (n < size) {
+		data = zend_string_truncate(data, n, 0);
+	}
+	ZSTR_VAL(data)[n] = '\0';
+
+	RETURN_NEW_STR(data);
+}
+
+/**
+ * Sends the whole of $data, waiting up to $timeout seconds each time the socket buffer is full
+ *
+ * @param string $data
+ * @param float $timeout NULL waits as long as needed, 0 does not wait
+ * @return int|boolean the number of bytes sent
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, send){
+
+	zval *data, *timeout = NULL;
+	phalcon_coroutine_socket_object *intern;
+	size_t sent = 0;
+	uint64_t msecs;
+	ssize_t n;
+	int wait;
+
+	phalcon_fetch_params(0, 1, 1, &data, &timeout);
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+	wait = phalcon_coroutine_timeout(timeout, &msecs);
+
+	while (sent < Z_STRLEN_P(data)) {
+		if (intern->fd < 0) {
+			intern->error = EBADF;
+			break;
+		}
+
+		n = send(intern->fd, Z_STRVAL_P(data) + sent, Z_STRLEN_P(data) - sent, MSG_NOSIGNAL);
+		if (n > 0) {
+			sent += n;
+			continue;
+		}
+
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+
+		if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+			intern->error = errno;
+			break;
+		}
+
+		if (phalcon_coroutine_socket_wait(intern, 1, wait, msecs) == FAILURE) {
+			break;
+		}
+	}
+
+	if (!sent && Z_STRLEN_P(data)) {
+		RETURN_FALSE;
+	}
+
+	RETURN_LONG(sent);
+}
+
+/**
+ * Closes the socket, coroutines waiting on it are woken up
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, close){
+
+	phalcon_coroutine_socket_object *intern;
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->fd < 0) {
+		RETURN_FALSE;
+	}
+
+	phalcon_coroutine_socket_close(intern);
+
+	RETURN_TRUE;
+}
+
+/**
+ * Returns the file descriptor, -1 once closed
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, getFd){
+
+	phalcon_coroutine_socket_object *intern;
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_LONG(intern->fd);
+}
+
+/**
+ * Returns the errno of the last failed call, ETIMEDOUT when a timeout expired
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Coroutine_Socket, getLastError){
+
+	phalcon_coroutine_socket_object *intern;
+
+	intern = phalcon_coroutine_socket_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_LONG(intern->error);
+}
@@ -0,0 +1,58 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_COROUTINE_SOCKET_H
+#define PHALCON_COROUTINE_SOCKET_H
+
+#include "php_phalcon.h"
+
+#ifdef PHALCON_USE_COROUTINE
+
+#include <Zend/zend_smart_str.h>
+
+typedef struct {
+	int fd;
+	int domain;
+	int type;
+	/* errno of the last failed call */
+	int error;
+	/* a coroutine is waiting for the socket to become readable or writable */
+	int reading;
+	int writing;
+	/* bytes read ahead by Phalcon\Coroutine\Client::readLine() */
+	smart_str buffer;
+	zend_object std;
+} phalcon_coroutine_socket_object;
+
+static inline phalcon_coroutine_socket_object *phalcon_coroutine_socket_object_from_obj(zend_object *obj) {
+	return (phalcon_coroutine_socket_object*)((char*)(obj) - XtOffsetOf(phalcon_coroutine_socket_object, std));
+}
+
+int phalcon_coroutine_socket_open(phalcon_coroutine_socket_object *intern, int domain, int type, int protocol);
+int phalcon_coroutine_socket_connect(phalcon_coroutine_socket_object *intern, const char *host, zend_long port, zval *timeout);
+int phalcon_coroutine_socket_wait(phalcon_coroutine_socket_object *intern, int write, int wait, uint64_t msecs);
+
+extern zend_class_entry *phalcon_coroutine_socket_ce;
+
+PHALCON_INIT_CLASS(Phalcon_Coroutine_Socket);
+
+#endif
+
+#endif /* PHALCON_COROUTINE_SOCKET_H */
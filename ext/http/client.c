@@ -21,11 +21,14 @@
 #include "http/client.h"
 #include "http/client/adapter/curl.h"
 #include "http/client/adapter/stream.h"
+#include "http/client/exception.h"
 
 #include "kernel/main.h"
 #include "kernel/memory.h"
 #include "kernel/fcall.h"
 #include "kernel/object.h"
+#include "kernel/array.h"
+#include "kernel/exception.h"
 
 /**
  * Phalcon\Http\Client
@@ -34,20 +37,32 @@
  *
  *<code>
  *	$client = Phalcon\Http\Client::factory();
+ *
+ *	$responses = Phalcon\Http\Client::multi([
+ *		'user' => new Phalcon\Http\Client\Adapter\Curl('http://users.local/1'),
+ *		'cart' => 'http://cart.local/1',
+ *	], 5);
  *</code>
  *
  */
 zend_class_entry *phalcon_http_client_ce;
 
 PHP_METHOD(Phalcon_Http_Client, factory);
+PHP_METHOD(Phalcon_Http_Client, multi);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_client_factory, 0, 0, 0)
 	ZEND_ARG_INFO(0, uri)
 	ZEND_ARG_INFO(0, method)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_client_multi, 0, 0, 1)
+	ZEND_ARG_ARRAY_INFO(0, requests, 0)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry phalcon_http_client_method_entry[] = {
 	PHP_ME(Phalcon_Http_Client, factory, arginfo_phalcon_http_client_factory, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
+	PHP_ME(Phalcon_Http_Client, multi, arginfo_phalcon_http_client_multi, ZEND_ACC_PUBLIC|ZEND_ACC_STATIC)
 	PHP_FE_END
 };
 
@@ -85,3 +100,47 @@ PHP_METHOD(Phalcon_Http_Client, factory)
 		PHALCON_CALL_METHOD(NULL, return_value, "__construct", uri, &method);
 	}
 }
+
+/**
+ * Sends several requests concurrently and returns their responses with the same keys.
+ * Requests are Curl adapters or URIs (sent with GET), the total time is that of the slowest one
+ *
+ * @param array $requests
+ * @param float $timeout seconds allowed for the whole batch
+ * @return array
+ */
+PHP_METHOD(Phalcon_Http_Client, multi)
+{
+	zval *requests, *timeout = NULL, list = {}, *request;
+	zend_string *str_key;
+	zend_ulong idx;
+
+	phalcon_fetch_params(0, 1, 1, &requests, &timeout);
+
+	if (phalcon_function_exists_ex(SL("curl_multi_init")) == FAILURE) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_http_client_exception_ce, "The curl extension is required to send concurrent requests");
+		return;
+	}
+
+	array_init(&list);
+
+	ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL_P(requests), idx, str_key, request) {
+		zval adapter = {};
+
+		if (Z_TYPE_P(request) == IS_STRING) {
+			object_init_ex(&adapter, phalcon_http_client_adapter_curl_ce);
+			PHALCON_CALL_METHOD(NULL, &adapter, "__construct", request);
+		} else {
+			ZVAL_COPY(&adapter, request);
+		}
+
+		if (str_key) {
+			phalcon_array_update_string(&list, str_key, &adapter, 0);
+		} else {
+			phalcon_array_update_long(&list, idx, &adapter, 0);
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	phalcon_http_client_adapter_curl_multi(return_value, &list, timeout);
+	zval_ptr_dtor(&list);
+}
@@ -36,6 +36,9 @@
 #include "kernel/file.h"
 #include "kernel/hash.h"
 #include "kernel/string.h"
+#include "kernel/time.h"
+
+#include <unistd.h>
 
 /**
  * Phalcon\Http\Client\Adapter\Curl
@@ -59,6 +62,7 @@ PHALCON_INIT_CLASS(Phalcon_Http_Client_Adapter_Curl){
 	PHALCON_REGISTER_CLASS_EX(Phalcon\\Http\\Client\\Adapter, Curl, http_client_adapter_curl, phalcon_http_client_adapter_ce,  phalcon_http_client_adapter_curl_method_entry, 0);
 
 	zend_declare_property_null(phalcon_http_client_adapter_curl_ce, SL("_curl"), ZEND_ACC_PROTECTED);
+	zend_declare_property_null(phalcon_http_client_adapter_curl_ce, SL("_multi"), ZEND_ACC_PROTECTED|ZEND_ACC_STATIC);
 
 	zend_class_implements(phalcon_http_client_adapter_curl_ce, 1, phalcon_http_client_adapterinterface_ce);
 
@@ -123,85 +127,86 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Curl, __construct){
 	zval_ptr_dtor(&curl);
 }
 
-PHP_METHOD(Phalcon_Http_Client_Adapter_Curl, sendInternal){
-
-	zval uri = {}, url = {}, method = {}, useragent = {}, data = {}, type = {}, files = {}, timeout = {}, curl = {}, username = {}, password = {}, authtype = {};
+/**
+ * Applies the request held by an adapter to its curl handle
+ */
+static void phalcon_http_client_adapter_curl_prepare(zval *object, zval *curl)
+{
+	zval uri = {}, url = {}, method = {}, useragent = {}, data = {}, type = {}, files = {}, timeout = {}, username = {}, password = {}, authtype = {};
 	zval *constant, header = {}, *constant1, curl_data = {}, *file, body = {}, boundary = {}, *value, key = {}, key_value = {}, headers = {};
-	zval content = {}, errorno = {}, error = {}, headersize = {}, headerstr = {}, bodystr = {}, response = {};
 	zend_string *str_key;
 	ulong idx;
 
 	if ((constant = zend_get_constant_str(SL("CURLOPT_URL"))) == NULL) {
-		RETURN_FALSE;
+		return;
 	}
 
-	PHALCON_CALL_METHOD(&uri, getThis(), "geturi");
+	PHALCON_CALL_METHOD(&uri, object, "geturi");
 	PHALCON_CALL_METHOD(&url, &uri, "build");
 	zval_ptr_dtor(&uri);
 
-	phalcon_read_property(&method, getThis(), SL("_method"), PH_NOISY|PH_READONLY);
-	phalcon_read_property(&useragent, getThis(), SL("_useragent"), PH_NOISY|PH_READONLY);
-	phalcon_read_property(&data, getThis(), SL("_data"), PH_NOISY|PH_READONLY);
-	phalcon_read_property(&type, getThis(), SL("_type"), PH_NOISY|PH_READONLY);
-	phalcon_read_property(&files, getThis(), SL("_files"), PH_NOISY|PH_READONLY);
-	phalcon_read_property(&timeout, getThis(), SL("_timeout"), PH_NOISY|PH_READONLY);
-	phalcon_read_property(&curl, getThis(), SL("_curl"), PH_NOISY|PH_READONLY);
-	phalcon_read_property(&username, getThis(), SL("_username"), PH_NOISY|PH_READONLY);
-	phalcon_read_property(&password, getThis(), SL("_password"), PH_NOISY|PH_READONLY);
-	phalcon_read_property(&authtype, getThis(), SL("_authtype"), PH_NOISY|PH_READONLY);
-
-	PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &url);
+	phalcon_read_property(&method, object, SL("_method"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&useragent, object, SL("_useragent"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&data, object, SL("_data"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&type, object, SL("_type"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&files, object, SL("_files"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&timeout, object, SL("_timeout"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&username, object, SL("_username"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&password, object, SL("_password"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&authtype, object, SL("_authtype"), PH_NOISY|PH_READONLY);
+
+	PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &url);
 	zval_ptr_dtor(&url);
 
 	if ((constant = zend_get_constant_str(SL("CURLOPT_CONNECTTIMEOUT"))) != NULL) {
-		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &timeout);
+		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &timeout);
 	}
 
 	if ((constant = zend_get_constant_str(SL("CURLOPT_TIMEOUT"))) != NULL) {
-		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &timeout);
+		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &timeout);
 	}
 
 	if (PHALCON_IS_NOT_EMPTY(&method) && (constant = zend_get_constant_str(SL("CURLOPT_CUSTOMREQUEST"))) != NULL) {
-		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &method);
+		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &method);
 	}
 
 	if (PHALCON_IS_NOT_EMPTY(&useragent) && (constant = zend_get_constant_str(SL("CURLOPT_USERAGENT"))) != NULL) {
-		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &useragent);
+		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &useragent);
 	}
 
-	phalcon_read_property(&header, getThis(), SL("_header"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&header, object, SL("_header"), PH_NOISY|PH_READONLY);
 
 	if (PHALCON_IS_NOT_EMPTY(&username)) {
 		if (PHALCON_IS_STRING(&authtype, "any")) {
 			if ((constant = zend_get_constant_str(SL("CURLOPT_HTTPAUTH"))) != NULL && (constant1 = zend_get_constant_str(SL("CURLAUTH_ANY"))) != NULL) {
-				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, constant1);
+				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, constant1);
 
 				if ((constant = zend_get_constant_str(SL("CURLOPT_USERPWD"))) != NULL) {
 					zval userpwd = {};
 					PHALCON_CONCAT_VSV(&userpwd, &username, ":", &password);
-					PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &userpwd);
+					PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &userpwd);
 					zval_ptr_dtor(&userpwd);
 				}
 			}
 		} else if (PHALCON_IS_STRING(&authtype, "basic")) {
 			if ((constant = zend_get_constant_str(SL("CURLOPT_HTTPAUTH"))) != NULL && (constant1 = zend_get_constant_str(SL("CURLAUTH_BASIC"))) != NULL) {
-				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, constant1);
+				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, constant1);
 
 				if ((constant = zend_get_constant_str(SL("CURLOPT_USERPWD"))) != NULL) {
 					zval userpwd = {};
 					PHALCON_CONCAT_VSV(&userpwd, &username, ":", &password);
-					PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &userpwd);
+					PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &userpwd);
 					zval_ptr_dtor(&userpwd);
 				}
 			}
 		} else if (PHALCON_IS_STRING(&authtype, "digest")) {
 			if ((constant = zend_get_constant_str(SL("CURLOPT_HTTPAUTH"))) != NULL && (constant1 = zend_get_constant_str(SL("CURLAUTH_DIGEST"))) != NULL) {
-				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, constant1);
+				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, constant1);
 
 				if ((constant = zend_get_constant_str(SL("CURLOPT_USERPWD"))) != NULL) {
 					zval userpwd = {};
 					PHALCON_CONCAT_VSV(&userpwd, &username, ":", &password);
-					PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &userpwd);
+					PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &userpwd);
 					zval_ptr_dtor(&userpwd);
 				}
 			}
@@ -209,7 +214,7 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Curl, sendInternal){
 	}
 
 	if ((constant = zend_get_constant_str(SL("CURLOPT_SAFE_UPLOAD"))) != NULL) {
-		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &PHALCON_GLOBAL(z_true));
+		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &PHALCON_GLOBAL(z_true));
 	}
 
 	if (Z_TYPE(data) == IS_STRING && PHALCON_IS_NOT_EMPTY(&data)) {
@@ -232,7 +237,7 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Curl, sendInternal){
 		zval_ptr_dtor(&key);
 
 		if ((constant = zend_get_constant_str(SL("CURLOPT_POSTFIELDS"))) != NULL) {
-			PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &data);
+			PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &data);
 		}
 	} else if (phalcon_class_str_exists(SL("CURLFile"), 0) != NULL) {
 		if (Z_TYPE(data) != IS_ARRAY) {
@@ -257,7 +262,7 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Curl, sendInternal){
 		}
 
 		if ((constant = zend_get_constant_str(SL("CURLOPT_POSTFIELDS"))) != NULL) {
-			PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &curl_data);
+			PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &curl_data);
 		}
 		zval_ptr_dtor(&curl_data);
 	} else {
@@ -317,7 +322,7 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Curl, sendInternal){
 			zval_ptr_dtor(&key);
 			zval_ptr_dtor(&key_value);
 			if ((constant = zend_get_constant_str(SL("CURLOPT_POSTFIELDS"))) != NULL) {
-				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &body);
+				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &body);
 			}
 		}
 		zval_ptr_dtor(&boundary);
@@ -326,49 +331,268 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Curl, sendInternal){
 
 	if ((constant = zend_get_constant_str(SL("CURLOPT_HTTPHEADER"))) != NULL) {
 		PHALCON_CALL_METHOD(&headers, &header, "build");
-		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &headers);
+		PHALCON_CALL_FUNCTION(NULL, "curl_setopt", curl, constant, &headers);
 		zval_ptr_dtor(&headers);
 	}
+}
 
-	PHALCON_CALL_FUNCTION(&content, "curl_exec", &curl);
-	PHALCON_CALL_FUNCTION(&errorno, "curl_errno", &curl);
-
-	if (PHALCON_IS_TRUE(&errorno)) {
-		zval_ptr_dtor(&content);
-		PHALCON_CALL_FUNCTION(&error, "curl_error", &curl);
-		PHALCON_THROW_EXCEPTION_ZVAL(phalcon_http_client_exception_ce, &error);
-		return;
-	}
+/**
+ * Builds a response from the raw output of a finished curl handle
+ */
+static void phalcon_http_client_adapter_curl_response(zval *return_value, zval *curl, zval *content)
+{
+	zval *constant, headersize = {}, headerstr = {}, bodystr = {}, response = {};
 
 	object_init_ex(&response, phalcon_http_client_response_ce);
 	PHALCON_CALL_METHOD(NULL, &response, "__construct");
 
 	if ((constant = zend_get_constant_str(SL("CURLINFO_HTTP_CODE"))) != NULL) {
 		zval httpcode = {};
-		PHALCON_CALL_FUNCTION(&httpcode, "curl_getinfo", &curl, constant);
+		PHALCON_CALL_FUNCTION(&httpcode, "curl_getinfo", curl, constant);
 		PHALCON_CALL_METHOD(NULL, &response, "setstatuscode", &httpcode);
 		zval_ptr_dtor(&httpcode);
 	}
 
 
-	if (Z_TYPE(content) == IS_STRING) {
+	if (Z_TYPE_P(content) == IS_STRING) {
 		if ((constant = zend_get_constant_str(SL("CURLINFO_HEADER_SIZE"))) != NULL) {
-			PHALCON_CALL_FUNCTION(&headersize, "curl_getinfo", &curl, constant);
+			PHALCON_CALL_FUNCTION(&headersize, "curl_getinfo", curl, constant);
 
 			if (Z_LVAL(headersize) > 0 ) {
-				phalcon_substr(&headerstr, &content, 0 , Z_LVAL(headersize));
-				phalcon_substr(&bodystr, &content, Z_LVAL(headersize) , Z_STRLEN(content) - Z_LVAL(headersize));
+				phalcon_substr(&headerstr, content, 0 , Z_LVAL(headersize));
+				phalcon_substr(&bodystr, content, Z_LVAL(headersize) , Z_STRLEN_P(content) - Z_LVAL(headersize));
 
 				PHALCON_CALL_METHOD(NULL, &response, "setheader", &headerstr);
 				PHALCON_CALL_METHOD(NULL, &response, "setbody", &bodystr);
 				zval_ptr_dtor(&headerstr);
 				zval_ptr_dtor(&bodystr);
 			} else {
-				PHALCON_CALL_METHOD(NULL, &response, "setbody", &content);
+				PHALCON_CALL_METHOD(NULL, &response, "setbody", content);
 			}
 		}
 	}
+	RETURN_ZVAL(&response, 0, 0);
+}
+
+PHP_METHOD(Phalcon_Http_Client_Adapter_Curl, sendInternal){
+
+	zval curl = {}, content = {}, errorno = {}, error = {};
+
+	phalcon_read_property(&curl, getThis(), SL("_curl"), PH_NOISY|PH_READONLY);
+
+	phalcon_http_client_adapter_curl_prepare(getThis(), &curl);
+	if (EG(exception)) {
+		return;
+	}
+
+	PHALCON_CALL_FUNCTION(&content, "curl_exec", &curl);
+	PHALCON_CALL_FUNCTION(&errorno, "curl_errno", &curl);
+
+	if (PHALCON_IS_TRUE(&errorno)) {
+		zval_ptr_dtor(&content);
+		PHALCON_CALL_FUNCTION(&error, "curl_error", &curl);
+		PHALCON_THROW_EXCEPTION_ZVAL(phalcon_http_client_exception_ce, &error);
+		return;
+	}
+
+	phalcon_http_client_adapter_curl_response(return_value, &curl, &content);
 	zval_ptr_dtor(&content);
+}
 
-	RETURN_ZVAL(&response, 0, 0);
+static zend_ulong phalcon_http_client_adapter_curl_handle_id(zval *handle)
+{
+	return Z_TYPE_P(handle) == IS_OBJECT ? Z_OBJ_HANDLE_P(handle) : (zend_ulong) Z_RES_HANDLE_P(handle);
+}
+
+static void phalcon_http_client_adapter_curl_error(zval *return_value, zval *message, zend_long code)
+{
+	zval errorno = {};
+
+	ZVAL_LONG(&errorno, code);
+
+	object_init_ex(return_value, phalcon_http_client_exception_ce);
+	PHALCON_CALL_METHOD(NULL, return_value, "__construct", message, &errorno);
+}
+
+/**
+ * Moves the results of finished transfers from the multi handle into done, keyed by handle
+ */
+static void phalcon_http_client_adapter_curl_collect(zval *multi, zval *done)
+{
+	zval info = {}, *handle, *result;
+
+	while (1) {
+		PHALCON_CALL_FUNCTION(&info, "curl_multi_info_read", multi);
+		if (Z_TYPE(info) != IS_ARRAY) {
+			zval_ptr_dtor(&info);
+			break;
+		}
+
+		if ((handle = zend_hash_str_find(Z_ARRVAL(info), SL("handle"))) != NULL
+			&& (result = zend_hash_str_find(Z_ARRVAL(info), SL("result"))) != NULL) {
+			add_index_long(done, phalcon_http_client_adapter_curl_handle_id(handle), zval_get_long(result));
+		}
+		zval_ptr_dtor(&info);
+	}
+}
+
+/**
+ * Runs several Curl adapters concurrently on a shared multi handle. The multi
+ * handle lives for the whole PHP request, so its connection cache keeps backends
+ * alive across calls, and HTTP/2 streams to the same host share a connection when
+ * libcurl supports it. Each request keeps its own timeout, $timeout (in seconds)
+ * bounds the whole batch.
+ *
+ * Results keep the keys of $requests, failed requests get a
+ * Phalcon\Http\Client\Exception instead of a response.
+ */
+void phalcon_http_client_adapter_curl_multi(zval *return_value, zval *requests, zval *timeout)
+{
+	zval multi = {}, handles = {}, done = {}, running = {}, *request, *handle, *constant, *constant1;
+	zend_string *str_key;
+	zend_ulong idx;
+	double deadline = 0, now, wait;
+	int http2 = 0, flag;
+
+	array_init(return_value);
+
+	if (!zend_hash_num_elements(Z_ARRVAL_P(requests))) {
+		return;
+	}
+
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(requests), request) {
+		if (Z_TYPE_P(request) != IS_OBJECT || !instanceof_function(Z_OBJCE_P(request), phalcon_http_client_adapter_curl_ce)) {
+			PHALCON_THROW_EXCEPTION_STR(phalcon_http_client_exception_ce, "Requests must be instances of Phalcon\\Http\\Client\\Adapter\\Curl");
+			return;
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	phalcon_read_static_property_ce(&multi, phalcon_http_client_adapter_curl_ce, SL("_multi"), PH_COPY);
+	if (Z_TYPE(multi) == IS_NULL) {
+		PHALCON_CALL_FUNCTION(&multi, "curl_multi_init");
+
+		if ((constant = zend_get_constant_str(SL("CURLMOPT_PIPELINING"))) != NULL && (constant1 = zend_get_constant_str(SL("CURLPIPE_MULTIPLEX"))) != NULL) {
+			PHALCON_CALL_FUNCTION(NULL, "curl_multi_setopt", &multi, constant, constant1);
+		}
+
+		phalcon_update_static_property_ce(phalcon_http_client_adapter_curl_ce, SL("_multi"), &multi);
+	}
+
+	if ((constant = zend_get_constant_str(SL("CURL_VERSION_HTTP2"))) != NULL
+		&& zend_get_constant_str(SL("CURL_HTTP_VERSION_2TLS")) != NULL) {
+		zval version = {}, features = {};
+
+		PHALCON_CALL_FUNCTION(&version, "curl_version");
+		if (phalcon_array_isset_fetch_str(&features, &version, SL("features"), PH_READONLY)) {
+			http2 = (zval_get_long(&features) & Z_LVAL_P(constant)) != 0;
+		}
+		zval_ptr_dtor(&version);
+	}
+
+	array_init(&handles);
+	array_init(&done);
+
+	ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL_P(requests), idx, str_key, request) {
+		zval curl = {};
+
+		phalcon_read_property(&curl, request, SL("_curl"), PH_NOISY|PH_READONLY);
+
+		phalcon_http_client_adapter_curl_prepare(request, &curl);
+		if (EG(exception)) {
+			break;
+		}
+
+		if (http2) {
+			if ((constant = zend_get_constant_str(SL("CURLOPT_HTTP_VERSION"))) != NULL) {
+				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, zend_get_constant_str(SL("CURL_HTTP_VERSION_2TLS")));
+			}
+			// Wait for a connection able to multiplex rather than opening a new one
+			if ((constant = zend_get_constant_str(SL("CURLOPT_PIPEWAIT"))) != NULL) {
+				PHALCON_CALL_FUNCTION(NULL, "curl_setopt", &curl, constant, &PHALCON_GLOBAL(z_true));
+			}
+		}
+
+		PHALCON_CALL_FUNCTION(NULL, "curl_multi_add_handle", &multi, &curl);
+
+		if (str_key) {
+			phalcon_array_update_string(&handles, str_key, &curl, PH_COPY);
+		} else {
+			phalcon_array_update_long(&handles, idx, &curl, PH_COPY);
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	if (timeout && Z_TYPE_P(timeout) != IS_NULL) {
+		deadline = phalcon_get_microtime() + zval_get_double(timeout);
+	}
+
+	ZVAL_LONG(&running, 0);
+	ZVAL_MAKE_REF(&running);
+
+	while (!EG(exception)) {
+		zval status = {}, ready = {}, seconds = {};
+
+		PHALCON_CALL_FUNCTION_FLAG(flag, &status, "curl_multi_exec", &multi, &running);
+		zval_ptr_dtor(&status);
+		if (flag == FAILURE) {
+			break;
+		}
+
+		phalcon_http_client_adapter_curl_collect(&multi, &done);
+
+		if (zval_get_long(Z_REFVAL(running)) <= 0) {
+			break;
+		}
+
+		wait = 1.0;
+		if (deadline) {
+			now = phalcon_get_microtime();
+			if (now >= deadline) {
+				break;
+			}
+			if (deadline - now < wait) {
+				wait = deadline - now;
+			}
+		}
+
+		ZVAL_DOUBLE(&seconds, wait);
+		PHALCON_CALL_FUNCTION_FLAG(flag, &ready, "curl_multi_select", &multi, &seconds);
+
+		// No descriptor to wait on yet (e.g. resolving), avoid spinning
+		if (Z_TYPE(ready) == IS_LONG && Z_LVAL(ready) == -1) {
+			usleep(1000);
+		}
+		zval_ptr_dtor(&ready);
+	}
+	zval_ptr_dtor(&running);
+
+	ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL(handles), idx, str_key, handle) {
+		zval result = {}, *code, content = {}, error = {};
+
+		if (!EG(exception)) {
+			if ((code = zend_hash_index_find(Z_ARRVAL(done), phalcon_http_client_adapter_curl_handle_id(handle))) == NULL) {
+				ZVAL_STRING(&error, "Operation timed out");
+				phalcon_http_client_adapter_curl_error(&result, &error, 28);
+			} else if (Z_LVAL_P(code) != 0) {
+				PHALCON_CALL_FUNCTION_FLAG(flag, &error, "curl_error", handle);
+				phalcon_http_client_adapter_curl_error(&result, &error, Z_LVAL_P(code));
+			} else {
+				PHALCON_CALL_FUNCTION_FLAG(flag, &content, "curl_multi_getcontent", handle);
+				phalcon_http_client_adapter_curl_response(&result, handle, &content);
+			}
+			zval_ptr_dtor(&error);
+			zval_ptr_dtor(&content);
+
+			if (str_key) {
+				phalcon_array_update_string(return_value, str_key, &result, 0);
+			} else {
+				phalcon_array_update_long(return_value, idx, &result, 0);
+			}
+		}
+
+		PHALCON_CALL_FUNCTION_FLAG(flag, NULL, "curl_multi_remove_handle", &multi, handle);
+	} ZEND_HASH_FOREACH_END();
+
+	zval_ptr_dtor(&done);
+	zval_ptr_dtor(&handles);
+	zval_ptr_dtor(&multi);
 }
@@ -24,6 +24,8 @@
 
 extern zend_class_entry *phalcon_http_client_adapter_curl_ce;
 
+void phalcon_http_client_adapter_curl_multi(zval *return_value, zval *requests, zval *timeout);
+
 PHALCON_INIT_CLASS(Phalcon_Http_Client_Adapter_Curl);
 
 #endif /* PHALCON_HTTP_CLIENT_ADAPTER_CURL_H */
@@ -24,8 +24,11 @@
 #include "http/client/response.h"
 #include "http/client/exception.h"
 #include "http/uri.h"
+#include "http/parser/http_parser.h"
 #include "debug.h"
 
+#include <Zend/zend_smart_str.h>
+
 #include "kernel/main.h"
 #include "kernel/exception.h"
 #include "kernel/memory.h"
@@ -37,8 +40,11 @@
 #include "kernel/file.h"
 #include "kernel/hash.h"
 #include "kernel/string.h"
+#include "kernel/time.h"
 #include "kernel/debug.h"
 
+#include <ext/standard/file.h>
+
 /**
  * Phalcon\Http\Client\Adapter\Stream
  */
@@ -48,6 +54,7 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, __construct);
 PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, buildBody);
 PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, errorHandler);
 PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, sendInternal);
+PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, setKeepAlive);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_client_adapter_stream_errorhandler, 0, 0, 5)
 	ZEND_ARG_INFO(0, errno)
@@ -57,11 +64,16 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_client_adapter_stream_errorhandler,
 	ZEND_ARG_INFO(0, data)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_client_adapter_stream_setkeepalive, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, idle, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry phalcon_http_client_adapter_stream_method_entry[] = {
 	PHP_ME(Phalcon_Http_Client_Adapter_Stream, __construct, arginfo_phalcon_http_client_adapterinterface___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Http_Client_Adapter_Stream, buildBody, NULL, ZEND_ACC_PROTECTED)
 	PHP_ME(Phalcon_Http_Client_Adapter_Stream, errorHandler, arginfo_phalcon_http_client_adapter_stream_errorhandler, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Http_Client_Adapter_Stream, sendInternal, NULL, ZEND_ACC_PROTECTED)
+	PHP_ME(Phalcon_Http_Client_Adapter_Stream, setKeepAlive, arginfo_phalcon_http_client_adapter_stream_setkeepalive, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -73,12 +85,520 @@ PHALCON_INIT_CLASS(Phalcon_Http_Client_Adapter_Stream){
 	PHALCON_REGISTER_CLASS_EX(Phalcon\\Http\\Client\\Adapter, Stream, http_client_adapter_stream, phalcon_http_client_adapter_ce,  phalcon_http_client_adapter_stream_method_entry, 0);
 
 	zend_declare_property_null(phalcon_http_client_adapter_stream_ce, SL("_stream"), ZEND_ACC_PROTECTED);
+	zend_declare_property_long(phalcon_http_client_adapter_stream_ce, SL("_keepalive"), PHALCON_HTTP_CLIENT_STREAM_KEEPALIVE, ZEND_ACC_PROTECTED);
 
 	zend_class_implements(phalcon_http_client_adapter_stream_ce, 1, phalcon_http_client_adapterinterface_ce);
 
 	return SUCCESS;
 }
 
+/*
+ * Keep-alive requests are written by hand over persistent sockets and the
+ * responses read back with the bundled http_parser, which also undoes the
+ * chunked transfer coding
+ */
+typedef struct {
+	http_parser parser;
+	zval lines;
+	zval location;
+	smart_str status;
+	smart_str field;
+	smart_str value;
+	smart_str body;
+	int was_header_value;
+	int head;
+	int finished;
+	size_t received;
+} phalcon_http_client_stream_context;
+
+static void phalcon_http_client_stream_reset(phalcon_http_client_stream_context *ctx)
+{
+	zval_ptr_dtor(&ctx->lines);
+	zval_ptr_dtor(&ctx->location);
+
+	array_init(&ctx->lines);
+	ZVAL_NULL(&ctx->location);
+
+	smart_str_free(&ctx->status);
+	smart_str_free(&ctx->field);
+	smart_str_free(&ctx->value);
+	smart_str_free(&ctx->body);
+
+	ctx->was_header_value = 0;
+	ctx->finished = 0;
+}
+
+static void phalcon_http_client_stream_destroy(phalcon_http_client_stream_context *ctx)
+{
+	phalcon_http_client_stream_reset(ctx);
+	zval_ptr_dtor(&ctx->lines);
+	ZVAL_UNDEF(&ctx->lines);
+}
+
+/* The response lines are handed to Header::parse(), the status line first */
+static void phalcon_http_client_stream_header(phalcon_http_client_stream_context *ctx)
+{
+	const char *value;
+
+	if (zend_hash_num_elements(Z_ARRVAL(ctx->lines)) == 0) {
+		smart_str_0(&ctx->status);
+		add_next_index_str(&ctx->lines, strpprintf(0, "HTTP/%d.%d %d %s", ctx->parser.http_major, ctx->parser.http_minor,
+			ctx->parser.status_code, ctx->status.s ? ZSTR_VAL(ctx->status.s) : ""));
+	}
+
+	if (!ctx->field.s) {
+		return;
+	}
+
+	smart_str_0(&ctx->field);
+	smart_str_0(&ctx->value);
+	value = ctx->value.s ? ZSTR_VAL(ctx->value.s) : "";
+
+	if (!strcasecmp(ZSTR_VAL(ctx->field.s), "Location")) {
+		zval_ptr_dtor(&ctx->location);
+		ZVAL_STRING(&ctx->location, value);
+	}
+
+	add_next_index_str(&ctx->lines, strpprintf(0, "%s: %s", ZSTR_VAL(ctx->field.s), value));
+
+	smart_str_free(&ctx->field);
+	smart_str_free(&ctx->value);
+	ctx->was_header_value = 0;
+}
+
+static int phalcon_http_client_stream_on_message_begin(http_parser *p)
+{
+	/* an interim 1xx response is dropped, the final one follows */
+	phalcon_http_client_stream_reset((phalcon_http_client_stream_context *) p->data);
+	return 0;
+}
+
+static int phalcon_http_client_stream_on_status(http_parser *p, const char *at, size_t len)
+{
+	phalcon_http_client_stream_context *ctx = p->data;
+
+	smart_str_appendl(&ctx->status, at, len);
+	return 0;
+}
+
+static int phalcon_http_client_stream_on_header_field(http_parser *p, const char *at, size_t len)
+{
+	phalcon_http_client_stream_context *ctx = p->data;
+
+	if (ctx->was_header_value) {
+		phalcon_http_client_stream_header(ctx);
+	}
+
+	smart_str_appendl(&ctx->field, at, len);
+	return 0;
+}
+
+static int phalcon_http_client_stream_on_header_value(http_parser *p, const char *at, size_t len)
+{
+	phalcon_http_client_stream_context *ctx = p->data;
+
+	ctx->was_header_value = 1;
+	smart_str_appendl(&ctx->value, at, len);
+	return 0;
+}
+
+static int phalcon_http_client_stream_on_headers_complete(http_parser *p)
+{
+	phalcon_http_client_stream_context *ctx = p->data;
+
+	phalcon_http_client_stream_header(ctx);
+
+	/* responses to HEAD announce a length but carry no body */
+	return ctx->head ? 1 : 0;
+}
+
+static int phalcon_http_client_stream_on_body(http_parser *p, const char *at, size_t len)
+{
+	phalcon_http_client_stream_context *ctx = p->data;
+
+	smart_str_appendl(&ctx->body, at, len);
+	return 0;
+}
+
+static int phalcon_http_client_stream_on_message_complete(http_parser *p)
+{
+	phalcon_http_client_stream_context *ctx = p->data;
+
+	if (p->status_code >= 200) {
+		ctx->finished = 1;
+		http_parser_pause(p, 1);
+	}
+
+	return 0;
+}
+
+/* Whether the header lines set by the user already carry the field */
+static int phalcon_http_client_stream_has_header(zval *headers, const char *name, size_t len)
+{
+	const char *p, *end;
+
+	if (Z_TYPE_P(headers) != IS_STRING) {
+		return 0;
+	}
+
+	p = Z_STRVAL_P(headers);
+	end = p + Z_STRLEN_P(headers);
+
+	while (p && p < end) {
+		if ((size_t) (end - p) > len && !strncasecmp(p, name, len) && p[len] == ':') {
+			return 1;
+		}
+		if ((p = memchr(p, '\n', end - p)) != NULL) {
+			p++;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Closes every pooled socket idle for longer than the keepalive it was released with
+ */
+static void phalcon_http_client_stream_sweep(HashTable *pool, double now)
+{
+	zend_string *id;
+	zval *deadline;
+	php_stream *stream;
+
+	ZEND_HASH_FOREACH_STR_KEY_VAL(pool, id, deadline) {
+		if (id && Z_DVAL_P(deadline) < now) {
+			if (php_stream_from_persistent_id(ZSTR_VAL(id), &stream) == PHP_STREAM_PERSISTENT_SUCCESS) {
+				php_stream_pclose(stream);
+			}
+			zend_hash_del(pool, id);
+		}
+	} ZEND_HASH_FOREACH_END();
+}
+
+/*
+ * Sends one request and parses its response into ctx. Connections are
+ * persistent streams keyed by scheme, host and port, the time until which
+ * each released one may be reused is kept in PHALCON_GLOBAL(http).pool.
+ * Every request first closes the sockets idle past that time, whatever their
+ * host, so idle connections to hosts no longer contacted do not linger. TLS
+ * connections stay established between requests, so the handshake is only
+ * paid when a socket is opened.
+ */
+static int phalcon_http_client_stream_exchange(phalcon_http_client_stream_context *ctx, zval *context, zval *uri, zval *method,
+	zval *headers, zval *content, zend_long keepalive, zend_long timeout)
+{
+	zval parts = {}, scheme = {}, host = {}, port = {}, path = {}, query = {}, tmp = {}, stamp = {};
+	http_parser_settings settings;
+	php_stream *stream;
+	zend_string *key, *address, *errstr = NULL;
+	smart_str request = {0};
+	struct timeval tv;
+	HashTable *pool;
+	char buf[8192];
+	zend_long portno;
+	int secure = 0, reused = 0, leftover, attempt, err = 0, status = FAILURE;
+
+	phalcon_read_property(&parts, uri, SL("_parts"), PH_NOISY|PH_READONLY);
+
+	if (phalcon_array_isset_fetch_str(&scheme, &parts, SL("scheme"), PH_READONLY) && Z_TYPE(scheme) == IS_STRING && Z_STRLEN(scheme)) {
+		if (zend_string_equals_literal_ci(Z_STR(scheme), "https")) {
+			secure = 1;
+		} else if (!zend_string_equals_literal_ci(Z_STR(scheme), "http")) {
+			zend_throw_exception_ex(phalcon_http_client_exception_ce, 0, "Unsupported scheme '%s'", Z_STRVAL(scheme));
+			return FAILURE;
+		}
+	}
+
+	if (!phalcon_array_isset_fetch_str(&host, &parts, SL("host"), PH_READONLY) || Z_TYPE(host) != IS_STRING || !Z_STRLEN(host)) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_http_client_exception_ce, "The URI has no host");
+		return FAILURE;
+	}
+
+	if (phalcon_array_isset_fetch_str(&port, &parts, SL("port"), PH_READONLY) && PHALCON_IS_NOT_EMPTY(&port)) {
+		portno = phalcon_get_intval(&port);
+	} else {
+		portno = secure ? 443 : 80;
+	}
+
+	smart_str_append(&request, Z_STR_P(method));
+	smart_str_appendc(&request, ' ');
+
+	if (phalcon_array_isset_fetch_str(&path, &parts, SL("path"), PH_READONLY) && Z_TYPE(path) == IS_STRING && Z_STRLEN(path)) {
+		if (Z_STRVAL(path)[0] != '/') {
+			smart_str_appendc(&request, '/');
+		}
+		smart_str_append(&request, Z_STR(path));
+	} else {
+		smart_str_appendc(&request, '/');
+	}
+
+	if (phalcon_array_isset_fetch_str(&query, &parts, SL("query"), PH_READONLY) && PHALCON_IS_NOT_EMPTY(&query)) {
+		if (Z_TYPE(query) == IS_ARRAY) {
+			phalcon_http_build_query(&tmp, &query, "&");
+		} else {
+			ZVAL_COPY(&tmp, &query);
+			convert_to_string(&tmp);
+		}
+		smart_str_appendc(&request, '?');
+		smart_str_append(&request, Z_STR(tmp));
+		zval_ptr_dtor(&tmp);
+	}
+
+	smart_str_appends(&request, " HTTP/1.1\r\n");
+
+	/* a Host or Connection set by the user is sent as is, never twice */
+	if (!phalcon_http_client_stream_has_header(headers, SL("Host"))) {
+		smart_str_appends(&request, "Host: ");
+		smart_str_append(&request, Z_STR(host));
+		if (portno != (secure ? 443 : 80)) {
+			smart_str_appendc(&request, ':');
+			smart_str_append_long(&request, portno);
+		}
+		smart_str_appends(&request, "\r\n");
+	}
+	if (!phalcon_http_client_stream_has_header(headers, SL("Connection"))) {
+		smart_str_appends(&request, "Connection: keep-alive\r\n");
+	}
+
+	if (Z_TYPE_P(headers) == IS_STRING && Z_STRLEN_P(headers)) {
+		smart_str_append(&request, Z_STR_P(headers));
+		smart_str_appends(&request, "\r\n");
+	}
+	smart_str_appends(&request, "\r\n");
+
+	if (Z_TYPE_P(content) == IS_STRING) {
+		smart_str_append(&request, Z_STR_P(content));
+	}
+	smart_str_0(&request);
+
+	key = strpprintf(0, "phalcon_http_client_%s_%s_" ZEND_LONG_FMT, secure ? "https" : "http", Z_STRVAL(host), portno);
+	address = strpprintf(0, "%s://%s:" ZEND_LONG_FMT, secure ? "ssl" : "tcp", Z_STRVAL(host), portno);
+
+	if (!PHALCON_GLOBAL(http).pool) {
+		pool = pemalloc(sizeof(HashTable), 1);
+		zend_hash_init(pool, 8, NULL, NULL, 1);
+		PHALCON_GLOBAL(http).pool = pool;
+	}
+	pool = PHALCON_GLOBAL(http).pool;
+
+	phalcon_http_client_stream_sweep(pool, phalcon_get_microtime());
+	reused = zend_hash_exists(pool, key);
+
+	memset(&settings, 0, sizeof(settings));
+	settings.on_message_begin = phalcon_http_client_stream_on_message_begin;
+	settings.on_status = phalcon_http_client_stream_on_status;
+	settings.on_header_field = phalcon_http_client_stream_on_header_field;
+	settings.on_header_value = phalcon_http_client_stream_on_header_value;
+	settings.on_headers_complete = phalcon_http_client_stream_on_headers_complete;
+	settings.on_body = phalcon_http_client_stream_on_body;
+	settings.on_message_complete = phalcon_http_client_stream_on_message_complete;
+
+	tv.tv_sec = timeout > 0 ? timeout : (zend_long) FG(default_socket_timeout);
+	tv.tv_usec = 0;
+
+	for (attempt = 0; attempt < 2; attempt++) {
+		/* an existing socket is checked for liveness before being handed back */
+		stream = php_stream_xport_create(ZSTR_VAL(address), ZSTR_LEN(address), 0, STREAM_XPORT_CLIENT | STREAM_XPORT_CONNECT,
+			ZSTR_VAL(key), &tv, php_stream_context_from_zval(context, 0), &errstr, &err);
+
+		if (!stream) {
+			zend_throw_exception_ex(phalcon_http_client_exception_ce, err, "Unable to connect to %s (%s)", ZSTR_VAL(address), (errstr == NULL ? "Unknown error" : ZSTR_VAL(errstr)));
+			break;
+		}
+
+		php_stream_set_option(stream, PHP_STREAM_OPTION_READ_TIMEOUT, 0, &tv);
+
+		phalcon_http_client_stream_reset(ctx);
+		http_parser_init(&ctx->parser, HTTP_RESPONSE);
+		ctx->parser.data = ctx;
+		ctx->received = 0;
+		leftover = 0;
+
+		if ((size_t) php_stream_write(stream, ZSTR_VAL(request.s), ZSTR_LEN(request.s)) == ZSTR_LEN(request.s)) {
+			while (!ctx->finished) {
+				ssize_t n = (ssize_t) php_stream_read(stream, buf, sizeof(buf));
+				size_t parsed;
+
+				if (n <= 0) {
+					/* a body delimited by the end of the connection completes here */
+					http_parser_execute(&ctx->parser, &settings, NULL, 0);
+					break;
+				}
+
+				ctx->received += n;
+				parsed = http_parser_execute(&ctx->parser, &settings, buf, n);
+
+				if (ctx->finished) {
+					leftover = parsed < (size_t) n;
+				} else if (HTTP_PARSER_ERRNO(&ctx->parser) != HPE_OK) {
+					break;
+				}
+			}
+		}
+
+		if (ctx->finished) {
+			if (keepalive > 0 && !leftover && http_should_keep_alive(&ctx->parser)) {
+				ZVAL_DOUBLE(&stamp, phalcon_get_microtime() + (double) keepalive);
+				zend_hash_str_update(pool, ZSTR_VAL(key), ZSTR_LEN(key), &stamp);
+			} else {
+				php_stream_pclose(stream);
+				zend_hash_str_del(pool, ZSTR_VAL(key), ZSTR_LEN(key));
+			}
+			status = SUCCESS;
+			break;
+		}
+
+		php_stream_pclose(stream);
+		zend_hash_str_del(pool, ZSTR_VAL(key), ZSTR_LEN(key));
+
+		/* the server may have closed a pooled socket while it was idle, that is retried once on a new one */
+		if (!reused || ctx->received) {
+			if (HTTP_PARSER_ERRNO(&ctx->parser) != HPE_OK) {
+				zend_throw_exception_ex(phalcon_http_client_exception_ce, 0, "Invalid response from %s (%s)", ZSTR_VAL(address), http_errno_description(HTTP_PARSER_ERRNO(&ctx->parser)));
+			} else {
+				zend_throw_exception_ex(phalcon_http_client_exception_ce, 0, "Connection to %s closed before the response was complete", ZSTR_VAL(address));
+			}
+			break;
+		}
+
+		reused = 0;
+	}
+
+	if (errstr) {
+		zend_string_release(errstr);
+	}
+	zend_string_release(address);
+	zend_string_release(key);
+	smart_str_free(&request);
+
+	return status;
+}
+
+/*
+ * Honours follow_location, max_redirects and ignore_errors the way the http:// wrapper does
+ */
+static void phalcon_http_client_adapter_stream_send(zval *return_value, zval *object, zval *context, zval *uri, zval *options, zend_long keepalive, zend_long timeout)
+{
+	zval header = {}, method = {}, current = {}, headers = {}, content = {}, response = {}, body = {}, key = {}, flags = {}, value = {}, *line;
+	phalcon_http_client_stream_context ctx;
+	zend_long max_redirects = PHALCON_HTTP_CLIENT_STREAM_MAX_REDIRECTS;
+	int redirects = 0, code, flag, follow_location = 1, ignore_errors = 0;
+
+	if (phalcon_array_isset_fetch_str(&value, options, SL("follow_location"), PH_READONLY)) {
+		follow_location = zend_is_true(&value);
+	}
+
+	if (phalcon_array_isset_fetch_str(&value, options, SL("max_redirects"), PH_READONLY)) {
+		max_redirects = phalcon_get_intval(&value);
+	}
+
+	/* a limit of 1 or less follows nothing */
+	if (max_redirects <= 1) {
+		follow_location = 0;
+	}
+
+	if (phalcon_array_isset_fetch_str(&value, options, SL("ignore_errors"), PH_READONLY)) {
+		ignore_errors = zend_is_true(&value);
+	}
+
+	phalcon_read_property(&header, object, SL("_header"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&method, object, SL("_method"), PH_NOISY|PH_COPY);
+
+	ZVAL_COPY(&current, uri);
+
+	if (!phalcon_array_isset_fetch_str(&headers, options, SL("header"), PH_COPY)) {
+		ZVAL_EMPTY_STRING(&headers);
+	}
+
+	if (!phalcon_array_isset_fetch_str(&content, options, SL("content"), PH_COPY)) {
+		ZVAL_NULL(&content);
+	}
+
+	memset(&ctx, 0, sizeof(ctx));
+
+	while (1) {
+		ctx.head = PHALCON_IS_STRING(&method, "HEAD");
+
+		if (phalcon_http_client_stream_exchange(&ctx, context, &current, &method, &headers, &content, keepalive, timeout) == FAILURE) {
+			break;
+		}
+
+		code = ctx.parser.status_code;
+
+		if (follow_location && Z_TYPE(ctx.location) == IS_STRING && ((code >= 300 && code < 304) || code == 307 || code == 308)) {
+			zval next = {};
+
+			if (++redirects >= max_redirects) {
+				PHALCON_THROW_EXCEPTION_STR(phalcon_http_client_exception_ce, "Redirection limit reached, aborting");
+				break;
+			}
+
+			PHALCON_CALL_METHOD_FLAG(flag, &next, &current, "resolve", &ctx.location);
+			if (flag == FAILURE) {
+				break;
+			}
+
+			zval_ptr_dtor(&current);
+			ZVAL_COPY_VALUE(&current, &next);
+
+			/* a 303, or a 301/302 answering a POST, is followed with a GET */
+			if (code == 303 || ((code == 301 || code == 302) && PHALCON_IS_STRING(&method, "POST"))) {
+				zval_ptr_dtor(&method);
+				ZVAL_STRING(&method, "GET");
+
+				zval_ptr_dtor(&content);
+				ZVAL_NULL(&content);
+
+				ZVAL_STRING(&key, "Content-Type");
+				PHALCON_CALL_METHOD_FLAG(flag, NULL, &header, "remove", &key);
+				zval_ptr_dtor(&key);
+
+				ZVAL_STRING(&key, "Content-Length");
+				PHALCON_CALL_METHOD_FLAG(flag, NULL, &header, "remove", &key);
+				zval_ptr_dtor(&key);
+
+				zval_ptr_dtor(&headers);
+				ZVAL_LONG(&flags, PHALCON_HTTP_CLIENT_HEADER_BUILD_FIELDS);
+				PHALCON_CALL_METHOD_FLAG(flag, &headers, &header, "build", &flags);
+				if (flag == FAILURE) {
+					break;
+				}
+			}
+			continue;
+		}
+
+		/* errors are thrown like the warning of the wrapper through errorHandler() */
+		if (code >= 400 && !ignore_errors) {
+			line = zend_hash_index_find(Z_ARRVAL(ctx.lines), 0);
+			zend_throw_exception_ex(phalcon_http_client_exception_ce, 0, "HTTP request failed! %s", line ? Z_STRVAL_P(line) : "");
+			break;
+		}
+
+		object_init_ex(&response, phalcon_http_client_response_ce);
+		PHALCON_CALL_METHOD_FLAG(flag, NULL, &response, "__construct");
+		PHALCON_CALL_METHOD_FLAG(flag, NULL, &response, "setheader", &ctx.lines);
+
+		smart_str_0(&ctx.body);
+		if (ctx.body.s) {
+			ZVAL_STR_COPY(&body, ctx.body.s);
+		} else {
+			ZVAL_EMPTY_STRING(&body);
+		}
+
+		PHALCON_CALL_METHOD_FLAG(flag, NULL, &response, "setbody", &body);
+		zval_ptr_dtor(&body);
+
+		ZVAL_COPY_VALUE(return_value, &response);
+		break;
+	}
+
+	phalcon_http_client_stream_destroy(&ctx);
+	zval_ptr_dtor(&current);
+	zval_ptr_dtor(&method);
+	zval_ptr_dtor(&headers);
+	zval_ptr_dtor(&content);
+}
+
 PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, __construct){
 
 	zval *uri = NULL, *method = NULL, header = {}, stream = {}, http = {}, option = {}, value = {};
@@ -350,18 +870,17 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, errorHandler)
 
 PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, sendInternal)
 {
-	zval stream = {}, header = {}, method = {}, useragent = {}, timeout = {}, uri = {}, url = {}, http = {}, option = {}, handler = {};
-	zval fp = {}, meta = {}, wrapper_data = {}, bodystr = {}, response = {};
+	zval stream = {}, header = {}, method = {}, useragent = {}, timeout = {}, keepalive = {}, uri = {}, url = {}, http = {}, option = {}, handler = {};
+	zval fp = {}, meta = {}, wrapper_data = {}, bodystr = {}, response = {}, options = {}, http_options = {};
 
 	phalcon_read_property(&stream, getThis(), SL("_stream"), PH_NOISY|PH_READONLY);
 	phalcon_read_property(&header, getThis(), SL("_header"), PH_NOISY|PH_READONLY);
 	phalcon_read_property(&method, getThis(), SL("_method"), PH_NOISY|PH_READONLY);
 	phalcon_read_property(&useragent, getThis(), SL("_useragent"), PH_NOISY|PH_READONLY);
 	phalcon_read_property(&timeout, getThis(), SL("_timeout"), PH_NOISY|PH_READONLY);
+	phalcon_read_property(&keepalive, getThis(), SL("_keepalive"), PH_NOISY|PH_READONLY);
 
 	PHALCON_CALL_METHOD(&uri, getThis(), "geturi");
-	PHALCON_CALL_METHOD(&url, &uri, "build");
-	zval_ptr_dtor(&uri);
 
 	ZVAL_STRING(&http, "http");
 	ZVAL_STRING(&option, "method");
@@ -382,6 +901,39 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, sendInternal)
 
 	PHALCON_CALL_SELF(NULL, "buildBody");
 
+	/* requests through a proxy, or in HTTP/1.0, are left to the http:// wrapper */
+	if (phalcon_get_intval(&keepalive) > 0) {
+		zval value = {};
+		int pooled = 1;
+
+		PHALCON_CALL_FUNCTION(&options, "stream_context_get_options", &stream);
+
+		if (phalcon_array_isset_fetch_str(&http_options, &options, SL("http"), PH_READONLY)) {
+			if (phalcon_array_isset_str(&http_options, SL("proxy"))) {
+				pooled = 0;
+			} else if (phalcon_array_isset_fetch_str(&value, &http_options, SL("request_fulluri"), PH_READONLY) && zend_is_true(&value)) {
+				pooled = 0;
+			} else if (phalcon_array_isset_fetch_str(&value, &http_options, SL("protocol_version"), PH_READONLY) && phalcon_get_doubleval(&value) < 1.1) {
+				pooled = 0;
+			}
+		} else {
+			ZVAL_NULL(&http_options);
+		}
+
+		if (pooled) {
+			phalcon_http_client_adapter_stream_send(return_value, getThis(), &stream, &uri, &http_options, phalcon_get_intval(&keepalive), phalcon_get_intval(&timeout));
+			zval_ptr_dtor(&options);
+			zval_ptr_dtor(&uri);
+			zval_ptr_dtor(&http);
+			zval_ptr_dtor(&option);
+			return;
+		}
+		zval_ptr_dtor(&options);
+	}
+
+	PHALCON_CALL_METHOD(&url, &uri, "build");
+	zval_ptr_dtor(&uri);
+
 	array_init_size(&handler, 2);
 	phalcon_array_append(&handler, getThis(), PH_COPY);
 	add_next_index_stringl(&handler, SL("errorHandler"));
@@ -408,3 +960,25 @@ PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, sendInternal)
 
 	RETURN_CTOR(&response);
 }
+
+/**
+ * Sets how long, in seconds, a pooled connection may stay idle before it is closed,
+ * 0 (the default) opens a new connection for every request through the http:// wrapper
+ *
+ * Pooled requests speak HTTP/1.1 over persistent sockets and honour the follow_location,
+ * max_redirects and ignore_errors context options. Requests through a proxy, with
+ * request_fulluri or with a protocol_version below 1.1 keep using the wrapper
+ *
+ * @param int $idle
+ * @return Phalcon\Http\Client\Adapter\Stream
+ */
+PHP_METHOD(Phalcon_Http_Client_Adapter_Stream, setKeepAlive){
+
+	zval *idle;
+
+	phalcon_fetch_params(0, 1, 0, &idle);
+
+	phalcon_update_property(getThis(), SL("_keepalive"), idle);
+
+	RETURN_THIS();
+}
@@ -22,6 +22,10 @@
 
 #include "php_phalcon.h"
 
+/* Seconds a pooled connection may stay idle before it is dropped, 0 disables the pool */
+#define PHALCON_HTTP_CLIENT_STREAM_KEEPALIVE     0
+#define PHALCON_HTTP_CLIENT_STREAM_MAX_REDIRECTS 20
+
 extern zend_class_entry *phalcon_http_client_adapter_stream_ce;
 
 PHALCON_INIT_CLASS(Phalcon_Http_Client_Adapter_Stream);
@@ -18,8 +18,13 @@
 
 #include "http/parser.h"
 #include "http/parser/http_parser.h"
+#include "http/parser/multipart.h"
 
 #include <ext/standard/url.h>
+#include <main/php_open_temporary_file.h>
+
+#include <errno.h>
+#include <unistd.h>
 
 #include "kernel/main.h"
 #include "kernel/memory.h"
@@ -38,11 +43,31 @@
  *	$parser = new Phalcon\Http\Parser(Phalcon\Http\Parser::TYPE_BOTH);
  *  $result = $parser->execute($body);
  *</code>
+ *
+ * Messages can also be streamed, the body is then handed to callbacks as it
+ * arrives instead of being returned, and multipart/form-data bodies are split
+ * into parts which may be spilled to temporary files:
+ *
+ *<code>
+ *	$parser = new Phalcon\Http\Parser(Phalcon\Http\Parser::TYPE_REQUEST);
+ *	$parser->setSpill(1048576);
+ *	$parser->on(Phalcon\Http\Parser::ON_PART, function($part) {
+ *		if (isset($part['tmp_name'])) {
+ *			rename($part['tmp_name'], '/uploads/' . basename($part['filename']));
+ *		}
+ *	});
+ *	while (($chunk = fread($socket, 65536)) != '') {
+ *		$parser->feed($chunk);
+ *	}
+ *</code>
  */
 zend_class_entry *phalcon_http_parser_ce;
 
 PHP_METHOD(Phalcon_Http_Parser, __construct);
 PHP_METHOD(Phalcon_Http_Parser, execute);
+PHP_METHOD(Phalcon_Http_Parser, on);
+PHP_METHOD(Phalcon_Http_Parser, feed);
+PHP_METHOD(Phalcon_Http_Parser, setSpill);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_parser___construct, 0, 0, 0)
 	ZEND_ARG_TYPE_INFO(0, type, IS_LONG, 1)
@@ -52,9 +77,26 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_parser_execute, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, body, IS_STRING, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_parser_on, 0, 0, 2)
+	ZEND_ARG_TYPE_INFO(0, event, IS_LONG, 0)
+	ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_parser_feed, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_http_parser_setspill, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, threshold, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, dir, IS_STRING, 1)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry phalcon_http_parser_method_entry[] = {
 	PHP_ME(Phalcon_Http_Parser, __construct, arginfo_phalcon_http_parser___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Http_Parser, execute, arginfo_phalcon_http_parser_execute, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Http_Parser, on, arginfo_phalcon_http_parser_on, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Http_Parser, feed, arginfo_phalcon_http_parser_feed, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Http_Parser, setSpill, arginfo_phalcon_http_parser_setspill, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -176,18 +218,439 @@ static int phalcon_on_body_cb(http_parser *p, const char *at, size_t len)
 	return 0;
 }
 
+/* Streaming callbacks, state lives in the parser object */
+static int phalcon_http_parser_invoke(phalcon_http_parser_object *intern, phalcon_http_parser_cb_type type, zval *arg)
+{
+	zval retval = {};
+	int flag;
+
+	if (Z_TYPE(intern->callbacks[type]) == IS_NULL) {
+		return 0;
+	}
+
+	PHALCON_CALL_USER_FUNC_FLAG(flag, &retval, &intern->callbacks[type], arg);
+
+	/* returning false stops the parser */
+	if (flag != SUCCESS || EG(exception) || Z_TYPE(retval) == IS_FALSE) {
+		zval_ptr_dtor(&retval);
+		return -1;
+	}
+
+	zval_ptr_dtor(&retval);
+	return 0;
+}
+
+static int phalcon_http_parser_write(int fd, const char *at, size_t length)
+{
+	while (length > 0) {
+		ssize_t n = write(fd, at, length);
+
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+
+		at += n;
+		length -= n;
+	}
+
+	return 0;
+}
+
+/* Drops the part being read, a temporary file still in place is removed */
+static void phalcon_http_parser_part_reset(phalcon_http_parser_object *intern)
+{
+	zval_ptr_dtor(&intern->part);
+	ZVAL_UNDEF(&intern->part);
+
+	smart_str_free(&intern->part_data);
+
+	if (intern->part_fd >= 0) {
+		close(intern->part_fd);
+		intern->part_fd = -1;
+	}
+
+	if (intern->part_path) {
+		VCWD_UNLINK(ZSTR_VAL(intern->part_path));
+		zend_string_release(intern->part_path);
+		intern->part_path = NULL;
+	}
+
+	intern->part_size = 0;
+}
+
+static void phalcon_http_parser_message_reset(phalcon_http_parser_object *intern)
+{
+	zval_ptr_dtor(&intern->headers);
+	array_init(&intern->headers);
+
+	smart_str_free(&intern->url);
+	smart_str_free(&intern->field);
+	smart_str_free(&intern->value);
+
+	if (intern->content_type) {
+		zend_string_release(intern->content_type);
+		intern->content_type = NULL;
+	}
+
+	intern->multipart = 0;
+	phalcon_http_parser_part_reset(intern);
+}
+
+/* Finds a parameter of a header value such as boundary="..." or name="..." */
+static int phalcon_http_parser_param(const char *s, size_t length, const char *key, size_t key_length, const char **value, size_t *value_length)
+{
+	const char *end = s + length, *p = s, *q;
+
+	while (p < end) {
+		p = memchr(p, ';', end - p);
+		if (!p) {
+			return 0;
+		}
+
+		do {
+			p++;
+		} while (p < end && (*p == ' ' || *p == '\t'));
+
+		if ((size_t) (end - p) > key_length && !strncasecmp(p, key, key_length) && p[key_length] == '=') {
+			p += key_length + 1;
+
+			if (p < end && *p == '"') {
+				p++;
+				q = memchr(p, '"', end - p);
+				if (!q) {
+					return 0;
+				}
+			} else {
+				for (q = p; q < end && *q != ';' && *q != ' ' && *q != '\t'; q++);
+			}
+
+			*value = p;
+			*value_length = q - p;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int phalcon_http_parser_part_headers(phalcon_http_multipart *m, const char *at, size_t length)
+{
+	phalcon_http_parser_object *intern = m->data;
+	const char *end = at + length, *line = at, *eol, *colon, *value, *param;
+	size_t value_length, param_length;
+	zval headers = {};
+
+	phalcon_http_parser_part_reset(intern);
+
+	array_init(&intern->part);
+	array_init(&headers);
+	add_assoc_null(&intern->part, "name");
+
+	while (line < end) {
+		eol = zend_memnstr(line, "\r\n", 2, end);
+		if (!eol) {
+			eol = end;
+		}
+
+		colon = memchr(line, ':', eol - line);
+		if (colon) {
+			for (value = colon + 1; value < eol && (*value == ' ' || *value == '\t'); value++);
+			value_length = eol - value;
+
+			add_assoc_stringl_ex(&headers, line, colon - line, (char *) value, value_length);
+
+			if ((size_t) (colon - line) == sizeof("Content-Disposition") - 1 && !strncasecmp(line, "Content-Disposition", colon - line)) {
+				if (phalcon_http_parser_param(value, value_length, SL("name"), &param, &param_length)) {
+					add_assoc_stringl(&intern->part, "name", (char *) param, param_length);
+				}
+				if (phalcon_http_parser_param(value, value_length, SL("filename"), &param, &param_length)) {
+					add_assoc_stringl(&intern->part, "filename", (char *) param, param_length);
+				}
+			} else if ((size_t) (colon - line) == sizeof("Content-Type") - 1 && !strncasecmp(line, "Content-Type", colon - line)) {
+				add_assoc_stringl(&intern->part, "type", (char *) value, value_length);
+			}
+		}
+
+		line = eol + 2;
+	}
+
+	add_assoc_zval(&intern->part, "headers", &headers);
+	return 0;
+}
+
+static int phalcon_http_parser_part_data(phalcon_http_multipart *m, const char *at, size_t length)
+{
+	phalcon_http_parser_object *intern = m->data;
+	int result;
+
+	intern->part_size += length;
+
+	if (intern->part_fd >= 0) {
+		return phalcon_http_parser_write(intern->part_fd, at, length);
+	}
+
+	smart_str_appendl(&intern->part_data, at, length);
+
+	if (intern->spill >= 0 && ZSTR_LEN(intern->part_data.s) > (size_t) intern->spill) {
+		intern->part_fd = php_open_temporary_fd(intern->spill_dir ? ZSTR_VAL(intern->spill_dir) : NULL, "php", &intern->part_path);
+		if (intern->part_fd < 0) {
+			php_error_docref(NULL, E_WARNING, "Unable to create a temporary file for a multipart body");
+			return -1;
+		}
+
+		result = phalcon_http_parser_write(intern->part_fd, ZSTR_VAL(intern->part_data.s), ZSTR_LEN(intern->part_data.s));
+		smart_str_free(&intern->part_data);
+		return result;
+	}
+
+	return 0;
+}
+
+static int phalcon_http_parser_part_complete(phalcon_http_multipart *m)
+{
+	phalcon_http_parser_object *intern = m->data;
+	int result;
+
+	if (intern->part_fd >= 0) {
+		close(intern->part_fd);
+		intern->part_fd = -1;
+		add_assoc_str(&intern->part, "tmp_name", zend_string_copy(intern->part_path));
+	} else if (intern->part_data.s) {
+		smart_str_0(&intern->part_data);
+		add_assoc_str(&intern->part, "data", intern->part_data.s);
+		intern->part_data.s = NULL;
+		intern->part_data.a = 0;
+	} else {
+		add_assoc_stringl(&intern->part, "data", "", 0);
+	}
+
+	add_assoc_long(&intern->part, "size", intern->part_size);
+
+	/* a temporary file the callback did not move is removed right after */
+	result = phalcon_http_parser_invoke(intern, PHALCON_HTTP_PARSER_ON_PART, &intern->part);
+	phalcon_http_parser_part_reset(intern);
+
+	return result;
+}
+
+static const phalcon_http_multipart_settings phalcon_http_parser_multipart_settings = {
+	phalcon_http_parser_part_headers,
+	phalcon_http_parser_part_data,
+	phalcon_http_parser_part_complete,
+	NULL
+};
+
+static void phalcon_http_parser_stream_header(phalcon_http_parser_object *intern)
+{
+	zval value = {};
+
+	if (!intern->field.s) {
+		return;
+	}
+
+	smart_str_0(&intern->field);
+
+	if (intern->value.s) {
+		smart_str_0(&intern->value);
+		ZVAL_STR(&value, intern->value.s);
+		intern->value.s = NULL;
+		intern->value.a = 0;
+	} else {
+		ZVAL_EMPTY_STRING(&value);
+	}
+
+	if (!strcasecmp(ZSTR_VAL(intern->field.s), "Content-Type")) {
+		if (intern->content_type) {
+			zend_string_release(intern->content_type);
+		}
+		intern->content_type = zend_string_copy(Z_STR(value));
+	}
+
+	phalcon_array_update_string(&intern->headers, intern->field.s, &value, 0);
+	smart_str_free(&intern->field);
+}
+
+static int phalcon_http_parser_stream_message_begin(http_parser *p)
+{
+	phalcon_http_parser_message_reset(p->data);
+	return 0;
+}
+
+static int phalcon_http_parser_stream_url(http_parser *p, const char *at, size_t len)
+{
+	phalcon_http_parser_object *intern = p->data;
+
+	smart_str_appendl(&intern->url, at, len);
+	return 0;
+}
+
+static int phalcon_http_parser_stream_header_field(http_parser *p, const char *at, size_t len)
+{
+	phalcon_http_parser_object *intern = p->data;
+
+	if (intern->value.s) {
+		phalcon_http_parser_stream_header(intern);
+	}
+
+	smart_str_appendl(&intern->field, at, len);
+	return 0;
+}
+
+static int phalcon_http_parser_stream_header_value(http_parser *p, const char *at, size_t len)
+{
+	phalcon_http_parser_object *intern = p->data;
+
+	smart_str_appendl(&intern->value, at, len);
+	return 0;
+}
+
+static int phalcon_http_parser_stream_headers_complete(http_parser *p)
+{
+	phalcon_http_parser_object *intern = p->data;
+	zval info = {};
+	const char *boundary;
+	size_t boundary_length;
+	char version[4] = {0};
+	int result;
+
+	phalcon_http_parser_stream_header(intern);
+
+	snprintf(version, 4, "%d.%d", p->http_major, p->http_minor);
+	phalcon_array_update_str_str(&intern->headers, SL("VERSION"), version, 3, PH_COPY);
+
+	array_init(&info);
+	if (p->type == HTTP_REQUEST) {
+		add_assoc_string(&info, "REQUEST_METHOD", (char*)http_method_str(p->method));
+	} else {
+		add_assoc_long(&info, "STATUS_CODE", (long)p->status_code);
+	}
+
+	if (intern->url.s) {
+		smart_str_0(&intern->url);
+		add_assoc_str(&info, "QUERY_STRING", zend_string_copy(intern->url.s));
+	}
+
+	add_assoc_long(&info, "UPGRADE", (long)p->upgrade);
+	phalcon_array_update_str(&info, SL("HEADERS"), &intern->headers, PH_COPY);
+
+	/* without a part callback a multipart body is streamed as is */
+	if (Z_TYPE(intern->callbacks[PHALCON_HTTP_PARSER_ON_PART]) != IS_NULL && intern->content_type
+		&& ZSTR_LEN(intern->content_type) > sizeof("multipart/") - 1 && !strncasecmp(ZSTR_VAL(intern->content_type), "multipart/", sizeof("multipart/") - 1)
+		&& phalcon_http_parser_param(ZSTR_VAL(intern->content_type), ZSTR_LEN(intern->content_type), SL("boundary"), &boundary, &boundary_length)
+		&& phalcon_http_multipart_init(&intern->scanner, boundary, boundary_length) == 0) {
+		intern->scanner.data = intern;
+		intern->multipart = 1;
+	}
+
+	result = phalcon_http_parser_invoke(intern, PHALCON_HTTP_PARSER_ON_HEADERS, &info);
+	zval_ptr_dtor(&info);
+
+	return result;
+}
+
+static int phalcon_http_parser_stream_body(http_parser *p, const char *at, size_t len)
+{
+	phalcon_http_parser_object *intern = p->data;
+	zval chunk = {};
+	int result;
+
+	if (intern->multipart) {
+		if (phalcon_http_multipart_execute(&intern->scanner, &phalcon_http_parser_multipart_settings, at, len) != len) {
+			return -1;
+		}
+		return 0;
+	}
+
+	if (Z_TYPE(intern->callbacks[PHALCON_HTTP_PARSER_ON_BODY]) == IS_NULL) {
+		return 0;
+	}
+
+	ZVAL_STRINGL(&chunk, at, len);
+	result = phalcon_http_parser_invoke(intern, PHALCON_HTTP_PARSER_ON_BODY, &chunk);
+	zval_ptr_dtor(&chunk);
+
+	return result;
+}
+
+static int phalcon_http_parser_stream_message_complete(http_parser *p)
+{
+	phalcon_http_parser_object *intern = p->data;
+	int result;
+
+	/* a part cut short by the end of the message is dropped */
+	phalcon_http_parser_part_reset(intern);
+
+	result = phalcon_http_parser_invoke(intern, PHALCON_HTTP_PARSER_ON_COMPLETE, &intern->headers);
+	intern->multipart = 0;
+
+	return result;
+}
+
+zend_object_handlers phalcon_http_parser_object_handlers;
+zend_object* phalcon_http_parser_object_create_handler(zend_class_entry *ce)
+{
+	int i;
+	phalcon_http_parser_object *intern = ecalloc(1, sizeof(phalcon_http_parser_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_http_parser_object_handlers;
+
+	http_parser_init(&intern->parser, HTTP_REQUEST);
+
+	for (i = 0; i < PHALCON_HTTP_PARSER_CB_COUNT; ++i) {
+		ZVAL_NULL(&intern->callbacks[i]);
+	}
+
+	array_init(&intern->headers);
+	ZVAL_UNDEF(&intern->part);
+	intern->part_fd = -1;
+	intern->spill = -1;
+
+	return &intern->std;
+}
+
+void phalcon_http_parser_object_free_handler(zend_object *object)
+{
+	phalcon_http_parser_object *intern;
+	int i;
+	intern = phalcon_http_parser_object_from_obj(object);
+
+	for (i = 0; i < PHALCON_HTTP_PARSER_CB_COUNT; ++i) {
+		zval_ptr_dtor(&intern->callbacks[i]);
+	}
+
+	phalcon_http_parser_message_reset(intern);
+	zval_ptr_dtor(&intern->headers);
+
+	if (intern->spill_dir) {
+		zend_string_release(intern->spill_dir);
+	}
+
+	zend_object_std_dtor(object);
+}
+
 /**
  * Phalcon\Http\Parser initializer
  */
 PHALCON_INIT_CLASS(Phalcon_Http_Parser){
 
-	PHALCON_REGISTER_CLASS(Phalcon\\Http, Parser, http_parser, phalcon_http_parser_method_entry, 0);
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT(Phalcon\\Http, Parser, http_parser, phalcon_http_parser_method_entry, 0);
 
 	zend_declare_property_long(phalcon_http_parser_ce, SL("_type"), HTTP_REQUEST, ZEND_ACC_PROTECTED);
 
 	zend_declare_class_constant_long(phalcon_http_parser_ce, SL("TYPE_REQUEST"), HTTP_REQUEST);
 	zend_declare_class_constant_long(phalcon_http_parser_ce, SL("HTTP_RESPONSE"), HTTP_RESPONSE);
 	zend_declare_class_constant_long(phalcon_http_parser_ce, SL("TYPE_BOTH"), HTTP_BOTH);
+
+	zend_declare_class_constant_long(phalcon_http_parser_ce, SL("ON_HEADERS"), PHALCON_HTTP_PARSER_ON_HEADERS);
+	zend_declare_class_constant_long(phalcon_http_parser_ce, SL("ON_BODY"), PHALCON_HTTP_PARSER_ON_BODY);
+	zend_declare_class_constant_long(phalcon_http_parser_ce, SL("ON_PART"), PHALCON_HTTP_PARSER_ON_PART);
+	zend_declare_class_constant_long(phalcon_http_parser_ce, SL("ON_COMPLETE"), PHALCON_HTTP_PARSER_ON_COMPLETE);
 	return SUCCESS;
 }
 
@@ -208,6 +671,7 @@ PHP_METHOD(Phalcon_Http_Parser, __construct)
 			case HTTP_RESPONSE:
 			case HTTP_BOTH:
 				phalcon_update_property(getThis(), SL("_type"), type);
+				http_parser_init(&phalcon_http_parser_object_from_obj(Z_OBJ_P(getThis()))->parser, Z_LVAL_P(type));
 				break;
 			default:
 				break;
@@ -287,3 +751,105 @@ PHP_METHOD(Phalcon_Http_Parser, execute){
 	phalcon_array_update_str(return_value, SL("HEADERS"), &ctx->headers, PH_COPY);
 	efree(ctx);
 }
+
+/**
+ * Registers a streaming callback
+ *
+ * ON_HEADERS receives the message information once its headers are parsed,
+ * ON_BODY each chunk of a body, ON_PART each part of a multipart body
+ * (name, filename, type, headers, size and either data or tmp_name) and
+ * ON_COMPLETE the headers once the message is over. A callback returning
+ * false stops the parser.
+ *
+ * @param int $event
+ * @param callable $callback
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Http_Parser, on)
+{
+	zval *ev, *callback;
+	phalcon_http_parser_object *intern;
+	zend_long event;
+
+	phalcon_fetch_params(0, 2, 0, &ev, &callback);
+
+	event = phalcon_get_intval(ev);
+	if (event < 0 || event >= PHALCON_HTTP_PARSER_CB_COUNT) {
+		php_error_docref(NULL, E_WARNING, "Try to add an invalid event callback");
+		RETURN_FALSE;
+	}
+
+	intern = phalcon_http_parser_object_from_obj(Z_OBJ_P(getThis()));
+
+	zval_ptr_dtor(&intern->callbacks[event]);
+	ZVAL_COPY(&intern->callbacks[event], callback);
+
+	RETURN_TRUE;
+}
+
+/**
+ * Parses the next chunk of a stream, an empty string signals the end of the connection
+ *
+ * @param string $data
+ * @return int|boolean the number of bytes parsed, false on error
+ */
+PHP_METHOD(Phalcon_Http_Parser, feed)
+{
+	zval *data;
+	phalcon_http_parser_object *intern;
+	http_parser_settings settings;
+	size_t nparsed;
+
+	phalcon_fetch_params(0, 1, 0, &data);
+
+	intern = phalcon_http_parser_object_from_obj(Z_OBJ_P(getThis()));
+
+	memset(&settings, 0, sizeof(settings));
+	settings.on_message_begin = phalcon_http_parser_stream_message_begin;
+	settings.on_url = phalcon_http_parser_stream_url;
+	settings.on_header_field = phalcon_http_parser_stream_header_field;
+	settings.on_header_value = phalcon_http_parser_stream_header_value;
+	settings.on_headers_complete = phalcon_http_parser_stream_headers_complete;
+	settings.on_body = phalcon_http_parser_stream_body;
+	settings.on_message_complete = phalcon_http_parser_stream_message_complete;
+
+	intern->parser.data = intern;
+	nparsed = http_parser_execute(&intern->parser, &settings, Z_STRVAL_P(data), Z_STRLEN_P(data));
+
+	if (HTTP_PARSER_ERRNO(&intern->parser) != HPE_OK) {
+		RETURN_FALSE;
+	}
+
+	RETURN_LONG(nparsed);
+}
+
+/**
+ * Spills multipart parts to temporary files once they grow over $threshold bytes,
+ * -1 keeps every part in memory
+ *
+ * @param int $threshold
+ * @param string $dir
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Http_Parser, setSpill)
+{
+	zval *threshold, *dir = NULL;
+	phalcon_http_parser_object *intern;
+
+	phalcon_fetch_params(0, 1, 1, &threshold, &dir);
+
+	intern = phalcon_http_parser_object_from_obj(Z_OBJ_P(getThis()));
+
+	intern->spill = phalcon_get_intval(threshold);
+
+	if (intern->spill_dir) {
+		zend_string_release(intern->spill_dir);
+		intern->spill_dir = NULL;
+	}
+
+	if (dir && Z_TYPE_P(dir) == IS_STRING && Z_STRLEN_P(dir)) {
+		intern->spill_dir = zend_string_copy(Z_STR_P(dir));
+	}
+
+	RETURN_TRUE;
+}
@@ -21,6 +21,45 @@
 #define PHALCON_HTTP_PARSER_H
 
 #include "php_phalcon.h"
+#include "http/parser/http_parser.h"
+#include "http/parser/multipart.h"
+
+#include <Zend/zend_smart_str.h>
+
+typedef enum {
+	PHALCON_HTTP_PARSER_ON_HEADERS = 0,
+	PHALCON_HTTP_PARSER_ON_BODY,
+	PHALCON_HTTP_PARSER_ON_PART,
+	PHALCON_HTTP_PARSER_ON_COMPLETE,
+	PHALCON_HTTP_PARSER_CB_COUNT
+} phalcon_http_parser_cb_type;
+
+typedef struct {
+	http_parser parser;
+	zval callbacks[PHALCON_HTTP_PARSER_CB_COUNT];
+	/* message being streamed */
+	zval headers;
+	smart_str url;
+	smart_str field;
+	smart_str value;
+	zend_string *content_type;
+	int multipart;
+	phalcon_http_multipart scanner;
+	/* part being streamed */
+	zval part;
+	smart_str part_data;
+	int part_fd;
+	zend_string *part_path;
+	size_t part_size;
+	/* parts growing over spill bytes go to a temporary file, -1 keeps them in memory */
+	zend_long spill;
+	zend_string *spill_dir;
+	zend_object std;
+} phalcon_http_parser_object;
+
+static inline phalcon_http_parser_object *phalcon_http_parser_object_from_obj(zend_object *obj) {
+	return (phalcon_http_parser_object*)((char*)(obj) - XtOffsetOf(phalcon_http_parser_object, std));
+}
 
 extern zend_class_entry *phalcon_http_parser_ce;
 
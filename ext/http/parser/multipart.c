@@ -0,0 +1,234 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "http/parser/multipart.h"
+
+#include <string.h>
+
+enum state {
+	s_preamble = 0,
+	s_part_data,
+	s_boundary_end,
+	s_boundary_dash,
+	s_boundary_cr,
+	s_headers,
+	s_epilogue,
+	s_error
+};
+
+#define MULTIPART_FAIL(m, pos) \
+	do { \
+		(m)->state = s_error; \
+		return (pos); \
+	} while (0)
+
+/*
+ * Looks for the delimiter in a chunk, passing the bytes before it to on_data
+ * (inside a part) or dropping them (preamble). A delimiter cut by the end of
+ * the chunk is held back in m->matched; since it is a prefix of the delimiter
+ * itself it can be replayed from there if the next chunk does not complete it.
+ * Boundaries cannot contain CR, so memchr() on '\r' finds every candidate.
+ */
+static int multipart_scan(phalcon_http_multipart *m, const phalcon_http_multipart_settings *settings, const char *data, size_t length, size_t *consumed, int *found)
+{
+	phalcon_http_multipart_data_cb on_data = m->state == s_part_data ? settings->on_data : NULL;
+	size_t pos = 0, start, at, k;
+	const char *cr;
+
+	*found = 0;
+
+	if (m->matched) {
+		while (m->matched < m->delimiter_len && pos < length && data[pos] == m->delimiter[m->matched]) {
+			m->matched++;
+			pos++;
+		}
+
+		if (m->matched == m->delimiter_len) {
+			m->matched = 0;
+			*found = 1;
+			*consumed = pos;
+			return 0;
+		}
+
+		if (pos == length) {
+			*consumed = length;
+			return 0;
+		}
+
+		/* the held back bytes were part of the data after all */
+		if (on_data && on_data(m, m->delimiter, m->matched)) {
+			return -1;
+		}
+		m->matched = 0;
+	}
+
+	start = pos;
+	while (pos < length && (cr = memchr(data + pos, '\r', length - pos)) != NULL) {
+		at = cr - data;
+
+		for (k = 0; k < m->delimiter_len && at + k < length && data[at + k] == m->delimiter[k]; k++);
+
+		if (k == m->delimiter_len || at + k == length) {
+			if (on_data && at > start && on_data(m, data + start, at - start)) {
+				return -1;
+			}
+
+			if (k == m->delimiter_len) {
+				*found = 1;
+			} else {
+				m->matched = k;
+			}
+
+			*consumed = at + k;
+			return 0;
+		}
+
+		pos = at + 1;
+	}
+
+	if (on_data && length > start && on_data(m, data + start, length - start)) {
+		return -1;
+	}
+
+	*consumed = length;
+	return 0;
+}
+
+int phalcon_http_multipart_init(phalcon_http_multipart *m, const char *boundary, size_t length)
+{
+	if (length == 0 || length > PHALCON_HTTP_MULTIPART_MAX_BOUNDARY || memchr(boundary, '\r', length)) {
+		return -1;
+	}
+
+	memcpy(m->delimiter, "\r\n--", 4);
+	memcpy(m->delimiter + 4, boundary, length);
+	m->delimiter_len = length + 4;
+
+	/* the first delimiter may open the body, as if the CRLF before it had been seen */
+	m->matched = 2;
+	m->state = s_preamble;
+	m->headers_len = 0;
+
+	return 0;
+}
+
+size_t phalcon_http_multipart_execute(phalcon_http_multipart *m, const phalcon_http_multipart_settings *settings, const char *data, size_t length)
+{
+	size_t pos = 0, consumed;
+	int found;
+	char c;
+
+	while (pos < length) {
+		switch (m->state) {
+			case s_preamble:
+			case s_part_data:
+				if (multipart_scan(m, settings, data + pos, length - pos, &consumed, &found)) {
+					MULTIPART_FAIL(m, pos);
+				}
+				pos += consumed;
+
+				if (found) {
+					if (m->state == s_part_data && settings->on_part_complete && settings->on_part_complete(m)) {
+						MULTIPART_FAIL(m, pos);
+					}
+					m->state = s_boundary_end;
+				}
+				break;
+
+			case s_boundary_end:
+				c = data[pos++];
+				if (c == '-') {
+					m->state = s_boundary_dash;
+				} else if (c == '\r') {
+					m->state = s_boundary_cr;
+				} else if (c != ' ' && c != '\t') {
+					/* only transport padding may follow a boundary */
+					MULTIPART_FAIL(m, pos - 1);
+				}
+				break;
+
+			case s_boundary_dash:
+				if (data[pos++] != '-') {
+					MULTIPART_FAIL(m, pos - 1);
+				}
+
+				m->state = s_epilogue;
+				if (settings->on_complete && settings->on_complete(m)) {
+					MULTIPART_FAIL(m, pos);
+				}
+				break;
+
+			case s_boundary_cr:
+				if (data[pos++] != '\n') {
+					MULTIPART_FAIL(m, pos - 1);
+				}
+
+				m->state = s_headers;
+				m->headers_len = 0;
+				break;
+
+			case s_headers:
+				if (m->headers_len == PHALCON_HTTP_MULTIPART_MAX_HEADERS) {
+					MULTIPART_FAIL(m, pos);
+				}
+
+				c = data[pos++];
+				m->headers[m->headers_len++] = c;
+
+				if (c != '\n') {
+					break;
+				}
+
+				if (m->headers_len == 2 && m->headers[0] == '\r') {
+					m->headers_len = 0;
+				} else if (m->headers_len >= 4 && !memcmp(m->headers + m->headers_len - 4, "\r\n\r\n", 4)) {
+					m->headers_len -= 4;
+				} else {
+					break;
+				}
+
+				if (settings->on_headers && settings->on_headers(m, m->headers, m->headers_len)) {
+					MULTIPART_FAIL(m, pos);
+				}
+
+				m->state = s_part_data;
+				m->matched = 0;
+				break;
+
+			case s_epilogue:
+				return length;
+
+			default:
+				return pos;
+		}
+	}
+
+	return pos;
+}
+
+int phalcon_http_multipart_is_complete(const phalcon_http_multipart *m)
+{
+	return m->state == s_epilogue;
+}
+
+int phalcon_http_multipart_has_failed(const phalcon_http_multipart *m)
+{
+	return m->state == s_error;
+}
@@ -0,0 +1,65 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_HTTP_PARSER_MULTIPART_H
+#define PHALCON_HTTP_PARSER_MULTIPART_H
+
+#include <stddef.h>
+
+/* RFC 2046 limits boundaries to 70 characters */
+#define PHALCON_HTTP_MULTIPART_MAX_BOUNDARY 70
+#define PHALCON_HTTP_MULTIPART_MAX_HEADERS  8192
+
+typedef struct phalcon_http_multipart phalcon_http_multipart;
+typedef struct phalcon_http_multipart_settings phalcon_http_multipart_settings;
+
+/* Callbacks return 0 to go on, anything else aborts the scan */
+typedef int (*phalcon_http_multipart_data_cb) (phalcon_http_multipart *m, const char *at, size_t length);
+typedef int (*phalcon_http_multipart_cb) (phalcon_http_multipart *m);
+
+struct phalcon_http_multipart {
+	/* "\r\n--" followed by the boundary */
+	char delimiter[4 + PHALCON_HTTP_MULTIPART_MAX_BOUNDARY];
+	size_t delimiter_len;
+	/* bytes of the delimiter matched at the end of the previous chunk */
+	size_t matched;
+	int state;
+	char headers[PHALCON_HTTP_MULTIPART_MAX_HEADERS];
+	size_t headers_len;
+	void *data;
+};
+
+struct phalcon_http_multipart_settings {
+	/* the header block of a part, lines separated by CRLF, without the blank line */
+	phalcon_http_multipart_data_cb on_headers;
+	phalcon_http_multipart_data_cb on_data;
+	phalcon_http_multipart_cb on_part_complete;
+	phalcon_http_multipart_cb on_complete;
+};
+
+int phalcon_http_multipart_init(phalcon_http_multipart *m, const char *boundary, size_t length);
+
+/* Returns the number of bytes consumed, less than length on error */
+size_t phalcon_http_multipart_execute(phalcon_http_multipart *m, const phalcon_http_multipart_settings *settings, const char *data, size_t length);
+
+int phalcon_http_multipart_is_complete(const phalcon_http_multipart *m);
+int phalcon_http_multipart_has_failed(const phalcon_http_multipart *m);
+
+#endif /* PHALCON_HTTP_PARSER_MULTIPART_H */
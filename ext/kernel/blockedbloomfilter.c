@@ -0,0 +1,407 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          Vladimir Kolesnikov <vladimir@extrememember.com>              |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "kernel/blockedbloomfilter.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9) || defined(__clang__))
+# define PHALCON_BLOCKED_BLOOMFILTER_AVX2 1
+# include <immintrin.h>
+#endif
+
+/* 每个字一个奇数乘子，乘积的高 6 位即该字中的比特位置 */
+static const uint32_t __blocked_bloomfilter_salt[PHALCON_BLOCKED_BLOOMFILTER_BLOCK_WORDS] = {
+	0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+	0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+static zend_always_inline void __blocked_bloomfilter_mask(uint32_t hash, uint64_t *mask)
+{
+	int i;
+	for (i = 0; i < PHALCON_BLOCKED_BLOOMFILTER_BLOCK_WORDS; i++) {
+		mask[i] = ((uint64_t)1) << ((hash * __blocked_bloomfilter_salt[i]) >> 26);
+	}
+}
+
+static int __blocked_bloomfilter_probe_scalar(const uint64_t *block, uint32_t hash)
+{
+	uint64_t mask[PHALCON_BLOCKED_BLOOMFILTER_BLOCK_WORDS];
+	int i;
+
+	__blocked_bloomfilter_mask(hash, mask);
+	for (i = 0; i < PHALCON_BLOCKED_BLOOMFILTER_BLOCK_WORDS; i++) {
+		if ((block[i] & mask[i]) != mask[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+#ifdef PHALCON_BLOCKED_BLOOMFILTER_AVX2
+__attribute__((target("avx2")))
+static int __blocked_bloomfilter_probe_avx2(const uint64_t *block, uint32_t hash)
+{
+	const __m256i salt = _mm256_loadu_si256((const __m256i *)__blocked_bloomfilter_salt);
+	const __m256i one = _mm256_set1_epi64x(1);
+	__m256i pos, mask_lo, mask_hi;
+
+	/* 8 个比特位置一次算出，再扩展成两组 4 x 64 位掩码 */
+	pos = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((int)hash), salt), 26);
+	mask_lo = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(pos)));
+	mask_hi = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(pos, 1)));
+
+	return _mm256_testc_si256(_mm256_load_si256((const __m256i *)block), mask_lo)
+		&& _mm256_testc_si256(_mm256_load_si256((const __m256i *)(block + 4)), mask_hi);
+}
+#endif
+
+static int (*__blocked_bloomfilter_probe)(const uint64_t *block, uint32_t hash) = NULL;
+
+static void __blocked_bloomfilter_select(void)
+{
+	if (__blocked_bloomfilter_probe) {
+		return;
+	}
+#ifdef PHALCON_BLOCKED_BLOOMFILTER_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		__blocked_bloomfilter_probe = __blocked_bloomfilter_probe_avx2;
+		return;
+	}
+#endif
+	__blocked_bloomfilter_probe = __blocked_bloomfilter_probe_scalar;
+}
+
+int phalcon_blocked_bloomfilter_simd(void)
+{
+	__blocked_bloomfilter_select();
+#ifdef PHALCON_BLOCKED_BLOOMFILTER_AVX2
+	return __blocked_bloomfilter_probe == __blocked_bloomfilter_probe_avx2;
+#else
+	return 0;
+#endif
+}
+
+static zend_always_inline uint64_t __blocked_bloomfilter_calc(uint32_t max_items, double false_positive)
+{
+	double bits;
+	uint64_t blocks;
+
+	/* k 固定为 8，按标准公式估算比特数，分块会抬高误报率，多留 20% 后向上取整到块 */
+	bits = ceil(-1 * log(false_positive) * max_items / 0.4805 * 1.2);
+	blocks = (uint64_t)ceil(bits / (PHALCON_BLOCKED_BLOOMFILTER_BLOCK_SIZE * 8));
+
+	return blocks > 0 ? blocks : 1;
+}
+
+static zend_always_inline size_t __blocked_bloomfilter_size(uint64_t blocks)
+{
+	return sizeof(phalcon_blocked_bloomfilter_head) + blocks * PHALCON_BLOCKED_BLOOMFILTER_BLOCK_SIZE;
+}
+
+static void __blocked_bloomfilter_head_init(phalcon_blocked_bloomfilter_head *head, uint64_t blocks, uint32_t seed, uint32_t max_items, double false_positive)
+{
+	memset(head, 0, sizeof(phalcon_blocked_bloomfilter_head));
+	head->version = PHALCON_BLOCKED_BLOOMFILTER_VERSION;
+	head->blocks = blocks;
+	head->max_items = max_items;
+	head->seed = seed;
+	head->false_positive = false_positive;
+	head->count = 0;
+	/* 魔数最后写入，其他进程看到魔数时头部已完整 */
+	__sync_synchronize();
+	head->file_magic_code = PHALCON_BLOCKED_BLOOMFILTER_FILE_MAGIC_CODE;
+}
+
+static int __blocked_bloomfilter_head_valid(const phalcon_blocked_bloomfilter_head *head, size_t size)
+{
+	return head->file_magic_code == PHALCON_BLOCKED_BLOOMFILTER_FILE_MAGIC_CODE
+		&& head->version == PHALCON_BLOCKED_BLOOMFILTER_VERSION
+		&& head->blocks > 0
+		&& __blocked_bloomfilter_size(head->blocks) <= size;
+}
+
+static void __blocked_bloomfilter_attach(phalcon_blocked_bloomfilter *bloomfilter, void *mem, size_t size, int storage)
+{
+	bloomfilter->mem = mem;
+	bloomfilter->size = size;
+	bloomfilter->storage = storage;
+	bloomfilter->head = (phalcon_blocked_bloomfilter_head *)mem;
+	bloomfilter->data = (uint64_t *)((char *)mem + sizeof(phalcon_blocked_bloomfilter_head));
+}
+
+int phalcon_blocked_bloomfilter_init(phalcon_blocked_bloomfilter *bloomfilter, uint32_t seed, uint32_t max_items, double false_positive)
+{
+	uint64_t blocks;
+	size_t size;
+	void *mem;
+
+	if (bloomfilter == NULL || max_items == 0 || (false_positive <= 0) || (false_positive >= 1))
+		return -1;
+
+	phalcon_blocked_bloomfilter_free(bloomfilter);
+	__blocked_bloomfilter_select();
+
+	blocks = __blocked_bloomfilter_calc(max_items, false_positive);
+	size = __blocked_bloomfilter_size(blocks);
+
+	/* 块按缓存行对齐，AVX2 使用对齐加载 */
+	if (posix_memalign(&mem, PHALCON_BLOCKED_BLOOMFILTER_BLOCK_SIZE, size) != 0)
+		return -1;
+
+	memset(mem, 0, size);
+	__blocked_bloomfilter_attach(bloomfilter, mem, size, PHALCON_BLOCKED_BLOOMFILTER_STORAGE_MEMORY);
+	__blocked_bloomfilter_head_init(bloomfilter->head, blocks, seed, max_items, false_positive);
+	return 0;
+}
+
+int phalcon_blocked_bloomfilter_open_file(phalcon_blocked_bloomfilter *bloomfilter, const char *filename, uint32_t seed, uint32_t max_items, double false_positive)
+{
+	struct stat st;
+	uint64_t blocks = 0;
+	size_t size;
+	void *mem;
+	int fd, created = 0, ret = -1;
+
+	if (bloomfilter == NULL || filename == NULL || max_items == 0 || (false_positive <= 0) || (false_positive >= 1))
+		return -1;
+
+	phalcon_blocked_bloomfilter_free(bloomfilter);
+	__blocked_bloomfilter_select();
+
+	fd = open(filename, O_RDWR | O_CREAT, 0666);
+	if (fd < 0) {
+		return -1;
+	}
+	if (flock(fd, LOCK_EX) != 0) {
+		close(fd);
+		return -1;
+	}
+
+	if (fstat(fd, &st) != 0) {
+		goto end;
+	}
+
+	if (st.st_size == 0) {
+		blocks = __blocked_bloomfilter_calc(max_items, false_positive);
+		size = __blocked_bloomfilter_size(blocks);
+		if (ftruncate(fd, size) != 0) {
+			goto end;
+		}
+		created = 1;
+	} else if ((size_t)st.st_size < sizeof(phalcon_blocked_bloomfilter_head)) {
+		goto end;
+	} else {
+		size = (size_t)st.st_size;
+	}
+
+	mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mem == MAP_FAILED) {
+		goto end;
+	}
+
+	if (created) {
+		__blocked_bloomfilter_head_init((phalcon_blocked_bloomfilter_head *)mem, blocks, seed, max_items, false_positive);
+	} else if (!__blocked_bloomfilter_head_valid((phalcon_blocked_bloomfilter_head *)mem, size)) {
+		munmap(mem, size);
+		goto end;
+	}
+
+	__blocked_bloomfilter_attach(bloomfilter, mem, size, PHALCON_BLOCKED_BLOOMFILTER_STORAGE_FILE);
+	ret = 0;
+
+end:
+	/* 映射不依赖文件描述符 */
+	flock(fd, LOCK_UN);
+	close(fd);
+	return ret;
+}
+
+int phalcon_blocked_bloomfilter_open_shm(phalcon_blocked_bloomfilter *bloomfilter, const char *name, uint32_t seed, uint32_t max_items, double false_positive)
+{
+	phalcon_shared_memory *shm;
+	phalcon_blocked_bloomfilter_head *head = NULL;
+	uint64_t blocks;
+	size_t size;
+	int tries;
+
+	if (bloomfilter == NULL || name == NULL || max_items == 0 || (false_positive <= 0) || (false_positive >= 1))
+		return -1;
+
+	phalcon_blocked_bloomfilter_free(bloomfilter);
+	__blocked_bloomfilter_select();
+
+	blocks = __blocked_bloomfilter_calc(max_items, false_positive);
+
+	/* 只有独占创建成功的进程写入头部，其他进程等待魔数出现后再映射 */
+	for (tries = 0; tries < 1000; tries++) {
+		shm = phalcon_shared_memory_create_exclusive(name, __blocked_bloomfilter_size(blocks));
+		if (shm != NULL) {
+			head = (phalcon_blocked_bloomfilter_head *)phalcon_shared_memory_ptr(shm);
+			__blocked_bloomfilter_head_init(head, blocks, seed, max_items, false_positive);
+			break;
+		}
+
+		if (errno != EEXIST) {
+			return -1;
+		}
+
+		shm = phalcon_shared_memory_open(name);
+		if (shm != NULL) {
+			head = (phalcon_blocked_bloomfilter_head *)phalcon_shared_memory_ptr(shm);
+			if (phalcon_shared_memory_size(shm) >= sizeof(phalcon_blocked_bloomfilter_head) && head->file_magic_code == PHALCON_BLOCKED_BLOOMFILTER_FILE_MAGIC_CODE) {
+				__sync_synchronize();
+				break;
+			}
+
+			phalcon_shared_memory_cleanup(shm);
+			shm = NULL;
+		}
+
+		usleep(1000);
+	}
+
+	if (shm == NULL) {
+		return -1;
+	}
+
+	size = phalcon_shared_memory_size(shm);
+
+	if (!__blocked_bloomfilter_head_valid(head, size)) {
+		phalcon_shared_memory_cleanup(shm);
+		return -1;
+	}
+
+	__blocked_bloomfilter_attach(bloomfilter, head, size, PHALCON_BLOCKED_BLOOMFILTER_STORAGE_SHM);
+	bloomfilter->shm = shm;
+	return 0;
+}
+
+static zend_always_inline uint64_t *__blocked_bloomfilter_hash(phalcon_blocked_bloomfilter *bloomfilter, const void *key, int len, uint32_t *hash)
+{
+	uint32_t out[4];
+	uint64_t block;
+
+	MurmurHash3_x86_128(key, len, bloomfilter->head->seed, out);
+
+	/* 乘法取高位映射到块，避免取模 */
+	block = ((uint64_t)out[0] * bloomfilter->head->blocks) >> 32;
+	*hash = out[1];
+
+	return bloomfilter->data + block * PHALCON_BLOCKED_BLOOMFILTER_BLOCK_WORDS;
+}
+
+int phalcon_blocked_bloomfilter_add(phalcon_blocked_bloomfilter *bloomfilter, const void *key, int len)
+{
+	uint64_t mask[PHALCON_BLOCKED_BLOOMFILTER_BLOCK_WORDS];
+	uint64_t *block, count;
+	uint32_t hash;
+	int i;
+
+	if (bloomfilter == NULL || bloomfilter->head == NULL || key == NULL || len <= 0)
+		return -1;
+
+	block = __blocked_bloomfilter_hash(bloomfilter, key, len, &hash);
+	__blocked_bloomfilter_mask(hash, mask);
+
+	for (i = 0; i < PHALCON_BLOCKED_BLOOMFILTER_BLOCK_WORDS; i++) {
+		/* 已置位时不写，避免弄脏共享页 */
+		if ((block[i] & mask[i]) != mask[i]) {
+			__sync_fetch_and_or(&block[i], mask[i]);
+		}
+	}
+
+	count = __sync_add_and_fetch(&bloomfilter->head->count, 1);
+	if (count <= bloomfilter->head->max_items)
+		return 0;
+	else
+		return 1;
+}
+
+int phalcon_blocked_bloomfilter_check(phalcon_blocked_bloomfilter *bloomfilter, const void *key, int len)
+{
+	uint64_t *block;
+	uint32_t hash;
+
+	if (bloomfilter == NULL || bloomfilter->head == NULL || key == NULL || len <= 0)
+		return -1;
+
+	block = __blocked_bloomfilter_hash(bloomfilter, key, len, &hash);
+	if (__blocked_bloomfilter_probe(block, hash)) {
+		return 0;
+	}
+	return 1;
+}
+
+int phalcon_blocked_bloomfilter_reset(phalcon_blocked_bloomfilter *bloomfilter)
+{
+	if (bloomfilter == NULL || bloomfilter->head == NULL)
+		return -1;
+
+	memset(bloomfilter->data, 0, bloomfilter->head->blocks * PHALCON_BLOCKED_BLOOMFILTER_BLOCK_SIZE);
+	bloomfilter->head->count = 0;
+	return 0;
+}
+
+int phalcon_blocked_bloomfilter_sync(phalcon_blocked_bloomfilter *bloomfilter)
+{
+	if (bloomfilter == NULL || bloomfilter->head == NULL)
+		return -1;
+
+	switch (bloomfilter->storage) {
+		case PHALCON_BLOCKED_BLOOMFILTER_STORAGE_FILE:
+			return msync(bloomfilter->mem, bloomfilter->size, MS_SYNC) == 0 ? 0 : -1;
+		case PHALCON_BLOCKED_BLOOMFILTER_STORAGE_SHM:
+			return 0;
+		default:
+			return -1;
+	}
+}
+
+int phalcon_blocked_bloomfilter_free(phalcon_blocked_bloomfilter *bloomfilter)
+{
+	if (bloomfilter == NULL)
+		return -1;
+
+	if (bloomfilter->mem) {
+		switch (bloomfilter->storage) {
+			case PHALCON_BLOCKED_BLOOMFILTER_STORAGE_FILE:
+				munmap(bloomfilter->mem, bloomfilter->size);
+				break;
+			case PHALCON_BLOCKED_BLOOMFILTER_STORAGE_SHM:
+				/* 段保留给其他进程 */
+				phalcon_shared_memory_cleanup(bloomfilter->shm);
+				break;
+			default:
+				free(bloomfilter->mem);
+				break;
+		}
+	}
+
+	memset(bloomfilter, 0, sizeof(phalcon_blocked_bloomfilter));
+	return 0;
+}
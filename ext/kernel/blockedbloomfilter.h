@@ -0,0 +1,82 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          Vladimir Kolesnikov <vladimir@extrememember.com>              |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_KERNEL_BLOCKEDBLOOMFILTER_H
+#define PHALCON_KERNEL_BLOCKEDBLOOMFILTER_H
+
+#include "kernel/memory.h"
+#include "kernel/murmurhash.h"
+#include "kernel/shm.h"
+
+/*
+ * Split block bloom filter
+ *
+ * The bit array is cut into 64-byte blocks (one cache line, 8 words of 64 bits).
+ * A key selects one block and sets exactly one bit in each of its 8 words,
+ * so a lookup touches a single cache line whatever the filter size.
+ *
+ * The head and the blocks share one contiguous region, which may live in
+ * request memory, in an mmap'd file or in a shared memory segment.
+ */
+
+#define PHALCON_BLOCKED_BLOOMFILTER_FILE_MAGIC_CODE		0x44616F38
+#define PHALCON_BLOCKED_BLOOMFILTER_VERSION				1
+
+#define PHALCON_BLOCKED_BLOOMFILTER_BLOCK_SIZE			64
+#define PHALCON_BLOCKED_BLOOMFILTER_BLOCK_WORDS			8
+
+#define PHALCON_BLOCKED_BLOOMFILTER_STORAGE_MEMORY		0
+#define PHALCON_BLOCKED_BLOOMFILTER_STORAGE_FILE		1
+#define PHALCON_BLOCKED_BLOOMFILTER_STORAGE_SHM			2
+
+typedef struct {
+	uint32_t file_magic_code;
+	uint32_t version;
+	uint64_t blocks;			// 块个数
+	uint32_t max_items;
+	uint32_t seed;
+	double false_positive;
+	uint64_t count;				// 已存元素个数，多进程共享时原子递增
+	char reserved[24];			// 补齐到一个缓存行，保证数据块对齐
+} phalcon_blocked_bloomfilter_head;
+
+typedef struct {
+	phalcon_blocked_bloomfilter_head *head;
+	uint64_t *data;				// blocks * 8 个字
+	int storage;
+	void *mem;					// 映射或分配的起始地址
+	size_t size;
+	phalcon_shared_memory *shm;
+} phalcon_blocked_bloomfilter;
+
+int phalcon_blocked_bloomfilter_init(phalcon_blocked_bloomfilter *bloomfilter, uint32_t seed, uint32_t max_items, double false_positive);
+int phalcon_blocked_bloomfilter_open_file(phalcon_blocked_bloomfilter *bloomfilter, const char *filename, uint32_t seed, uint32_t max_items, double false_positive);
+int phalcon_blocked_bloomfilter_open_shm(phalcon_blocked_bloomfilter *bloomfilter, const char *name, uint32_t seed, uint32_t max_items, double false_positive);
+int phalcon_blocked_bloomfilter_add(phalcon_blocked_bloomfilter *bloomfilter, const void *key, int len);
+int phalcon_blocked_bloomfilter_check(phalcon_blocked_bloomfilter *bloomfilter, const void *key, int len);
+int phalcon_blocked_bloomfilter_reset(phalcon_blocked_bloomfilter *bloomfilter);
+int phalcon_blocked_bloomfilter_sync(phalcon_blocked_bloomfilter *bloomfilter);
+int phalcon_blocked_bloomfilter_free(phalcon_blocked_bloomfilter *bloomfilter);
+
+/* Returns 1 when the probe runs on AVX2 */
+int phalcon_blocked_bloomfilter_simd(void);
+
+#endif /* PHALCON_KERNEL_BLOCKEDBLOOMFILTER_H */
@@ -0,0 +1,376 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          Vladimir Kolesnikov <vladimir@extrememember.com>              |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "kernel/cuckoofilter.h"
+
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define CUCKOO_SALT_CONSTANT 0x5bd1e995
+
+/* byte-wise zero test on a word (Hacker's Delight) */
+#define CUCKOO_HASZERO8(v)  (((v) - 0x01010101U) & ~(v) & 0x80808080U)
+#define CUCKOO_HASZERO16(v) (((v) - 0x0001000100010001ULL) & ~(v) & 0x8000800080008000ULL)
+
+typedef struct {
+    uint64_t i1;
+    uint64_t i2;
+    uint32_t fp;
+} cuckoo_position_t;
+
+static inline unsigned char *cuckoo_bucket(cuckoo_filter_t *filter, uint64_t index)
+{
+    return filter->buckets + index * filter->bucket_bytes;
+}
+
+static inline uint32_t cuckoo_slot_get(cuckoo_filter_t *filter, const unsigned char *bucket, int slot)
+{
+    if (filter->header->fingerprint_bits == 8) {
+        return bucket[slot];
+    } else {
+        uint16_t v;
+        memcpy(&v, bucket + slot * 2, 2);
+        return v;
+    }
+}
+
+static inline void cuckoo_slot_set(cuckoo_filter_t *filter, unsigned char *bucket, int slot, uint32_t fp)
+{
+    if (filter->header->fingerprint_bits == 8) {
+        bucket[slot] = (unsigned char) fp;
+    } else {
+        uint16_t v = (uint16_t) fp;
+        memcpy(bucket + slot * 2, &v, 2);
+    }
+}
+
+/* whole bucket compared in one word */
+static inline int cuckoo_bucket_contains(cuckoo_filter_t *filter, const unsigned char *bucket, uint32_t fp)
+{
+    if (filter->header->fingerprint_bits == 8) {
+        uint32_t v;
+        memcpy(&v, bucket, 4);
+        v ^= fp * 0x01010101U;
+        return CUCKOO_HASZERO8(v) != 0;
+    } else {
+        uint64_t v;
+        memcpy(&v, bucket, 8);
+        v ^= fp * 0x0001000100010001ULL;
+        return CUCKOO_HASZERO16(v) != 0;
+    }
+}
+
+static inline int cuckoo_bucket_insert(cuckoo_filter_t *filter, uint64_t index, uint32_t fp)
+{
+    unsigned char *bucket = cuckoo_bucket(filter, index);
+    int i;
+
+    for (i = 0; i < CUCKOO_FILTER_SLOTS; i++) {
+        if (cuckoo_slot_get(filter, bucket, i) == 0) {
+            cuckoo_slot_set(filter, bucket, i, fp);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline int cuckoo_bucket_delete(cuckoo_filter_t *filter, uint64_t index, uint32_t fp)
+{
+    unsigned char *bucket = cuckoo_bucket(filter, index);
+    int i;
+
+    for (i = 0; i < CUCKOO_FILTER_SLOTS; i++) {
+        if (cuckoo_slot_get(filter, bucket, i) == fp) {
+            cuckoo_slot_set(filter, bucket, i, 0);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static inline uint64_t cuckoo_alt_index(cuckoo_filter_t *filter, uint64_t index, uint32_t fp)
+{
+    /* xor keeps the mapping symmetric, num_buckets is a power of two */
+    return (index ^ ((uint64_t) fp * CUCKOO_SALT_CONSTANT)) & (filter->header->num_buckets - 1);
+}
+
+static inline void cuckoo_hash(cuckoo_filter_t *filter, const char *key, size_t len, cuckoo_position_t *pos)
+{
+    uint32_t checksum[4];
+    uint32_t mask = (1U << filter->header->fingerprint_bits) - 1;
+
+    MurmurHash3_x86_128(key, (int) len, CUCKOO_SALT_CONSTANT, checksum);
+
+    pos->i1 = (((uint64_t) checksum[0] << 32) | checksum[1]) & (filter->header->num_buckets - 1);
+    pos->fp = checksum[2] & mask;
+    /* 0 marks an empty slot */
+    if (pos->fp == 0) {
+        pos->fp = 1;
+    }
+    pos->i2 = cuckoo_alt_index(filter, pos->i1, pos->fp);
+}
+
+static inline int cuckoo_contains(cuckoo_filter_t *filter, const cuckoo_position_t *pos)
+{
+    cuckoo_filter_header_t *header = filter->header;
+
+    if (cuckoo_bucket_contains(filter, cuckoo_bucket(filter, pos->i1), pos->fp)
+        || cuckoo_bucket_contains(filter, cuckoo_bucket(filter, pos->i2), pos->fp)) {
+        return 1;
+    }
+
+    return header->victim_fingerprint == pos->fp
+        && (header->victim_index == pos->i1 || header->victim_index == pos->i2);
+}
+
+/* evicts random residents until everyone fits, the last homeless one becomes the victim */
+static int cuckoo_place(cuckoo_filter_t *filter, uint64_t index, uint32_t fp)
+{
+    unsigned char *bucket;
+    uint32_t rnd = (uint32_t) index ^ (fp << 16) ^ (uint32_t) filter->header->count;
+    uint32_t evicted;
+    int n, slot;
+
+    for (n = 0; n < CUCKOO_FILTER_MAX_KICKS; n++) {
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 17;
+        rnd ^= rnd << 5;
+        slot = rnd % CUCKOO_FILTER_SLOTS;
+
+        bucket = cuckoo_bucket(filter, index);
+        evicted = cuckoo_slot_get(filter, bucket, slot);
+        cuckoo_slot_set(filter, bucket, slot, fp);
+
+        fp = evicted;
+        index = cuckoo_alt_index(filter, index, fp);
+        if (cuckoo_bucket_insert(filter, index, fp)) {
+            return 0;
+        }
+    }
+
+    filter->header->victim_index = index;
+    filter->header->victim_fingerprint = fp;
+    return 0;
+}
+
+static int cuckoo_filter_init(cuckoo_filter_t *filter, unsigned int capacity, double error_rate)
+{
+    cuckoo_filter_header_t *header = filter->header;
+    uint64_t buckets = 1;
+    double needed;
+    uint32_t bits;
+
+    /* false positive rate is about 2 * slots / 2^f */
+    bits = (uint32_t) ceil(log2(2.0 * CUCKOO_FILTER_SLOTS / error_rate));
+    bits = bits <= 8 ? 8 : 16;
+
+    needed = ceil(capacity / (CUCKOO_FILTER_SLOTS * CUCKOO_FILTER_LOAD_FACTOR));
+    while (buckets < needed) {
+        buckets <<= 1;
+    }
+
+    memset(header, 0, sizeof(cuckoo_filter_header_t));
+    header->fingerprint_bits = bits;
+    header->num_buckets = buckets;
+    header->capacity = capacity;
+    header->error_rate = error_rate;
+    header->magic = CUCKOO_FILTER_MAGIC;
+    return 0;
+}
+
+static size_t cuckoo_filter_bytes(uint32_t fingerprint_bits, uint64_t num_buckets)
+{
+    return sizeof(cuckoo_filter_header_t) + num_buckets * CUCKOO_FILTER_SLOTS * (fingerprint_bits / 8);
+}
+
+cuckoo_filter_t *autocreate_cuckoo_filter_from_file(unsigned int capacity, double error_rate, const char *filename)
+{
+    cuckoo_filter_t *filter;
+    cuckoo_filter_header_t probe;
+    struct stat st;
+    size_t bytes;
+    int fd, created = 0;
+
+    if (capacity == 0 || error_rate <= 0 || error_rate >= 1) {
+        return NULL;
+    }
+
+    if ((fd = open(filename, O_RDWR | O_CREAT, (mode_t)0600)) < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    if (st.st_size == 0) {
+        /* size the file from a header built on the stack */
+        cuckoo_filter_t tmp;
+        tmp.header = &probe;
+        cuckoo_filter_init(&tmp, capacity, error_rate);
+        bytes = cuckoo_filter_bytes(probe.fingerprint_bits, probe.num_buckets);
+        if (ftruncate(fd, bytes) < 0) {
+            close(fd);
+            return NULL;
+        }
+        created = 1;
+    } else {
+        if ((size_t) st.st_size < sizeof(cuckoo_filter_header_t)
+            || pread(fd, &probe, sizeof(probe), 0) != sizeof(probe)
+            || probe.magic != CUCKOO_FILTER_MAGIC
+            || (probe.fingerprint_bits != 8 && probe.fingerprint_bits != 16)
+            || probe.num_buckets == 0 || (probe.num_buckets & (probe.num_buckets - 1)) != 0) {
+            close(fd);
+            return NULL;
+        }
+        bytes = cuckoo_filter_bytes(probe.fingerprint_bits, probe.num_buckets);
+        if ((size_t) st.st_size != bytes) {
+            close(fd);
+            return NULL;
+        }
+    }
+
+    if ((filter = malloc(sizeof(cuckoo_filter_t))) == NULL) {
+        close(fd);
+        return NULL;
+    }
+
+    filter->fd = fd;
+    filter->num_bytes = bytes;
+    filter->header = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (filter->header == MAP_FAILED) {
+        close(fd);
+        free(filter);
+        return NULL;
+    }
+
+    if (created) {
+        cuckoo_filter_init(filter, capacity, error_rate);
+    }
+
+    filter->buckets = (unsigned char *) filter->header + sizeof(cuckoo_filter_header_t);
+    filter->bucket_bytes = CUCKOO_FILTER_SLOTS * (filter->header->fingerprint_bits / 8);
+
+    return filter;
+}
+
+int free_cuckoo_filter(cuckoo_filter_t *filter)
+{
+    if (filter != NULL) {
+        munmap(filter->header, filter->num_bytes);
+        close(filter->fd);
+        free(filter);
+    }
+    return 0;
+}
+
+int cuckoo_filter_add(cuckoo_filter_t *filter, const char *s, size_t len)
+{
+    cuckoo_position_t pos;
+
+    /* with a victim pending the table is full */
+    if (filter->header->victim_fingerprint != 0) {
+        return 1;
+    }
+
+    cuckoo_hash(filter, s, len, &pos);
+
+    if (!cuckoo_bucket_insert(filter, pos.i1, pos.fp) && !cuckoo_bucket_insert(filter, pos.i2, pos.fp)) {
+        cuckoo_place(filter, pos.i1, pos.fp);
+    }
+    filter->header->count++;
+
+    return 0;
+}
+
+int cuckoo_filter_remove(cuckoo_filter_t *filter, const char *s, size_t len)
+{
+    cuckoo_filter_header_t *header = filter->header;
+    cuckoo_position_t pos;
+    uint64_t index;
+    uint32_t fp;
+
+    cuckoo_hash(filter, s, len, &pos);
+
+    if (cuckoo_bucket_delete(filter, pos.i1, pos.fp) || cuckoo_bucket_delete(filter, pos.i2, pos.fp)) {
+        header->count--;
+
+        /* a slot was freed, give the victim another chance */
+        if (header->victim_fingerprint != 0) {
+            index = header->victim_index;
+            fp = header->victim_fingerprint;
+            header->victim_fingerprint = 0;
+            if (!cuckoo_bucket_insert(filter, index, fp) && !cuckoo_bucket_insert(filter, cuckoo_alt_index(filter, index, fp), fp)) {
+                cuckoo_place(filter, index, fp);
+            }
+        }
+        return 0;
+    }
+
+    if (header->victim_fingerprint == pos.fp && (header->victim_index == pos.i1 || header->victim_index == pos.i2)) {
+        header->victim_fingerprint = 0;
+        header->count--;
+        return 0;
+    }
+
+    return 1;
+}
+
+int cuckoo_filter_check(cuckoo_filter_t *filter, const char *s, size_t len)
+{
+    cuckoo_position_t pos;
+
+    cuckoo_hash(filter, s, len, &pos);
+    return cuckoo_contains(filter, &pos);
+}
+
+void cuckoo_filter_check_batch(cuckoo_filter_t *filter, const char **keys, const size_t *lens, int n, int *results)
+{
+    cuckoo_position_t pos[CUCKOO_FILTER_BATCH];
+    int i;
+
+    if (n > CUCKOO_FILTER_BATCH) {
+        n = CUCKOO_FILTER_BATCH;
+    }
+
+    /* issue every bucket load first so the cache misses overlap */
+    for (i = 0; i < n; i++) {
+        cuckoo_hash(filter, keys[i], lens[i], &pos[i]);
+#if defined(__GNUC__)
+        __builtin_prefetch(cuckoo_bucket(filter, pos[i].i1), 0, 1);
+        __builtin_prefetch(cuckoo_bucket(filter, pos[i].i2), 0, 1);
+#endif
+    }
+
+    for (i = 0; i < n; i++) {
+        results[i] = cuckoo_contains(filter, &pos[i]);
+    }
+}
+
+int cuckoo_filter_flush(cuckoo_filter_t *filter)
+{
+    return msync(filter->header, filter->num_bytes, MS_SYNC) < 0 ? -1 : 0;
+}
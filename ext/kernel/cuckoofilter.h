@@ -0,0 +1,80 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          Vladimir Kolesnikov <vladimir@extrememember.com>              |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_KERNEL_CUCKOOFILTER_H
+#define PHALCON_KERNEL_CUCKOOFILTER_H
+
+#include "kernel/murmurhash.h"
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Cuckoo filter (Fan et al. 2014), 4 slots per bucket, 8 or 16 bit fingerprints.
+ *
+ * Each key has two candidate buckets, i1 = hash(key) and i2 = i1 ^ hash(fingerprint),
+ * so either one can be found from the other while relocating. Deletion removes one copy
+ * of the fingerprint, which is why a key must only be removed after it was added.
+ *
+ * The table is a file mapped with MAP_SHARED, laid out as a 64-byte header followed by the buckets.
+ */
+
+#define CUCKOO_FILTER_MAGIC         0x43434B31
+#define CUCKOO_FILTER_SLOTS         4
+#define CUCKOO_FILTER_MAX_KICKS     500
+#define CUCKOO_FILTER_LOAD_FACTOR   0.95
+#define CUCKOO_FILTER_BATCH         16
+
+typedef struct {
+    uint32_t magic;
+    uint32_t fingerprint_bits;
+    uint64_t num_buckets;
+    uint64_t count;
+    uint64_t victim_index;
+    uint32_t victim_fingerprint;    /* 0 when no item is waiting for a slot */
+    uint32_t capacity;
+    double   error_rate;
+    char     reserved[16];
+} cuckoo_filter_header_t;
+
+typedef struct {
+    cuckoo_filter_header_t *header;
+    unsigned char *buckets;
+    size_t bucket_bytes;
+    size_t num_bytes;
+    int fd;
+} cuckoo_filter_t;
+
+cuckoo_filter_t *autocreate_cuckoo_filter_from_file(unsigned int capacity, double error_rate, const char *filename);
+int free_cuckoo_filter(cuckoo_filter_t *filter);
+
+/* 0 on success, 1 when the table is full and the key could not be stored */
+int cuckoo_filter_add(cuckoo_filter_t *filter, const char *s, size_t len);
+/* 0 when a fingerprint was removed, 1 when the key was not found */
+int cuckoo_filter_remove(cuckoo_filter_t *filter, const char *s, size_t len);
+int cuckoo_filter_check(cuckoo_filter_t *filter, const char *s, size_t len);
+
+/* Checks up to CUCKOO_FILTER_BATCH keys, prefetching all candidate buckets before probing */
+void cuckoo_filter_check_batch(cuckoo_filter_t *filter, const char **keys, const size_t *lens, int n, int *results);
+
+int cuckoo_filter_flush(cuckoo_filter_t *filter);
+
+#endif /* PHALCON_KERNEL_CUCKOOFILTER_H */
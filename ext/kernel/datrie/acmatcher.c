@@ -0,0 +1,380 @@
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "kernel/datrie/trie-private.h"
+#include "kernel/datrie/acmatcher.h"
+#include "kernel/datrie/darray.h"
+#include "kernel/datrie/fileutils.h"
+
+/* "ACM1" */
+#define AC_SIGNATURE 0x41434D31
+
+/* UTF-8 continuation bytes do not start a code point */
+#define AC_IS_LEAD_BYTE(c) (((c) & 0xC0) != 0x80)
+
+typedef struct {
+    TrieIndex   fail;   /* longest proper suffix that is also a state */
+    TrieIndex   dict;   /* next state on the failure chain ending a key */
+    int32       length; /* bytes of the key ending here, 0 if none */
+    int32       chars;  /* code points of the key ending here */
+    TrieData    data;
+} ACState;
+
+struct _ACMatcher {
+    DArray     *da;
+    TrieIndex   num_states;
+    ACState    *states;
+};
+
+/*
+ * States without children keep a free-list link (negative) in BASE,
+ * walking from them must never index the pool
+ */
+static Bool
+ac_walk (const DArray *d, TrieIndex *s, TrieChar c)
+{
+    if (da_get_base (d, *s) <= 0)
+        return FALSE;
+
+    return da_walk (d, s, c);
+}
+
+typedef struct {
+    ACMatcher  *matcher;
+    Bool        mark;
+    Bool        failed;
+} ACBuildContext;
+
+/*
+ * Keys come back as AlphaChar, one per byte of the original string
+ * (possibly sign-extended), the low byte is what the text will carry
+ */
+static Bool
+ac_matcher_add_key (const AlphaChar *key, TrieData key_data, void *user_data)
+{
+    ACBuildContext *ctx = (ACBuildContext *) user_data;
+    ACMatcher      *m = ctx->matcher;
+    TrieIndex       s;
+    int32           length = 0, chars = 0;
+
+    s = da_get_root (m->da);
+    for (; *key; key++) {
+        TrieChar c = (TrieChar) (*key & 0xFF);
+
+        if (ctx->mark) {
+            if (!ac_walk (m->da, &s, c)) {
+                ctx->failed = TRUE;
+                return FALSE;
+            }
+            length++;
+            if (AC_IS_LEAD_BYTE (c))
+                chars++;
+        } else if (!ac_walk (m->da, &s, c)) {
+            s = da_insert_branch (m->da, s, c);
+            if (UNLIKELY (TRIE_INDEX_ERROR == s)) {
+                ctx->failed = TRUE;
+                return FALSE;
+            }
+        }
+    }
+
+    if (ctx->mark && length > 0) {
+        m->states[s].length = length;
+        m->states[s].chars  = chars;
+        m->states[s].data   = key_data;
+    }
+
+    return TRUE;
+}
+
+static Bool
+ac_matcher_link (ACMatcher *m)
+{
+    TrieIndex  *queue;
+    TrieIndex   root, head = 0, tail = 0;
+
+    queue = (TrieIndex *) malloc (m->num_states * sizeof (TrieIndex));
+    if (UNLIKELY (!queue))
+        return FALSE;
+
+    root = da_get_root (m->da);
+    m->states[root].fail = root;
+    queue[tail++] = root;
+
+    /* breadth first, so the failure target of a state is always linked before it */
+    while (head < tail) {
+        TrieIndex   s = queue[head++];
+        Symbols    *syms;
+        int         i;
+
+        if (da_get_base (m->da, s) <= 0)
+            continue;
+
+        syms = da_output_symbols (m->da, s);
+
+        for (i = 0; i < symbols_num (syms); i++) {
+            TrieChar    c = symbols_get (syms, i);
+            TrieIndex   t = s, f;
+
+            da_walk (m->da, &t, c);
+
+            if (s == root) {
+                f = root;
+            } else {
+                f = m->states[s].fail;
+                while (f != root && !ac_walk (m->da, &f, c))
+                    f = m->states[f].fail;
+                if (f == root && !ac_walk (m->da, &f, c))
+                    f = root;
+            }
+
+            m->states[t].fail = f;
+            m->states[t].dict = m->states[f].length > 0 ? f : m->states[f].dict;
+
+            queue[tail++] = t;
+        }
+
+        symbols_free (syms);
+    }
+
+    free (queue);
+    return TRUE;
+}
+
+/**
+ * @brief Build an Aho-Corasick matcher from the keys of a trie
+ *
+ * @param trie  : the trie to read keys from
+ *
+ * @return a pointer to the matcher, NULL on failure
+ *
+ * The matcher is a snapshot, it has to be rebuilt after the trie changes.
+ * The created object must be freed with ac_matcher_free().
+ */
+ACMatcher *
+ac_matcher_new (const Trie *trie)
+{
+    ACMatcher      *m;
+    ACBuildContext  ctx;
+
+    m = (ACMatcher *) malloc (sizeof (ACMatcher));
+    if (UNLIKELY (!m))
+        return NULL;
+
+    m->states = NULL;
+    m->da = da_new ();
+    if (UNLIKELY (!m->da))
+        goto exit_matcher_created;
+
+    ctx.matcher = m;
+    ctx.failed  = FALSE;
+
+    /* insertion relocates states, so per-state data is attached in a second pass */
+    ctx.mark = FALSE;
+    trie_enumerate (trie, ac_matcher_add_key, &ctx);
+    if (ctx.failed)
+        goto exit_da_created;
+
+    m->num_states = da_get_num_cells (m->da);
+    m->states = (ACState *) calloc (m->num_states, sizeof (ACState));
+    if (UNLIKELY (!m->states))
+        goto exit_da_created;
+
+    ctx.mark = TRUE;
+    trie_enumerate (trie, ac_matcher_add_key, &ctx);
+    if (ctx.failed || !ac_matcher_link (m))
+        goto exit_states_created;
+
+    return m;
+
+exit_states_created:
+    free (m->states);
+exit_da_created:
+    da_free (m->da);
+exit_matcher_created:
+    free (m);
+    return NULL;
+}
+
+/**
+ * @brief Read a matcher written by ac_matcher_fwrite()
+ *
+ * @param file  : the handle of the open file
+ *
+ * @return a pointer to the matcher, NULL on failure
+ *
+ * On failure the file pointer is restored, so callers may probe for an
+ * optional matcher block after the trie data.
+ */
+ACMatcher *
+ac_matcher_fread (FILE *file)
+{
+    ACMatcher  *m;
+    long        save_pos;
+    int32       sig;
+    TrieIndex   i;
+
+    save_pos = ftell (file);
+    if (!file_read_int32 (file, &sig) || AC_SIGNATURE != (uint32) sig)
+        goto exit_file_read;
+
+    m = (ACMatcher *) malloc (sizeof (ACMatcher));
+    if (UNLIKELY (!m))
+        goto exit_file_read;
+
+    if (NULL == (m->da = da_fread (file)))
+        goto exit_matcher_created;
+
+    m->num_states = da_get_num_cells (m->da);
+    m->states = (ACState *) malloc (m->num_states * sizeof (ACState));
+    if (UNLIKELY (!m->states))
+        goto exit_da_created;
+
+    for (i = 0; i < m->num_states; i++) {
+        ACState *st = &m->states[i];
+        if (!file_read_int32 (file, &st->fail) ||
+            !file_read_int32 (file, &st->dict) ||
+            !file_read_int32 (file, &st->length) ||
+            !file_read_int32 (file, &st->chars) ||
+            !file_read_int32 (file, &st->data))
+        {
+            goto exit_states_created;
+        }
+        if (st->fail < 0 || st->fail >= m->num_states ||
+            st->dict < 0 || st->dict >= m->num_states)
+        {
+            goto exit_states_created;
+        }
+    }
+
+    return m;
+
+exit_states_created:
+    free (m->states);
+exit_da_created:
+    da_free (m->da);
+exit_matcher_created:
+    free (m);
+exit_file_read:
+    fseek (file, save_pos, SEEK_SET);
+    return NULL;
+}
+
+/**
+ * @brief Free a matcher
+ *
+ * @param matcher : the matcher to free
+ */
+void
+ac_matcher_free (ACMatcher *matcher)
+{
+    free (matcher->states);
+    da_free (matcher->da);
+    free (matcher);
+}
+
+/**
+ * @brief Write a matcher to an open file
+ *
+ * @param matcher : the matcher
+ * @param file    : the open file
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int
+ac_matcher_fwrite (const ACMatcher *matcher, FILE *file)
+{
+    TrieIndex i;
+
+    if (!file_write_int32 (file, AC_SIGNATURE))
+        return -1;
+
+    if (da_fwrite (matcher->da, file) != 0)
+        return -1;
+
+    for (i = 0; i < matcher->num_states; i++) {
+        const ACState *st = &matcher->states[i];
+        if (!file_write_int32 (file, st->fail) ||
+            !file_write_int32 (file, st->dict) ||
+            !file_write_int32 (file, st->length) ||
+            !file_write_int32 (file, st->chars) ||
+            !file_write_int32 (file, st->data))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Find every key occurring in a text
+ *
+ * @param matcher    : the matcher
+ * @param text       : the text to scan
+ * @param length     : the length of the text in bytes
+ * @param match_func : the callback invoked for each occurrence
+ * @param user_data  : the data passed to the callback
+ *
+ * @return number of reported occurrences
+ *
+ * Occurrences are reported in order of their end, the longest first when
+ * several keys end at the same byte.
+ */
+int
+ac_matcher_match (const ACMatcher       *matcher,
+                  const unsigned char   *text,
+                  size_t                 length,
+                  ACMatchFunc            match_func,
+                  void                  *user_data)
+{
+    TrieIndex   root, s;
+    size_t      i;
+    int         found = 0;
+
+    root = da_get_root (matcher->da);
+    s = root;
+
+    for (i = 0; i < length; i++) {
+        TrieChar    c = text[i];
+        TrieIndex   t;
+
+        /* on success ac_walk moves s to the child */
+        while (s != root && !ac_walk (matcher->da, &s, c))
+            s = matcher->states[s].fail;
+        if (s == root)
+            ac_walk (matcher->da, &s, c);
+
+        t = matcher->states[s].length > 0 ? s : matcher->states[s].dict;
+        while (t != 0 && t != root) {
+            const ACState *st = &matcher->states[t];
+
+            found++;
+            if (!match_func (i + 1, st->length, st->chars, st->data, user_data))
+                return found;
+
+            t = st->dict;
+        }
+    }
+
+    return found;
+}
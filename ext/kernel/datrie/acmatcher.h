@@ -0,0 +1,73 @@
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_KERNEL_DATRIE_ACMATCHER_H
+#define PHALCON_KERNEL_DATRIE_ACMATCHER_H
+
+#include <stdio.h>
+
+#include "kernel/datrie/triedefs.h"
+#include "kernel/datrie/trie.h"
+
+/**
+ * @file acmatcher.h
+ * @brief Aho-Corasick automaton over a double-array
+ *
+ * Every key of a trie is spelled out byte by byte in its own double-array
+ * (no tail), so each prefix is a state and failure links can be attached
+ * to it. Matching a text is then a single pass, whatever the number of keys.
+ */
+
+/**
+ * @brief Aho-Corasick matcher type
+ */
+typedef struct _ACMatcher ACMatcher;
+
+/**
+ * @brief Match callback
+ *
+ * @param end       : byte offset right after the match
+ * @param length    : length of the match in bytes
+ * @param chars     : length of the match in UTF-8 code points
+ * @param data      : the data of the matched key
+ * @param user_data : the user-supplied data on match call
+ *
+ * @return TRUE to continue matching, FALSE to stop
+ */
+typedef Bool (*ACMatchFunc) (size_t     end,
+                             int        length,
+                             int        chars,
+                             TrieData   data,
+                             void      *user_data);
+
+ACMatcher * ac_matcher_new (const Trie *trie);
+
+ACMatcher * ac_matcher_fread (FILE *file);
+
+void        ac_matcher_free (ACMatcher *matcher);
+
+int         ac_matcher_fwrite (const ACMatcher *matcher, FILE *file);
+
+int         ac_matcher_match (const ACMatcher       *matcher,
+                              const unsigned char   *text,
+                              size_t                 length,
+                              ACMatchFunc            match_func,
+                              void                  *user_data);
+
+#endif  /* PHALCON_KERNEL_DATRIE_ACMATCHER_H */
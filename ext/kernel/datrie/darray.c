@@ -322,6 +322,22 @@ da_get_root (const DArray *d)
 }
 
 
+/**
+ * @brief Get number of cells
+ *
+ * @param d     : the double-array data
+ *
+ * @return the size of the cell pool, every state is below it
+ *
+ * Allows callers to keep per-state data in arrays indexed by state.
+ */
+TrieIndex
+da_get_num_cells (const DArray *d)
+{
+    return d->num_cells;
+}
+
+
 /**
  * @brief Get BASE cell
  *
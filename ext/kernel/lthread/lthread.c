@@ -231,9 +231,30 @@ _lthread_key_create(void)
 int
 lthread_init(size_t size)
 {
+    assert(pthread_once(&key_once, _lthread_key_create) == 0);
     return (sched_create(size));
 }
 
+/*
+ * Drops the scheduler of the calling thread without running it, used to
+ * recover from a longjmp out of an lthread. lthreads that were attached to
+ * it have to be released with lthread_free().
+ */
+void
+lthread_sched_free(void)
+{
+    struct lthread_sched *sched = lthread_get_sched();
+
+    if (sched != NULL)
+        _sched_free(sched);
+}
+
+void
+lthread_free(struct lthread *lt)
+{
+    _lthread_free(lt);
+}
+
 static void
 _lthread_init(struct lthread *lt)
 {
@@ -408,7 +429,15 @@ lthread_cond_wait(struct lthread_cond *c, uint64_t timeout)
     struct lthread *lt = lthread_get_sched()->current_lthread;
     TAILQ_INSERT_TAIL(&c->blocked_lthreads, lt, cond_next);
 
+    lt->state |= BIT(LT_ST_WAIT_COND);
     _lthread_sched_busy_sleep(lt, timeout);
+    lt->state &= CLEARBIT(LT_ST_WAIT_COND);
+
+    if (lt->state & BIT(LT_ST_DEADLOCK)) {
+        lt->state &= CLEARBIT(LT_ST_DEADLOCK);
+        TAILQ_REMOVE(&c->blocked_lthreads, lt, cond_next);
+        return (-3);
+    }
 
     if (lt->state & BIT(LT_ST_EXPIRED)) {
         TAILQ_REMOVE(&c->blocked_lthreads, lt, cond_next);
@@ -66,6 +66,8 @@ int     lthread_cond_wait(lthread_cond_t *c, uint64_t timeout);
 void    lthread_cond_signal(lthread_cond_t *c);
 void    lthread_cond_broadcast(lthread_cond_t *c);
 int     lthread_init(size_t size);
+void    lthread_sched_free(void);
+void    lthread_free(lthread_t *lt);
 void    *lthread_get_data(void);
 void    lthread_set_data(void *data);
 lthread_t *lthread_current();
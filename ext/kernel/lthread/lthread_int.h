@@ -97,7 +97,9 @@ enum lthread_st {
     LT_ST_RUNCOMPUTE,   /* lthread needs to run in compute sched (2), step2 */
     LT_ST_WAIT_IO_READ, /* lthread waiting for READ IO to finish */
     LT_ST_WAIT_IO_WRITE,/* lthread waiting for WRITE IO to finish */
-    LT_ST_WAIT_MULTI    /* lthread waiting on multiple fds */
+    LT_ST_WAIT_MULTI,   /* lthread waiting on multiple fds */
+    LT_ST_WAIT_COND,    /* lthread waiting on a condition */
+    LT_ST_DEADLOCK      /* lthread woken up, nothing could signal its condition */
 };
 
 struct lthread {
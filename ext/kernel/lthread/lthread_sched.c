@@ -155,6 +155,42 @@ _lthread_sched_isdone(struct lthread_sched *sched)
         TAILQ_EMPTY(&sched->ready));
 }
 
+/*
+ * Returns 1 if every pending lthread waits without a timeout on a condition,
+ * nothing is left that could signal it and the scheduler would spin forever.
+ */
+static inline int
+_lthread_sched_isdeadlocked(struct lthread_sched *sched)
+{
+    struct lthread *lt = NULL;
+
+    if (!RB_EMPTY(&sched->waiting) || !RB_EMPTY(&sched->sleeping) ||
+        !TAILQ_EMPTY(&sched->ready) || !TAILQ_EMPTY(&sched->defer) ||
+        LIST_EMPTY(&sched->busy))
+        return (0);
+
+    LIST_FOREACH(lt, &sched->busy, busy_next) {
+        if (!(lt->state & BIT(LT_ST_WAIT_COND)))
+            return (0);
+    }
+
+    return (1);
+}
+
+/*
+ * Resumes the deadlocked lthreads, lthread_cond_wait() returns -3 to them.
+ */
+static void
+_lthread_sched_break_deadlock(struct lthread_sched *sched)
+{
+    struct lthread *lt = NULL;
+
+    LIST_FOREACH(lt, &sched->busy, busy_next) {
+        lt->state |= BIT(LT_ST_DEADLOCK);
+        TAILQ_INSERT_TAIL(&sched->ready, lt, ready_next);
+    }
+}
+
 void
 lthread_run(void)
 {
@@ -175,6 +211,9 @@ lthread_run(void)
         /* 1. start by checking if a sleeping thread needs to wakeup */
         _lthread_resume_expired(sched);
 
+        if (_lthread_sched_isdeadlocked(sched))
+            _lthread_sched_break_deadlock(sched);
+
         /* 2. check to see if we have any ready threads to run.
          * if new lthreads got added to the ready queue in process, they'll
          * run the next time we get here again.
@@ -67,6 +67,9 @@ void php_phalcon_init_globals(zend_phalcon_globals *phalcon_globals) {
 
 	/* DB options */
 	phalcon_globals->db.escape_identifiers = 1;
+
+	/* Coroutine options */
+	memset(&phalcon_globals->coroutine, 0, sizeof(phalcon_coroutine_options));
 }
 
 /**
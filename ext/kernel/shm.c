@@ -35,7 +35,7 @@
 #include <sys/mman.h>
 #include <semaphore.h>
 
-phalcon_shared_memory* phalcon_shared_memory_create(char const* name, size_t sz)
+static phalcon_shared_memory* phalcon_shared_memory_create_ex(char const* name, size_t sz, int flags)
 {
 	int rc = 0;
 	phalcon_shared_memory* shma = emalloc(sizeof(*shma));
@@ -52,7 +52,7 @@ phalcon_shared_memory* phalcon_shared_memory_create(char const* name, size_t sz)
 	}
 
 	shma->owner = 1;
-	shma->fd = shm_open(shma->name, O_CREAT | O_RDWR, 0666);
+	shma->fd = shm_open(shma->name, flags | O_RDWR, 0666);
 
 
 	if (shma->fd < 0) {
@@ -77,11 +77,26 @@ phalcon_shared_memory* phalcon_shared_memory_create(char const* name, size_t sz)
 	return shma;
 
 error:
+	/* a segment created here is not left behind half sized */
+	if ((flags & O_EXCL) && shma->fd) {
+		shm_unlink(shma->name);
+	}
 	phalcon_shared_memory_cleanup(shma);
 	errno = rc;
 	return NULL;
 }
 
+phalcon_shared_memory* phalcon_shared_memory_create(char const* name, size_t sz)
+{
+	return phalcon_shared_memory_create_ex(name, sz, O_CREAT);
+}
+
+/* Fails with EEXIST when the segment already exists, so only one process initialises it */
+phalcon_shared_memory* phalcon_shared_memory_create_exclusive(char const* name, size_t sz)
+{
+	return phalcon_shared_memory_create_ex(name, sz, O_CREAT | O_EXCL);
+}
+
 phalcon_shared_memory* phalcon_shared_memory_open(char const* name)
 {
 	int rc = 0;
@@ -35,6 +35,7 @@ typedef struct _phalcon_shared_memory {
 } phalcon_shared_memory;
 
 phalcon_shared_memory* phalcon_shared_memory_create(char const* name, size_t);
+phalcon_shared_memory* phalcon_shared_memory_create_exclusive(char const* name, size_t);
 phalcon_shared_memory* phalcon_shared_memory_open(char const* name);
 
 void phalcon_shared_memory_unlink(char const* name);
@@ -71,6 +71,20 @@ PHALCON_INIT_CLASS(Phalcon_Logger){
 	return SUCCESS;
 }
 
+const char *phalcon_logger_type_string(zend_long type)
+{
+	static const char *lut[10] = {
+		"EMERGENCY", "CRITICAL", "ALERT", "ERROR",  "WARNING",
+		"NOTICE",    "INFO",     "DEBUG", "CUSTOM", "SPECIAL"
+	};
+
+	if (type >= 0 && type < 10) {
+		return lut[type];
+	}
+
+	return "CUSTOM";
+}
+
 /**
  * Returns the string meaning of a logger constant
  *
@@ -79,21 +93,10 @@ PHALCON_INIT_CLASS(Phalcon_Logger){
  */
 PHP_METHOD(Phalcon_Logger, getTypeString){
 
-	static const char *lut[10] = {
-		"EMERGENCY", "CRITICAL", "ALERT", "ERROR",  "WARNING",
-		"NOTICE",    "INFO",     "DEBUG", "CUSTOM", "SPECIAL"
-	};
-
 	zval *type;
-	int itype;
 
 	phalcon_fetch_params(0, 1, 0, &type);
 	PHALCON_ENSURE_IS_LONG(type);
-	
-	itype = Z_LVAL_P(type);
-	if (itype >= 0 && itype < 10) {
-		RETURN_STRING(lut[itype]);
-	}
-	
-	RETURN_STRING("CUSTOM");
+
+	RETURN_STRING(phalcon_logger_type_string(Z_LVAL_P(type)));
 }
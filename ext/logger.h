@@ -35,6 +35,8 @@
 
 extern zend_class_entry *phalcon_logger_ce;
 
+const char *phalcon_logger_type_string(zend_long type);
+
 PHALCON_INIT_CLASS(Phalcon_Logger);
 
 #endif /* PHALCON_LOGGER_H */
@@ -23,6 +23,14 @@
 #include "logger/exception.h"
 #include "logger/formatter/line.h"
 
+#include <main/fopen_wrappers.h>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
 #include "kernel/main.h"
 #include "kernel/memory.h"
 #include "kernel/array.h"
@@ -44,12 +52,27 @@
  *	$logger->error("This is another error");
  *	$logger->close();
  *</code>
+ *
+ * When the "buffer" (bytes) or "flushInterval" (seconds) options are given the formatted lines
+ * are kept in memory and appended to the file with a single writev() once a threshold is reached,
+ * on flush(), close() or when the logger is destroyed. With the "async" option the batches are
+ * handed to a background thread, so the request never waits for the disk. Lines the thread fails
+ * to write make the next log(), flush() or close() fail
+ *
+ *<code>
+ *	$logger = new \Phalcon\Logger\Adapter\File("app/logs/test.log", array(
+ *		'buffer' => 65536,
+ *		'flushInterval' => 1,
+ *		'async' => true
+ *	));
+ *</code>
  */
 zend_class_entry *phalcon_logger_adapter_file_ce;
 
 PHP_METHOD(Phalcon_Logger_Adapter_File, __construct);
 PHP_METHOD(Phalcon_Logger_Adapter_File, getFormatter);
 PHP_METHOD(Phalcon_Logger_Adapter_File, logInternal);
+PHP_METHOD(Phalcon_Logger_Adapter_File, flush);
 PHP_METHOD(Phalcon_Logger_Adapter_File, close);
 PHP_METHOD(Phalcon_Logger_Adapter_File, getPath);
 PHP_METHOD(Phalcon_Logger_Adapter_File, __wakeup);
@@ -63,18 +86,299 @@ static const zend_function_entry phalcon_logger_adapter_file_method_entry[] = {
 	PHP_ME(Phalcon_Logger_Adapter_File, __construct, arginfo_phalcon_logger_adapter_file___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Logger_Adapter_File, getFormatter, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Logger_Adapter_File, logInternal, arginfo_phalcon_logger_adapter_loginternal, ZEND_ACC_PROTECTED)
+	PHP_ME(Phalcon_Logger_Adapter_File, flush, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Logger_Adapter_File, close, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Logger_Adapter_File, getPath, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Logger_Adapter_File, __wakeup, NULL, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
+static int phalcon_logger_adapter_file_writev(int fd, struct iovec *iov, int count)
+{
+	ssize_t written;
+
+	while (count > 0) {
+		written = writev(fd, iov, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return FAILURE;
+		}
+
+		/* Skip what the kernel already took, a partial write resumes inside the current line */
+		while (count > 0 && (size_t)written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			count--;
+		}
+
+		if (count > 0) {
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+
+	return SUCCESS;
+}
+
+static void *phalcon_logger_adapter_file_flusher(void *arg)
+{
+	phalcon_logger_adapter_file_object *intern = (phalcon_logger_adapter_file_object *)arg;
+	phalcon_logger_adapter_file_op *op;
+	struct iovec iov;
+
+	while (1) {
+		op = phalcon_message_queue_read(intern->queue);
+		if (!op->data) {
+			phalcon_message_queue_message_free(intern->queue, op);
+			break;
+		}
+
+		iov.iov_base = op->data;
+		iov.iov_len = op->len;
+		if (phalcon_logger_adapter_file_writev(intern->fd, &iov, 1) == FAILURE) {
+			__sync_fetch_and_add(&intern->errors, 1);
+		}
+
+		free(op->data);
+		phalcon_message_queue_message_free(intern->queue, op);
+	}
+
+	return NULL;
+}
+
+static int phalcon_logger_adapter_file_start(phalcon_logger_adapter_file_object *intern)
+{
+	void *queue;
+
+	/* The queue keeps its counters on separate cache lines, which ecalloc() does not align */
+	if (posix_memalign(&queue, KERNEL_MESSAGE_QUEUE_CACHE_LINE_SIZE, sizeof(struct phalcon_message_queue)) != 0) {
+		return FAILURE;
+	}
+
+	intern->queue = queue;
+	if (phalcon_message_queue_init(intern->queue, sizeof(phalcon_logger_adapter_file_op), 256) != 0) {
+		free(intern->queue);
+		intern->queue = NULL;
+		return FAILURE;
+	}
+
+	if (pthread_create(&intern->flusher, NULL, phalcon_logger_adapter_file_flusher, intern) != 0) {
+		phalcon_message_queue_destroy(intern->queue);
+		free(intern->queue);
+		intern->queue = NULL;
+		return FAILURE;
+	}
+
+	intern->pid = getpid();
+	return SUCCESS;
+}
+
+/* A forked child inherits the queue but not the thread draining it */
+static int phalcon_logger_adapter_file_restart(phalcon_logger_adapter_file_object *intern)
+{
+	if (intern->pid == getpid()) {
+		return SUCCESS;
+	}
+
+	/* What is still queued is written by the parent, the copy is left alone */
+	intern->queue = NULL;
+	intern->errors = 0;
+
+	return phalcon_logger_adapter_file_start(intern);
+}
+
+static int phalcon_logger_adapter_file_flush(phalcon_logger_adapter_file_object *intern)
+{
+	struct iovec iov[PHALCON_LOGGER_ADAPTER_FILE_MAX_LINES];
+	phalcon_logger_adapter_file_op *op;
+	int i, status = SUCCESS;
+	char *data;
+	size_t offset = 0;
+
+	/* Batches the flusher failed to write are reported by the next call */
+	if (intern->async && intern->pid == getpid() && __sync_lock_test_and_set(&intern->errors, 0)) {
+		status = FAILURE;
+	}
+
+	if (!intern->count) {
+		return status;
+	}
+
+	/* Without a flusher the batch is written in place */
+	if (intern->async && phalcon_logger_adapter_file_restart(intern) == FAILURE) {
+		intern->async = 0;
+	}
+
+	if (intern->async) {
+		/* The flusher thread cannot touch request memory, the batch is copied to a single block */
+		data = malloc(intern->buffered);
+		if (data) {
+			for (i = 0; i < intern->count; i++) {
+				memcpy(data + offset, ZSTR_VAL(intern->lines[i]), ZSTR_LEN(intern->lines[i]));
+				offset += ZSTR_LEN(intern->lines[i]);
+			}
+
+			op = phalcon_message_queue_message_alloc_blocking(intern->queue);
+			op->data = data;
+			op->len = offset;
+			phalcon_message_queue_write(intern->queue, op);
+		} else {
+			status = FAILURE;
+		}
+	} else {
+		for (i = 0; i < intern->count; i++) {
+			iov[i].iov_base = ZSTR_VAL(intern->lines[i]);
+			iov[i].iov_len = ZSTR_LEN(intern->lines[i]);
+		}
+		if (phalcon_logger_adapter_file_writev(intern->fd, iov, intern->count) == FAILURE) {
+			status = FAILURE;
+		}
+	}
+
+	for (i = 0; i < intern->count; i++) {
+		zend_string_release(intern->lines[i]);
+	}
+
+	intern->count = 0;
+	intern->buffered = 0;
+	intern->last_flush = time(NULL);
+
+	return status;
+}
+
+static int phalcon_logger_adapter_file_append(phalcon_logger_adapter_file_object *intern, zend_string *line)
+{
+	intern->lines[intern->count++] = line;
+	intern->buffered += ZSTR_LEN(line);
+
+	if (intern->count == PHALCON_LOGGER_ADAPTER_FILE_MAX_LINES
+		|| (intern->buffer_size && intern->buffered >= intern->buffer_size)
+		|| (intern->flush_interval > 0 && time(NULL) - intern->last_flush >= intern->flush_interval)
+		|| (!intern->buffer_size && !intern->flush_interval)) {
+		return phalcon_logger_adapter_file_flush(intern);
+	}
+
+	return SUCCESS;
+}
+
+static int phalcon_logger_adapter_file_shutdown(phalcon_logger_adapter_file_object *intern)
+{
+	phalcon_logger_adapter_file_op *op;
+	int status;
+
+	if (intern->fd < 0) {
+		return SUCCESS;
+	}
+
+	status = phalcon_logger_adapter_file_flush(intern);
+
+	/* The flusher is only joined by the process that started it */
+	if (intern->async && intern->pid == getpid()) {
+		op = phalcon_message_queue_message_alloc_blocking(intern->queue);
+		op->data = NULL;
+		op->len = 0;
+		phalcon_message_queue_write(intern->queue, op);
+
+		pthread_join(intern->flusher, NULL);
+		phalcon_message_queue_destroy(intern->queue);
+		free(intern->queue);
+
+		if (intern->errors) {
+			status = FAILURE;
+		}
+	}
+
+	intern->queue = NULL;
+	intern->async = 0;
+
+	close(intern->fd);
+	intern->fd = -1;
+
+	return status;
+}
+
+static int phalcon_logger_adapter_file_open(phalcon_logger_adapter_file_object *intern, zval *path, zval *mode, zval *options)
+{
+	zval buffer_size = {}, flush_interval = {}, async = {};
+	int flags = O_WRONLY | O_CREAT | O_APPEND;
+
+	if (Z_TYPE_P(options) != IS_ARRAY) {
+		return SUCCESS;
+	}
+
+	if (phalcon_array_isset_fetch_str(&buffer_size, options, SL("buffer"), PH_READONLY)) {
+		intern->buffer_size = (size_t)phalcon_get_intval(&buffer_size);
+	}
+
+	if (phalcon_array_isset_fetch_str(&flush_interval, options, SL("flushInterval"), PH_READONLY)) {
+		intern->flush_interval = phalcon_get_intval(&flush_interval);
+	}
+
+	if (phalcon_array_isset_fetch_str(&async, options, SL("async"), PH_READONLY)) {
+		intern->async = zend_is_true(&async);
+	}
+
+	if (!intern->buffer_size && !intern->flush_interval && !intern->async) {
+		return SUCCESS;
+	}
+
+	if (php_check_open_basedir(Z_STRVAL_P(path))) {
+		return FAILURE;
+	}
+
+	if (Z_TYPE_P(mode) == IS_STRING && Z_STRLEN_P(mode) && Z_STRVAL_P(mode)[0] == 'w') {
+		flags |= O_TRUNC;
+	}
+
+	intern->fd = open(Z_STRVAL_P(path), flags, 0644);
+	if (intern->fd < 0) {
+		return FAILURE;
+	}
+
+	if (intern->async) {
+		if (phalcon_logger_adapter_file_start(intern) == FAILURE) {
+			close(intern->fd);
+			intern->fd = -1;
+			intern->async = 0;
+			return FAILURE;
+		}
+	}
+
+	intern->last_flush = time(NULL);
+	return SUCCESS;
+}
+
+zend_object_handlers phalcon_logger_adapter_file_object_handlers;
+zend_object* phalcon_logger_adapter_file_object_create_handler(zend_class_entry *ce)
+{
+	phalcon_logger_adapter_file_object *intern = ecalloc(1, sizeof(phalcon_logger_adapter_file_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_logger_adapter_file_object_handlers;
+
+	intern->fd = -1;
+	return &intern->std;
+}
+
+void phalcon_logger_adapter_file_object_free_handler(zend_object *object)
+{
+	phalcon_logger_adapter_file_object *intern = phalcon_logger_adapter_file_object_from_obj(object);
+
+	phalcon_logger_adapter_file_shutdown(intern);
+
+	zend_object_std_dtor(object);
+}
+
 /**
  * Phalcon\Logger\Adapter\File initializer
  */
 PHALCON_INIT_CLASS(Phalcon_Logger_Adapter_File){
 
-	PHALCON_REGISTER_CLASS_EX(Phalcon\\Logger\\Adapter, File, logger_adapter_file, phalcon_logger_adapter_ce, phalcon_logger_adapter_file_method_entry, 0);
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT_EX(Phalcon\\Logger\\Adapter, File, logger_adapter_file, phalcon_logger_adapter_ce, phalcon_logger_adapter_file_method_entry, 0);
 
 	zend_declare_property_null(phalcon_logger_adapter_file_ce, SL("_fileHandler"), ZEND_ACC_PROTECTED);
 	zend_declare_property_null(phalcon_logger_adapter_file_ce, SL("_path"), ZEND_ACC_PROTECTED);
@@ -94,6 +398,7 @@ PHALCON_INIT_CLASS(Phalcon_Logger_Adapter_File){
 PHP_METHOD(Phalcon_Logger_Adapter_File, __construct){
 
 	zval *name, *options = NULL, mode = {}, handler = {};
+	phalcon_logger_adapter_file_object *intern;
 
 	phalcon_fetch_params(0, 1, 1, &name, &options);
 	PHALCON_ENSURE_IS_STRING(name);
@@ -111,6 +416,21 @@ PHP_METHOD(Phalcon_Logger_Adapter_File, __construct){
 		ZVAL_STRING(&mode, "ab");
 	}
 
+	/**
+	 * Buffered loggers write through their own O_APPEND descriptor
+	 */
+	intern = phalcon_logger_adapter_file_object_from_obj(Z_OBJ_P(getThis()));
+	if (phalcon_logger_adapter_file_open(intern, name, &mode, options) == FAILURE) {
+		zend_throw_exception_ex(phalcon_logger_exception_ce, 0, "Cannot open log file '%s'", Z_STRVAL_P(name));
+		return;
+	}
+
+	if (intern->fd >= 0) {
+		phalcon_update_property(getThis(), SL("_path"), name);
+		phalcon_update_property(getThis(), SL("_options"), options);
+		return;
+	}
+
 	/**
 	 * We use 'fopen' to respect to open-basedir directive
 	 */
@@ -155,9 +475,26 @@ PHP_METHOD(Phalcon_Logger_Adapter_File, getFormatter){
 PHP_METHOD(Phalcon_Logger_Adapter_File, logInternal){
 
 	zval *message, *type, *time, *context, file_handler = {}, formatter = {}, applied_format = {};
+	phalcon_logger_adapter_file_object *intern;
 
 	phalcon_fetch_params(0, 4, 0, &message, &type, &time, &context);
 
+	intern = phalcon_logger_adapter_file_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->fd >= 0) {
+		PHALCON_CALL_METHOD(&formatter, getThis(), "getformatter");
+		PHALCON_CALL_METHOD(&applied_format, &formatter, "format", message, type, time, context);
+		zval_ptr_dtor(&formatter);
+
+		if (Z_TYPE(applied_format) != IS_STRING) {
+			convert_to_string(&applied_format);
+		}
+
+		if (phalcon_logger_adapter_file_append(intern, Z_STR(applied_format)) == FAILURE) {
+			PHALCON_THROW_EXCEPTION_STR(phalcon_logger_exception_ce, "Cannot write the buffered messages to the log");
+		}
+		return;
+	}
+
 	phalcon_read_property(&file_handler, getThis(), SL("_fileHandler"), PH_NOISY|PH_READONLY);
 	if (Z_TYPE(file_handler) != IS_RESOURCE) {
 		PHALCON_THROW_EXCEPTION_STR(phalcon_logger_exception_ce, "Cannot send message to the log because it is invalid");
@@ -171,6 +508,23 @@ PHP_METHOD(Phalcon_Logger_Adapter_File, logInternal){
 	zval_ptr_dtor(&applied_format);
 }
 
+/**
+ * Writes the buffered messages to the file, or hands them to the background flusher
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Logger_Adapter_File, flush){
+
+	phalcon_logger_adapter_file_object *intern;
+
+	intern = phalcon_logger_adapter_file_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->fd < 0) {
+		RETURN_TRUE;
+	}
+
+	RETURN_BOOL(phalcon_logger_adapter_file_flush(intern) == SUCCESS);
+}
+
 /**
  * Closes the logger
  *
@@ -179,6 +533,12 @@ PHP_METHOD(Phalcon_Logger_Adapter_File, logInternal){
 PHP_METHOD(Phalcon_Logger_Adapter_File, close){
 
 	zval file_handler = {};
+	phalcon_logger_adapter_file_object *intern;
+
+	intern = phalcon_logger_adapter_file_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->fd >= 0) {
+		RETURN_BOOL(phalcon_logger_adapter_file_shutdown(intern) == SUCCESS);
+	}
 
 	phalcon_read_property(&file_handler, getThis(), SL("_fileHandler"), PH_NOISY|PH_READONLY);
 	PHALCON_RETURN_CALL_FUNCTION("fclose", &file_handler);
@@ -200,6 +560,7 @@ PHP_METHOD(Phalcon_Logger_Adapter_File, getPath) {
 PHP_METHOD(Phalcon_Logger_Adapter_File, __wakeup){
 
 	zval path = {}, options = {}, mode = {}, file_handler = {};
+	phalcon_logger_adapter_file_object *intern;
 
 	phalcon_read_property(&path, getThis(), SL("_path"), PH_NOISY|PH_READONLY);
 	if (Z_TYPE(path) != IS_STRING) {
@@ -218,6 +579,18 @@ PHP_METHOD(Phalcon_Logger_Adapter_File, __wakeup){
 		ZVAL_STRING(&mode, "ab");
 	}
 
+	intern = phalcon_logger_adapter_file_object_from_obj(Z_OBJ_P(getThis()));
+	if (phalcon_logger_adapter_file_open(intern, &path, &mode, &options) == FAILURE) {
+		zend_throw_exception_ex(phalcon_logger_exception_ce, 0, "Cannot open log file '%s'", Z_STRVAL(path));
+		zval_ptr_dtor(&mode);
+		return;
+	}
+
+	if (intern->fd >= 0) {
+		zval_ptr_dtor(&mode);
+		return;
+	}
+
 	/**
 	 * Re-open the file handler if the logger was serialized
 	 */
@@ -21,6 +21,36 @@
 #define PHALCON_LOGGER_ADAPTER_FILE_H
 
 #include "php_phalcon.h"
+#include "kernel/message/queue.h"
+
+#include <pthread.h>
+
+#define PHALCON_LOGGER_ADAPTER_FILE_MAX_LINES 128
+
+typedef struct {
+	char *data;
+	size_t len;
+} phalcon_logger_adapter_file_op;
+
+typedef struct {
+	int fd;
+	size_t buffer_size;
+	long flush_interval;
+	time_t last_flush;
+	size_t buffered;
+	int count;
+	zend_string *lines[PHALCON_LOGGER_ADAPTER_FILE_MAX_LINES];
+	int async;
+	pid_t pid;
+	int errors;
+	pthread_t flusher;
+	struct phalcon_message_queue *queue;
+	zend_object std;
+} phalcon_logger_adapter_file_object;
+
+static inline phalcon_logger_adapter_file_object *phalcon_logger_adapter_file_object_from_obj(zend_object *obj) {
+	return (phalcon_logger_adapter_file_object*)((char*)(obj) - XtOffsetOf(phalcon_logger_adapter_file_object, std));
+}
 
 extern zend_class_entry *phalcon_logger_adapter_file_ce;
 
@@ -24,6 +24,7 @@
 
 #include "kernel/main.h"
 #include "kernel/fcall.h"
+#include "kernel/operators.h"
 
 /**
  * Phalcon\Logger\Formatter
@@ -53,6 +54,26 @@ PHALCON_INIT_CLASS(Phalcon_Logger_Formatter){
 	return SUCCESS;
 }
 
+/**
+ * Returns the string meaning of a logger constant without a method call, unless a userland
+ * formatter overrides getTypeString(), in which case its result is stored in type_string
+ */
+const char *phalcon_logger_formatter_type_string(zval *formatter, zval *type, zval *type_string)
+{
+	zend_function *fn;
+
+	fn = zend_hash_str_find_ptr(&Z_OBJCE_P(formatter)->function_table, SL("gettypestring"));
+	if (!fn || fn->common.scope == phalcon_logger_formatter_ce) {
+		return phalcon_logger_type_string(phalcon_get_intval(type));
+	}
+
+	if (phalcon_call_method(type_string, formatter, "gettypestring", 1, &type) == FAILURE || Z_TYPE_P(type_string) != IS_STRING) {
+		return NULL;
+	}
+
+	return Z_STRVAL_P(type_string);
+}
+
 /**
  * Returns the string meaning of a logger constant
  *
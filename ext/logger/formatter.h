@@ -26,6 +26,8 @@ extern zend_class_entry *phalcon_logger_formatter_ce;
 
 PHALCON_INIT_CLASS(Phalcon_Logger_Formatter);
 
+const char *phalcon_logger_formatter_type_string(zval *formatter, zval *type, zval *type_string);
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_logger_formatter_gettypestring, 0, 0, 1)
 	ZEND_ARG_INFO(0, type)
 ZEND_END_ARG_INFO()
@@ -21,6 +21,8 @@
 #include "logger/formatter.h"
 #include "logger/formatterinterface.h"
 
+#include <Zend/zend_smart_str.h>
+
 #include "kernel/main.h"
 #include "kernel/memory.h"
 #include "kernel/string.h"
@@ -32,6 +34,8 @@
  * Phalcon\Logger\Formatter\Json
  *
  * Formats messages using JSON encoding
+ *
+ * The fixed fields are written directly, php_json_encode() is only used for values that need it
  */
 zend_class_entry *phalcon_logger_formatter_json_ce;
 
@@ -54,6 +58,74 @@ PHALCON_INIT_CLASS(Phalcon_Logger_Formatter_Json){
 	return SUCCESS;
 }
 
+/**
+ * Appends a JSON string, escaped the same way json_encode() does with the default options.
+ * Non ASCII input is left to the json extension
+ */
+static int phalcon_logger_formatter_json_append_str(smart_str *buf, const char *str, size_t len)
+{
+	static const char digits[] = "0123456789abcdef";
+	size_t start = buf->s ? ZSTR_LEN(buf->s) : 0, i;
+	unsigned char c;
+
+	smart_str_appendc(buf, '"');
+	for (i = 0; i < len; i++) {
+		c = (unsigned char)str[i];
+		if (c >= 0x80) {
+			ZSTR_LEN(buf->s) = start;
+			return FAILURE;
+		}
+
+		switch (c) {
+			case '"':  smart_str_appendl(buf, "\\\"", 2); break;
+			case '\\': smart_str_appendl(buf, "\\\\", 2); break;
+			case '/':  smart_str_appendl(buf, "\\/", 2); break;
+			case '\b': smart_str_appendl(buf, "\\b", 2); break;
+			case '\f': smart_str_appendl(buf, "\\f", 2); break;
+			case '\n': smart_str_appendl(buf, "\\n", 2); break;
+			case '\r': smart_str_appendl(buf, "\\r", 2); break;
+			case '\t': smart_str_appendl(buf, "\\t", 2); break;
+			default:
+				if (c < 0x20) {
+					smart_str_appendl(buf, "\\u00", 4);
+					smart_str_appendc(buf, digits[c >> 4]);
+					smart_str_appendc(buf, digits[c & 0xf]);
+				} else {
+					smart_str_appendc(buf, c);
+				}
+				break;
+		}
+	}
+	smart_str_appendc(buf, '"');
+
+	return SUCCESS;
+}
+
+static int phalcon_logger_formatter_json_append(smart_str *buf, zval *value)
+{
+	zval json = {};
+
+	if (Z_TYPE_P(value) == IS_LONG) {
+		smart_str_append_long(buf, Z_LVAL_P(value));
+		return SUCCESS;
+	}
+
+	if (Z_TYPE_P(value) == IS_STRING && phalcon_logger_formatter_json_append_str(buf, Z_STRVAL_P(value), Z_STRLEN_P(value)) == SUCCESS) {
+		return SUCCESS;
+	}
+
+	if (phalcon_json_encode(&json, value, 0) == FAILURE) {
+		return FAILURE;
+	}
+
+	if (Z_TYPE(json) == IS_STRING) {
+		smart_str_append(buf, Z_STR(json));
+	}
+	zval_ptr_dtor(&json);
+
+	return SUCCESS;
+}
+
 /**
  * Applies a format to a message before sent it to the internal log
  *
@@ -65,24 +137,57 @@ PHALCON_INIT_CLASS(Phalcon_Logger_Formatter_Json){
  */
 PHP_METHOD(Phalcon_Logger_Formatter_Json, format){
 
-	zval *message, *type, *timestamp, *context, interpolated = {}, type_str = {}, log = {}, json = {};
+	zval *message, *type, *timestamp, *context, interpolated = {}, type_string = {}, type_value = {};
+	smart_str buf = {0};
+	const char *type_str;
+	int status;
 
 	phalcon_fetch_params(0, 4, 0, &message, &type, &timestamp, &context);
 
 	if (Z_TYPE_P(context) == IS_ARRAY) {
 		PHALCON_CALL_METHOD(&interpolated, getThis(), "interpolate", message, context);
 	} else {
-		ZVAL_COPY_VALUE(&interpolated, message);
+		ZVAL_COPY(&interpolated, message);
 	}
 
-	PHALCON_CALL_METHOD(&type_str, getThis(), "gettypestring", type);
+	type_str = phalcon_logger_formatter_type_string(getThis(), type, &type_string);
 
-	array_init_size(&log, 3);
-	phalcon_array_update_str(&log, SL("type"), &type_str, PH_COPY);
-	phalcon_array_update_str(&log, SL("message"), &interpolated, PH_COPY);
-	phalcon_array_update_str(&log, SL("timestamp"), timestamp, PH_COPY);
+	/**
+	 * The fields are fixed, only the values need to be encoded
+	 */
+	smart_str_appendl(&buf, "{\"type\":", sizeof("{\"type\":") - 1);
+	if (type_str && Z_TYPE(type_string) == IS_UNDEF) {
+		status = phalcon_logger_formatter_json_append_str(&buf, type_str, strlen(type_str));
+	} else {
+		if (Z_TYPE(type_string) == IS_UNDEF) {
+			ZVAL_NULL(&type_value);
+		} else {
+			ZVAL_COPY_VALUE(&type_value, &type_string);
+		}
+		status = phalcon_logger_formatter_json_append(&buf, &type_value);
+	}
+
+	if (status == SUCCESS) {
+		smart_str_appendl(&buf, ",\"message\":", sizeof(",\"message\":") - 1);
+		status = phalcon_logger_formatter_json_append(&buf, &interpolated);
+	}
+
+	if (status == SUCCESS) {
+		smart_str_appendl(&buf, ",\"timestamp\":", sizeof(",\"timestamp\":") - 1);
+		status = phalcon_logger_formatter_json_append(&buf, timestamp);
+	}
+
+	zval_ptr_dtor(&type_string);
+	zval_ptr_dtor(&interpolated);
+
+	if (status == FAILURE) {
+		smart_str_free(&buf);
+		return;
+	}
 
-	RETURN_ON_FAILURE(phalcon_json_encode(&json, &log, 0));
+	smart_str_appendc(&buf, '}');
+	smart_str_appendl(&buf, PHP_EOL, sizeof(PHP_EOL) - 1);
+	smart_str_0(&buf);
 
-	PHALCON_CONCAT_VS(return_value, &json, PHP_EOL);
+	RETURN_NEW_STR(buf.s);
 }
@@ -20,6 +20,7 @@
 #include "logger/formatter/line.h"
 #include "logger/formatter.h"
 #include "logger/formatterinterface.h"
+#include "logger.h"
 
 #include <ext/date/php_date.h>
 
@@ -29,11 +30,15 @@
 #include "kernel/string.h"
 #include "kernel/fcall.h"
 #include "kernel/concat.h"
+#include "kernel/operators.h"
 
 /**
  * Phalcon\Logger\Formatter\Line
  *
  * Formats messages using an one-line string
+ *
+ * The format is compiled once into literal and placeholder segments, the lines are rendered into
+ * a buffer reused by every call and the formatted date is cached for the current second
  */
 zend_class_entry *phalcon_logger_formatter_line_ce;
 
@@ -67,12 +72,157 @@ static const zend_function_entry phalcon_logger_formatter_line_method_entry[] =
 	PHP_FE_END
 };
 
+zend_object_handlers phalcon_logger_formatter_line_object_handlers;
+zend_object* phalcon_logger_formatter_line_object_create_handler(zend_class_entry *ce)
+{
+	phalcon_logger_formatter_line_object *intern = ecalloc(1, sizeof(phalcon_logger_formatter_line_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_logger_formatter_line_object_handlers;
+
+	return &intern->std;
+}
+
+void phalcon_logger_formatter_line_object_free_handler(zend_object *object)
+{
+	phalcon_logger_formatter_line_object *intern = phalcon_logger_formatter_line_object_from_obj(object);
+
+	if (intern->format) {
+		zend_string_release(intern->format);
+	}
+	if (intern->segments) {
+		efree(intern->segments);
+	}
+	if (intern->date_format) {
+		zend_string_release(intern->date_format);
+	}
+	if (intern->date) {
+		zend_string_release(intern->date);
+	}
+	smart_str_free(&intern->buffer);
+
+	zend_object_std_dtor(object);
+}
+
+static void phalcon_logger_formatter_line_add_segment(phalcon_logger_formatter_line_object *intern, int type, size_t offset, size_t len)
+{
+	if ((intern->num_segments & 7) == 0) {
+		intern->segments = erealloc(intern->segments, (intern->num_segments + 8) * sizeof(phalcon_logger_formatter_line_segment));
+	}
+
+	intern->segments[intern->num_segments].type = type;
+	intern->segments[intern->num_segments].offset = offset;
+	intern->segments[intern->num_segments].len = len;
+	intern->num_segments++;
+}
+
+/**
+ * Splits the format into literal and placeholder segments
+ */
+static void phalcon_logger_formatter_line_compile(phalcon_logger_formatter_line_object *intern, zend_string *format)
+{
+	static const struct {
+		const char *name;
+		size_t len;
+		int type;
+	} placeholders[] = {
+		{ "%date%",    sizeof("%date%") - 1,    PHALCON_LOGGER_FORMATTER_LINE_DATE    },
+		{ "%type%",    sizeof("%type%") - 1,    PHALCON_LOGGER_FORMATTER_LINE_TYPE    },
+		{ "%message%", sizeof("%message%") - 1, PHALCON_LOGGER_FORMATTER_LINE_MESSAGE }
+	};
+
+	const char *start = ZSTR_VAL(format), *end = start + ZSTR_LEN(format), *p = start, *literal = start;
+	int i;
+
+	if (intern->format) {
+		zend_string_release(intern->format);
+	}
+	if (intern->segments) {
+		efree(intern->segments);
+		intern->segments = NULL;
+	}
+	intern->num_segments = 0;
+
+	while (p < end) {
+		p = memchr(p, '%', end - p);
+		if (!p) {
+			break;
+		}
+
+		for (i = 0; i < 3; i++) {
+			if ((size_t)(end - p) >= placeholders[i].len && !memcmp(p, placeholders[i].name, placeholders[i].len)) {
+				break;
+			}
+		}
+
+		if (i == 3) {
+			p++;
+			continue;
+		}
+
+		if (p > literal) {
+			phalcon_logger_formatter_line_add_segment(intern, PHALCON_LOGGER_FORMATTER_LINE_LITERAL, literal - start, p - literal);
+		}
+		phalcon_logger_formatter_line_add_segment(intern, placeholders[i].type, 0, 0);
+
+		p += placeholders[i].len;
+		literal = p;
+	}
+
+	if (end > literal) {
+		phalcon_logger_formatter_line_add_segment(intern, PHALCON_LOGGER_FORMATTER_LINE_LITERAL, literal - start, end - literal);
+	}
+
+	intern->format = zend_string_copy(format);
+}
+
+/**
+ * Returns the formatted date, reusing the last one while the timestamp does not change
+ */
+static zend_string *phalcon_logger_formatter_line_date(phalcon_logger_formatter_line_object *intern, zval *date_format, zval *timestamp)
+{
+	zval date = {};
+
+	if (intern->date && Z_TYPE_P(timestamp) == IS_LONG && intern->date_timestamp == Z_LVAL_P(timestamp)
+		&& Z_TYPE_P(date_format) == IS_STRING && zend_string_equals(intern->date_format, Z_STR_P(date_format))) {
+		return intern->date;
+	}
+
+	phalcon_date(&date, date_format, timestamp);
+	if (Z_TYPE(date) != IS_STRING) {
+		convert_to_string(&date);
+	}
+
+	if (intern->date) {
+		zend_string_release(intern->date);
+		intern->date = NULL;
+	}
+	if (intern->date_format) {
+		zend_string_release(intern->date_format);
+		intern->date_format = NULL;
+	}
+
+	intern->date = Z_STR(date);
+	if (Z_TYPE_P(timestamp) == IS_LONG && Z_TYPE_P(date_format) == IS_STRING) {
+		intern->date_timestamp = Z_LVAL_P(timestamp);
+		intern->date_format = zend_string_copy(Z_STR_P(date_format));
+	} else {
+		/* Not cacheable, the next call formats the date again */
+		intern->date_timestamp = -1;
+		intern->date_format = ZSTR_EMPTY_ALLOC();
+	}
+
+	return intern->date;
+}
+
 /**
  * Phalcon\Logger\Formatter\Line initializer
  */
 PHALCON_INIT_CLASS(Phalcon_Logger_Formatter_Line){
 
-	PHALCON_REGISTER_CLASS_EX(Phalcon\\Logger\\Formatter, Line, logger_formatter_line, phalcon_logger_formatter_ce, phalcon_logger_formatter_line_method_entry, 0);
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT_EX(Phalcon\\Logger\\Formatter, Line, logger_formatter_line, phalcon_logger_formatter_ce, phalcon_logger_formatter_line_method_entry, 0);
 
 	zend_declare_property_string(phalcon_logger_formatter_line_ce, SL("_dateFormat"), "D, d M y H:i:s O", ZEND_ACC_PROTECTED);
 	zend_declare_property_string(phalcon_logger_formatter_line_ce, SL("_format"), "[%date%][%type%] %message%", ZEND_ACC_PROTECTED);
@@ -166,49 +316,71 @@ PHP_METHOD(Phalcon_Logger_Formatter_Line, getDateFormat){
  */
 PHP_METHOD(Phalcon_Logger_Formatter_Line, format){
 
-	zval *message, *type, *timestamp, *context, format = {}, date_format = {}, date = {}, date_wildcard = {}, new_format = {}, type_string = {}, type_wildcard = {}, message_wildcard = {};
+	zval *message, *type, *timestamp, *context, format = {}, date_format = {}, type_string = {}, line = {}, interpolated = {};
+	phalcon_logger_formatter_line_object *intern;
+	phalcon_logger_formatter_line_segment *segment;
+	zend_string *format_str, *message_str, *date;
+	const char *type_str;
+	int i, interpolate;
 
 	phalcon_fetch_params(0, 4, 0, &message, &type, &timestamp, &context);
 
-	phalcon_read_property(&format, getThis(), SL("_format"), PH_READONLY);
+	intern = phalcon_logger_formatter_line_object_from_obj(Z_OBJ_P(getThis()));
 
-	/**
-	 * Check if the format has the %date% placeholder
-	 */
-	if (phalcon_memnstr_str(&format, SL("%date%"))) {
-		phalcon_read_property(&date_format, getThis(), SL("_dateFormat"), PH_READONLY);
-
-		phalcon_date(&date, &date_format, timestamp);
-
-		ZVAL_STRING(&date_wildcard, "%date%");
+	phalcon_read_property(&format, getThis(), SL("_format"), PH_READONLY);
 
-		PHALCON_STR_REPLACE(&new_format, &date_wildcard, &date, &format);
-	} else {
-		ZVAL_COPY_VALUE(&new_format, &format);
+	format_str = zval_get_string(&format);
+	if (!intern->format || !zend_string_equals(intern->format, format_str)) {
+		phalcon_logger_formatter_line_compile(intern, format_str);
 	}
+	zend_string_release(format_str);
 
-	/**
-	 * Check if the format has the %type% placeholder
-	 */
-	if (phalcon_memnstr_str(&format, SL("%type%"))) {
-		PHALCON_CALL_METHOD(&type_string, getThis(), "gettypestring", type);
-
-		ZVAL_STRING(&type_wildcard, "%type%");
+	message_str = zval_get_string(message);
+	interpolate = Z_TYPE_P(context) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(context)) > 0;
 
-		PHALCON_STR_REPLACE(&format, &type_wildcard, &type_string, &new_format);
-	} else {
-		ZVAL_COPY_VALUE(&format, &new_format);
+	if (intern->buffer.s) {
+		ZSTR_LEN(intern->buffer.s) = 0;
 	}
 
-	ZVAL_STRING(&message_wildcard, "%message%");
+	for (i = 0; i < intern->num_segments; i++) {
+		segment = &intern->segments[i];
+		switch (segment->type) {
+			case PHALCON_LOGGER_FORMATTER_LINE_DATE:
+				phalcon_read_property(&date_format, getThis(), SL("_dateFormat"), PH_READONLY);
+				date = phalcon_logger_formatter_line_date(intern, &date_format, timestamp);
+				smart_str_append(&intern->buffer, date);
+				break;
+
+			case PHALCON_LOGGER_FORMATTER_LINE_TYPE:
+				type_str = phalcon_logger_formatter_type_string(getThis(), type, &type_string);
+				if (type_str) {
+					smart_str_appends(&intern->buffer, type_str);
+				}
+				zval_ptr_dtor(&type_string);
+				ZVAL_UNDEF(&type_string);
+				break;
+
+			case PHALCON_LOGGER_FORMATTER_LINE_MESSAGE:
+				smart_str_append(&intern->buffer, message_str);
+				break;
+
+			default:
+				smart_str_appendl(&intern->buffer, ZSTR_VAL(intern->format) + segment->offset, segment->len);
+				break;
+		}
+	}
 
-	PHALCON_STR_REPLACE(&new_format, &message_wildcard, message, &format);
+	zend_string_release(message_str);
 
-	if (Z_TYPE_P(context) == IS_ARRAY && zend_hash_num_elements(Z_ARRVAL_P(context)) > 0) {
-		PHALCON_CALL_METHOD(&format, getThis(), "interpolate", &new_format, context);
-	} else {
-		ZVAL_COPY_VALUE(&format, &new_format);
+	if (!interpolate) {
+		smart_str_appendl(&intern->buffer, PHP_EOL, sizeof(PHP_EOL) - 1);
+		RETURN_STRINGL(intern->buffer.s ? ZSTR_VAL(intern->buffer.s) : "", intern->buffer.s ? ZSTR_LEN(intern->buffer.s) : 0);
 	}
 
-	PHALCON_CONCAT_VS(return_value, &format, PHP_EOL);
+	ZVAL_STRINGL(&line, intern->buffer.s ? ZSTR_VAL(intern->buffer.s) : "", intern->buffer.s ? ZSTR_LEN(intern->buffer.s) : 0);
+	PHALCON_CALL_METHOD(&interpolated, getThis(), "interpolate", &line, context);
+	zval_ptr_dtor(&line);
+
+	PHALCON_CONCAT_VS(return_value, &interpolated, PHP_EOL);
+	zval_ptr_dtor(&interpolated);
 }
@@ -22,6 +22,34 @@
 
 #include "php_phalcon.h"
 
+#include <Zend/zend_smart_str.h>
+
+#define PHALCON_LOGGER_FORMATTER_LINE_LITERAL  0
+#define PHALCON_LOGGER_FORMATTER_LINE_DATE     1
+#define PHALCON_LOGGER_FORMATTER_LINE_TYPE     2
+#define PHALCON_LOGGER_FORMATTER_LINE_MESSAGE  3
+
+typedef struct {
+	int type;
+	size_t offset;
+	size_t len;
+} phalcon_logger_formatter_line_segment;
+
+typedef struct {
+	zend_string *format;
+	phalcon_logger_formatter_line_segment *segments;
+	int num_segments;
+	zend_string *date_format;
+	zend_long date_timestamp;
+	zend_string *date;
+	smart_str buffer;
+	zend_object std;
+} phalcon_logger_formatter_line_object;
+
+static inline phalcon_logger_formatter_line_object *phalcon_logger_formatter_line_object_from_obj(zend_object *obj) {
+	return (phalcon_logger_formatter_line_object*)((char*)(obj) - XtOffsetOf(phalcon_logger_formatter_line_object, std));
+}
+
 extern zend_class_entry *phalcon_logger_formatter_line_ce;
 
 PHALCON_INIT_CLASS(Phalcon_Logger_Formatter_Line);
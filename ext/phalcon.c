@@ -90,6 +90,8 @@ PHP_INI_BEGIN()
 	STD_PHP_INI_BOOLEAN("phalcon.cache.enable_yac_cli",         "0",   PHP_INI_ALL,    OnUpdateBool, cache.enable_yac_cli,      zend_phalcon_globals, phalcon_globals)
     STD_PHP_INI_ENTRY("phalcon.cache.yac_keys_size",            "4M",  PHP_INI_SYSTEM, OnChangeKeysMemoryLimit, cache.yac_keys_size,       zend_phalcon_globals, phalcon_globals)
     STD_PHP_INI_ENTRY("phalcon.cache.yac_values_size",          "64M", PHP_INI_SYSTEM, OnChangeValsMemoryLimit, cache.yac_values_size,     zend_phalcon_globals, phalcon_globals)
+	/* C stack size of a coroutine */
+	STD_PHP_INI_ENTRY("phalcon.coroutine.stack_size",      "256K", PHP_INI_ALL, OnUpdateLong, coroutine.stack_size,	zend_phalcon_globals, phalcon_globals)
 	/* Enables/Disables xhprof */
 	STD_PHP_INI_ENTRY("phalcon.xhprof.nesting_max_level", "0",  PHP_INI_ALL, OnUpdateLong, xhprof.nesting_maximum_level,	zend_phalcon_globals, phalcon_globals)
 	STD_PHP_INI_BOOLEAN("phalcon.xhprof.enable_xhprof",   "0",  PHP_INI_ALL, OnUpdateBool, xhprof.enable_xhprof,	zend_phalcon_globals, phalcon_globals)
@@ -391,6 +393,9 @@ static PHP_MINIT_FUNCTION(phalcon)
 	PHALCON_INIT(Phalcon_Cache_Backend_Memcached);
 	PHALCON_INIT(Phalcon_Cache_Backend_Redis);
 	PHALCON_INIT(Phalcon_Cache_Backend_Yac);
+#ifdef PHALCON_CACHE_YAC
+	PHALCON_INIT(Phalcon_Cache_Backend_Shm);
+#endif
 #if PHALCON_USE_WIREDTIGER
 	PHALCON_INIT(Phalcon_Cache_Backend_Wiredtiger);
 #endif
@@ -463,6 +468,7 @@ static PHP_MINIT_FUNCTION(phalcon)
 	PHALCON_INIT(Phalcon_Session_Adapter_Files);
 	PHALCON_INIT(Phalcon_Session_Adapter_Memcached);
 	PHALCON_INIT(Phalcon_Session_Adapter_Cache);
+	PHALCON_INIT(Phalcon_Session_Adapter_Shm);
 	PHALCON_INIT(Phalcon_Filter);
 	PHALCON_INIT(Phalcon_Flash_Direct);
 	PHALCON_INIT(Phalcon_Flash_Session);
@@ -474,6 +480,9 @@ static PHP_MINIT_FUNCTION(phalcon)
 	PHALCON_INIT(Phalcon_Annotations_Adapter_Files);
 	PHALCON_INIT(Phalcon_Annotations_Adapter_Memory);
 	PHALCON_INIT(Phalcon_Annotations_Adapter_Cache);
+#ifdef PHALCON_CACHE_YAC
+	PHALCON_INIT(Phalcon_Annotations_Adapter_Yac);
+#endif
 	PHALCON_INIT(Phalcon_Loader);
 	PHALCON_INIT(Phalcon_Logger);
 	PHALCON_INIT(Phalcon_Logger_Item);
@@ -665,6 +674,7 @@ static PHP_MINIT_FUNCTION(phalcon)
 
 #ifdef PHALCON_STORAGE_BTREE
 	PHALCON_INIT(Phalcon_Storage_Btree);
+	PHALCON_INIT(Phalcon_Storage_Btree_Iterator);
 #endif
 
 #if PHALCON_USE_WIREDTIGER
@@ -675,10 +685,12 @@ static PHP_MINIT_FUNCTION(phalcon)
 #if PHALCON_USE_LMDB
 	PHALCON_INIT(Phalcon_Storage_Lmdb);
 	PHALCON_INIT(Phalcon_Storage_Lmdb_Cursor);
+	PHALCON_INIT(Phalcon_Storage_Lmdb_View);
 #endif
 #if PHALCON_USE_LIBMDBX
 	PHALCON_INIT(Phalcon_Storage_Libmdbx);
 	PHALCON_INIT(Phalcon_Storage_Libmdbx_Cursor);
+	PHALCON_INIT(Phalcon_Storage_Libmdbx_View);
 #endif
 
 #if PHALCON_USE_LEVELDB
@@ -689,6 +701,7 @@ static PHP_MINIT_FUNCTION(phalcon)
 
 #if PHALCON_USE_BLOOMFILTER
 	PHALCON_INIT(Phalcon_Storage_Bloomfilter);
+	PHALCON_INIT(Phalcon_Storage_Bloomfilter_Blocked);
 # ifdef ZEND_ENABLE_ZVAL_LONG64
 	PHALCON_INIT(Phalcon_Storage_Bloomfilter_Counting);
 # endif
@@ -704,6 +717,14 @@ static PHP_MINIT_FUNCTION(phalcon)
 #endif
 	PHALCON_INIT(Phalcon_Server_Simple);
 
+#ifdef PHALCON_USE_COROUTINE
+	PHALCON_INIT(Phalcon_Coroutine_Exception);
+	PHALCON_INIT(Phalcon_Coroutine);
+	PHALCON_INIT(Phalcon_Coroutine_Channel);
+	PHALCON_INIT(Phalcon_Coroutine_Socket);
+	PHALCON_INIT(Phalcon_Coroutine_Client);
+#endif
+
 #if PHALCON_USE_PYTHON
 	PHALCON_INIT(Phalcon_Py);
 	PHALCON_INIT(Phalcon_Py_Object);
@@ -778,6 +799,10 @@ static PHP_RSHUTDOWN_FUNCTION(phalcon){
 		tracing_request_shutdown();
 	}
 
+#ifdef PHALCON_USE_COROUTINE
+	phalcon_coroutine_shutdown();
+#endif
+
 	phalcon_deinitialize_memory();
 	phalcon_release_interned_strings();
 
@@ -887,6 +912,10 @@ static PHP_MINFO_FUNCTION(phalcon)
 	php_info_print_table_row(2, "Server", "enabled");
 #endif
 
+#ifdef PHALCON_USE_COROUTINE
+	php_info_print_table_row(2, "Coroutine", "enabled");
+#endif
+
 #if PHALCON_USE_PYTHON
 	php_info_print_table_row(2, "Python", "enabled");
 #endif
@@ -906,6 +935,7 @@ static PHP_GINIT_FUNCTION(phalcon)
 	phalcon_globals->cache.yac_keys_size = (4 * 1024 * 1024);
 	phalcon_globals->cache.yac_values_size = (64 * 1024 * 1024);
 #endif
+	phalcon_globals->http.pool = NULL;
 	phalcon_globals->xhprof.root = NULL;
 	phalcon_globals->xhprof.callgraph_frames = NULL;
 	phalcon_globals->xhprof.frame_free_list = NULL;
@@ -915,6 +945,12 @@ static PHP_GINIT_FUNCTION(phalcon)
 
 static PHP_GSHUTDOWN_FUNCTION(phalcon)
 {
+	if (phalcon_globals->http.pool) {
+		zend_hash_destroy(phalcon_globals->http.pool);
+		pefree(phalcon_globals->http.pool, 1);
+		phalcon_globals->http.pool = NULL;
+	}
+
 	phalcon_deinitialize_memory();
 }
 
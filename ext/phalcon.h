@@ -28,6 +28,7 @@
 #include "annotations/adapter/files.h"
 #include "annotations/adapter/memory.h"
 #include "annotations/adapter/cache.h"
+#include "annotations/adapter/yac.h"
 #include "annotations/annotation.h"
 #include "annotations/collection.h"
 #include "annotations/exception.h"
@@ -55,6 +56,7 @@
 #include "cache/backend/mongo.h"
 #include "cache/backend/redis.h"
 #include "cache/backend/yac.h"
+#include "cache/backend/shm.h"
 #include "cache/backend/wiredtiger.h"
 #include "cache/backend/lmdb.h"
 #include "cache/exception.h"
@@ -370,6 +372,7 @@
 #include "session/exception.h"
 #include "session/adapter/memcached.h"
 #include "session/adapter/cache.h"
+#include "session/adapter/shm.h"
 
 #include "tag.h"
 #include "tag/exception.h"
@@ -461,15 +464,19 @@
 
 #include "storage/exception.h"
 #include "storage/btree.h"
+#include "storage/btree/iterator.h"
 #include "storage/wiredtiger.h"
 #include "storage/wiredtiger/cursor.h"
 #include "storage/bloomfilter.h"
 #include "storage/bloomfilter/counting.h"
+#include "storage/bloomfilter/blocked.h"
 #include "storage/datrie.h"
 #include "storage/lmdb.h"
 #include "storage/lmdb/cursor.h"
+#include "storage/lmdb/view.h"
 #include "storage/libmdbx.h"
 #include "storage/libmdbx/cursor.h"
+#include "storage/libmdbx/view.h"
 #include "storage/leveldb.h"
 #include "storage/leveldb/iterator.h"
 #include "storage/leveldb/writebatch.h"
@@ -479,6 +486,12 @@
 #include "server/http.h"
 #include "server/simple.h"
 
+#include "coroutine.h"
+#include "coroutine/exception.h"
+#include "coroutine/channel.h"
+#include "coroutine/socket.h"
+#include "coroutine/client.h"
+
 #include "py/common.h"
 #include "py.h"
 #include "py/object.h"
@@ -94,6 +94,30 @@ typedef struct _phalcon_cache_options {
 	size_t yac_values_size;
 } phalcon_cache_options;
 
+/** HTTP client options */
+typedef struct _phalcon_http_options {
+	HashTable *pool;
+} phalcon_http_options;
+
+/** Coroutine options */
+struct _phalcon_coroutine;
+
+typedef struct _phalcon_coroutine_options {
+	/* coroutine being run, NULL in the main context */
+	struct _phalcon_coroutine *current;
+	/* coroutines not finished yet */
+	struct _phalcon_coroutine *head;
+	zend_long last_id;
+	zend_long count;
+	/* first uncaught exception, rethrown by wait() */
+	zend_object *exception;
+	JMP_BUF *bailout;
+	int running;
+	int shutdown;
+	/* C stack of every coroutine, phalcon.coroutine.stack_size */
+	zend_long stack_size;
+} phalcon_coroutine_options;
+
 /** Xhprof options */
 
 #define PHALCON_XHPROF_CALLGRAPH_COUNTER_SIZE 1024
@@ -203,6 +227,12 @@ ZEND_BEGIN_MODULE_GLOBALS(phalcon)
 	/** Cache */
 	phalcon_cache_options cache;
 
+	/** HTTP client */
+	phalcon_http_options http;
+
+	/** Coroutine */
+	phalcon_coroutine_options coroutine;
+
 	/** Xhprof */
 	phalcon_xhprof_options xhprof;
 
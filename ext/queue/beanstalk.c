@@ -34,6 +34,8 @@
 #include "kernel/concat.h"
 #include "kernel/operators.h"
 
+#include <Zend/zend_smart_str.h>
+
 /**
  * Phalcon\Queue\Beanstalk
  *
@@ -47,7 +49,12 @@ zend_class_entry *phalcon_queue_beanstalk_ce;
 PHP_METHOD(Phalcon_Queue_Beanstalk, __construct);
 PHP_METHOD(Phalcon_Queue_Beanstalk, connect);
 PHP_METHOD(Phalcon_Queue_Beanstalk, put);
+PHP_METHOD(Phalcon_Queue_Beanstalk, putMany);
 PHP_METHOD(Phalcon_Queue_Beanstalk, reserve);
+PHP_METHOD(Phalcon_Queue_Beanstalk, reserveMany);
+PHP_METHOD(Phalcon_Queue_Beanstalk, reserveAsync);
+PHP_METHOD(Phalcon_Queue_Beanstalk, poll);
+PHP_METHOD(Phalcon_Queue_Beanstalk, getConnection);
 PHP_METHOD(Phalcon_Queue_Beanstalk, choose);
 PHP_METHOD(Phalcon_Queue_Beanstalk, watch);
 PHP_METHOD(Phalcon_Queue_Beanstalk, stats);
@@ -72,10 +79,20 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_queue_beanstalk_put, 0, 0, 1)
 	ZEND_ARG_INFO(0, options)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_queue_beanstalk_putmany, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, jobs, IS_ARRAY, 0)
+	ZEND_ARG_INFO(0, options)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_queue_beanstalk_reserve, 0, 0, 0)
 	ZEND_ARG_INFO(0, timeout)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_queue_beanstalk_reservemany, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, count, IS_LONG, 0)
+	ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_queue_beanstalk_choose, 0, 0, 1)
 	ZEND_ARG_INFO(0, tube)
 ZEND_END_ARG_INFO()
@@ -96,7 +113,12 @@ static const zend_function_entry phalcon_queue_beanstalk_method_entry[] = {
 	PHP_ME(Phalcon_Queue_Beanstalk, __construct, arginfo_phalcon_queue_beanstalk___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Queue_Beanstalk, connect, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Queue_Beanstalk, put, arginfo_phalcon_queue_beanstalk_put, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Queue_Beanstalk, putMany, arginfo_phalcon_queue_beanstalk_putmany, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Queue_Beanstalk, reserve, arginfo_phalcon_queue_beanstalk_reserve, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Queue_Beanstalk, reserveMany, arginfo_phalcon_queue_beanstalk_reservemany, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Queue_Beanstalk, reserveAsync, arginfo_phalcon_queue_beanstalk_reserve, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Queue_Beanstalk, poll, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Queue_Beanstalk, getConnection, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Queue_Beanstalk, choose, arginfo_phalcon_queue_beanstalk_choose, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Queue_Beanstalk, watch, arginfo_phalcon_queue_beanstalk_watch, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Queue_Beanstalk, stats, NULL, ZEND_ACC_PUBLIC)
@@ -123,6 +145,8 @@ PHALCON_INIT_CLASS(Phalcon_Queue_Beanstalk){
 
 	zend_declare_property_null(phalcon_queue_beanstalk_ce, SL("_connection"), ZEND_ACC_PROTECTED);
 	zend_declare_property_null(phalcon_queue_beanstalk_ce, SL("_parameters"), ZEND_ACC_PROTECTED);
+	zend_declare_property_long(phalcon_queue_beanstalk_ce, SL("_pending"), 0, ZEND_ACC_PROTECTED);
+	zend_declare_property_string(phalcon_queue_beanstalk_ce, SL("_buffer"), "", ZEND_ACC_PROTECTED);
 
 	return SUCCESS;
 }
@@ -213,8 +237,86 @@ PHP_METHOD(Phalcon_Queue_Beanstalk, connect){
 
 		php_stream_to_zval(stream, &new_connection);
 		phalcon_update_property(getThis(), SL("_connection"), &new_connection);
-		RETVAL_ZVAL(&connection, 1, 1);
+		phalcon_update_property_long(getThis(), SL("_pending"), 0);
+		phalcon_update_property_str(getThis(), SL("_buffer"), SL(""));
+		RETVAL_ZVAL(&new_connection, 0, 0);
+	}
+}
+
+/**
+ * Returns the stream of the connection, connecting first if needed
+ */
+static php_stream *phalcon_queue_beanstalk_stream(zval *this_ptr)
+{
+	zval connection = {};
+	php_stream *stream;
+	int flag;
+
+	phalcon_read_property(&connection, this_ptr, SL("_connection"), PH_READONLY);
+	if (Z_TYPE(connection) != IS_RESOURCE) {
+		PHALCON_CALL_METHOD_FLAG(flag, NULL, this_ptr, "connect");
+		if (flag == FAILURE) {
+			return NULL;
+		}
+
+		phalcon_read_property(&connection, this_ptr, SL("_connection"), PH_READONLY);
+		if (Z_TYPE(connection) != IS_RESOURCE) {
+			return NULL;
+		}
 	}
+
+	php_stream_from_zval_no_verify(stream, &connection);
+	return stream;
+}
+
+/**
+ * Writes the buffered put commands at once, then reads their statuses in order
+ */
+static void phalcon_queue_beanstalk_flush_puts(zval *return_value, zval *this_ptr, php_stream *stream, smart_str *buffer, zval *keys)
+{
+	zval *key, response = {}, status = {}, job_id = {};
+
+	if (!buffer->s) {
+		return;
+	}
+
+	php_stream_write(stream, ZSTR_VAL(buffer->s), ZSTR_LEN(buffer->s));
+	smart_str_free(buffer);
+
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(keys), key) {
+		zval value = {};
+
+		PHALCON_CALL_METHOD(&response, this_ptr, "readstatus");
+
+		if (phalcon_array_isset_fetch_long(&status, &response, 0, PH_READONLY)
+			&& (PHALCON_IS_STRING(&status, "INSERTED") || PHALCON_IS_STRING(&status, "BURIED"))
+			&& phalcon_array_isset_fetch_long(&job_id, &response, 1, PH_READONLY)) {
+			ZVAL_COPY(&value, &job_id);
+		} else {
+			ZVAL_FALSE(&value);
+		}
+		zval_ptr_dtor(&response);
+
+		phalcon_array_update(return_value, key, &value, 0);
+	} ZEND_HASH_FOREACH_END();
+
+	zend_hash_clean(Z_ARRVAL_P(keys));
+}
+
+/**
+ * Builds a job from a RESERVED or FOUND status and the body that follows it
+ */
+static void phalcon_queue_beanstalk_job(zval *return_value, zval *this_ptr, zval *job_id, const char *data, size_t length)
+{
+	zval serialized = {}, body = {};
+
+	ZVAL_STRINGL(&serialized, data, length);
+	phalcon_unserialize(&body, &serialized);
+	zval_ptr_dtor(&serialized);
+
+	object_init_ex(return_value, phalcon_queue_beanstalk_job_ce);
+	PHALCON_CALL_METHOD(NULL, return_value, "__construct", this_ptr, job_id, &body);
+	zval_ptr_dtor(&body);
 }
 
 /**
@@ -285,6 +387,103 @@ PHP_METHOD(Phalcon_Queue_Beanstalk, put){
 	zval_ptr_dtor(&response);
 }
 
+/**
+ * Inserts several jobs into the queue, the commands are pipelined so that
+ * a batch costs one round trip instead of one per job
+ *
+ *<code>
+ *	$ids = $queue->putMany(array('job1' => $data1, 'job2' => $data2), array('priority' => 10));
+ *</code>
+ *
+ * @param array $jobs
+ * @param array $options
+ * @return array the job ids, or false for the jobs that were not inserted, under the keys of $jobs
+ */
+PHP_METHOD(Phalcon_Queue_Beanstalk, putMany){
+
+	zval *jobs, *options = NULL, value = {}, keys = {}, *data;
+	zend_long priority = 100, delay = 0, ttr = 86400;
+	zend_string *str_key;
+	ulong idx;
+	smart_str buffer = {0};
+	php_stream *stream;
+
+	phalcon_fetch_params(0, 1, 1, &jobs, &options);
+
+	if (options && Z_TYPE_P(options) == IS_ARRAY) {
+		if (phalcon_array_isset_fetch_str(&value, options, SL("priority"), PH_READONLY)) {
+			priority = phalcon_get_intval(&value);
+		}
+		if (phalcon_array_isset_fetch_str(&value, options, SL("delay"), PH_READONLY)) {
+			delay = phalcon_get_intval(&value);
+		}
+		if (phalcon_array_isset_fetch_str(&value, options, SL("ttr"), PH_READONLY)) {
+			ttr = phalcon_get_intval(&value);
+		}
+	}
+
+	array_init(return_value);
+
+	if (!zend_hash_num_elements(Z_ARRVAL_P(jobs))) {
+		return;
+	}
+
+	stream = phalcon_queue_beanstalk_stream(getThis());
+	if (!stream) {
+		zval_ptr_dtor(return_value);
+		RETURN_FALSE;
+	}
+
+	array_init(&keys);
+
+	ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL_P(jobs), idx, str_key, data) {
+		zval serialized = {}, key = {};
+
+		if (str_key) {
+			ZVAL_STR_COPY(&key, str_key);
+		} else {
+			ZVAL_LONG(&key, idx);
+		}
+
+		phalcon_serialize(&serialized, data);
+		if (Z_TYPE(serialized) != IS_STRING) {
+			phalcon_array_update(return_value, &key, &PHALCON_GLOBAL(z_false), PH_COPY);
+			zval_ptr_dtor(&serialized);
+			zval_ptr_dtor(&key);
+			continue;
+		}
+
+		smart_str_appendl(&buffer, "put ", 4);
+		smart_str_append_long(&buffer, priority);
+		smart_str_appendc(&buffer, ' ');
+		smart_str_append_long(&buffer, delay);
+		smart_str_appendc(&buffer, ' ');
+		smart_str_append_long(&buffer, ttr);
+		smart_str_appendc(&buffer, ' ');
+		smart_str_append_long(&buffer, Z_STRLEN(serialized));
+		smart_str_appendl(&buffer, "\r\n", 2);
+		smart_str_append(&buffer, Z_STR(serialized));
+		smart_str_appendl(&buffer, "\r\n", 2);
+		zval_ptr_dtor(&serialized);
+
+		phalcon_array_append(&keys, &key, 0);
+
+		if (zend_hash_num_elements(Z_ARRVAL(keys)) >= PHALCON_QUEUE_BEANSTALK_PIPELINE) {
+			phalcon_queue_beanstalk_flush_puts(return_value, getThis(), stream, &buffer, &keys);
+			if (EG(exception)) {
+				break;
+			}
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	if (!EG(exception)) {
+		phalcon_queue_beanstalk_flush_puts(return_value, getThis(), stream, &buffer, &keys);
+	}
+
+	smart_str_free(&buffer);
+	zval_ptr_dtor(&keys);
+}
+
 /**
  * Reserves a job in the queue
  *
@@ -340,6 +539,194 @@ PHP_METHOD(Phalcon_Queue_Beanstalk, reserve){
 	zval_ptr_dtor(&response);
 }
 
+/**
+ * Reserves up to $count jobs at once. Only the first reserve waits for
+ * $timeout (indefinitely when null), the others are sent with a zero
+ * timeout and return whatever is ready right after it
+ *
+ * @param int $count
+ * @param int $timeout
+ * @return array
+ */
+PHP_METHOD(Phalcon_Queue_Beanstalk, reserveMany){
+
+	zval *count, *timeout = NULL, response = {}, status = {}, job_id = {}, length = {}, serialized_body = {};
+	zend_long n, i, batch, j;
+	smart_str buffer = {0};
+	php_stream *stream;
+
+	phalcon_fetch_params(0, 1, 1, &count, &timeout);
+
+	n = phalcon_get_intval(count);
+
+	array_init(return_value);
+
+	if (n <= 0) {
+		return;
+	}
+
+	stream = phalcon_queue_beanstalk_stream(getThis());
+	if (!stream) {
+		zval_ptr_dtor(return_value);
+		RETURN_FALSE;
+	}
+
+	for (i = 0; i < n; i += batch) {
+		batch = n - i < PHALCON_QUEUE_BEANSTALK_PIPELINE ? n - i : PHALCON_QUEUE_BEANSTALK_PIPELINE;
+
+		for (j = 0; j < batch; j++) {
+			if (i + j > 0) {
+				smart_str_appends(&buffer, "reserve-with-timeout 0\r\n");
+			} else if (timeout && Z_TYPE_P(timeout) != IS_NULL) {
+				smart_str_appends(&buffer, "reserve-with-timeout ");
+				smart_str_append_long(&buffer, phalcon_get_intval(timeout));
+				smart_str_appendl(&buffer, "\r\n", 2);
+			} else {
+				smart_str_appends(&buffer, "reserve\r\n");
+			}
+		}
+
+		php_stream_write(stream, ZSTR_VAL(buffer.s), ZSTR_LEN(buffer.s));
+		smart_str_free(&buffer);
+
+		for (j = 0; j < batch; j++) {
+			PHALCON_CALL_METHOD(&response, getThis(), "readstatus");
+
+			if (phalcon_array_isset_fetch_long(&status, &response, 0, PH_READONLY) && PHALCON_IS_STRING(&status, "RESERVED")) {
+				zval job = {};
+
+				phalcon_array_fetch_long(&job_id, &response, 1, PH_NOISY|PH_READONLY);
+				phalcon_array_fetch_long(&length, &response, 2, PH_NOISY|PH_READONLY);
+
+				PHALCON_CALL_METHOD(&serialized_body, getThis(), "read", &length);
+				if (Z_TYPE(serialized_body) == IS_STRING) {
+					phalcon_queue_beanstalk_job(&job, getThis(), &job_id, Z_STRVAL(serialized_body), Z_STRLEN(serialized_body));
+					phalcon_array_append(return_value, &job, 0);
+				}
+				zval_ptr_dtor(&serialized_body);
+			}
+			zval_ptr_dtor(&response);
+		}
+
+		/* fewer jobs than reserves were ready, the next batch would come back empty */
+		if (zend_hash_num_elements(Z_ARRVAL_P(return_value)) < i + batch) {
+			break;
+		}
+	}
+}
+
+/**
+ * Sends a reserve command without waiting for its response, which is
+ * collected later by poll(). Meant to be driven from an event loop watching
+ * getConnection(), blocking calls must not be mixed in while a reserve is pending
+ *
+ * @param int $timeout
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Queue_Beanstalk, reserveAsync){
+
+	zval *timeout = NULL, pending = {};
+	smart_str command = {0};
+	php_stream *stream;
+
+	phalcon_fetch_params(0, 0, 1, &timeout);
+
+	stream = phalcon_queue_beanstalk_stream(getThis());
+	if (!stream) {
+		RETURN_FALSE;
+	}
+
+	if (timeout && Z_TYPE_P(timeout) != IS_NULL) {
+		smart_str_appends(&command, "reserve-with-timeout ");
+		smart_str_append_long(&command, phalcon_get_intval(timeout));
+		smart_str_appendl(&command, "\r\n", 2);
+	} else {
+		smart_str_appends(&command, "reserve\r\n");
+	}
+
+	php_stream_write(stream, ZSTR_VAL(command.s), ZSTR_LEN(command.s));
+	smart_str_free(&command);
+
+	phalcon_read_property(&pending, getThis(), SL("_pending"), PH_NOISY|PH_READONLY);
+	phalcon_update_property_long(getThis(), SL("_pending"), phalcon_get_intval(&pending) + 1);
+
+	RETURN_TRUE;
+}
+
+/**
+ * Collects the response of a reserve sent by reserveAsync() without blocking
+ *
+ * @return Phalcon\Queue\Beanstalk\Job|boolean|null the job, false when the reserve timed out, null when the response has not arrived yet
+ */
+PHP_METHOD(Phalcon_Queue_Beanstalk, poll){
+
+	zval pending = {}, buffer = {}, job_id = {};
+	smart_str data = {0};
+	php_stream *stream;
+	char buf[8192], *line, *eol;
+	size_t consumed = 0, length;
+	ssize_t n;
+
+	phalcon_read_property(&pending, getThis(), SL("_pending"), PH_NOISY|PH_READONLY);
+	if (phalcon_get_intval(&pending) <= 0) {
+		RETURN_NULL();
+	}
+
+	stream = phalcon_queue_beanstalk_stream(getThis());
+	if (!stream) {
+		RETURN_FALSE;
+	}
+
+	phalcon_read_property(&buffer, getThis(), SL("_buffer"), PH_NOISY|PH_READONLY);
+	if (Z_TYPE(buffer) == IS_STRING) {
+		smart_str_appendl(&data, Z_STRVAL(buffer), Z_STRLEN(buffer));
+	}
+
+	php_stream_set_option(stream, PHP_STREAM_OPTION_BLOCKING, 0, NULL);
+	while ((n = (ssize_t) php_stream_read(stream, buf, sizeof(buf))) > 0) {
+		smart_str_appendl(&data, buf, n);
+	}
+	php_stream_set_option(stream, PHP_STREAM_OPTION_BLOCKING, 1, NULL);
+
+	RETVAL_NULL();
+
+	if (data.s && (eol = memchr(ZSTR_VAL(data.s), '\n', ZSTR_LEN(data.s))) != NULL) {
+		line = ZSTR_VAL(data.s);
+		consumed = eol - line + 1;
+
+		if (consumed > 9 && !strncmp(line, "RESERVED ", 9)) {
+			char *id = line + 9, *space = memchr(id, ' ', eol - id);
+
+			if (space) {
+				length = (size_t) ZEND_STRTOL(space + 1, NULL, 10);
+
+				/* the body and its trailing CRLF must be complete too */
+				if (ZSTR_LEN(data.s) >= consumed + length + 2) {
+					ZVAL_STRINGL(&job_id, id, space - id);
+					phalcon_queue_beanstalk_job(return_value, getThis(), &job_id, line + consumed, length);
+					zval_ptr_dtor(&job_id);
+					consumed += length + 2;
+				} else {
+					consumed = 0;
+				}
+			} else {
+				RETVAL_FALSE;
+			}
+		} else {
+			RETVAL_FALSE;
+		}
+
+		if (consumed) {
+			phalcon_update_property_long(getThis(), SL("_pending"), phalcon_get_intval(&pending) - 1);
+		}
+	}
+
+	if (data.s) {
+		phalcon_update_property_str(getThis(), SL("_buffer"), ZSTR_VAL(data.s) + consumed, ZSTR_LEN(data.s) - consumed);
+	}
+	smart_str_free(&data);
+}
+
 /**
  * Change the active tube. By default the tube is 'default'
  *
@@ -729,6 +1116,20 @@ PHP_METHOD(Phalcon_Queue_Beanstalk, disconnect){
 	RETURN_TRUE;
 }
 
+/**
+ * Returns the connection resource, for event loops waiting on responses to reserveAsync()
+ *
+ * @return resource|boolean
+ */
+PHP_METHOD(Phalcon_Queue_Beanstalk, getConnection){
+
+	if (!phalcon_queue_beanstalk_stream(getThis())) {
+		RETURN_FALSE;
+	}
+
+	RETURN_MEMBER(getThis(), "_connection");
+}
+
 PHP_METHOD(Phalcon_Queue_Beanstalk, __sleep){
 
 	array_init_size(return_value, 1);
@@ -22,6 +22,9 @@
 
 #include "php_phalcon.h"
 
+/* Commands written before their responses are read back, so neither side blocks on a full socket buffer */
+#define PHALCON_QUEUE_BEANSTALK_PIPELINE 512
+
 extern zend_class_entry *phalcon_queue_beanstalk_ce;
 
 PHALCON_INIT_CLASS(Phalcon_Queue_Beanstalk);
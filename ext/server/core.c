@@ -21,10 +21,13 @@
 #include "server/core.h"
 
 #include <sys/select.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 
 void phalcon_server_init_log(struct phalcon_server_context *ctx)
 {
 	ctx->pfd = dup(STDERR_FILENO);
+	fcntl(ctx->pfd, F_SETFD, FD_CLOEXEC);
 	if (unlikely(PHALCON_GLOBAL(debug).enable_debug) && ctx->log_path && ctx->log_path->len > 0) {
 		ctx->log_file = fopen(ctx->log_path->val, "a");
 		if (!ctx->log_file) {
@@ -83,6 +86,13 @@ void phalcon_server_init_signal(struct phalcon_server_context *ctx)
 		phalcon_server_exit_cleanup(ctx);
 	}
 
+	/* supervisor signals, workers only get SIGTERM back */
+	if(sigaddset(&siglist, SIGTERM) == -1 || sigaddset(&siglist, SIGHUP) == -1
+		|| sigaddset(&siglist, SIGCHLD) == -1 || sigaddset(&siglist, SIGUSR1) == -1) {
+		perror("Unable to add supervisor signals to signal list");
+		phalcon_server_exit_cleanup(ctx);
+	}
+
 	if(pthread_sigmask(SIG_BLOCK, &siglist, NULL) != 0) {
 		perror("Unable to change signal mask");
 		phalcon_server_exit_cleanup(ctx);
@@ -152,6 +162,8 @@ struct phalcon_server_conn_context *phalcon_server_alloc_context(struct phalcon_
 	ret->fd = 0;
 	ret->fd_added = 0;
 	ret->next_idx = -1;
+	ret->file = NULL;
+	ret->file_remaining = 0;
 
 	ret->pool = pool;
 
@@ -185,12 +197,42 @@ struct phalcon_server_conn_context *phalcon_server_get_context(struct phalcon_se
 	return ret;
 }
 
+/* Returns the listening socket left by the master before a reload, -1 if none */
+static int phalcon_server_inherited_fd(const char *ip, uint16_t port)
+{
+	char *env, *list, *entry, *last = NULL;
+	char entry_ip[32];
+	int fd = -1, entry_fd, entry_port;
+
+	env = getenv(PHALCON_SERVER_LISTEN_ENV);
+	if (!env) {
+		return -1;
+	}
+
+	list = strdup(env);
+	for (entry = strtok_r(list, ";", &last); entry; entry = strtok_r(NULL, ";", &last)) {
+		if (sscanf(entry, "%d:%31[^:]:%d", &entry_fd, entry_ip, &entry_port) == 3
+			&& entry_port == port && !strcmp(entry_ip, ip) && fcntl(entry_fd, F_GETFD) != -1) {
+			fd = entry_fd;
+			break;
+		}
+	}
+	free(list);
+
+	return fd;
+}
+
 int phalcon_server_init_single_server(struct phalcon_server_context *ctx, struct in_addr ip, uint16_t port)
 {
 	struct sockaddr_in addr;
 	socklen_t addrlen = sizeof(addr);
 	int serverfd, flags, value;
 
+	if((serverfd = phalcon_server_inherited_fd(inet_ntoa(ip), port)) != -1) {
+		phalcon_server_log_printf(ctx, "Reuse listen socket %d\n", serverfd);
+		return serverfd;
+	}
+
 	if((serverfd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
 		perror("Unable to open socket");
 		phalcon_server_exit_cleanup(ctx);
@@ -242,6 +284,7 @@ void phalcon_server_init_server(struct phalcon_server_context *ctx)
 
 		ctx->la[i].listen_fd = phalcon_server_init_single_server(ctx, ip, port);
 	}
+	unsetenv(PHALCON_SERVER_LISTEN_ENV);
 
 	limits.rlim_cur = RLIM_INFINITY;
 	limits.rlim_max = RLIM_INFINITY;
@@ -315,6 +358,22 @@ static void phalcon_server_worker_threadpool_destroy(struct phalcon_server_conte
 
 /* Thread end */
 
+/* Stops accepting, the listening sockets are left open for the other workers */
+static void phalcon_server_stop_accepting(struct phalcon_server_context *ctx, struct phalcon_server_conn_context **listen_ctxs)
+{
+	int i;
+
+	ctx->draining = 1;
+	ctx->drain_deadline = time(NULL) + (ctx->drain_timeout > 0 ? ctx->drain_timeout : PHALCON_SERVER_DRAIN_TIMEOUT);
+
+	for (i = 0; i < ctx->la_num; i++) {
+		if (epoll_ctl(listen_ctxs[i]->ep_fd, EPOLL_CTL_DEL, listen_ctxs[i]->fd, NULL) < 0) {
+			perror("Unable to delete listen socket from epoll");
+		}
+		phalcon_server_free_context(listen_ctxs[i]);
+	}
+}
+
 void phalcon_server_process_clients(struct phalcon_server_context *ctx, void *arg)
 {
 	struct phalcon_server_worker_data *mydata = (struct phalcon_server_worker_data *)arg;
@@ -331,6 +390,7 @@ void phalcon_server_process_clients(struct phalcon_server_context *ctx, void *ar
 	int i;
 
 	struct phalcon_server_conn_context *listen_ctx;
+	struct phalcon_server_conn_context *listen_ctxs[32];
 
 	ret = phalcon_server_bind_process_cpu(cpu_id);
 	if (ret < 0) {
@@ -345,8 +405,12 @@ void phalcon_server_process_clients(struct phalcon_server_context *ctx, void *ar
 		phalcon_server_exit_cleanup(ctx);
 	}
 
+#if PHALCON_USE_THREADPOOL
+	FD_ZERO(&listen_fds);
+#endif
 	for (i = 0; i < ctx->la_num; i++) {
 		listen_ctx = phalcon_server_alloc_context(ctx->pool);
+		listen_ctxs[i] = listen_ctx;
 
 		listen_ctx->fd = ctx->la[i].listen_fd;
 		listen_ctx->handler = ctx->accept ? ctx->accept : phalcon_server_builtin_process_accept;
@@ -368,13 +432,15 @@ void phalcon_server_process_clients(struct phalcon_server_context *ctx, void *ar
 	phalcon_server_worker_threadpool_init(ctx, mydata);
 #endif
 	mydata->polls_min = PHALCON_SERVER_EVENTS_PER_BATCH;
+	mydata->trancnt_start = mydata->trancnt;
 
 	while (likely(!mydata->shutdown)) {
 		int num_events;
 		int i;
 		int events;
 
-		num_events = epoll_wait(ep_fd, evts, PHALCON_SERVER_EVENTS_PER_BATCH, -1);
+		/* wake up every second to notice a reload or a recycle limit */
+		num_events = epoll_wait(ep_fd, evts, PHALCON_SERVER_EVENTS_PER_BATCH, 1000);
 		if (num_events < 0) {
 			if (errno == EINTR)
 				continue;
@@ -418,40 +484,157 @@ void phalcon_server_process_clients(struct phalcon_server_context *ctx, void *ar
 			listen_ctx->handler(ctx, listen_ctx);
 #endif
 		}
+
+		if (!ctx->draining) {
+			mydata->memory = zend_memory_usage(0);
+
+			if (mydata->draining) {
+				/* asked by the master on reload or graceful stop */
+				phalcon_server_stop_accepting(ctx, listen_ctxs);
+			} else if ((ctx->max_requests && mydata->trancnt - mydata->trancnt_start >= ctx->max_requests)
+				|| (ctx->max_memory && mydata->memory >= ctx->max_memory)) {
+				phalcon_server_log_printf(ctx, "Recycle worker on cpu %d\n", cpu_id);
+				mydata->draining = 1;
+				phalcon_server_stop_accepting(ctx, listen_ctxs);
+				kill(ctx->master, SIGUSR1);
+			}
+		}
+
+		if (ctx->draining && (ctx->pool->allocated == 0 || time(NULL) >= ctx->drain_deadline)) {
+			break;
+		}
 	}
 #if PHALCON_USE_THREADPOOL
 	phalcon_server_worker_threadpool_destroy(ctx, mydata);
 #endif
 }
 
-void phalcon_server_init_workers(struct phalcon_server_context *ctx)
+/* Maps the stats page holding the worker data, shared with the workers and with readers of its name */
+static void phalcon_server_init_stats(struct phalcon_server_context *ctx)
 {
-	int i, pid;
+	size_t size = sizeof(struct phalcon_server_stats) + ctx->num_workers * sizeof(struct phalcon_server_worker_data);
+	int fd;
+
+	if (ctx->stats_name[0]) {
+		shm_unlink(ctx->stats_name);
 
-	ctx->wdata = mmap(NULL, ctx->num_workers * sizeof(struct phalcon_server_worker_data),
-		     PROT_READ|PROT_WRITE,
-		     MAP_ANON|MAP_SHARED,
-		     -1, 0);
+		fd = shm_open(ctx->stats_name, O_CREAT | O_EXCL | O_RDWR, 0644);
+		if (fd < 0 || ftruncate(fd, size) != 0) {
+			perror("Unable to create the stats shared memory");
+			phalcon_server_exit_cleanup(ctx);
+		}
 
-	memset(ctx->wdata, 0, ctx->num_workers * sizeof(struct phalcon_server_worker_data));
+		ctx->stats = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+	} else {
+		ctx->stats = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_ANON|MAP_SHARED, -1, 0);
+	}
 
-	if (ctx->wdata == NULL) {
+	if (ctx->stats == MAP_FAILED) {
+		ctx->stats = NULL;
 		perror("Unable to mmap shared global wdata");
 		phalcon_server_exit_cleanup(ctx);
 	}
 
+	memset(ctx->stats, 0, size);
+
+	ctx->stats->magic = PHALCON_SERVER_STATS_MAGIC;
+	ctx->stats->worker_size = sizeof(struct phalcon_server_worker_data);
+	ctx->stats->num_workers = ctx->num_workers;
+	ctx->stats->master = ctx->master;
+	ctx->stats->started = time(NULL);
+
+	ctx->wdata = (struct phalcon_server_worker_data *)(ctx->stats + 1);
+}
+
+static void phalcon_server_free_stats(struct phalcon_server_context *ctx)
+{
+	if (ctx->stats_name[0]) {
+		shm_unlink(ctx->stats_name);
+	}
+}
+
+/*
+ * Maps a stats page read-only, returns NULL if it is missing or was written by another build
+ * The mapping has to be released with munmap(stats, size)
+ */
+struct phalcon_server_stats *phalcon_server_open_stats(const char *name, size_t *size)
+{
+	struct phalcon_server_stats *stats;
+	struct stat info;
+	int fd;
+
+	fd = shm_open(name, O_RDONLY, 0);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(struct phalcon_server_stats)) {
+		close(fd);
+		return NULL;
+	}
+
+	*size = info.st_size;
+	stats = mmap(NULL, *size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (stats == MAP_FAILED) {
+		return NULL;
+	}
+
+	if (stats->magic != PHALCON_SERVER_STATS_MAGIC || stats->worker_size != sizeof(struct phalcon_server_worker_data)
+		|| *size < sizeof(struct phalcon_server_stats) + stats->num_workers * stats->worker_size) {
+		munmap(stats, *size);
+		return NULL;
+	}
+
+	return stats;
+}
+
+/* Forks a worker for the slot, the previous process of the slot may still be draining */
+int phalcon_server_spawn_worker(struct phalcon_server_context *ctx, int i)
+{
+	sigset_t siglist;
+	int pid;
+
+	ctx->wdata[i].draining = 0;
+	ctx->wdata[i].shutdown = 0;
+	ctx->wdata[i].respawn = 0;
+	ctx->wdata[i].spawned = time(NULL);
+
+	if ((pid = fork()) < 0) {
+		perror("Unable to fork child process");
+		return -1;
+	} else if (pid == 0) {
+		sigemptyset(&siglist);
+		sigaddset(&siglist, SIGTERM);
+		pthread_sigmask(SIG_UNBLOCK, &siglist, NULL);
+
+		ctx->wdata[i].process = getpid();
+		ctx->cpu_id = ctx->wdata[i].cpu_id;
+		phalcon_server_process_clients(ctx, (void *)&(ctx->wdata[i]));
+		exit(0);
+	}
+
+	ctx->wdata[i].process = pid;
+
+	return pid;
+}
+
+void phalcon_server_init_workers(struct phalcon_server_context *ctx)
+{
+	int i;
+
+	ctx->master = getpid();
+
+	phalcon_server_init_stats(ctx);
+
 	for(i = 0; i < ctx->num_workers; i++) {
 		ctx->wdata[i].trancnt = 0;
 		ctx->wdata[i].cpu_id = i + ctx->start_cpu;
 
-		if ( (pid = fork()) < 0) {
-			perror("Unable to fork child process");
+		if (phalcon_server_spawn_worker(ctx, i) < 0) {
 			phalcon_server_exit_cleanup(ctx);
-		} else if( pid == 0) {
-			ctx->wdata[i].process = getpid();
-			ctx->cpu_id = ctx->wdata[i].cpu_id ;
-			phalcon_server_process_clients(ctx, (void *)&(ctx->wdata[i]));
-			exit(0);
 		}
 	}
 }
@@ -551,6 +734,101 @@ back:
 	return;
 }
 
+/* Starts a replacement for every worker that stopped accepting */
+static void phalcon_server_replace_workers(struct phalcon_server_context *ctx)
+{
+	int i;
+
+	for(i = 0; i < ctx->num_workers; i++) {
+		if (ctx->wdata[i].draining && ctx->wdata[i].process) {
+			phalcon_server_log_printf(ctx, "Replace process %d\n", ctx->wdata[i].process);
+			if (phalcon_server_spawn_worker(ctx, i) > 0) {
+				ctx->wdata[i].restarts++;
+			}
+		}
+	}
+}
+
+/*
+ * Forks a worker for a slot that has none, a slot whose workers keep failing to
+ * start waits 1, 2, 4... seconds before the next one and is given up after
+ * PHALCON_SERVER_MAX_START_FAILURES of them
+ */
+static void phalcon_server_respawn_worker(struct phalcon_server_context *ctx, int i, int failed)
+{
+	if (!failed) {
+		ctx->wdata[i].failures = 0;
+	} else if (++ctx->wdata[i].failures >= PHALCON_SERVER_MAX_START_FAILURES) {
+		fprintf(stderr, "Worker slot %d failed to start %d times in a row, giving up\n", i, ctx->wdata[i].failures);
+		ctx->wdata[i].respawn = 0;
+		return;
+	} else {
+		ctx->wdata[i].respawn = time(NULL) + (1 << (ctx->wdata[i].failures - 1));
+		return;
+	}
+
+	if (phalcon_server_spawn_worker(ctx, i) > 0) {
+		ctx->wdata[i].restarts++;
+	} else {
+		phalcon_server_respawn_worker(ctx, i, 1);
+	}
+}
+
+/* Forks the workers whose backoff has elapsed, called on every stats tick */
+static void phalcon_server_respawn_workers(struct phalcon_server_context *ctx)
+{
+	time_t now = time(NULL);
+	int i;
+
+	for(i = 0; i < ctx->num_workers; i++) {
+		if (!ctx->wdata[i].process && ctx->wdata[i].respawn && ctx->wdata[i].respawn <= now) {
+			ctx->wdata[i].respawn = 0;
+			if (phalcon_server_spawn_worker(ctx, i) > 0) {
+				ctx->wdata[i].restarts++;
+			} else {
+				phalcon_server_respawn_worker(ctx, i, 1);
+			}
+		}
+	}
+}
+
+/*
+ * Reaps the exited workers and respawns the ones that died without being replaced,
+ * returns the number still alive or waiting to be respawned
+ */
+static int phalcon_server_reap_workers(struct phalcon_server_context *ctx)
+{
+	int i, status, failed, alive = 0;
+	pid_t pid;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+		for(i = 0; i < ctx->num_workers; i++) {
+			if (ctx->wdata[i].process != pid) {
+				continue;
+			}
+
+			ctx->wdata[i].process = 0;
+			if (!ctx->stopping) {
+				failed = 0;
+				if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+					fprintf(stderr, "Worker %d exited unexpectedly, status %d\n", pid, status);
+					failed = time(NULL) - ctx->wdata[i].spawned <= PHALCON_SERVER_START_TIMEOUT;
+				}
+				phalcon_server_respawn_worker(ctx, i, failed);
+			}
+			break;
+		}
+	}
+
+	for(i = 0; i < ctx->num_workers; i++) {
+		if (ctx->wdata[i].process || (ctx->wdata[i].respawn && !ctx->stopping)) {
+			alive++;
+		}
+	}
+
+	return alive;
+}
+
 void phalcon_server_do_stats(struct phalcon_server_context *ctx)
 {
 	sigset_t siglist;
@@ -573,6 +851,12 @@ void phalcon_server_do_stats(struct phalcon_server_context *ctx)
 		phalcon_server_exit_cleanup(ctx);
 	}
 
+	if(sigaddset(&siglist, SIGTERM) == -1 || sigaddset(&siglist, SIGHUP) == -1
+		|| sigaddset(&siglist, SIGCHLD) == -1 || sigaddset(&siglist, SIGUSR1) == -1) {
+		perror("Unable to add supervisor signals to stats signal list");
+		phalcon_server_exit_cleanup(ctx);
+	}
+
 	FILE *p = fdopen(ctx->pfd, "w");
 
 	while(1) {
@@ -600,11 +884,34 @@ void phalcon_server_do_stats(struct phalcon_server_context *ctx)
 
 			fprintf(p, "\tRequest/s %8"PRIu64",%8"PRIu64"\n", acceptcnt, trancnt);
 
+			if (!ctx->stopping) {
+				phalcon_server_respawn_workers(ctx);
+			}
+
+		} else if(signum == SIGUSR1) {
+			if (!ctx->stopping) {
+				phalcon_server_replace_workers(ctx);
+			}
+		} else if(signum == SIGCHLD) {
+			if (!phalcon_server_reap_workers(ctx)) {
+				/* without stopping, every slot was given up */
+				if (!ctx->stopping) {
+					fprintf(stderr, "No worker could be started, stopping\n");
+					ctx->stopping = 1;
+				}
+				break;
+			}
+		} else if(signum == SIGHUP) {
+			phalcon_server_reload(ctx);
+		} else if(signum == SIGTERM) {
+			phalcon_server_drain_workers(ctx);
 		} else if(signum == SIGINT) {
 			phalcon_server_stop_workers(ctx);
 			break;
 		}
 	}
+
+	phalcon_server_free_stats(ctx);
 }
 
 void phalcon_server_exit_cleanup(struct phalcon_server_context *ctx)
@@ -617,6 +924,8 @@ void phalcon_server_stop_workers(struct phalcon_server_context *ctx)
 {
 	int i;
 
+	ctx->stopping = 1;
+
 	if (ctx->wdata) {
 		for(i = 0; i < ctx->num_workers; i++) {
 			ctx->wdata[i].shutdown = 1;
@@ -627,3 +936,106 @@ void phalcon_server_stop_workers(struct phalcon_server_context *ctx)
 		}
 	}
 }
+
+/* Graceful stop, the workers finish their connections and the master returns once all of them exited */
+void phalcon_server_drain_workers(struct phalcon_server_context *ctx)
+{
+	int i;
+
+	ctx->stopping = 1;
+
+	if (ctx->wdata) {
+		for(i = 0; i < ctx->num_workers; i++) {
+			ctx->wdata[i].draining = 1;
+		}
+	}
+}
+
+/*
+ * Graceful reload: the workers stop accepting and drain while the master re-executes
+ * itself with the same command line, keeping its pid and handing the listening
+ * sockets over, so the new workers accept on them without dropping connections
+ */
+void phalcon_server_reload(struct phalcon_server_context *ctx)
+{
+	struct itimerval interval;
+	sigset_t siglist;
+	char env[2048];
+	char **argv = NULL, *cmdline = NULL, *arg;
+	size_t len = 0, used = 0;
+	int fd, argc = 0, i, pos = 0;
+	ssize_t n;
+
+	fd = open("/proc/self/cmdline", O_RDONLY);
+	if (fd < 0) {
+		perror("Unable to read the command line for reload");
+		return;
+	}
+
+	do {
+		if (used == len) {
+			len += 4096;
+			cmdline = realloc(cmdline, len + 1);
+		}
+		n = read(fd, cmdline + used, len - used);
+		if (n > 0) {
+			used += n;
+		}
+	} while (n > 0);
+	close(fd);
+
+	if (!used) {
+		free(cmdline);
+		return;
+	}
+	cmdline[used] = '\0';
+
+	for (arg = cmdline; arg < cmdline + used; arg += strlen(arg) + 1) {
+		argv = realloc(argv, sizeof(char *) * (argc + 2));
+		argv[argc++] = arg;
+	}
+	argv[argc] = NULL;
+
+	env[0] = '\0';
+	for (i = 0; i < ctx->la_num && pos < (int)sizeof(env); i++) {
+		pos += snprintf(env + pos, sizeof(env) - pos, "%s%d:%s:%d", i ? ";" : "", ctx->la[i].listen_fd, inet_ntoa(ctx->la[i].listenip), ctx->la[i].param_port);
+		fcntl(ctx->la[i].listen_fd, F_SETFD, 0);
+	}
+	setenv(PHALCON_SERVER_LISTEN_ENV, env, 1);
+
+	fprintf(stderr, "Reload master %d\n", getpid());
+
+	for(i = 0; i < ctx->num_workers; i++) {
+		ctx->wdata[i].draining = 1;
+	}
+
+	/* the new master creates its own page, the draining workers keep the old one */
+	phalcon_server_free_stats(ctx);
+
+	/*
+	 * timers, the signal mask, pending and ignored signals all survive exec. The
+	 * supervisor signals stay blocked so one sent before the new master waits
+	 * for them is kept pending instead of killing it, only the stats timer is
+	 * stopped and its pending SIGALRM discarded
+	 */
+	memset(&interval, 0, sizeof(interval));
+	setitimer(ITIMER_REAL, &interval, NULL);
+	signal(SIGALRM, SIG_IGN);
+	signal(SIGALRM, SIG_DFL);
+
+	sigemptyset(&siglist);
+	sigaddset(&siglist, SIGALRM);
+	pthread_sigmask(SIG_UNBLOCK, &siglist, NULL);
+
+	fflush(NULL);
+	execv("/proc/self/exe", argv);
+
+	perror("Unable to re-execute the master");
+	pthread_sigmask(SIG_BLOCK, &siglist, NULL);
+	unsetenv(PHALCON_SERVER_LISTEN_ENV);
+	free(argv);
+	free(cmdline);
+
+	phalcon_server_replace_workers(ctx);
+	phalcon_server_init_timer(ctx);
+}
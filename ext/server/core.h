@@ -65,6 +65,19 @@
 #define PHALCON_SERVER_ACCEPT_PER_LISTEN_EVENT	1
 #define PHALCON_SERVER_MAX_WORKER_THREADS		4
 
+/* seconds a recycled or reloaded worker may take to finish its connections */
+#define PHALCON_SERVER_DRAIN_TIMEOUT			30
+
+/* a worker dying within this many seconds of its fork failed to start, its slot is respawned with a backoff */
+#define PHALCON_SERVER_START_TIMEOUT			1
+/* failed starts in a row after which a slot is given up */
+#define PHALCON_SERVER_MAX_START_FAILURES		5
+
+/* listening sockets handed over to the re-executed master, "fd:ip:port;..." */
+#define PHALCON_SERVER_LISTEN_ENV				"PHALCON_SERVER_LISTEN"
+
+#define PHALCON_SERVER_STATS_MAGIC				0x5048534552564552ULL
+
 typedef struct phalcon_server_conn_context phalcon_server_conn_context_t;
 typedef struct phalcon_server_context phalcon_server_context_t;
 typedef struct phalcon_server_context_pool phalcon_server_context_pool_t;
@@ -91,6 +104,11 @@ struct phalcon_server_conn_context {
 	char buf[PHALCON_SERVER_MAX_BUFSIZE];
 	void *user_data;
 	zend_string *response;
+	/* file sent after the response headers, see server/static.c */
+	void *file;
+	int file_fd;
+	off_t file_offset;
+	size_t file_remaining;
 	phalcon_server_context_pool_t *pool;
 } *arr;
 
@@ -134,7 +152,18 @@ struct phalcon_server_worker_data {
 	uint64_t accept_cnt;
 	uint64_t read_cnt;
 	uint64_t write_cnt;
+	/* requests served by the slot when its current process started */
+	uint64_t trancnt_start;
+	uint64_t memory;
+	uint64_t restarts;
+	/* when the current process of the slot was forked */
+	time_t spawned;
+	/* workers of the slot that failed to start in a row, when to fork the next one */
+	int failures;
+	time_t respawn;
 	int shutdown;
+	/* stop accepting and exit once the open connections are done */
+	int draining;
 #if PHALCON_USE_THREADPOOL
 	pthread_t main_thread;
 	pthread_t worker_threads[PHALCON_SERVER_MAX_WORKER_THREADS];
@@ -142,6 +171,18 @@ struct phalcon_server_worker_data {
 #endif
 };
 
+/*
+ * Head of the stats page, followed by one phalcon_server_worker_data per worker.
+ * With a name the page is a POSIX shared memory object other processes can map.
+ */
+struct phalcon_server_stats {
+	uint64_t magic;
+	uint64_t worker_size;
+	uint64_t num_workers;
+	uint64_t master;
+	uint64_t started;
+};
+
 struct phalcon_server_context {
 	int enable_verbose;
 	int num_workers;
@@ -153,6 +194,17 @@ struct phalcon_server_context {
 	int cpu_id;
 	phalcon_server_context_pool_t *pool;
 	struct phalcon_server_worker_data *wdata;
+	struct phalcon_server_stats *stats;
+	char stats_name[64];
+	pid_t master;
+	uint64_t max_requests;
+	uint64_t max_memory;
+	int drain_timeout;
+	/* set in a worker once it stopped accepting */
+	int draining;
+	time_t drain_deadline;
+	/* set in the master once the workers are not replaced anymore */
+	int stopping;
 	struct phalcon_server_listen_addr la[32];
 	void (*accept)(phalcon_server_context_t *, phalcon_server_conn_context_t *);
 	void (*read)(phalcon_server_context_t *, phalcon_server_conn_context_t *);
@@ -167,6 +219,11 @@ void phalcon_server_init_workers(struct phalcon_server_context *ctx);
 void phalcon_server_do_stats(struct phalcon_server_context *ctx);
 void phalcon_server_exit_cleanup(struct phalcon_server_context *ctx);
 void phalcon_server_stop_workers(struct phalcon_server_context *ctx);
+void phalcon_server_drain_workers(struct phalcon_server_context *ctx);
+void phalcon_server_reload(struct phalcon_server_context *ctx);
+int phalcon_server_spawn_worker(struct phalcon_server_context *ctx, int i);
+
+struct phalcon_server_stats *phalcon_server_open_stats(const char *name, size_t *size);
 
 void phalcon_server_client_close(struct phalcon_server_conn_context *client_ctx);
 struct phalcon_server_conn_context *phalcon_server_alloc_context(struct phalcon_server_context_pool *pool);
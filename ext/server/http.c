@@ -23,6 +23,10 @@
 #include "server/exception.h"
 #include "server/utils.h"
 
+#ifdef PHALCON_USE_COROUTINE
+# include "coroutine.h"
+#endif
+
 #include "kernel/main.h"
 #include "kernel/memory.h"
 #include "kernel/fcall.h"
@@ -42,11 +46,37 @@
  *  $server->start($application);
  *
  *</code>
+ *
+ * The master process supervises the workers: a worker that dies is forked again,
+ * SIGHUP reloads the code without dropping connections (the workers drain while
+ * the master re-executes itself), SIGTERM drains the workers and stops, SIGINT
+ * stops at once.
+ *
+ * Coroutines a handler starts with Phalcon\Coroutine::go() run to completion
+ * before its response is sent. Until they finish the worker does not accept or
+ * read other connections, so a handler should only start coroutines that wait
+ * on I/O it needs for the response, and more workers are needed for handlers
+ * that do so.
+ *
+ *<code>
+ *
+ *	$server = new Phalcon\Server\Http([
+ *		'port' => 8989,
+ *		'staticCache' => 4096,
+ *		'maxRequests' => 10000,
+ *		'maxMemory' => 64 * 1024 * 1024,
+ *		'stats' => '/phalcon-server-8989',
+ *	]);
+ *  $server->start($application);
+ *
+ *</code>
  */
 zend_class_entry *phalcon_server_http_ce;
 
 PHP_METHOD(Phalcon_Server_Http, __construct);
 PHP_METHOD(Phalcon_Server_Http, start);
+PHP_METHOD(Phalcon_Server_Http, getStats);
+PHP_METHOD(Phalcon_Server_Http, addStaticDir);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_server_http___construct, 0, 0, 0)
 	ZEND_ARG_TYPE_INFO(0, config, IS_ARRAY, 1)
@@ -56,9 +86,16 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_server_http_start, 0, 0, 1)
 	ZEND_ARG_OBJ_INFO(0, application, Phalcon\\Application, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_server_http_addstaticdir, 0, 0, 2)
+	ZEND_ARG_TYPE_INFO(0, prefix, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, root, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry phalcon_server_http_method_entry[] = {
 	PHP_ME(Phalcon_Server_Http, __construct, arginfo_phalcon_server_http___construct, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Server_Http, start, arginfo_phalcon_server_http_start, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Server_Http, getStats, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Server_Http, addStaticDir, arginfo_phalcon_server_http_addstaticdir, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -86,6 +123,10 @@ void phalcon_server_http_object_free_handler(zend_object *object)
 	if (intern->ctx.log_path) {
 		zend_string_release(intern->ctx.log_path);
 	}
+
+	if (intern->statics) {
+		phalcon_server_static_free(intern->statics);
+	}
 }
 
 /**
@@ -101,12 +142,19 @@ PHALCON_INIT_CLASS(Phalcon_Server_Http){
 /**
  * Phalcon\Http\Server constructor
  *
+ * Besides host, port, worker, log and verbose, the config accepts:
+ *  - maxRequests: requests a worker serves before it is replaced
+ *  - maxMemory: bytes of PHP memory above which a worker is replaced
+ *  - drainTimeout: seconds a replaced worker may take to finish its connections
+ *  - stats: name of the shared memory object holding the worker counters
+ *  - staticCache: files kept open for the static directories
+ *
  * @param array $config
  * @throws \Phalcon\Server\Exception
  */
 PHP_METHOD(Phalcon_Server_Http, __construct){
 
-	zval *config, verbose = {}, worker = {}, log_path = {}, host = {}, port = {};
+	zval *config, verbose = {}, worker = {}, log_path = {}, host = {}, port = {}, option = {};
 	phalcon_server_http_object *intern;
 	int num_workers = 2;
 
@@ -142,6 +190,30 @@ PHP_METHOD(Phalcon_Server_Http, __construct){
 	} else {
 		intern->ctx.la[0].param_port = 8383;
 	}
+
+	if (phalcon_array_isset_fetch_str(&option, config, SL("maxRequests"), PH_READONLY) && Z_TYPE(option) == IS_LONG && Z_LVAL(option) > 0) {
+		intern->ctx.max_requests = Z_LVAL(option);
+	}
+
+	if (phalcon_array_isset_fetch_str(&option, config, SL("maxMemory"), PH_READONLY) && Z_TYPE(option) == IS_LONG && Z_LVAL(option) > 0) {
+		intern->ctx.max_memory = Z_LVAL(option);
+	}
+
+	if (phalcon_array_isset_fetch_str(&option, config, SL("drainTimeout"), PH_READONLY) && Z_TYPE(option) == IS_LONG) {
+		intern->ctx.drain_timeout = Z_LVAL(option);
+	}
+
+	if (phalcon_array_isset_fetch_str(&option, config, SL("staticCache"), PH_READONLY) && Z_TYPE(option) == IS_LONG && Z_LVAL(option) > 0) {
+		intern->static_cache = Z_LVAL(option);
+	}
+
+	if (phalcon_array_isset_fetch_str(&option, config, SL("stats"), PH_READONLY) && Z_TYPE(option) == IS_STRING) {
+		if (Z_STRLEN(option) >= sizeof(intern->ctx.stats_name) || Z_STRVAL(option)[0] != '/') {
+			PHALCON_THROW_EXCEPTION_STR(phalcon_server_exception_ce, "The stats name must start with a slash and be shorter than 64 characters");
+			return;
+		}
+		strcpy(intern->ctx.stats_name, Z_STRVAL(option));
+	}
 }
 
 /* Http parser */
@@ -176,6 +248,7 @@ void phalcon_server_http_process_write(struct phalcon_server_context *ctx, struc
 
 	ep_fd = client_ctx->ep_fd;
 	fd = client_ctx->fd;
+	intern = phalcon_server_http_object_from_ctx(ctx);
 
 	phalcon_server_log_printf(ctx, "Process write event[%02x]\n", events);
 
@@ -184,6 +257,11 @@ void phalcon_server_http_process_write(struct phalcon_server_context *ctx, struc
 		goto free_back;
 	}
 
+	/* NULL once the headers are out and only the file is left */
+	if (!client_ctx->response) {
+		goto send_file;
+	}
+
 	old_len = ZSTR_LEN(client_ctx->response);
 	if (ZSTR_LEN(client_ctx->response)) {
 		ret = write(fd, ZSTR_VAL(client_ctx->response), old_len);
@@ -220,10 +298,30 @@ void phalcon_server_http_process_write(struct phalcon_server_context *ctx, struc
 
 	phalcon_server_log_printf(ctx, "Write %d to socket %d\n", ret, fd);
 
+send_file:
+	if (client_ctx->file) {
+		ret = phalcon_server_static_send(client_ctx);
+		if (ret < 0) {
+			ctx->wdata[cpu_id].write_cnt++;
+			perror("process_write() can't send file to client socket");
+			goto free_back;
+		}
+		if (ret == 0) {
+			evt.events = EPOLLOUT | EPOLLHUP | EPOLLERR;
+			evt.data.ptr = client_ctx;
+			ret = epoll_ctl(ep_fd, EPOLL_CTL_MOD, fd, &evt);
+			if (ret < 0) {
+				perror("Unable to add client socket write event to epoll");
+				goto free_back;
+			}
+			goto back;
+		}
+		phalcon_server_static_release(intern->statics, client_ctx);
+	}
+
 	ctx->wdata[cpu_id].trancnt++;
 
-	intern = phalcon_server_http_object_from_ctx(ctx);
-	if (!intern->enable_keepalive)
+	if (!intern->enable_keepalive || ctx->draining)
 		goto free_back;
 
 	client_ctx->handler = ctx->read;
@@ -240,6 +338,9 @@ void phalcon_server_http_process_write(struct phalcon_server_context *ctx, struc
 	goto back;
 
 free_back:
+	if (client_ctx->file) {
+		phalcon_server_static_release(intern->statics, client_ctx);
+	}
 	// __sync_synchronize();
 	phalcon_server_client_close(client_ctx);
 	// __sync_synchronize();
@@ -297,10 +398,27 @@ static void phalcon_server_http_process_read(struct phalcon_server_context *ctx,
 			phalcon_server_http_object *intern;
 			int flag = 0;
 
-			ZVAL_STR(&url, parser_data->url.s);
 			intern = phalcon_server_http_object_from_ctx(ctx);
+			smart_str_0(&parser_data->url);
+
+			/* assets are answered before any PHP runs, once the whole request is in */
+			if (intern->statics && parser_data->state == HTTP_PARSER_STATE_END
+				&& phalcon_server_static_handle(intern->statics, client_ctx, parser_data, intern->enable_keepalive)) {
+				phalcon_http_parser_data_free(parser_data);
+				client_ctx->user_data = NULL;
+				goto respond;
+			}
+
+			ZVAL_STR(&url, parser_data->url.s);
 
 			PHALCON_CALL_METHOD_FLAG(flag, &response, &intern->application, "handle", &url);
+#ifdef PHALCON_USE_COROUTINE
+			/* coroutines started by the handler finish before the response is sent, this blocks the worker's loop */
+			if (phalcon_coroutine_wait() == FAILURE && flag == SUCCESS) {
+				zval_ptr_dtor(&response);
+				flag = FAILURE;
+			}
+#endif
 			phalcon_http_parser_data_free(parser_data);
 			client_ctx->user_data = NULL;
 			client_ctx->response = phalcon_server_http_get_headers();
@@ -322,6 +440,7 @@ static void phalcon_server_http_process_read(struct phalcon_server_context *ctx,
 				zval_ptr_dtor(&content);
 				zval_ptr_dtor(&response);
 			}
+respond:
 			client_ctx->handler = ctx->write;
 			evt.events = EPOLLOUT | EPOLLHUP | EPOLLERR;
 			evt.data.ptr = client_ctx;
@@ -384,3 +503,117 @@ PHP_METHOD(Phalcon_Server_Http, start){
 	phalcon_server_init_timer(&intern->ctx);
 	phalcon_server_do_stats(&intern->ctx);
 }
+
+/**
+ * Returns the counters of the workers
+ *
+ * Inside a handler they are read from the running server, otherwise from the
+ * shared memory named by the stats option, which lets another process watch it
+ *
+ *<code>
+ *
+ *	$stats = (new Phalcon\Server\Http(['stats' => '/phalcon-server-8989']))->getStats();
+ *	foreach ($stats['workers'] as $worker) {
+ *		echo $worker['pid'], ' ', $worker['requests'], ' ', $worker['memory'], PHP_EOL;
+ *	}
+ *
+ *</code>
+ *
+ * @return array|boolean
+ */
+PHP_METHOD(Phalcon_Server_Http, getStats){
+
+	phalcon_server_http_object *intern;
+	struct phalcon_server_stats *stats;
+	struct phalcon_server_worker_data *wdata;
+	zval workers = {}, worker = {};
+	size_t size = 0;
+	uint64_t i;
+
+	intern = phalcon_server_http_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (intern->ctx.stats) {
+		stats = intern->ctx.stats;
+	} else if (!intern->ctx.stats_name[0] || !(stats = phalcon_server_open_stats(intern->ctx.stats_name, &size))) {
+		RETURN_FALSE;
+	}
+
+	array_init(return_value);
+	add_assoc_long_ex(return_value, SL("master"), stats->master);
+	add_assoc_long_ex(return_value, SL("started"), stats->started);
+
+	array_init_size(&workers, stats->num_workers);
+	wdata = (struct phalcon_server_worker_data *)(stats + 1);
+
+	for (i = 0; i < stats->num_workers; i++) {
+		array_init(&worker);
+		add_assoc_long_ex(&worker, SL("pid"), wdata[i].process);
+		add_assoc_long_ex(&worker, SL("cpu"), wdata[i].cpu_id);
+		add_assoc_long_ex(&worker, SL("requests"), wdata[i].trancnt);
+		add_assoc_long_ex(&worker, SL("accepts"), wdata[i].acceptcnt);
+		add_assoc_long_ex(&worker, SL("memory"), wdata[i].memory);
+		add_assoc_long_ex(&worker, SL("restarts"), wdata[i].restarts);
+		add_assoc_long_ex(&worker, SL("failures"), wdata[i].failures);
+		add_assoc_bool_ex(&worker, SL("draining"), wdata[i].draining);
+		add_assoc_long_ex(&worker, SL("acceptErrors"), wdata[i].accept_cnt);
+		add_assoc_long_ex(&worker, SL("readErrors"), wdata[i].read_cnt);
+		add_assoc_long_ex(&worker, SL("writeErrors"), wdata[i].write_cnt);
+		add_assoc_long_ex(&worker, SL("polls"), wdata[i].polls_cnt);
+		add_assoc_long_ex(&worker, SL("pollsEmpty"), wdata[i].polls_mpt);
+		add_assoc_long_ex(&worker, SL("pollsMax"), wdata[i].polls_max);
+		add_assoc_long_ex(&worker, SL("pollsAvg"), wdata[i].polls_avg);
+		add_next_index_zval(&workers, &worker);
+	}
+	add_assoc_zval_ex(return_value, SL("workers"), &workers);
+
+	if (size) {
+		munmap(stats, size);
+	}
+}
+
+/**
+ * Serves the files under a directory for the URLs starting with a prefix,
+ * without running the application
+ *
+ * GET and HEAD requests get ETag, Last-Modified, single byte ranges and the
+ * precompressed .br or .gz sibling of a file when the client accepts it.
+ * A missing file is answered with 404, other methods go to the application.
+ *
+ *<code>
+ *
+ *	$server = new Phalcon\Server\Http(['port' => 8989]);
+ *	$server->addStaticDir('/assets', __DIR__ . '/public/assets');
+ *  $server->start($application);
+ *
+ *</code>
+ *
+ * @param string $prefix
+ * @param string $root
+ * @return Phalcon\Server\Http
+ * @throws \Phalcon\Server\Exception
+ */
+PHP_METHOD(Phalcon_Server_Http, addStaticDir){
+
+	zval *prefix, *root;
+	phalcon_server_http_object *intern;
+
+	phalcon_fetch_params(0, 2, 0, &prefix, &root);
+
+	if (!Z_STRLEN_P(prefix) || Z_STRVAL_P(prefix)[0] != '/') {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_server_exception_ce, "The prefix must start with a slash");
+		return;
+	}
+
+	intern = phalcon_server_http_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (!intern->statics) {
+		intern->statics = phalcon_server_static_new(intern->static_cache);
+	}
+
+	if (phalcon_server_static_add_dir(intern->statics, Z_STRVAL_P(prefix), Z_STRLEN_P(prefix), Z_STRVAL_P(root)) == FAILURE) {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_server_exception_ce, "The directory '%s' does not exist", Z_STRVAL_P(root));
+		return;
+	}
+
+	RETURN_THIS();
+}
@@ -24,10 +24,13 @@
 #include "php_phalcon.h"
 
 #include "server/core.h"
+#include "server/static.h"
 
 typedef struct _phalcon_server_http_object {
 	struct phalcon_server_context ctx;
 	int enable_keepalive;
+	phalcon_server_static *statics;
+	size_t static_cache;
 	zval application;
 	zend_object std;
 } phalcon_server_http_object;
@@ -0,0 +1,773 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "server/static.h"
+
+#include <ctype.h>
+#include <limits.h>
+#ifdef HAVE_SENDFILE
+# include <sys/sendfile.h>
+#endif
+
+typedef struct {
+	const char *extension;
+	const char *type;
+} phalcon_server_static_mime;
+
+static const phalcon_server_static_mime phalcon_server_static_mimes[] = {
+	{ "html", "text/html; charset=utf-8" },
+	{ "htm", "text/html; charset=utf-8" },
+	{ "css", "text/css; charset=utf-8" },
+	{ "js", "application/javascript; charset=utf-8" },
+	{ "mjs", "application/javascript; charset=utf-8" },
+	{ "json", "application/json" },
+	{ "map", "application/json" },
+	{ "xml", "application/xml" },
+	{ "txt", "text/plain; charset=utf-8" },
+	{ "csv", "text/csv; charset=utf-8" },
+	{ "svg", "image/svg+xml" },
+	{ "png", "image/png" },
+	{ "jpg", "image/jpeg" },
+	{ "jpeg", "image/jpeg" },
+	{ "gif", "image/gif" },
+	{ "webp", "image/webp" },
+	{ "avif", "image/avif" },
+	{ "ico", "image/x-icon" },
+	{ "woff", "font/woff" },
+	{ "woff2", "font/woff2" },
+	{ "ttf", "font/ttf" },
+	{ "otf", "font/otf" },
+	{ "pdf", "application/pdf" },
+	{ "wasm", "application/wasm" },
+	{ "mp3", "audio/mpeg" },
+	{ "mp4", "video/mp4" },
+	{ "webm", "video/webm" },
+	{ "zip", "application/zip" },
+	{ NULL, NULL }
+};
+
+static const char *phalcon_server_static_days[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+static const char *phalcon_server_static_months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+static const char *phalcon_server_static_mime_type(const char *path)
+{
+	const char *dot = strrchr(path, '.');
+	int i;
+
+	if (dot && !strchr(dot, '/')) {
+		for (i = 0; phalcon_server_static_mimes[i].extension; i++) {
+			if (!strcasecmp(dot + 1, phalcon_server_static_mimes[i].extension)) {
+				return phalcon_server_static_mimes[i].type;
+			}
+		}
+	}
+
+	return "application/octet-stream";
+}
+
+/* RFC 7231 date, formatted by hand since strftime() follows the locale */
+static void phalcon_server_static_http_date(char *buf, size_t len, time_t t)
+{
+	struct tm tm;
+
+	gmtime_r(&t, &tm);
+	snprintf(buf, len, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+		phalcon_server_static_days[tm.tm_wday], tm.tm_mday, phalcon_server_static_months[tm.tm_mon],
+		tm.tm_year + 1900, tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+static const char *phalcon_server_static_header(phalcon_http_parser_data *request, const char *name)
+{
+	zend_string *key;
+	zval *value;
+
+	ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL(request->head), key, value) {
+		if (key && Z_TYPE_P(value) == IS_STRING && !strcasecmp(ZSTR_VAL(key), name)) {
+			return Z_STRVAL_P(value);
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	return NULL;
+}
+
+/* Whether a comma separated header lists the token, tokens with q=0 are refused */
+static int phalcon_server_static_has_token(const char *header, const char *token)
+{
+	size_t len = strlen(token);
+	const char *p = header, *q;
+
+	while (p && *p) {
+		while (*p == ' ' || *p == '\t' || *p == ',') {
+			p++;
+		}
+
+		if (!strncasecmp(p, token, len) && (p[len] == '\0' || p[len] == ',' || p[len] == ';' || p[len] == ' ')) {
+			q = strchr(p, ',');
+			p = strstr(p + len, "q=");
+			if (p && (!q || p < q)) {
+				return strtod(p + 2, NULL) > 0;
+			}
+			return 1;
+		}
+
+		p = strchr(p, ',');
+	}
+
+	return 0;
+}
+
+static void phalcon_server_static_close(phalcon_server_static_file *file)
+{
+	close(file->fd);
+	if (file->gz_fd >= 0) {
+		close(file->gz_fd);
+	}
+	if (file->br_fd >= 0) {
+		close(file->br_fd);
+	}
+	free(file->path);
+	free(file->real);
+	free(file);
+}
+
+/* Whether a resolved path is the root itself or below it */
+static int phalcon_server_static_contains(const char *root, const char *real)
+{
+	size_t len = strlen(root);
+
+	if (strncmp(real, root, len)) {
+		return 0;
+	}
+
+	return len == 1 || real[len] == '/' || real[len] == '\0';
+}
+
+/* Opens a regular file once its symlinks are resolved, a link inside the root may not lead out of it */
+static int phalcon_server_static_open_regular(const char *root, const char *path, char *real, struct stat *st)
+{
+	int fd;
+
+	if (!realpath(path, real) || !phalcon_server_static_contains(root, real)) {
+		return -1;
+	}
+
+	fd = open(real, O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+	if (fd < 0) {
+		return -1;
+	}
+
+	if (fstat(fd, st) != 0 || !S_ISREG(st->st_mode)) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static int phalcon_server_static_open_sibling(const char *root, const char *path, const char *suffix, struct stat *st)
+{
+	char sibling[PATH_MAX], real[PATH_MAX];
+
+	if (snprintf(sibling, sizeof(sibling), "%s%s", path, suffix) >= (int)sizeof(sibling)) {
+		return -1;
+	}
+
+	return phalcon_server_static_open_regular(root, sibling, real, st);
+}
+
+static phalcon_server_static_file *phalcon_server_static_open(const char *root, const char *path)
+{
+	phalcon_server_static_file *file;
+	char real[PATH_MAX];
+	struct stat st;
+	int fd;
+
+	fd = phalcon_server_static_open_regular(root, path, real, &st);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	file = calloc(1, sizeof(phalcon_server_static_file));
+	file->path = strdup(path);
+	file->real = strdup(real);
+	file->fd = fd;
+	file->st = st;
+	file->gz_fd = phalcon_server_static_open_sibling(root, path, ".gz", &file->gz_st);
+	file->br_fd = phalcon_server_static_open_sibling(root, path, ".br", &file->br_st);
+	file->checked = time(NULL);
+
+	return file;
+}
+
+static int phalcon_server_static_changed(const char *path, const char *suffix, int fd, const struct stat *cached)
+{
+	char name[PATH_MAX];
+	struct stat st;
+	int exists;
+
+	snprintf(name, sizeof(name), "%s%s", path, suffix);
+	exists = stat(name, &st) == 0 && S_ISREG(st.st_mode);
+
+	if (fd < 0) {
+		return exists;
+	}
+
+	return !exists || st.st_ino != cached->st_ino || st.st_mtime != cached->st_mtime || st.st_size != cached->st_size;
+}
+
+static void phalcon_server_static_unlink(phalcon_server_static *statics, phalcon_server_static_file *file)
+{
+	if (file->prev) {
+		file->prev->next = file->next;
+	} else {
+		statics->head = file->next;
+	}
+
+	if (file->next) {
+		file->next->prev = file->prev;
+	} else {
+		statics->tail = file->prev;
+	}
+
+	file->prev = NULL;
+	file->next = NULL;
+}
+
+static void phalcon_server_static_link(phalcon_server_static *statics, phalcon_server_static_file *file)
+{
+	file->prev = NULL;
+	file->next = statics->head;
+
+	if (statics->head) {
+		statics->head->prev = file;
+	} else {
+		statics->tail = file;
+	}
+
+	statics->head = file;
+}
+
+static void phalcon_server_static_evict(phalcon_server_static *statics, phalcon_server_static_file *file)
+{
+	phalcon_server_static_unlink(statics, file);
+	zend_hash_str_del(&statics->files, file->path, strlen(file->path));
+
+	statics->count--;
+	file->linked = 0;
+
+	/* responses still sending from the file close it on release */
+	if (file->refcount == 0) {
+		phalcon_server_static_close(file);
+	}
+}
+
+/*
+ * Returns a referenced file under the root, from the cache when its stat result is still valid.
+ * Directories may overlap, so a cached file is checked against the root of the request too.
+ */
+static phalcon_server_static_file *phalcon_server_static_acquire(phalcon_server_static *statics, const char *root, const char *path)
+{
+	phalcon_server_static_file *file;
+	size_t len = strlen(path);
+	time_t now = time(NULL);
+
+	pthread_mutex_lock(&statics->mutex);
+
+	file = zend_hash_str_find_ptr(&statics->files, path, len);
+	if (file && now - file->checked >= PHALCON_SERVER_STATIC_VALID) {
+		if (phalcon_server_static_changed(path, "", file->fd, &file->st)
+			|| phalcon_server_static_changed(path, ".gz", file->gz_fd, &file->gz_st)
+			|| phalcon_server_static_changed(path, ".br", file->br_fd, &file->br_st)) {
+			phalcon_server_static_evict(statics, file);
+			file = NULL;
+		} else {
+			file->checked = now;
+		}
+	}
+
+	if (file && !phalcon_server_static_contains(root, file->real)) {
+		pthread_mutex_unlock(&statics->mutex);
+		return NULL;
+	}
+
+	if (!file) {
+		file = phalcon_server_static_open(root, path);
+		if (!file) {
+			pthread_mutex_unlock(&statics->mutex);
+			return NULL;
+		}
+
+		while (statics->count >= statics->capacity && statics->tail) {
+			phalcon_server_static_evict(statics, statics->tail);
+		}
+
+		zend_hash_str_update_ptr(&statics->files, file->path, len, file);
+		phalcon_server_static_link(statics, file);
+		file->linked = 1;
+		statics->count++;
+	} else if (statics->head != file) {
+		phalcon_server_static_unlink(statics, file);
+		phalcon_server_static_link(statics, file);
+	}
+
+	file->refcount++;
+
+	pthread_mutex_unlock(&statics->mutex);
+
+	return file;
+}
+
+phalcon_server_static *phalcon_server_static_new(size_t capacity)
+{
+	phalcon_server_static *statics = calloc(1, sizeof(phalcon_server_static));
+
+	statics->capacity = capacity > 0 ? capacity : PHALCON_SERVER_STATIC_CACHE_SIZE;
+	zend_hash_init(&statics->files, 64, NULL, NULL, 1);
+	pthread_mutex_init(&statics->mutex, NULL);
+
+	return statics;
+}
+
+void phalcon_server_static_free(phalcon_server_static *statics)
+{
+	int i;
+
+	while (statics->tail) {
+		phalcon_server_static_evict(statics, statics->tail);
+	}
+	zend_hash_destroy(&statics->files);
+	pthread_mutex_destroy(&statics->mutex);
+
+	for (i = 0; i < statics->num_dirs; i++) {
+		free(statics->dirs[i].prefix);
+		free(statics->dirs[i].root);
+	}
+	free(statics->dirs);
+	free(statics);
+}
+
+int phalcon_server_static_add_dir(phalcon_server_static *statics, const char *prefix, size_t prefix_len, const char *root)
+{
+	char resolved[PATH_MAX];
+	struct stat st;
+	phalcon_server_static_dir *dir;
+
+	if (!realpath(root, resolved) || stat(resolved, &st) != 0 || !S_ISDIR(st.st_mode)) {
+		return FAILURE;
+	}
+
+	while (prefix_len > 1 && prefix[prefix_len - 1] == '/') {
+		prefix_len--;
+	}
+
+	statics->dirs = realloc(statics->dirs, sizeof(phalcon_server_static_dir) * (statics->num_dirs + 1));
+	dir = &statics->dirs[statics->num_dirs++];
+
+	/* "/" serves the whole URL space, kept as an empty prefix */
+	dir->prefix_len = prefix_len == 1 ? 0 : prefix_len;
+	dir->prefix = strndup(prefix, dir->prefix_len);
+	dir->root = strdup(resolved);
+
+	return SUCCESS;
+}
+
+/* Decodes the path of the URL below the prefix, refusing anything that could leave the root */
+static int phalcon_server_static_decode(const char *src, size_t len, char *dst, size_t size)
+{
+	size_t i, j = 0;
+	int c;
+
+	for (i = 0; i < len; i++) {
+		c = (unsigned char) src[i];
+
+		if (c == '%' && i + 2 < len && isxdigit((unsigned char) src[i + 1]) && isxdigit((unsigned char) src[i + 2])) {
+			char hex[3] = { src[i + 1], src[i + 2], '\0' };
+			c = (int) strtol(hex, NULL, 16);
+			i += 2;
+		}
+
+		if (c == '\0' || c == '\\' || j + 1 >= size) {
+			return FAILURE;
+		}
+
+		dst[j++] = (char) c;
+	}
+	dst[j] = '\0';
+
+	/* no ".." segment once decoded */
+	for (i = 0; i < j; i++) {
+		if (dst[i] == '.' && dst[i + 1] == '.' && (i == 0 || dst[i - 1] == '/') && (dst[i + 2] == '/' || dst[i + 2] == '\0')) {
+			return FAILURE;
+		}
+	}
+
+	return SUCCESS;
+}
+
+/* Parses a single "bytes=" range, returns 0 to send everything, -1 if unsatisfiable */
+static int phalcon_server_static_range(const char *header, off_t size, off_t *start, off_t *end)
+{
+	char *p;
+	long long first, last;
+
+	if (strncasecmp(header, "bytes=", 6) || strchr(header, ',')) {
+		return 0;
+	}
+	header += 6;
+
+	while (*header == ' ') {
+		header++;
+	}
+
+	if (*header == '-') {
+		last = strtoll(header + 1, &p, 10);
+		if (p == header + 1 || *p != '\0') {
+			return 0;
+		}
+		if (last <= 0 || size == 0) {
+			return -1;
+		}
+		*start = last >= size ? 0 : size - last;
+		*end = size - 1;
+		return 1;
+	}
+
+	first = strtoll(header, &p, 10);
+	if (p == header || *p != '-' || first < 0) {
+		return 0;
+	}
+
+	header = p + 1;
+	if (*header == '\0') {
+		last = size - 1;
+	} else {
+		last = strtoll(header, &p, 10);
+		if (p == header || *p != '\0' || last < first) {
+			return 0;
+		}
+		if (last >= size) {
+			last = size - 1;
+		}
+	}
+
+	if (first >= size) {
+		return -1;
+	}
+
+	*start = first;
+	*end = last;
+	return 1;
+}
+
+/* Whether an If-None-Match list holds the ETag, weak comparison as RFC 7232 asks for */
+static int phalcon_server_static_etag_matches(const char *header, const char *etag)
+{
+	size_t len = strlen(etag);
+	const char *p = header;
+
+	while (*p) {
+		while (*p == ' ' || *p == ',') {
+			p++;
+		}
+
+		if (*p == '*') {
+			return 1;
+		}
+
+		if (!strncmp(p, "W/", 2)) {
+			p += 2;
+		}
+
+		if (!strncmp(p, etag, len) && (p[len] == '\0' || p[len] == ',' || p[len] == ' ')) {
+			return 1;
+		}
+
+		while (*p && *p != ',') {
+			p++;
+		}
+	}
+
+	return 0;
+}
+
+static zend_string *phalcon_server_static_status(int status, int keepalive, const char *extra)
+{
+	smart_str buffer = {0};
+	char date[64];
+	const char *reason;
+
+	switch (status) {
+		case 200: reason = "OK"; break;
+		case 206: reason = "Partial Content"; break;
+		case 304: reason = "Not Modified"; break;
+		case 404: reason = "Not Found"; break;
+		case 416: reason = "Requested Range Not Satisfiable"; break;
+		default: reason = "Bad Request"; break;
+	}
+
+	phalcon_server_static_http_date(date, sizeof(date), time(NULL));
+
+	smart_str_appendl(&buffer, "HTTP/1.1 ", sizeof("HTTP/1.1 ") - 1);
+	smart_str_append_long(&buffer, status);
+	smart_str_appendc(&buffer, ' ');
+	smart_str_appends(&buffer, reason);
+	smart_str_appendl(&buffer, "\r\nDate: ", sizeof("\r\nDate: ") - 1);
+	smart_str_appends(&buffer, date);
+	smart_str_appends(&buffer, keepalive ? "\r\nConnection: keep-alive\r\n" : "\r\nConnection: close\r\n");
+	if (extra) {
+		smart_str_appends(&buffer, extra);
+	}
+	smart_str_0(&buffer);
+
+	return buffer.s;
+}
+
+static int phalcon_server_static_error(phalcon_server_conn_context_t *client_ctx, int status, int keepalive)
+{
+	const char *body = status == 404 ? "Not Found" : "Bad Request";
+	char extra[128];
+
+	snprintf(extra, sizeof(extra), "Content-Type: text/plain\r\nContent-Length: %zu\r\n\r\n%s", strlen(body), body);
+	client_ctx->response = phalcon_server_static_status(status, keepalive, extra);
+
+	return 1;
+}
+
+int phalcon_server_static_handle(phalcon_server_static *statics, phalcon_server_conn_context_t *client_ctx, phalcon_http_parser_data *request, int keepalive)
+{
+	phalcon_server_static_dir *dir = NULL;
+	phalcon_server_static_file *file;
+	const char *url, *header, *encoding = NULL;
+	char path[PATH_MAX], decoded[PATH_MAX], etag[64], modified[64];
+	size_t url_len;
+	struct stat *st;
+	off_t start = 0, end = 0;
+	smart_str headers = {0};
+	int i, fd, status = 200, range = 0, head;
+
+	if (request->parser->method != HTTP_GET && request->parser->method != HTTP_HEAD) {
+		return 0;
+	}
+	head = request->parser->method == HTTP_HEAD;
+
+	if (!request->url.s) {
+		return 0;
+	}
+
+	/* bounded by the length, the URL is only NUL-terminated once the message is complete */
+	url = ZSTR_VAL(request->url.s);
+	for (url_len = 0; url_len < ZSTR_LEN(request->url.s) && url[url_len] != '?' && url[url_len] != '#'; url_len++);
+
+	/* the longest prefix wins */
+	for (i = 0; i < statics->num_dirs; i++) {
+		phalcon_server_static_dir *candidate = &statics->dirs[i];
+
+		if (url_len >= candidate->prefix_len && !memcmp(url, candidate->prefix, candidate->prefix_len)
+			&& (candidate->prefix_len == url_len || url[candidate->prefix_len] == '/')
+			&& (!dir || candidate->prefix_len > dir->prefix_len)) {
+			dir = candidate;
+		}
+	}
+
+	if (!dir) {
+		return 0;
+	}
+
+	if (phalcon_server_static_decode(url + dir->prefix_len, url_len - dir->prefix_len, decoded, sizeof(decoded)) == FAILURE) {
+		return phalcon_server_static_error(client_ctx, 404, keepalive);
+	}
+
+	if (snprintf(path, sizeof(path), "%s%s%s%s", dir->root, decoded[0] == '/' ? "" : "/", decoded,
+			(!decoded[0] || decoded[strlen(decoded) - 1] == '/') ? "index.html" : "") >= (int)sizeof(path)) {
+		return phalcon_server_static_error(client_ctx, 404, keepalive);
+	}
+
+	file = phalcon_server_static_acquire(statics, dir->root, path);
+	if (!file) {
+		return phalcon_server_static_error(client_ctx, 404, keepalive);
+	}
+
+	/* the smallest precompressed sibling the client accepts */
+	fd = file->fd;
+	st = &file->st;
+	header = phalcon_server_static_header(request, "Accept-Encoding");
+	if (header) {
+		if (file->br_fd >= 0 && phalcon_server_static_has_token(header, "br")) {
+			fd = file->br_fd;
+			st = &file->br_st;
+			encoding = "br";
+		}
+		if (file->gz_fd >= 0 && (!encoding || file->gz_st.st_size < st->st_size) && phalcon_server_static_has_token(header, "gzip")) {
+			fd = file->gz_fd;
+			st = &file->gz_st;
+			encoding = "gzip";
+		}
+	}
+
+	snprintf(etag, sizeof(etag), "\"%lx-%llx\"", (unsigned long) st->st_mtime, (unsigned long long) st->st_size);
+	phalcon_server_static_http_date(modified, sizeof(modified), file->st.st_mtime);
+
+	if ((header = phalcon_server_static_header(request, "If-None-Match")) != NULL) {
+		if (phalcon_server_static_etag_matches(header, etag)) {
+			status = 304;
+		}
+	} else if ((header = phalcon_server_static_header(request, "If-Modified-Since")) != NULL && !strcmp(header, modified)) {
+		status = 304;
+	}
+
+	if (status == 200 && (header = phalcon_server_static_header(request, "Range")) != NULL) {
+		const char *if_range = phalcon_server_static_header(request, "If-Range");
+
+		if (!if_range || !strcmp(if_range, etag) || !strcmp(if_range, modified)) {
+			range = phalcon_server_static_range(header, st->st_size, &start, &end);
+		}
+	}
+
+	if (range < 0) {
+		smart_str_appendl(&headers, "Content-Range: bytes */", sizeof("Content-Range: bytes */") - 1);
+		smart_str_append_long(&headers, (zend_long) st->st_size);
+		smart_str_appends(&headers, "\r\nContent-Length: 0\r\n\r\n");
+		smart_str_0(&headers);
+
+		client_ctx->response = phalcon_server_static_status(416, keepalive, ZSTR_VAL(headers.s));
+		smart_str_free(&headers);
+
+		client_ctx->file = file;
+		phalcon_server_static_release(statics, client_ctx);
+		return 1;
+	}
+
+	if (range) {
+		status = 206;
+	} else {
+		start = 0;
+		end = st->st_size - 1;
+	}
+
+	smart_str_appends(&headers, "ETag: ");
+	smart_str_appends(&headers, etag);
+	smart_str_appends(&headers, "\r\nLast-Modified: ");
+	smart_str_appends(&headers, modified);
+	smart_str_appends(&headers, "\r\nAccept-Ranges: bytes\r\n");
+	if (file->gz_fd >= 0 || file->br_fd >= 0) {
+		smart_str_appends(&headers, "Vary: Accept-Encoding\r\n");
+	}
+
+	if (status != 304) {
+		smart_str_appends(&headers, "Content-Type: ");
+		smart_str_appends(&headers, phalcon_server_static_mime_type(path));
+		smart_str_appends(&headers, "\r\nContent-Length: ");
+		smart_str_append_long(&headers, (zend_long) (end - start + 1));
+		smart_str_appends(&headers, "\r\n");
+
+		if (encoding) {
+			smart_str_appends(&headers, "Content-Encoding: ");
+			smart_str_appends(&headers, encoding);
+			smart_str_appends(&headers, "\r\n");
+		}
+
+		if (status == 206) {
+			smart_str_appends(&headers, "Content-Range: bytes ");
+			smart_str_append_long(&headers, (zend_long) start);
+			smart_str_appendc(&headers, '-');
+			smart_str_append_long(&headers, (zend_long) end);
+			smart_str_appendc(&headers, '/');
+			smart_str_append_long(&headers, (zend_long) st->st_size);
+			smart_str_appends(&headers, "\r\n");
+		}
+	}
+	smart_str_appends(&headers, "\r\n");
+	smart_str_0(&headers);
+
+	client_ctx->response = phalcon_server_static_status(status, keepalive, ZSTR_VAL(headers.s));
+	smart_str_free(&headers);
+
+	if (status == 304 || head || st->st_size == 0) {
+		client_ctx->file = file;
+		phalcon_server_static_release(statics, client_ctx);
+		return 1;
+	}
+
+	client_ctx->file = file;
+	client_ctx->file_fd = fd;
+	client_ctx->file_offset = start;
+	client_ctx->file_remaining = end - start + 1;
+
+	return 1;
+}
+
+int phalcon_server_static_send(phalcon_server_conn_context_t *client_ctx)
+{
+	ssize_t n;
+
+	while (client_ctx->file_remaining > 0) {
+#ifdef HAVE_SENDFILE
+		n = sendfile(client_ctx->fd, client_ctx->file_fd, &client_ctx->file_offset, client_ctx->file_remaining);
+#else
+		char buf[16384];
+
+		n = pread(client_ctx->file_fd, buf, MIN(sizeof(buf), client_ctx->file_remaining), client_ctx->file_offset);
+		if (n > 0) {
+			n = write(client_ctx->fd, buf, n);
+			if (n > 0) {
+				client_ctx->file_offset += n;
+			}
+		} else if (n == 0) {
+			/* the file shrank since it was opened */
+			return -1;
+		}
+#endif
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+		}
+
+		if (n == 0) {
+			return -1;
+		}
+
+		client_ctx->file_remaining -= n;
+	}
+
+	return 1;
+}
+
+void phalcon_server_static_release(phalcon_server_static *statics, phalcon_server_conn_context_t *client_ctx)
+{
+	phalcon_server_static_file *file = client_ctx->file;
+
+	if (!file) {
+		return;
+	}
+
+	client_ctx->file = NULL;
+	client_ctx->file_remaining = 0;
+
+	pthread_mutex_lock(&statics->mutex);
+
+	file->refcount--;
+	if (file->refcount == 0 && !file->linked) {
+		phalcon_server_static_close(file);
+	}
+
+	pthread_mutex_unlock(&statics->mutex);
+}
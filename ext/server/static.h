@@ -0,0 +1,99 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_SERVER_STATIC_H
+#define PHALCON_SERVER_STATIC_H
+
+#include "php_phalcon.h"
+
+#include "server/core.h"
+#include "server/utils.h"
+
+#include <sys/stat.h>
+
+/* default number of files kept open */
+#define PHALCON_SERVER_STATIC_CACHE_SIZE	1024
+
+/* seconds a cached stat result is trusted before the file is checked again */
+#define PHALCON_SERVER_STATIC_VALID			1
+
+typedef struct _phalcon_server_static_file phalcon_server_static_file;
+
+struct _phalcon_server_static_file {
+	char *path;
+	/* path with its symlinks resolved, served only under a root holding it */
+	char *real;
+	int fd;
+	struct stat st;
+	/* precompressed siblings, path.gz and path.br, -1 if missing */
+	int gz_fd;
+	struct stat gz_st;
+	int br_fd;
+	struct stat br_st;
+	time_t checked;
+
+	uint32_t refcount;
+	int linked;
+
+	phalcon_server_static_file *prev;
+	phalcon_server_static_file *next;
+};
+
+typedef struct {
+	char *prefix;
+	size_t prefix_len;
+	char *root;
+} phalcon_server_static_dir;
+
+/*
+ * Directories served without running PHP, with an LRU cache of open files.
+ * Requests may be handled by the worker threads, so the cache is locked.
+ */
+typedef struct {
+	phalcon_server_static_dir *dirs;
+	int num_dirs;
+
+	HashTable files;
+	phalcon_server_static_file *head;
+	phalcon_server_static_file *tail;
+	size_t capacity;
+	size_t count;
+
+	pthread_mutex_t mutex;
+} phalcon_server_static;
+
+phalcon_server_static *phalcon_server_static_new(size_t capacity);
+void phalcon_server_static_free(phalcon_server_static *statics);
+int phalcon_server_static_add_dir(phalcon_server_static *statics, const char *prefix, size_t prefix_len, const char *root);
+
+/*
+ * Prepares the response of a request under a static directory: the headers go to
+ * client_ctx->response and the body is left in client_ctx->file* for sendfile().
+ * Returns 0 when the request has to go to the application.
+ */
+int phalcon_server_static_handle(phalcon_server_static *statics, phalcon_server_conn_context_t *client_ctx, phalcon_http_parser_data *request, int keepalive);
+
+/*
+ * Sends the pending file body, returns 1 once it is sent, 0 if the socket is full and -1 on error
+ */
+int phalcon_server_static_send(phalcon_server_conn_context_t *client_ctx);
+void phalcon_server_static_release(phalcon_server_static *statics, phalcon_server_conn_context_t *client_ctx);
+
+#endif /* PHALCON_SERVER_STATIC_H */
@@ -42,6 +42,12 @@ phalcon_http_parser_data *phalcon_http_parser_data_new(struct http_parser_settin
 void phalcon_http_parser_data_free(phalcon_http_parser_data *data)
 {
     if (!data) return;
+    zval_ptr_dtor(&data->head);
+    smart_str_free(&data->url);
+    smart_str_free(&data->body);
+    if (data->last_key) {
+        zend_string_release(data->last_key);
+    }
     efree(data->parser);
     efree(data);
     data = NULL;
@@ -140,7 +146,8 @@ int phalcon_http_parser_on_chunk_header(http_parser *p)
 int phalcon_http_parser_on_chunk_complete(http_parser *p)
 {
     phalcon_http_parser_data *data = (phalcon_http_parser_data *)p->data;
-    data->state = HTTP_PARSER_STATE_END;
+    /* more chunks may follow, only on_message_complete ends the request */
+    data->state = HTTP_PARSER_STATE_CHUNK;
     return 0;
 }
 
@@ -0,0 +1,615 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "session/adapter/shm.h"
+#include "session/adapter.h"
+#include "session/adapterinterface.h"
+#include "session/exception.h"
+
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "kernel/main.h"
+#include "kernel/exception.h"
+#include "kernel/fcall.h"
+#include "kernel/string.h"
+#include "kernel/array.h"
+#include "kernel/object.h"
+#include "kernel/operators.h"
+
+/**
+ * Phalcon\Session\Adapter\Shm
+ *
+ * This adapter store sessions in a POSIX shared memory segment shared by all the
+ * workers of the box. The segment is split in buckets of fixed size slots, every
+ * bucket is guarded by its own robust process-shared mutex so concurrent requests
+ * only contend when their session ids hash to the same bucket, and a worker dying
+ * with the lock held only costs the sessions of that bucket. A session written back
+ * unchanged under the id it was read with is not copied, only its access time is
+ * refreshed. Expired slots are reclaimed while scanning a bucket and by the gc
+ * handler. When every slot of a bucket holds a live session the write fails rather
+ * than evicting one
+ *
+ *<code>
+ * $session = new Phalcon\Session\Adapter\Shm(array(
+ *     'name' => '/phalcon_session',
+ *     'size' => 33554432,
+ *     'slotSize' => 4096,
+ *     'lifetime' => 3600
+ * ));
+ *
+ * $session->start();
+ *
+ * $session->set('var', 'some-value');
+ *
+ * echo $session->get('var');
+ *</code>
+ */
+zend_class_entry *phalcon_session_adapter_shm_ce;
+
+PHP_METHOD(Phalcon_Session_Adapter_Shm, start);
+PHP_METHOD(Phalcon_Session_Adapter_Shm, open);
+PHP_METHOD(Phalcon_Session_Adapter_Shm, close);
+PHP_METHOD(Phalcon_Session_Adapter_Shm, read);
+PHP_METHOD(Phalcon_Session_Adapter_Shm, write);
+PHP_METHOD(Phalcon_Session_Adapter_Shm, destroy);
+PHP_METHOD(Phalcon_Session_Adapter_Shm, gc);
+
+static const zend_function_entry phalcon_session_adapter_shm_method_entry[] = {
+	PHP_ME(Phalcon_Session_Adapter_Shm, start, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Session_Adapter_Shm, open, arginfo_phalcon_session_adapterinterface_open, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Session_Adapter_Shm, close, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Session_Adapter_Shm, read, arginfo_phalcon_session_adapterinterface_read, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Session_Adapter_Shm, write, arginfo_phalcon_session_adapterinterface_write, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Session_Adapter_Shm, destroy, arginfo_phalcon_session_adapterinterface_destroy, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Session_Adapter_Shm, gc, arginfo_phalcon_session_adapterinterface_gc, ZEND_ACC_PUBLIC)
+	PHP_FE_END
+};
+
+/* Drops the session remembered by read() */
+static void phalcon_session_adapter_shm_forget(phalcon_session_adapter_shm_object *intern)
+{
+	if (intern->sid) {
+		zend_string_release(intern->sid);
+		intern->sid = NULL;
+	}
+
+	if (intern->data) {
+		zend_string_release(intern->data);
+		intern->data = NULL;
+	}
+}
+
+zend_object_handlers phalcon_session_adapter_shm_object_handlers;
+zend_object* phalcon_session_adapter_shm_object_create_handler(zend_class_entry *ce)
+{
+	phalcon_session_adapter_shm_object *intern = ecalloc(1, sizeof(phalcon_session_adapter_shm_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_session_adapter_shm_object_handlers;
+
+	return &intern->std;
+}
+
+void phalcon_session_adapter_shm_object_free_handler(zend_object *object)
+{
+	phalcon_session_adapter_shm_object *intern = phalcon_session_adapter_shm_object_from_obj(object);
+
+	phalcon_session_adapter_shm_forget(intern);
+
+	if (intern->shm) {
+		phalcon_shared_memory_cleanup(intern->shm);
+	}
+
+	zend_object_std_dtor(object);
+}
+
+/**
+ * Phalcon\Session\Adapter\Shm initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Session_Adapter_Shm){
+
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT_EX(Phalcon\\Session\\Adapter, Shm, session_adapter_shm, phalcon_session_adapter_ce, phalcon_session_adapter_shm_method_entry, 0);
+
+	zend_declare_property_long(phalcon_session_adapter_shm_ce, SL("_lifetime"), 8600, ZEND_ACC_PROTECTED);
+
+	return SUCCESS;
+}
+
+/* The mutex of a bucket sits in the cache line before its slots */
+typedef char phalcon_session_adapter_shm_lock_fits[sizeof(pthread_mutex_t) <= PHALCON_SESSION_ADAPTER_SHM_ALIGN ? 1 : -1];
+
+static inline pthread_mutex_t *phalcon_session_adapter_shm_lock_at(phalcon_session_adapter_shm_header *header, uint32_t bucket)
+{
+	return (pthread_mutex_t*)((char*)header + PHALCON_SESSION_ADAPTER_SHM_ALIGN + (size_t)bucket * header->bucket_size);
+}
+
+static inline phalcon_session_adapter_shm_slot *phalcon_session_adapter_shm_slot_at(phalcon_session_adapter_shm_header *header, uint32_t bucket, uint32_t i)
+{
+	return (phalcon_session_adapter_shm_slot*)((char*)phalcon_session_adapter_shm_lock_at(header, bucket) + PHALCON_SESSION_ADAPTER_SHM_ALIGN + (size_t)i * header->slot_size);
+}
+
+/**
+ * Locks a bucket. When the previous holder died the bucket may be half written,
+ * its sessions are dropped before the mutex is marked consistent again
+ */
+static int phalcon_session_adapter_shm_lock(phalcon_session_adapter_shm_header *header, uint32_t bucket)
+{
+	pthread_mutex_t *lock = phalcon_session_adapter_shm_lock_at(header, bucket);
+	uint32_t i;
+	int ret;
+
+	ret = pthread_mutex_lock(lock);
+	if (ret == EOWNERDEAD) {
+		for (i = 0; i < PHALCON_SESSION_ADAPTER_SHM_BUCKET_SLOTS; i++) {
+			phalcon_session_adapter_shm_slot_at(header, bucket, i)->sid_len = 0;
+		}
+		ret = pthread_mutex_consistent(lock);
+	}
+
+	return ret == 0 ? SUCCESS : FAILURE;
+}
+
+static inline void phalcon_session_adapter_shm_unlock(phalcon_session_adapter_shm_header *header, uint32_t bucket)
+{
+	pthread_mutex_unlock(phalcon_session_adapter_shm_lock_at(header, bucket));
+}
+
+static inline uint32_t phalcon_session_adapter_shm_bucket(phalcon_session_adapter_shm_header *header, zend_string *sid)
+{
+	return (uint32_t)(zend_inline_hash_func(ZSTR_VAL(sid), ZSTR_LEN(sid)) % header->num_buckets);
+}
+
+/**
+ * Scans a locked bucket for the session, freeing the expired slots on the way.
+ * When the session is not found and a slot is requested, a free slot is returned,
+ * or NULL if every slot holds a live session
+ */
+static phalcon_session_adapter_shm_slot *phalcon_session_adapter_shm_find(phalcon_session_adapter_shm_header *header, uint32_t bucket, zend_string *sid, zend_long lifetime, time_t now, int alloc)
+{
+	phalcon_session_adapter_shm_slot *slot, *empty = NULL, *found = NULL;
+	uint32_t i;
+
+	for (i = 0; i < PHALCON_SESSION_ADAPTER_SHM_BUCKET_SLOTS; i++) {
+		slot = phalcon_session_adapter_shm_slot_at(header, bucket, i);
+
+		if (slot->sid_len && lifetime > 0 && now - slot->mtime > lifetime) {
+			slot->sid_len = 0;
+		}
+
+		if (!slot->sid_len) {
+			if (!empty) {
+				empty = slot;
+			}
+			continue;
+		}
+
+		if (!found && slot->sid_len == ZSTR_LEN(sid) && !memcmp(slot->sid, ZSTR_VAL(sid), ZSTR_LEN(sid))) {
+			found = slot;
+		}
+	}
+
+	if (found || !alloc || !empty) {
+		return found;
+	}
+
+	empty->data_len = 0;
+	return empty;
+}
+
+/**
+ * Lays out a segment this process has just created, nobody else uses it before the magic is set
+ */
+static int phalcon_session_adapter_shm_init(phalcon_session_adapter_shm_header *header, size_t size, size_t slot_size)
+{
+	pthread_mutexattr_t attr;
+	size_t bucket_size;
+	uint32_t bucket;
+	int ret = SUCCESS;
+
+	slot_size = ZEND_MM_ALIGNED_SIZE_EX(MAX(slot_size, XtOffsetOf(phalcon_session_adapter_shm_slot, data) + 1), 8);
+	bucket_size = ZEND_MM_ALIGNED_SIZE_EX(PHALCON_SESSION_ADAPTER_SHM_ALIGN + PHALCON_SESSION_ADAPTER_SHM_BUCKET_SLOTS * slot_size, PHALCON_SESSION_ADAPTER_SHM_ALIGN);
+
+	if (size < PHALCON_SESSION_ADAPTER_SHM_ALIGN + bucket_size || bucket_size > UINT32_MAX) {
+		return FAILURE;
+	}
+
+	header->slot_size = (uint32_t)slot_size;
+	header->bucket_size = (uint32_t)bucket_size;
+	header->num_buckets = (uint32_t)((size - PHALCON_SESSION_ADAPTER_SHM_ALIGN) / bucket_size);
+
+	if (pthread_mutexattr_init(&attr)) {
+		return FAILURE;
+	}
+
+	if (pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) || pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST)) {
+		ret = FAILURE;
+	}
+
+	for (bucket = 0; ret == SUCCESS && bucket < header->num_buckets; bucket++) {
+		if (pthread_mutex_init(phalcon_session_adapter_shm_lock_at(header, bucket), &attr)) {
+			ret = FAILURE;
+		}
+	}
+	pthread_mutexattr_destroy(&attr);
+
+	if (ret == SUCCESS) {
+		__sync_synchronize();
+		header->magic = PHALCON_SESSION_ADAPTER_SHM_MAGIC;
+	}
+
+	return ret;
+}
+
+/**
+ * Maps the segment. Only the worker that creates it lays it out, the others
+ * attach and wait until the layout is published
+ */
+static int phalcon_session_adapter_shm_attach(phalcon_session_adapter_shm_object *intern, const char *name, size_t size, size_t slot_size)
+{
+	phalcon_session_adapter_shm_header *header = NULL;
+	int tries;
+
+	for (tries = 0; tries < 1000; tries++) {
+		intern->shm = phalcon_shared_memory_create_exclusive(name, size);
+		if (intern->shm) {
+			header = (phalcon_session_adapter_shm_header*)phalcon_shared_memory_ptr(intern->shm);
+			if (phalcon_session_adapter_shm_init(header, phalcon_shared_memory_size(intern->shm), slot_size) == FAILURE) {
+				phalcon_shared_memory_unlink(name);
+				return FAILURE;
+			}
+			break;
+		}
+
+		if (errno != EEXIST) {
+			return FAILURE;
+		}
+
+		/* The creator may not have sized or laid out the segment yet */
+		intern->shm = phalcon_shared_memory_open(name);
+		if (intern->shm) {
+			header = (phalcon_session_adapter_shm_header*)phalcon_shared_memory_ptr(intern->shm);
+			if (phalcon_shared_memory_size(intern->shm) >= sizeof(*header) && header->magic == PHALCON_SESSION_ADAPTER_SHM_MAGIC) {
+				__sync_synchronize();
+				break;
+			}
+
+			phalcon_shared_memory_cleanup(intern->shm);
+			intern->shm = NULL;
+		}
+
+		usleep(1000);
+	}
+
+	if (!intern->shm) {
+		return FAILURE;
+	}
+
+	if (!header->num_buckets || PHALCON_SESSION_ADAPTER_SHM_ALIGN + (size_t)header->num_buckets * header->bucket_size > phalcon_shared_memory_size(intern->shm)) {
+		return FAILURE;
+	}
+
+	intern->header = header;
+	return SUCCESS;
+}
+
+/**
+ * Starts the session (if headers are already sent the session will not be started)
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Session_Adapter_Shm, start){
+
+	zval options = {}, name = {}, size = {}, slot_size = {}, lifetime = {};
+	zval callable_open = {}, callable_close = {}, callable_read = {}, callable_write = {}, callable_destroy = {}, callable_gc = {};
+	phalcon_session_adapter_shm_object *intern = phalcon_session_adapter_shm_object_from_obj(Z_OBJ_P(getThis()));
+	const char *shm_name = "/phalcon_session";
+	zend_long shm_size = 32 * 1024 * 1024, shm_slot_size = 4096;
+
+	phalcon_read_property(&options, getThis(), SL("_options"), PH_NOISY|PH_READONLY);
+
+	if (Z_TYPE(options) == IS_ARRAY) {
+		if (phalcon_array_isset_fetch_str(&name, &options, SL("name"), PH_READONLY) && Z_TYPE(name) == IS_STRING) {
+			shm_name = Z_STRVAL(name);
+		}
+
+		if (phalcon_array_isset_fetch_str(&size, &options, SL("size"), PH_READONLY)) {
+			shm_size = phalcon_get_intval(&size);
+		}
+
+		if (phalcon_array_isset_fetch_str(&slot_size, &options, SL("slotSize"), PH_READONLY)) {
+			shm_slot_size = phalcon_get_intval(&slot_size);
+		}
+
+		if (phalcon_array_isset_fetch_str(&lifetime, &options, SL("lifetime"), PH_READONLY)) {
+			phalcon_update_property(getThis(), SL("_lifetime"), &lifetime);
+		}
+	}
+
+	if (shm_size <= 0 || shm_slot_size <= 0) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_session_exception_ce, "The size and slotSize options must be positive");
+		return;
+	}
+
+	if (!intern->shm && phalcon_session_adapter_shm_attach(intern, shm_name, (size_t)shm_size, (size_t)shm_slot_size) == FAILURE) {
+		if (intern->shm) {
+			phalcon_shared_memory_cleanup(intern->shm);
+			intern->shm = NULL;
+		}
+		zend_throw_exception_ex(phalcon_session_exception_ce, 0, "Cannot attach the shared memory segment '%s'", shm_name);
+		return;
+	}
+
+	/* open callback */
+	array_init_size(&callable_open, 2);
+	phalcon_array_append(&callable_open, getThis(), PH_COPY);
+	phalcon_array_append_str(&callable_open, SL("open"), 0);
+
+	/* close callback */
+	array_init_size(&callable_close, 2);
+	phalcon_array_append(&callable_close, getThis(), PH_COPY);
+	phalcon_array_append_str(&callable_close, SL("close"), 0);
+
+	/* read callback */
+	array_init_size(&callable_read, 2);
+	phalcon_array_append(&callable_read, getThis(), PH_COPY);
+	phalcon_array_append_str(&callable_read, SL("read"), 0);
+
+	/* write callback */
+	array_init_size(&callable_write, 2);
+	phalcon_array_append(&callable_write, getThis(), PH_COPY);
+	phalcon_array_append_str(&callable_write, SL("write"), 0);
+
+	/* destroy callback */
+	array_init_size(&callable_destroy, 2);
+	phalcon_array_append(&callable_destroy, getThis(), PH_COPY);
+	phalcon_array_append_str(&callable_destroy, SL("destroy"), 0);
+
+	/* gc callback */
+	array_init_size(&callable_gc, 2);
+	phalcon_array_append(&callable_gc, getThis(), PH_COPY);
+	phalcon_array_append_str(&callable_gc, SL("gc"), 0);
+
+	PHALCON_CALL_FUNCTION(return_value, "session_set_save_handler", &callable_open, &callable_close, &callable_read, &callable_write, &callable_destroy, &callable_gc);
+	zval_ptr_dtor(&callable_open);
+	zval_ptr_dtor(&callable_close);
+	zval_ptr_dtor(&callable_read);
+	zval_ptr_dtor(&callable_write);
+	zval_ptr_dtor(&callable_destroy);
+	zval_ptr_dtor(&callable_gc);
+	PHALCON_CALL_FUNCTION(NULL, "session_register_shutdown");
+
+	if (!zend_is_true(return_value)) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_session_exception_ce, "Sets user-level session storage functions failed");
+		RETURN_FALSE;
+	}
+	PHALCON_CALL_PARENT(return_value, phalcon_session_adapter_shm_ce, getThis(), "start");
+}
+
+/**
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Session_Adapter_Shm, open){
+
+	RETURN_TRUE;
+}
+
+/**
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Session_Adapter_Shm, close){
+
+	phalcon_session_adapter_shm_object *intern = phalcon_session_adapter_shm_object_from_obj(Z_OBJ_P(getThis()));
+
+	phalcon_session_adapter_shm_forget(intern);
+
+	RETURN_TRUE;
+}
+
+/**
+ *
+ * @param string $sessionId
+ * @return string
+ */
+PHP_METHOD(Phalcon_Session_Adapter_Shm, read){
+
+	zval *sid, lifetime = {};
+	phalcon_session_adapter_shm_object *intern = phalcon_session_adapter_shm_object_from_obj(Z_OBJ_P(getThis()));
+	phalcon_session_adapter_shm_slot *slot;
+	zend_string *data = NULL;
+	uint32_t bucket;
+	time_t now;
+
+	phalcon_fetch_params(0, 1, 0, &sid);
+	PHALCON_ENSURE_IS_STRING(sid);
+
+	phalcon_session_adapter_shm_forget(intern);
+
+	if (!intern->header || Z_STRLEN_P(sid) > PHALCON_SESSION_ADAPTER_SHM_SID_LEN) {
+		RETURN_EMPTY_STRING();
+	}
+
+	phalcon_read_property(&lifetime, getThis(), SL("_lifetime"), PH_NOISY|PH_READONLY);
+
+	now = time(NULL);
+	bucket = phalcon_session_adapter_shm_bucket(intern->header, Z_STR_P(sid));
+
+	if (phalcon_session_adapter_shm_lock(intern->header, bucket) == FAILURE) {
+		RETURN_EMPTY_STRING();
+	}
+	slot = phalcon_session_adapter_shm_find(intern->header, bucket, Z_STR_P(sid), phalcon_get_intval(&lifetime), now, 0);
+	if (slot) {
+		data = zend_string_init(slot->data, slot->data_len, 0);
+		slot->mtime = now;
+	}
+	phalcon_session_adapter_shm_unlock(intern->header, bucket);
+
+	if (!data) {
+		RETURN_EMPTY_STRING();
+	}
+
+	/* Remembered with its id to skip the copy when the same session is written back unchanged */
+	intern->sid = zend_string_copy(Z_STR_P(sid));
+	intern->data = zend_string_copy(data);
+	RETURN_STR(data);
+}
+
+/**
+ *
+ * @param string $sessionId
+ * @param string $data
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Session_Adapter_Shm, write){
+
+	zval *sid, *data, lifetime = {};
+	phalcon_session_adapter_shm_object *intern = phalcon_session_adapter_shm_object_from_obj(Z_OBJ_P(getThis()));
+	phalcon_session_adapter_shm_slot *slot;
+	uint32_t bucket;
+	time_t now;
+	int unchanged;
+
+	phalcon_fetch_params(0, 2, 0, &sid, &data);
+	PHALCON_ENSURE_IS_STRING(sid);
+	PHALCON_ENSURE_IS_STRING(data);
+
+	if (!intern->header || Z_STRLEN_P(sid) > PHALCON_SESSION_ADAPTER_SHM_SID_LEN) {
+		RETURN_FALSE;
+	}
+
+	if (Z_STRLEN_P(data) > intern->header->slot_size - XtOffsetOf(phalcon_session_adapter_shm_slot, data)) {
+		php_error_docref(NULL, E_WARNING, "Session data of %zu bytes does not fit in a slot of %u bytes", Z_STRLEN_P(data), intern->header->slot_size);
+		RETURN_FALSE;
+	}
+
+	phalcon_read_property(&lifetime, getThis(), SL("_lifetime"), PH_NOISY|PH_READONLY);
+
+	/* A regenerated id with the same payload still has to be written */
+	unchanged = intern->sid && intern->data && zend_string_equals(intern->sid, Z_STR_P(sid)) && zend_string_equals(intern->data, Z_STR_P(data));
+
+	now = time(NULL);
+	bucket = phalcon_session_adapter_shm_bucket(intern->header, Z_STR_P(sid));
+
+	if (phalcon_session_adapter_shm_lock(intern->header, bucket) == FAILURE) {
+		RETURN_FALSE;
+	}
+	slot = phalcon_session_adapter_shm_find(intern->header, bucket, Z_STR_P(sid), phalcon_get_intval(&lifetime), now, 1);
+	if (!slot) {
+		phalcon_session_adapter_shm_unlock(intern->header, bucket);
+		RETURN_FALSE;
+	}
+	if (!unchanged || !slot->sid_len) {
+		memcpy(slot->sid, Z_STRVAL_P(sid), Z_STRLEN_P(sid));
+		memcpy(slot->data, Z_STRVAL_P(data), Z_STRLEN_P(data));
+		slot->data_len = (uint32_t)Z_STRLEN_P(data);
+		slot->sid_len = (uint32_t)Z_STRLEN_P(sid);
+	}
+	slot->mtime = now;
+	phalcon_session_adapter_shm_unlock(intern->header, bucket);
+
+	RETURN_TRUE;
+}
+
+/**
+ *
+ * @param string $session_id optional, session id
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Session_Adapter_Shm, destroy){
+
+	zval *_sid = NULL, sid = {}, lifetime = {};
+	phalcon_session_adapter_shm_object *intern = phalcon_session_adapter_shm_object_from_obj(Z_OBJ_P(getThis()));
+	phalcon_session_adapter_shm_slot *slot;
+	uint32_t bucket;
+
+	phalcon_fetch_params(0, 0, 1, &_sid);
+
+	if (!_sid) {
+		PHALCON_CALL_SELF(&sid, "getid");
+	} else {
+		ZVAL_COPY(&sid, _sid);
+	}
+
+	phalcon_session_adapter_shm_forget(intern);
+
+	if (!intern->header || Z_TYPE(sid) != IS_STRING || Z_STRLEN(sid) > PHALCON_SESSION_ADAPTER_SHM_SID_LEN) {
+		zval_ptr_dtor(&sid);
+		RETURN_TRUE;
+	}
+
+	phalcon_read_property(&lifetime, getThis(), SL("_lifetime"), PH_NOISY|PH_READONLY);
+
+	bucket = phalcon_session_adapter_shm_bucket(intern->header, Z_STR(sid));
+
+	if (phalcon_session_adapter_shm_lock(intern->header, bucket) == SUCCESS) {
+		slot = phalcon_session_adapter_shm_find(intern->header, bucket, Z_STR(sid), phalcon_get_intval(&lifetime), time(NULL), 0);
+		if (slot) {
+			slot->sid_len = 0;
+		}
+		phalcon_session_adapter_shm_unlock(intern->header, bucket);
+	}
+
+	zval_ptr_dtor(&sid);
+	RETURN_TRUE;
+}
+
+/**
+ * Frees the slots of the sessions not accessed during the lifetime
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Session_Adapter_Shm, gc){
+
+	zval lifetime = {};
+	phalcon_session_adapter_shm_object *intern = phalcon_session_adapter_shm_object_from_obj(Z_OBJ_P(getThis()));
+	phalcon_session_adapter_shm_slot *slot;
+	zend_long ttl;
+	uint32_t bucket, i;
+	time_t now;
+
+	phalcon_read_property(&lifetime, getThis(), SL("_lifetime"), PH_NOISY|PH_READONLY);
+
+	ttl = phalcon_get_intval(&lifetime);
+	if (!intern->header || ttl <= 0) {
+		RETURN_TRUE;
+	}
+
+	now = time(NULL);
+	for (bucket = 0; bucket < intern->header->num_buckets; bucket++) {
+		if (phalcon_session_adapter_shm_lock(intern->header, bucket) == FAILURE) {
+			continue;
+		}
+		for (i = 0; i < PHALCON_SESSION_ADAPTER_SHM_BUCKET_SLOTS; i++) {
+			slot = phalcon_session_adapter_shm_slot_at(intern->header, bucket, i);
+			if (slot->sid_len && now - slot->mtime > ttl) {
+				slot->sid_len = 0;
+			}
+		}
+		phalcon_session_adapter_shm_unlock(intern->header, bucket);
+	}
+
+	RETURN_TRUE;
+}
@@ -0,0 +1,65 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_SESSION_ADAPTER_SHM_H
+#define PHALCON_SESSION_ADAPTER_SHM_H
+
+#include "php_phalcon.h"
+#include "kernel/shm.h"
+
+#include <pthread.h>
+
+#define PHALCON_SESSION_ADAPTER_SHM_MAGIC        0x5048534e
+#define PHALCON_SESSION_ADAPTER_SHM_SID_LEN      128
+#define PHALCON_SESSION_ADAPTER_SHM_BUCKET_SLOTS 8
+#define PHALCON_SESSION_ADAPTER_SHM_ALIGN        64
+
+typedef struct {
+	uint32_t magic;
+	uint32_t num_buckets;
+	uint32_t slot_size;
+	uint32_t bucket_size;
+} phalcon_session_adapter_shm_header;
+
+typedef struct {
+	uint32_t sid_len;
+	uint32_t data_len;
+	int64_t mtime;
+	char sid[PHALCON_SESSION_ADAPTER_SHM_SID_LEN];
+	char data[1];
+} phalcon_session_adapter_shm_slot;
+
+typedef struct {
+	phalcon_shared_memory *shm;
+	phalcon_session_adapter_shm_header *header;
+	zend_string *sid;
+	zend_string *data;
+	zend_object std;
+} phalcon_session_adapter_shm_object;
+
+static inline phalcon_session_adapter_shm_object *phalcon_session_adapter_shm_object_from_obj(zend_object *obj) {
+	return (phalcon_session_adapter_shm_object*)((char*)(obj) - XtOffsetOf(phalcon_session_adapter_shm_object, std));
+}
+
+extern zend_class_entry *phalcon_session_adapter_shm_ce;
+
+PHALCON_INIT_CLASS(Phalcon_Session_Adapter_Shm);
+
+#endif /* PHALCON_SESSION_ADAPTER_SHM_H */
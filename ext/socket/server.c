@@ -24,6 +24,7 @@
 #include "socket/exception.h"
 
 #include <Zend/zend_closures.h>
+#include <Zend/zend_smart_str.h>
 
 #if HAVE_EPOLL
 # include <sys/epoll.h>
@@ -33,6 +34,7 @@
 # include <sys/wait.h>
 # include <arpa/inet.h>
 # include <signal.h>
+# include <fcntl.h>
 # define EPOLL_EVENT_SIZE 1024
 #endif
 
@@ -52,6 +54,7 @@
  *<code>
  *
  *	$server = new Phalcon\Socket\Server('127.0.0.1', 8989);
+ *  $server->setIdleTimeout(60);
  *  $server->run(
  *      function(Phalcon\Socket\Client $client){
  *          // Connect
@@ -79,9 +82,19 @@
  */
 zend_class_entry *phalcon_socket_server_ce;
 
+#if HAVE_EPOLL
+struct _phalcon_socket_server_loop;
+
+/* the epoll loop run() is driving, so that disconnect() can release its slot */
+static struct _phalcon_socket_server_loop *phalcon_socket_server_current = NULL;
+
+static void phalcon_socket_server_conn_drop(zval *object, struct _phalcon_socket_server_loop *loop, int fd);
+#endif
+
 PHP_METHOD(Phalcon_Socket_Server, __construct);
 PHP_METHOD(Phalcon_Socket_Server, setDaemon);
 PHP_METHOD(Phalcon_Socket_Server, setMaxChildren);
+PHP_METHOD(Phalcon_Socket_Server, setIdleTimeout);
 PHP_METHOD(Phalcon_Socket_Server, setEvent);
 PHP_METHOD(Phalcon_Socket_Server, getEvent);
 PHP_METHOD(Phalcon_Socket_Server, listen);
@@ -107,6 +120,10 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_socket_server_setmaxchildren, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, maxChildren, IS_LONG, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_socket_server_setidletimeout, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, seconds, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_socket_server_setevent, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, event, IS_LONG, 0)
 ZEND_END_ARG_INFO()
@@ -143,6 +160,7 @@ static const zend_function_entry phalcon_socket_server_method_entry[] = {
 	PHP_ME(Phalcon_Socket_Server, __construct, arginfo_phalcon_socket_server___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Socket_Server, setDaemon, arginfo_phalcon_socket_server_setdaemon, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Socket_Server, setMaxChildren, arginfo_phalcon_socket_server_setmaxchildren, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Socket_Server, setIdleTimeout, arginfo_phalcon_socket_server_setidletimeout, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Socket_Server, setEvent, arginfo_phalcon_socket_server_setevent, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Socket_Server, getEvent, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Socket_Server, listen, arginfo_phalcon_socket_server_listen, ZEND_ACC_PUBLIC)
@@ -168,6 +186,7 @@ PHALCON_INIT_CLASS(Phalcon_Socket_Server){
 	zend_declare_property_null(phalcon_socket_server_ce, SL("_clients"), ZEND_ACC_PROTECTED);
 	zend_declare_property_long(phalcon_socket_server_ce, SL("_event"), 1, ZEND_ACC_PROTECTED);
 	zend_declare_property_long(phalcon_socket_server_ce, SL("_backlog"), 0, ZEND_ACC_PROTECTED);
+	zend_declare_property_long(phalcon_socket_server_ce, SL("_idleTimeout"), 0, ZEND_ACC_PROTECTED);
 #if HAVE_EPOLL
 	zend_declare_property_long(phalcon_socket_server_ce, SL("_epollSize"), 1024, ZEND_ACC_PROTECTED);
 #endif
@@ -268,6 +287,25 @@ PHP_METHOD(Phalcon_Socket_Server, setMaxChildren){
 	RETURN_THIS();
 }
 
+/**
+ * Sets the idle timeout of the connections in seconds, 0 disables it
+ *
+ * Only the epoll loop enforces it, an idle connection is closed and onclose is called
+ *
+ * @param int $seconds
+ * @return Phalcon\Socket\Server
+ */
+PHP_METHOD(Phalcon_Socket_Server, setIdleTimeout){
+
+	zval *seconds;
+
+	phalcon_fetch_params(0, 1, 0, &seconds);
+
+	phalcon_update_property(getThis(), SL("_idleTimeout"), seconds);
+
+	RETURN_THIS();
+}
+
 /**
  * Sets the event
  *
@@ -397,11 +435,19 @@ PHP_METHOD(Phalcon_Socket_Server, disconnect){
 
 	phalcon_fetch_params(0, 1, 0, &socket_id);
 
+#if HAVE_EPOLL
+	if (phalcon_socket_server_current && Z_TYPE_P(socket_id) == IS_LONG) {
+		phalcon_socket_server_conn_drop(getThis(), phalcon_socket_server_current, (int) Z_LVAL_P(socket_id));
+	}
+#endif
+
 	phalcon_read_property_array(&client, getThis(), SL("_clients"), socket_id, PH_READONLY);
 	if (Z_TYPE(client) == IS_OBJECT) {
 		PHALCON_CALL_METHOD(NULL, &client, "close");
 	}
 	phalcon_unset_property_array(getThis(), SL("_clients"), socket_id);
+
+	RETURN_THIS();
 }
 
 void setkeepalive(int fd) {
@@ -528,6 +574,398 @@ static int phalcon_socket_server_startup_workers(zval *object, int max_childs) {
 	}
 }
 
+#if HAVE_EPOLL
+/*
+ * The epoll loop keeps its per-connection state in C, indexed by fd. The
+ * Phalcon\Socket\Client of a connection is only created when a callback needs
+ * it, so accepting and keeping idle connections costs no PHP object.
+ *
+ * Idle timeouts use a hashed timer wheel with one second slots. Activity only
+ * moves the deadline of a connection, it is moved to its new slot when its old
+ * slot comes around, so a busy connection costs nothing more than a store.
+ */
+#define PHALCON_SOCKET_SERVER_WHEEL_SIZE 512
+#define PHALCON_SOCKET_SERVER_READ_SIZE  8192
+
+typedef struct {
+	zval client;
+	smart_str buffer;
+	time_t deadline;
+	int slot;
+	int prev;
+	int next;
+	int active;
+} phalcon_socket_server_conn;
+
+typedef struct _phalcon_socket_server_loop {
+	zend_object *owner;
+	int epollfd;
+	int listenfd;
+	int family;
+	int size;
+	phalcon_socket_server_conn *conns;
+	int wheel[PHALCON_SOCKET_SERVER_WHEEL_SIZE];
+	time_t tick;
+	zend_long idle;
+	zend_long maxlen;
+} phalcon_socket_server_loop;
+
+static void phalcon_socket_server_wheel_link(phalcon_socket_server_loop *loop, int fd)
+{
+	phalcon_socket_server_conn *conn = &loop->conns[fd];
+	int slot = (int) (conn->deadline % PHALCON_SOCKET_SERVER_WHEEL_SIZE);
+
+	conn->slot = slot;
+	conn->prev = -1;
+	conn->next = loop->wheel[slot];
+	if (conn->next >= 0) {
+		loop->conns[conn->next].prev = fd;
+	}
+	loop->wheel[slot] = fd;
+}
+
+static void phalcon_socket_server_wheel_unlink(phalcon_socket_server_loop *loop, int fd)
+{
+	phalcon_socket_server_conn *conn = &loop->conns[fd];
+
+	if (conn->slot < 0) {
+		return;
+	}
+
+	if (conn->prev >= 0) {
+		loop->conns[conn->prev].next = conn->next;
+	} else {
+		loop->wheel[conn->slot] = conn->next;
+	}
+	if (conn->next >= 0) {
+		loop->conns[conn->next].prev = conn->prev;
+	}
+
+	conn->slot = conn->prev = conn->next = -1;
+}
+
+static int phalcon_socket_server_loop_reserve(phalcon_socket_server_loop *loop, int fd)
+{
+	int size = loop->size ? loop->size : 1024, i;
+
+	if (fd < loop->size) {
+		return 1;
+	}
+
+	while (size <= fd) {
+		size *= 2;
+	}
+
+	loop->conns = erealloc(loop->conns, size * sizeof(phalcon_socket_server_conn));
+	memset(loop->conns + loop->size, 0, (size - loop->size) * sizeof(phalcon_socket_server_conn));
+	for (i = loop->size; i < size; i++) {
+		loop->conns[i].slot = loop->conns[i].prev = loop->conns[i].next = -1;
+	}
+	loop->size = size;
+
+	return 1;
+}
+
+/*
+ * Forgets a connection without touching its fd
+ */
+static void phalcon_socket_server_conn_release(zval *object, phalcon_socket_server_loop *loop, int fd)
+{
+	phalcon_socket_server_conn *conn = &loop->conns[fd];
+	zval socket_id = {};
+
+	phalcon_socket_server_wheel_unlink(loop, fd);
+	smart_str_free(&conn->buffer);
+
+	if (Z_TYPE(conn->client) == IS_OBJECT) {
+		ZVAL_LONG(&socket_id, fd);
+		phalcon_unset_property_array(object, SL("_clients"), &socket_id);
+		zval_ptr_dtor(&conn->client);
+	}
+
+	ZVAL_UNDEF(&conn->client);
+	conn->active = 0;
+}
+
+static zval *phalcon_socket_server_conn_client(zval *object, phalcon_socket_server_loop *loop, int fd)
+{
+	phalcon_socket_server_conn *conn = &loop->conns[fd];
+	zval socket = {}, socket_id = {}, *params[1];
+	php_socket *php_sock;
+
+	if (Z_TYPE(conn->client) == IS_OBJECT) {
+		return &conn->client;
+	}
+
+	php_sock = php_create_socket();
+	php_sock->bsd_socket = fd;
+	php_sock->error = 0;
+	php_sock->blocking = 0;
+	php_sock->type = loop->family;
+
+	ZVAL_RES(&socket, zend_register_resource(php_sock, php_sockets_le_socket()));
+
+	object_init_ex(&conn->client, phalcon_socket_client_ce);
+	params[0] = &socket;
+	phalcon_call_method(NULL, &conn->client, "__construct", 1, params);
+	zval_ptr_dtor(&socket);
+
+	ZVAL_LONG(&socket_id, fd);
+	phalcon_update_property_array(object, SL("_clients"), &socket_id, &conn->client);
+
+	return &conn->client;
+}
+
+/*
+ * Calls the callback given to run() or else the method of the same name
+ */
+static int phalcon_socket_server_dispatch(zval *object, zval *callback, const char *method, uint32_t method_len, zval *retval, int argc, zval *argv)
+{
+	zval *params[2], ret = {};
+	int i, status = SUCCESS;
+
+	if (Z_TYPE_P(callback) > IS_NULL) {
+		status = phalcon_call_user_func_args(retval ? retval : &ret, callback, argv, argc);
+	} else if (phalcon_method_exists_ex(object, method, method_len) == SUCCESS) {
+		for (i = 0; i < argc; i++) {
+			params[i] = &argv[i];
+		}
+		status = phalcon_call_method(retval ? retval : &ret, object, method, argc, params);
+	}
+	zval_ptr_dtor(&ret);
+
+	return status;
+}
+
+/*
+ * Takes a connection out of the loop and closes its fd, unless its client was closed already
+ */
+static void phalcon_socket_server_conn_drop(zval *object, phalcon_socket_server_loop *loop, int fd)
+{
+	phalcon_socket_server_conn *conn;
+	struct epoll_event ev = {0};
+	zval closed = {};
+
+	if (fd < 0 || fd >= loop->size || !loop->conns[fd].active || Z_OBJ_P(object) != loop->owner) {
+		return;
+	}
+	conn = &loop->conns[fd];
+
+	epoll_ctl(loop->epollfd, EPOLL_CTL_DEL, fd, &ev);
+
+	if (Z_TYPE(conn->client) != IS_OBJECT) {
+		shutdown(fd, SHUT_RDWR);
+		close(fd);
+	} else {
+		phalcon_read_property(&closed, &conn->client, SL("_close"), PH_NOISY|PH_READONLY);
+		if (!zend_is_true(&closed)) {
+			shutdown(fd, SHUT_RDWR);
+			/* the fd belongs to the socket resource of the client */
+			phalcon_call_method(NULL, &conn->client, "close", 0, NULL);
+		}
+	}
+
+	phalcon_socket_server_conn_release(object, loop, fd);
+}
+
+static void phalcon_socket_server_conn_close(zval *object, phalcon_socket_server_loop *loop, int fd, zval *onclose)
+{
+	if (!loop->conns[fd].active) {
+		return;
+	}
+
+	if (Z_TYPE_P(onclose) > IS_NULL || phalcon_method_exists_ex(object, SL("onclose")) == SUCCESS) {
+		phalcon_socket_server_dispatch(object, onclose, SL("onclose"), NULL, 1, phalcon_socket_server_conn_client(object, loop, fd));
+	}
+
+	/* a no-op when the callback disconnected it already */
+	phalcon_socket_server_conn_drop(object, loop, fd);
+}
+
+static void phalcon_socket_server_accept(zval *object, phalcon_socket_server_loop *loop, zval *onconnection)
+{
+	struct sockaddr_storage addr;
+	struct epoll_event ev = {0};
+	socklen_t addr_len;
+	phalcon_socket_server_conn *conn;
+	int fd;
+
+	/* the listening socket is level triggered, a burst is still taken at once */
+	for (;;) {
+		addr_len = sizeof(addr);
+		if ((fd = accept(loop->listenfd, (struct sockaddr *) &addr, &addr_len)) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+		setkeepalive(fd);
+
+		phalcon_socket_server_loop_reserve(loop, fd);
+		conn = &loop->conns[fd];
+
+		/* the fd was closed behind our back (Phalcon\Socket\Client::close) */
+		if (conn->active) {
+			phalcon_socket_server_conn_release(object, loop, fd);
+		}
+
+		ev.data.fd = fd;
+		ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		if (epoll_ctl(loop->epollfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			close(fd);
+			continue;
+		}
+
+		ZVAL_UNDEF(&conn->client);
+		conn->active = 1;
+		if (loop->idle > 0) {
+			conn->deadline = time(NULL) + loop->idle;
+			phalcon_socket_server_wheel_link(loop, fd);
+		}
+
+		if (Z_TYPE_P(onconnection) > IS_NULL || phalcon_method_exists_ex(object, SL("onconnection")) == SUCCESS) {
+			phalcon_socket_server_dispatch(object, onconnection, SL("onconnection"), NULL, 1, phalcon_socket_server_conn_client(object, loop, fd));
+		}
+	}
+}
+
+static void phalcon_socket_server_read(zval *object, phalcon_socket_server_loop *loop, int fd, uint32_t events, zval *onrecv, zval *onsend, zval *onclose, zval *onerror)
+{
+	phalcon_socket_server_conn *conn = &loop->conns[fd];
+	struct epoll_event ev = {0};
+	zval args[2], ret = {};
+	size_t limit = loop->maxlen > 0 ? (size_t) loop->maxlen : PHALCON_SOCKET_SERVER_READ_SIZE, chunk;
+	ssize_t n;
+	int closed = 0, failed = 0, pending = 0;
+
+	if (loop->idle > 0) {
+		conn->deadline = time(NULL) + loop->idle;
+	}
+
+	/*
+	 * Edge triggered, the socket has to be drained. At most maxlen bytes are
+	 * buffered per edge, the rest is left to the next round so that a fast
+	 * sender neither grows the buffer without end nor starves the others.
+	 */
+	for (;;) {
+		chunk = limit - (conn->buffer.s ? ZSTR_LEN(conn->buffer.s) : 0);
+		if (chunk == 0) {
+			pending = 1;
+			break;
+		}
+		smart_str_alloc(&conn->buffer, chunk, 0);
+		n = recv(fd, ZSTR_VAL(conn->buffer.s) + ZSTR_LEN(conn->buffer.s), chunk, 0);
+		if (n > 0) {
+			ZSTR_LEN(conn->buffer.s) += n;
+			continue;
+		}
+		if (n == 0) {
+			closed = 1;
+		} else if (errno == EINTR) {
+			continue;
+		} else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+			failed = 1;
+		}
+		break;
+	}
+
+	if (!failed && (events & EPOLLERR)) {
+		failed = 1;
+	}
+
+	if (conn->buffer.s && ZSTR_LEN(conn->buffer.s)) {
+		/* held on to, the callback may disconnect the client */
+		ZVAL_COPY(&args[0], phalcon_socket_server_conn_client(object, loop, fd));
+
+		/* the buffer is handed over as is, nothing stays allocated for an idle connection */
+		smart_str_0(&conn->buffer);
+		ZVAL_STR(&args[1], conn->buffer.s);
+		conn->buffer.s = NULL;
+		conn->buffer.a = 0;
+
+		phalcon_socket_server_dispatch(object, onrecv, SL("onrecv"), &ret, 2, args);
+		zval_ptr_dtor(&args[1]);
+
+		if (PHALCON_IS_FALSE(&ret) || EG(exception)) {
+			closed = 1;
+		} else if (!closed && !failed && conn->active) {
+			zval_ptr_dtor(&ret);
+			ZVAL_NULL(&ret);
+			if (Z_TYPE_P(onsend) > IS_NULL || phalcon_method_exists_ex(object, SL("onsend")) == SUCCESS) {
+				phalcon_socket_server_dispatch(object, onsend, SL("onsend"), &ret, 1, args);
+				if (PHALCON_IS_FALSE(&ret)) {
+					closed = 1;
+				}
+			}
+		}
+		zval_ptr_dtor(&ret);
+		zval_ptr_dtor(&args[0]);
+	} else {
+		smart_str_free(&conn->buffer);
+	}
+
+	/* callbacks may have disconnected it */
+	if (!conn->active) {
+		return;
+	}
+
+	if (failed) {
+		if (Z_TYPE_P(onerror) > IS_NULL || phalcon_method_exists_ex(object, SL("onerror")) == SUCCESS) {
+			phalcon_socket_server_dispatch(object, onerror, SL("onerror"), NULL, 1, phalcon_socket_server_conn_client(object, loop, fd));
+		}
+		closed = 1;
+	}
+
+	if (closed || (!pending && (events & EPOLLHUP))) {
+		phalcon_socket_server_conn_close(object, loop, fd, onclose);
+	} else if (pending) {
+		/* modifying an edge triggered fd reports it again while data is left */
+		ev.data.fd = fd;
+		ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+		if (epoll_ctl(loop->epollfd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+			phalcon_socket_server_conn_close(object, loop, fd, onclose);
+		}
+	}
+}
+
+/*
+ * Closes the connections whose deadline passed, walking the slots up to now
+ */
+static void phalcon_socket_server_expire(zval *object, phalcon_socket_server_loop *loop, time_t now, zval *onclose)
+{
+	time_t t = loop->tick;
+	int fd, next, slot;
+
+	if (now - t > PHALCON_SOCKET_SERVER_WHEEL_SIZE) {
+		t = now - PHALCON_SOCKET_SERVER_WHEEL_SIZE;
+	}
+
+	while (t < now) {
+		t++;
+		slot = (int) (t % PHALCON_SOCKET_SERVER_WHEEL_SIZE);
+		for (fd = loop->wheel[slot]; fd >= 0; fd = next) {
+			phalcon_socket_server_conn *conn = &loop->conns[fd];
+
+			next = conn->next;
+			if (conn->deadline <= now) {
+				phalcon_socket_server_conn_close(object, loop, fd, onclose);
+				/* callbacks may have closed the next one too */
+				if (next >= 0 && loop->conns[next].slot != slot) {
+					next = loop->wheel[slot];
+				}
+			} else if ((int) (conn->deadline % PHALCON_SOCKET_SERVER_WHEEL_SIZE) != slot) {
+				phalcon_socket_server_wheel_unlink(loop, fd);
+				phalcon_socket_server_wheel_link(loop, fd);
+			}
+		}
+	}
+
+	loop->tick = now;
+}
+#endif
+
 /**
  * Run the Server
  *
@@ -535,7 +973,7 @@ static int phalcon_socket_server_startup_workers(zval *object, int max_childs) {
 PHP_METHOD(Phalcon_Socket_Server, run)
 {
 	zval *_onconnection = NULL, *_onrecv = NULL, *_onsend = NULL, *_onclose = NULL, *_onerror = NULL, *_ontimeout = NULL, *timeout = NULL, *usec = NULL;
-	zval onconnection = {}, onrecv = {}, onsend = {}, onclose = {}, onerror = {}, ontimeout, socket = {}, maxlen = {}, event = {};
+	zval onconnection = {}, onrecv = {}, onsend = {}, onclose = {}, onerror = {}, ontimeout = {}, socket = {}, maxlen = {}, event = {};
 	zval daemon = {}, max_children = {};
 	php_socket *listen_php_sock;
 	struct sockaddr_in client_addr;
@@ -818,203 +1256,106 @@ worker:
 	} else if (Z_LVAL(event) == 1) {
 		struct epoll_event events[EPOLL_EVENT_SIZE];
 		struct epoll_event ev = {0};
-		int epollfd, sec = -1, epoll_ctl_ret;
-
-		if (Z_TYPE_P(timeout) == IS_LONG) {
-			sec = Z_LVAL_P(timeout) * 1000;
+		phalcon_socket_server_loop loop = {0};
+		zval idle_timeout = {};
+		time_t now, quiet_since;
+		int msec, i;
+
+		phalcon_read_property(&idle_timeout, getThis(), SL("_idleTimeout"), PH_NOISY|PH_READONLY);
+
+		loop.owner = Z_OBJ_P(getThis());
+		loop.listenfd = listenfd;
+		loop.family = listen_php_sock->type;
+		loop.idle = phalcon_get_intval(&idle_timeout);
+		loop.maxlen = phalcon_get_intval(&maxlen);
+		loop.tick = quiet_since = time(NULL);
+		for (i = 0; i < PHALCON_SOCKET_SERVER_WHEEL_SIZE; i++) {
+			loop.wheel[i] = -1;
 		}
 
-		epollfd = epoll_create(EPOLL_EVENT_SIZE+1);
-		if (epollfd < 0) {
+		loop.epollfd = epoll_create(EPOLL_EVENT_SIZE+1);
+		if (loop.epollfd < 0) {
 			PHALCON_THROW_EXCEPTION_STR(phalcon_socket_exception_ce, "epoll: unable to initialize");
 			phalcon_socket_server_destroy();
 			RETURN_FALSE;
 		}
 
 		ev.data.fd = listenfd;
-		ev.events = EPOLLIN | EPOLLHUP | EPOLLERR;
+		ev.events = EPOLLIN;
 
-		if ((epoll_ctl_ret = epoll_ctl(epollfd, EPOLL_CTL_ADD, listenfd, &ev)) < 0) {
+		if (epoll_ctl(loop.epollfd, EPOLL_CTL_ADD, listenfd, &ev) < 0) {
 			PHALCON_THROW_EXCEPTION_FORMAT(phalcon_socket_exception_ce, "epoll: unable to add fd %d", listenfd);
+			close(loop.epollfd);
 			phalcon_socket_server_destroy();
 			RETURN_FALSE;
 		}
 
-		while (server->running) {
-			int ret, i;
-			ret = epoll_wait(epollfd, events, EPOLL_EVENT_SIZE/100, sec);
+		phalcon_socket_server_current = &loop;
+
+		while (server->running && !EG(exception)) {
+			int ret;
+
+			msec = -1;
+			if (Z_TYPE_P(timeout) == IS_LONG) {
+				msec = Z_LVAL_P(timeout) * 1000;
+			}
+			/* wake up every second to advance the timer wheel */
+			if (loop.idle > 0 && (msec < 0 || msec > 1000)) {
+				msec = 1000;
+			}
+
+			ret = epoll_wait(loop.epollfd, events, EPOLL_EVENT_SIZE, msec);
 			if (ret < 0) {
 				if (errno != EINTR && errno != EWOULDBLOCK) {
 					PHALCON_THROW_EXCEPTION_FORMAT(phalcon_socket_exception_ce, "epoll_wait() returns %d", errno);
-					phalcon_socket_server_destroy();
-					RETURN_FALSE;
+					break;
 				}
 				continue;
-			} else if (ret == 0) {
+			}
+
+			now = time(NULL);
+
+			for (i = 0; i < ret && !EG(exception); i++) {
+				int event_fd = events[i].data.fd;
+
+				if (event_fd == listenfd) {
+					phalcon_socket_server_accept(getThis(), &loop, &onconnection);
+				} else if (event_fd < loop.size && loop.conns[event_fd].active) {
+					phalcon_socket_server_read(getThis(), &loop, event_fd, events[i].events, &onrecv, &onsend, &onclose, &onerror);
+				}
+			}
+
+			if (loop.idle > 0 && now > loop.tick) {
+				phalcon_socket_server_expire(getThis(), &loop, now, &onclose);
+			}
+
+			if (ret > 0) {
+				quiet_since = now;
+			} else if (Z_TYPE_P(timeout) == IS_LONG && now - quiet_since >= Z_LVAL_P(timeout)) {
+				quiet_since = now;
 				if (phalcon_method_exists_ex(getThis(), SL("ontimeout")) == SUCCESS) {
 					PHALCON_CALL_METHOD(NULL, getThis(), "ontimeout");
 				}
 				if (Z_TYPE(ontimeout) > IS_NULL) {
 					PHALCON_CALL_USER_FUNC(NULL, &ontimeout);
 				}
-				continue;
 			}
-			for (i = 0; i < ret; i++) {
-				zval client = {}, client_socket_id = {}, data = {}, *args, ret = {};
-				int event_fd, client_fd, status = 0;
-
-				event_fd = events[i].data.fd;
-				if (event_fd <= 0) {
-					continue;
-				}
-				ZVAL_LONG(&client_socket_id, event_fd);
-				if (event_fd == listenfd) {
-					if (events[i].events & (EPOLLHUP | EPOLLERR)) {
-						continue;
-					}
-					client_fd = accept(listenfd, (struct sockaddr *) &client_addr, &client_addr_len);
-					if (client_fd < 0) {
-						continue;
-					}
-					zval tmp_client_socket = {}, tmp_client = {}, tmp_client_socket_id = {};
-					php_socket *tmp_client_sock;
-					tmp_client_sock = php_create_socket();
-					tmp_client_sock->bsd_socket = client_fd;
-					tmp_client_sock->error = 0;
-					tmp_client_sock->blocking = 1;
-					tmp_client_sock->type = ((struct sockaddr *) &client_addr)->sa_family;
-
-					ZVAL_RES(&tmp_client_socket, zend_register_resource(tmp_client_sock, php_sockets_le_socket()));
-
-					object_init_ex(&tmp_client, phalcon_socket_client_ce);
-					PHALCON_CALL_METHOD(NULL, &tmp_client, "__construct", &tmp_client_socket);
-
-					ZVAL_LONG(&tmp_client_socket_id, client_fd);
-					phalcon_update_property_array(getThis(), SL("_clients"), &tmp_client_socket_id, &tmp_client);
-
-					PHALCON_CALL_METHOD(NULL, &tmp_client, "setblocking", &PHALCON_GLOBAL(z_false));
-
-					if (Z_TYPE(onconnection) > IS_NULL) {
-						args = (zval *)safe_emalloc(1, sizeof(zval), 0);
-						ZVAL_COPY(&args[0], &tmp_client);
-						PHALCON_CALL_USER_FUNC_ARGS(NULL, &onconnection, args, 1);
-					} else if (phalcon_method_exists_ex(getThis(), SL("onconnection")) == SUCCESS) {
-						PHALCON_CALL_METHOD(NULL, getThis(), "onconnection", &tmp_client);
-					}
-					setkeepalive(client_fd);
-					ev.data.fd = client_fd;
-					ev.events = EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLET;
-					epoll_ctl_ret = epoll_ctl(epollfd, EPOLL_CTL_ADD, client_fd, &ev);
-					if (epoll_ctl_ret < 0) {
-						close(client_fd);
-					}
-					continue;
-				}
-				if (events[i].events & (EPOLLHUP | EPOLLERR)) {
-						continue;
-				}
-				if (events[i].events & EPOLLIN) {
-					PHALCON_CALL_METHOD(&client, getThis(), "getclient", &client_socket_id);
-
-					zend_string	*tmpbuf;
-					int retval;
-
-					tmpbuf = zend_string_alloc(Z_LVAL(maxlen), 0);
-
-					retval = recv(event_fd, ZSTR_VAL(tmpbuf), Z_LVAL(maxlen), MSG_DONTWAIT);
-
-					if (retval < 0) {
-						zend_string_free(tmpbuf);
-						if (Z_TYPE(onerror) > IS_NULL) {
-							args = (zval *)safe_emalloc(1, sizeof(zval), 0);
-							ZVAL_COPY(&args[0], &client);
-							PHALCON_CALL_USER_FUNC_ARGS(NULL, &onerror, args, 1);
-						} else if (phalcon_method_exists_ex(getThis(), SL("onerror")) == SUCCESS) {
-							PHALCON_CALL_METHOD(NULL, getThis(), "onerror", &client);
-						}
-						status = -1;
-					} else if (retval == 0) {
-						zend_string_free(tmpbuf);
-						status = -1;
-					} else {
-						status = 1;
-						tmpbuf = zend_string_truncate(tmpbuf, retval, 0);
-						ZSTR_LEN(tmpbuf) = retval;
-						ZSTR_VAL(tmpbuf)[ZSTR_LEN(tmpbuf)] = '\0' ;
-
-						ZVAL_NEW_STR(&data, tmpbuf);
-						if (Z_TYPE(onrecv) > IS_NULL) {
-							args = (zval *)safe_emalloc(2, sizeof(zval), 0);
-							ZVAL_COPY(&args[0], &client);
-							ZVAL_COPY_VALUE(&args[1], &data);
-							PHALCON_CALL_USER_FUNC_ARGS(&ret, &onrecv, args, 2);
-						} else if (phalcon_method_exists_ex(getThis(), SL("onrecv")) == SUCCESS) {
-							PHALCON_CALL_METHOD(&ret, getThis(), "onrecv", &client, &data);
-						}
+		}
 
-						if (PHALCON_IS_FALSE(&ret)) {
-							status = -1;
-						}
-					}
+		phalcon_socket_server_current = NULL;
 
-					ev.data.fd = event_fd;
-					if (status > 0) {
-						if (retval == Z_LVAL(maxlen)) {
-							ev.events = EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLET;
-						} else {
-							ev.events = EPOLLOUT | EPOLLHUP | EPOLLERR;
-						}
-						epoll_ctl_ret = epoll_ctl(epollfd, EPOLL_CTL_MOD, event_fd, &ev);
-						if (epoll_ctl_ret < 0) {
-							status = -1;
-						}
-					}
-					if  (status < 0) {
-						if (Z_TYPE(onclose) > IS_NULL) {
-							args = (zval *)safe_emalloc(1, sizeof(zval), 0);
-							ZVAL_COPY(&args[0], &client);
-							PHALCON_CALL_USER_FUNC_ARGS(NULL, &onclose, args, 1);
-						} else if (phalcon_method_exists_ex(getThis(), SL("onclose")) == SUCCESS) {
-							PHALCON_CALL_METHOD(NULL, getThis(), "onclose", &client);
-						}
-						ev.events = EPOLLOUT | EPOLLHUP;
-						epoll_ctl(epollfd, EPOLL_CTL_DEL, event_fd, &ev);
-						close(event_fd);
-						phalcon_unset_property_array(getThis(), SL("_clients"), &client_socket_id);
-					}
-				} else if (events[i].events & EPOLLOUT) {
-					PHALCON_CALL_METHOD(&client, getThis(), "getclient", &client_socket_id);
-					if (Z_TYPE(onsend) > IS_NULL) {
-						args = (zval *)safe_emalloc(1, sizeof(zval), 0);
-						ZVAL_COPY(&args[0], &client);
-						PHALCON_CALL_USER_FUNC_ARGS(&ret, &onsend, args, 1);
-					} else if (phalcon_method_exists_ex(getThis(), SL("onsend")) == SUCCESS) {
-						PHALCON_CALL_METHOD(&ret, getThis(), "onsend", &client, &data);
-					}
-					ev.data.fd = event_fd;
-					if (PHALCON_IS_FALSE(&ret)) {
-						if (Z_TYPE(onclose) > IS_NULL) {
-							args = (zval *)safe_emalloc(1, sizeof(zval), 0);
-							ZVAL_COPY(&args[0], &client);
-							PHALCON_CALL_USER_FUNC_ARGS(NULL, &onclose, args, 1);
-						} else if (phalcon_method_exists_ex(getThis(), SL("onclose")) == SUCCESS) {
-							PHALCON_CALL_METHOD(NULL, getThis(), "onclose", &client);
-						}
-						ev.events = EPOLLOUT | EPOLLHUP;
-						epoll_ctl(epollfd, EPOLL_CTL_DEL, event_fd, &ev);
-						close(event_fd);
-						phalcon_unset_property_array(getThis(), SL("_clients"), &client_socket_id);
-					} else {
-						ev.data.fd = event_fd;
-						ev.events = EPOLLIN | EPOLLOUT | EPOLLHUP | EPOLLET;
-						epoll_ctl_ret = epoll_ctl(epollfd, EPOLL_CTL_MOD, event_fd, &ev);
-						if (epoll_ctl_ret < 0) {
-							close(client_fd);
-						}
-					}
+		for (i = 0; i < loop.size; i++) {
+			if (loop.conns[i].active) {
+				if (Z_TYPE(loop.conns[i].client) != IS_OBJECT) {
+					close(i);
 				}
+				phalcon_socket_server_conn_release(getThis(), &loop, i);
 			}
 		}
+		if (loop.conns) {
+			efree(loop.conns);
+		}
+		close(loop.epollfd);
 	}
 #endif
 
@@ -0,0 +1,272 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "storage/bloomfilter/blocked.h"
+#include "storage/exception.h"
+
+#include "kernel/main.h"
+#include "kernel/exception.h"
+#include "kernel/object.h"
+#include "kernel/fcall.h"
+#include "kernel/operators.h"
+
+/**
+ * Phalcon\Storage\Bloomfilter\Blocked
+ *
+ * Split block bloom filter, every key lives in a single 64-byte block so a lookup costs one cache miss.
+ * The filter is mapped instead of loaded, a file or a shared memory segment is shared by all workers.
+ *
+ *<code>
+ *	$filter = new Phalcon\Storage\Bloomfilter\Blocked('/var/cache/urls.bloom', 0, 100000000, 0.001);
+ *	$filter->add('https://phalcon7.org/');
+ *	$filter->check('https://phalcon7.org/');
+ *
+ *	$filter = new Phalcon\Storage\Bloomfilter\Blocked('/urls', 0, 100000000, 0.001, Phalcon\Storage\Bloomfilter\Blocked::STORAGE_SHM);
+ *</code>
+ */
+zend_class_entry *phalcon_storage_bloomfilter_blocked_ce;
+
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, __construct);
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, add);
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, check);
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, reset);
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, save);
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, count);
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_bloomfilter_blocked___construct, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, filename, IS_STRING, 1)
+	ZEND_ARG_TYPE_INFO(0, seed, IS_LONG, 1)
+	ZEND_ARG_TYPE_INFO(0, maxItems, IS_LONG, 1)
+	ZEND_ARG_TYPE_INFO(0, falsePositive, IS_DOUBLE, 1)
+	ZEND_ARG_TYPE_INFO(0, storage, IS_LONG, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_bloomfilter_blocked_add, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, value, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_bloomfilter_blocked_check, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, value, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry phalcon_storage_bloomfilter_blocked_method_entry[] = {
+	PHP_ME(Phalcon_Storage_Bloomfilter_Blocked, __construct, arginfo_phalcon_storage_bloomfilter_blocked___construct, ZEND_ACC_PUBLIC|ZEND_ACC_FINAL|ZEND_ACC_CTOR)
+	PHP_ME(Phalcon_Storage_Bloomfilter_Blocked, add, arginfo_phalcon_storage_bloomfilter_blocked_add, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Bloomfilter_Blocked, check, arginfo_phalcon_storage_bloomfilter_blocked_check, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Bloomfilter_Blocked, reset, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Bloomfilter_Blocked, save, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Bloomfilter_Blocked, count, NULL, ZEND_ACC_PUBLIC)
+	PHP_FE_END
+};
+
+zend_object_handlers phalcon_storage_bloomfilter_blocked_object_handlers;
+zend_object* phalcon_storage_bloomfilter_blocked_object_create_handler(zend_class_entry *ce)
+{
+	phalcon_storage_bloomfilter_blocked_object *intern = ecalloc(1, sizeof(phalcon_storage_bloomfilter_blocked_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_storage_bloomfilter_blocked_object_handlers;
+
+	memset(&intern->bloomfilter, 0, sizeof(phalcon_blocked_bloomfilter));
+
+	return &intern->std;
+}
+
+void phalcon_storage_bloomfilter_blocked_object_free_handler(zend_object *object)
+{
+	phalcon_storage_bloomfilter_blocked_object *intern = phalcon_storage_bloomfilter_blocked_object_from_obj(object);
+
+	phalcon_blocked_bloomfilter_free(&intern->bloomfilter);
+	zend_object_std_dtor(object);
+}
+
+/**
+ * Phalcon\Storage\Bloomfilter\Blocked initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Storage_Bloomfilter_Blocked){
+
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT(Phalcon\\Storage\\Bloomfilter, Blocked, storage_bloomfilter_blocked, phalcon_storage_bloomfilter_blocked_method_entry, 0);
+
+	zend_class_implements(phalcon_storage_bloomfilter_blocked_ce, 1, spl_ce_Countable);
+
+	zend_declare_class_constant_long(phalcon_storage_bloomfilter_blocked_ce, SL("STORAGE_MEMORY"), PHALCON_BLOCKED_BLOOMFILTER_STORAGE_MEMORY);
+	zend_declare_class_constant_long(phalcon_storage_bloomfilter_blocked_ce, SL("STORAGE_FILE"), PHALCON_BLOCKED_BLOOMFILTER_STORAGE_FILE);
+	zend_declare_class_constant_long(phalcon_storage_bloomfilter_blocked_ce, SL("STORAGE_SHM"), PHALCON_BLOCKED_BLOOMFILTER_STORAGE_SHM);
+
+	return SUCCESS;
+}
+
+/**
+ * Phalcon\Storage\Bloomfilter\Blocked constructor
+ *
+ * An existing file or segment keeps the geometry it was created with, the sizing arguments only apply to new ones.
+ * Shared memory names follow shm_open(), e.g. "/phalcon-bloom".
+ *
+ * @param string $filename
+ * @param int $seed
+ * @param int $maxItems
+ * @param float $falsePositive
+ * @param int $storage
+ */
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, __construct){
+
+	zval *filename = NULL, *_seed = NULL, *_max_items = NULL, *_false_positive = NULL, *_storage = NULL;
+	phalcon_storage_bloomfilter_blocked_object *intern;
+	uint32_t seed = 0, max_items = 100000;
+	double false_positive = 0.00001;
+	int storage = PHALCON_BLOCKED_BLOOMFILTER_STORAGE_FILE, ret;
+
+	phalcon_fetch_params(0, 0, 5, &filename, &_seed, &_max_items, &_false_positive, &_storage);
+
+	if (_seed && Z_TYPE_P(_seed) == IS_LONG) {
+		seed = Z_LVAL_P(_seed);
+	}
+
+	if (_max_items && Z_TYPE_P(_max_items) == IS_LONG && Z_LVAL_P(_max_items) > 0) {
+		max_items = Z_LVAL_P(_max_items);
+	}
+
+	if (_false_positive && Z_TYPE_P(_false_positive) == IS_DOUBLE && Z_DVAL_P(_false_positive) < 1 && Z_DVAL_P(_false_positive) > 0) {
+		false_positive =  Z_DVAL_P(_false_positive);
+	}
+
+	if (_storage && Z_TYPE_P(_storage) == IS_LONG) {
+		storage = Z_LVAL_P(_storage);
+	}
+
+	if (!filename || Z_TYPE_P(filename) != IS_STRING || !Z_STRLEN_P(filename)) {
+		storage = PHALCON_BLOCKED_BLOOMFILTER_STORAGE_MEMORY;
+	}
+
+	intern = phalcon_storage_bloomfilter_blocked_object_from_obj(Z_OBJ_P(getThis()));
+
+	switch (storage) {
+		case PHALCON_BLOCKED_BLOOMFILTER_STORAGE_MEMORY:
+			ret = phalcon_blocked_bloomfilter_init(&intern->bloomfilter, seed, max_items, false_positive);
+			break;
+		case PHALCON_BLOCKED_BLOOMFILTER_STORAGE_FILE:
+			ret = phalcon_blocked_bloomfilter_open_file(&intern->bloomfilter, Z_STRVAL_P(filename), seed, max_items, false_positive);
+			break;
+		case PHALCON_BLOCKED_BLOOMFILTER_STORAGE_SHM:
+			ret = phalcon_blocked_bloomfilter_open_shm(&intern->bloomfilter, Z_STRVAL_P(filename), seed, max_items, false_positive);
+			break;
+		default:
+			PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Unknown storage type %d", storage);
+			return;
+	}
+
+	if (ret != 0) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Create blocked bloom filter failed");
+		return;
+	}
+}
+
+/**
+ * Add value
+ *
+ * @param string value
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, add){
+
+	zval *value;
+	phalcon_storage_bloomfilter_blocked_object *intern;
+	int ret;
+
+	phalcon_fetch_params(0, 1, 0, &value);
+
+	intern = phalcon_storage_bloomfilter_blocked_object_from_obj(Z_OBJ_P(getThis()));
+	ret = phalcon_blocked_bloomfilter_add(&intern->bloomfilter, Z_STRVAL_P(value), Z_STRLEN_P(value));
+	if (ret < 0) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Add value error");
+		return;
+	}
+	RETURN_TRUE;
+}
+
+/**
+ * Check value
+ *
+ * @param string value
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, check){
+
+	zval *value;
+	phalcon_storage_bloomfilter_blocked_object *intern;
+
+	phalcon_fetch_params(0, 1, 0, &value);
+
+	intern = phalcon_storage_bloomfilter_blocked_object_from_obj(Z_OBJ_P(getThis()));
+	if (!phalcon_blocked_bloomfilter_check(&intern->bloomfilter, Z_STRVAL_P(value), Z_STRLEN_P(value))) {
+		RETURN_TRUE;
+	}
+	RETURN_FALSE;
+}
+
+/**
+ * Reset, every process sharing the filter sees it empty
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, reset){
+
+	phalcon_storage_bloomfilter_blocked_object *intern;
+
+	intern = phalcon_storage_bloomfilter_blocked_object_from_obj(Z_OBJ_P(getThis()));
+	if (!phalcon_blocked_bloomfilter_reset(&intern->bloomfilter)) {
+		RETURN_TRUE;
+	}
+	RETURN_FALSE;
+}
+
+/**
+ * Flush a file backed filter to disk, changes are already visible to other processes without it
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, save){
+
+	phalcon_storage_bloomfilter_blocked_object *intern;
+
+	intern = phalcon_storage_bloomfilter_blocked_object_from_obj(Z_OBJ_P(getThis()));
+	if (!phalcon_blocked_bloomfilter_sync(&intern->bloomfilter)) {
+		RETURN_TRUE;
+	}
+	RETURN_FALSE;
+}
+
+/**
+ * Number of values added
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Blocked, count){
+
+	phalcon_storage_bloomfilter_blocked_object *intern;
+
+	intern = phalcon_storage_bloomfilter_blocked_object_from_obj(Z_OBJ_P(getThis()));
+	if (!intern->bloomfilter.head) {
+		RETURN_LONG(0);
+	}
+	RETURN_LONG(intern->bloomfilter.head->count);
+}
@@ -39,13 +39,15 @@ PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, __construct);
 PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, add);
 PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, remove);
 PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, check);
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, addMany);
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, checkMany);
 PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, save);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_bloomfilter_counting___construct, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, filename, IS_STRING, 0)
-	ZEND_ARG_TYPE_INFO(0, seed, IS_LONG, 1)
-	ZEND_ARG_TYPE_INFO(0, maxItems, IS_LONG, 1)
-	ZEND_ARG_TYPE_INFO(0, falsePositive, IS_DOUBLE, 1)
+	ZEND_ARG_TYPE_INFO(0, capacity, IS_LONG, 1)
+	ZEND_ARG_TYPE_INFO(0, errorRate, IS_DOUBLE, 1)
+	ZEND_ARG_TYPE_INFO(0, type, IS_LONG, 1)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_bloomfilter_counting_add, 0, 0, 1)
@@ -60,11 +62,22 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_bloomfilter_counting_check, 0, 0,
 	ZEND_ARG_TYPE_INFO(0, value, IS_STRING, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_bloomfilter_counting_addmany, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, values, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_bloomfilter_counting_checkmany, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, values, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry phalcon_storage_bloomfilter_counting_method_entry[] = {
 	PHP_ME(Phalcon_Storage_Bloomfilter_Counting, __construct, arginfo_phalcon_storage_bloomfilter_counting___construct, ZEND_ACC_PUBLIC|ZEND_ACC_FINAL|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Storage_Bloomfilter_Counting, add, arginfo_phalcon_storage_bloomfilter_counting_add, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Bloomfilter_Counting, remove, arginfo_phalcon_storage_bloomfilter_counting_remove, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Bloomfilter_Counting, check, arginfo_phalcon_storage_bloomfilter_counting_check, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Bloomfilter_Counting, addMany, arginfo_phalcon_storage_bloomfilter_counting_addmany, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Bloomfilter_Counting, checkMany, arginfo_phalcon_storage_bloomfilter_counting_checkmany, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Bloomfilter_Counting, save, NULL, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -88,6 +101,44 @@ void phalcon_storage_bloomfilter_counting_object_free_handler(zend_object *objec
 	if (intern->bloomfilter) {
 		free_counting_bloom(intern->bloomfilter);
 	}
+	if (intern->cuckoo) {
+		free_cuckoo_filter(intern->cuckoo);
+	}
+}
+
+static int phalcon_storage_bloomfilter_counting_add_value(phalcon_storage_bloomfilter_counting_object *intern, const char *value, size_t len)
+{
+	if (intern->type == PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_CUCKOO) {
+		return cuckoo_filter_add(intern->cuckoo, value, len);
+	}
+	return counting_bloom_add(intern->bloomfilter, value, len);
+}
+
+static void phalcon_storage_bloomfilter_counting_check_batch(phalcon_storage_bloomfilter_counting_object *intern, zend_string **values, int n, unsigned char *bitmap, zend_long offset)
+{
+	const char *keys[CUCKOO_FILTER_BATCH];
+	size_t lens[CUCKOO_FILTER_BATCH];
+	int results[CUCKOO_FILTER_BATCH], i;
+
+	for (i = 0; i < n; i++) {
+		keys[i] = ZSTR_VAL(values[i]);
+		lens[i] = ZSTR_LEN(values[i]);
+	}
+
+	if (intern->type == PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_CUCKOO) {
+		cuckoo_filter_check_batch(intern->cuckoo, keys, lens, n, results);
+	} else {
+		for (i = 0; i < n; i++) {
+			results[i] = counting_bloom_check(intern->bloomfilter, keys[i], lens[i]);
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		if (results[i]) {
+			bitmap[(offset + i) >> 3] |= 1 << ((offset + i) & 7);
+		}
+		zend_string_release(values[i]);
+	}
 }
 
 /**
@@ -97,37 +148,72 @@ PHALCON_INIT_CLASS(Phalcon_Storage_Bloomfilter_Counting){
 
 	PHALCON_REGISTER_CLASS_CREATE_OBJECT(Phalcon\\Storage\\Bloomfilter, Counting, storage_bloomfilter_counting, phalcon_storage_bloomfilter_counting_method_entry, 0);
 
+	zend_declare_class_constant_long(phalcon_storage_bloomfilter_counting_ce, SL("TYPE_COUNTING"), PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_COUNTING);
+	zend_declare_class_constant_long(phalcon_storage_bloomfilter_counting_ce, SL("TYPE_CUCKOO"), PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_CUCKOO);
+
 	return SUCCESS;
 }
 
 /**
  * Phalcon\Storage\Bloomfilter\Counting constructor
+ *
+ * TYPE_CUCKOO stores one 8 or 16 bit fingerprint per value instead of 4-bit counters in every hash position,
+ * which takes about a quarter of the memory for the same error rate and still supports remove().
+ *
+ *<code>
+ *	$filter = new Phalcon\Storage\Bloomfilter\Counting('ids.cuckoo', 1000000, 0.001, Phalcon\Storage\Bloomfilter\Counting::TYPE_CUCKOO);
+ *</code>
+ *
+ * @param string $filename
+ * @param int $capacity
+ * @param float $errorRate
+ * @param int $type
  */
 PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, __construct){
 
-	zval *filename, *_capacity = NULL, *_error_rate = NULL;
+	zval *filename, *_capacity = NULL, *_error_rate = NULL, *_type = NULL;
 	phalcon_storage_bloomfilter_counting_object *intern;
 	unsigned int capacity = 100000;
 	double error_rate = 0.05;
+	int type = PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_COUNTING;
 
-	phalcon_fetch_params(0, 1, 4, &filename, &_capacity, &_error_rate);
+	phalcon_fetch_params(0, 1, 3, &filename, &_capacity, &_error_rate, &_type);
 
 	if (_capacity && Z_TYPE_P(_capacity) == IS_LONG && Z_LVAL_P(_capacity) > capacity) {
 		capacity = Z_LVAL_P(_capacity);
 	}
 
-	if (_error_rate && Z_TYPE_P(_error_rate) == IS_LONG && Z_LVAL_P(_error_rate) > 0 &&  Z_LVAL_P(_error_rate) < error_rate) {
-		error_rate = Z_LVAL_P(_error_rate);
+	if (_error_rate && Z_TYPE_P(_error_rate) == IS_DOUBLE && Z_DVAL_P(_error_rate) > 0 &&  Z_DVAL_P(_error_rate) < error_rate) {
+		error_rate = Z_DVAL_P(_error_rate);
+	}
+
+	if (_type && Z_TYPE_P(_type) == IS_LONG) {
+		type = Z_LVAL_P(_type);
 	}
 
 	intern = phalcon_storage_bloomfilter_counting_object_from_obj(Z_OBJ_P(getThis()));
 
 	PHALCON_ZVAL_DUP(&intern->filename, filename);
 
-	intern->bloomfilter = autocreate_counting_bloom_from_file(capacity, error_rate, Z_STRVAL_P(filename));
-	if (!intern->bloomfilter) {
-		PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Create counting bloom filter failed");
-		return;
+	intern->type = type;
+	switch (type) {
+		case PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_COUNTING:
+			intern->bloomfilter = autocreate_counting_bloom_from_file(capacity, error_rate, Z_STRVAL_P(filename));
+			if (!intern->bloomfilter) {
+				PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Create counting bloom filter failed");
+				return;
+			}
+			break;
+		case PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_CUCKOO:
+			intern->cuckoo = autocreate_cuckoo_filter_from_file(capacity, error_rate, Z_STRVAL_P(filename));
+			if (!intern->cuckoo) {
+				PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Create cuckoo filter failed");
+				return;
+			}
+			break;
+		default:
+			PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Unknown filter type %d", type);
+			return;
 	}
 }
 
@@ -146,12 +232,13 @@ PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, add){
 	phalcon_fetch_params(0, 1, 0, &value);
 
 	intern = phalcon_storage_bloomfilter_counting_object_from_obj(Z_OBJ_P(getThis()));
-	ret = counting_bloom_add(intern->bloomfilter, Z_STRVAL_P(value), Z_STRLEN_P(value));
+	ret = phalcon_storage_bloomfilter_counting_add_value(intern, Z_STRVAL_P(value), Z_STRLEN_P(value));
 	if (ret < 0) {
 		PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Add value error");
 		return;
 	}
-	RETURN_TRUE;
+	/* a full cuckoo table refuses the value */
+	RETURN_BOOL(ret == 0);
 }
 
 /**
@@ -169,6 +256,10 @@ PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, remove){
 	phalcon_fetch_params(0, 1, 0, &value);
 
 	intern = phalcon_storage_bloomfilter_counting_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->type == PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_CUCKOO) {
+		RETURN_BOOL(cuckoo_filter_remove(intern->cuckoo, Z_STRVAL_P(value), Z_STRLEN_P(value)) == 0);
+	}
+
 	ret = counting_bloom_remove(intern->bloomfilter, Z_STRVAL_P(value), Z_STRLEN_P(value));
 	if (ret < 0) {
 		PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Add value error");
@@ -191,10 +282,122 @@ PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, check){
 	phalcon_fetch_params(0, 1, 0, &value);
 
 	intern = phalcon_storage_bloomfilter_counting_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->type == PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_CUCKOO) {
+		RETURN_BOOL(cuckoo_filter_check(intern->cuckoo, Z_STRVAL_P(value), Z_STRLEN_P(value)));
+	}
+
 	if (!counting_bloom_check(intern->bloomfilter, Z_STRVAL_P(value), Z_STRLEN_P(value))) {
 		RETURN_FALSE;
 	}
 	RETURN_TRUE;
 }
 
-#endif
\ No newline at end of file
+/**
+ * Add values, returns a bitmap where bit i (ord($bitmap[$i >> 3]) >> ($i & 7) & 1) is set when the i-th value was added
+ *
+ *<code>
+ *	$bitmap = $filter->addMany(['a', 'b', 'c']);
+ *</code>
+ *
+ * @param array values
+ * @return string
+ */
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, addMany){
+
+	zval *values, *value;
+	phalcon_storage_bloomfilter_counting_object *intern;
+	zend_string *bitmap, *str;
+	unsigned char *bits;
+	size_t bytes;
+	zend_long i = 0;
+	int ret;
+
+	phalcon_fetch_params(0, 1, 0, &values);
+
+	intern = phalcon_storage_bloomfilter_counting_object_from_obj(Z_OBJ_P(getThis()));
+
+	bytes = (zend_hash_num_elements(Z_ARRVAL_P(values)) + 7) / 8;
+	bitmap = zend_string_alloc(bytes, 0);
+	bits = (unsigned char *) ZSTR_VAL(bitmap);
+	memset(bits, 0, bytes + 1);
+
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(values), value) {
+		str = zval_get_string(value);
+		ret = phalcon_storage_bloomfilter_counting_add_value(intern, ZSTR_VAL(str), ZSTR_LEN(str));
+		zend_string_release(str);
+		if (ret == 0) {
+			bits[i >> 3] |= 1 << (i & 7);
+		}
+		i++;
+	} ZEND_HASH_FOREACH_END();
+
+	RETURN_NEW_STR(bitmap);
+}
+
+/**
+ * Check values, returns a bitmap where bit i (ord($bitmap[$i >> 3]) >> ($i & 7) & 1) is set when the i-th value may exist
+ *
+ *<code>
+ *	$bitmap = $filter->checkMany($ids);
+ *	foreach ($ids as $i => $id) {
+ *		if (ord($bitmap[$i >> 3]) >> ($i & 7) & 1) {
+ *			// seen
+ *		}
+ *	}
+ *</code>
+ *
+ * @param array values
+ * @return string
+ */
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, checkMany){
+
+	zval *values, *value;
+	phalcon_storage_bloomfilter_counting_object *intern;
+	zend_string *bitmap, *batch[CUCKOO_FILTER_BATCH];
+	unsigned char *bits;
+	size_t bytes;
+	zend_long i = 0;
+	int n = 0;
+
+	phalcon_fetch_params(0, 1, 0, &values);
+
+	intern = phalcon_storage_bloomfilter_counting_object_from_obj(Z_OBJ_P(getThis()));
+
+	bytes = (zend_hash_num_elements(Z_ARRVAL_P(values)) + 7) / 8;
+	bitmap = zend_string_alloc(bytes, 0);
+	bits = (unsigned char *) ZSTR_VAL(bitmap);
+	memset(bits, 0, bytes + 1);
+
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(values), value) {
+		batch[n++] = zval_get_string(value);
+		if (n == CUCKOO_FILTER_BATCH) {
+			phalcon_storage_bloomfilter_counting_check_batch(intern, batch, n, bits, i);
+			i += n;
+			n = 0;
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	if (n > 0) {
+		phalcon_storage_bloomfilter_counting_check_batch(intern, batch, n, bits, i);
+	}
+
+	RETURN_NEW_STR(bitmap);
+}
+
+/**
+ * Flush data to file
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Bloomfilter_Counting, save){
+
+	phalcon_storage_bloomfilter_counting_object *intern;
+
+	intern = phalcon_storage_bloomfilter_counting_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->type == PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_CUCKOO) {
+		RETURN_BOOL(cuckoo_filter_flush(intern->cuckoo) == 0);
+	}
+	RETURN_BOOL(bitmap_flush(intern->bloomfilter->bitmap) == 0);
+}
+
+#endif
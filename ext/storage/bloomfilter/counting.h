@@ -23,10 +23,16 @@
 
 #include "php_phalcon.h"
 #include "kernel/countingbloomfilter.h"
+#include "kernel/cuckoofilter.h"
+
+#define PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_COUNTING	0
+#define PHALCON_STORAGE_BLOOMFILTER_COUNTING_TYPE_CUCKOO	1
 
 #ifdef ZEND_ENABLE_ZVAL_LONG64
 typedef struct _phalcon_storage_bloomfilter_counting_object {
+	int type;
 	counting_bloom_t* bloomfilter;
+	cuckoo_filter_t* cuckoo;
 	zval filename;
 	zend_object std;
 } phalcon_storage_bloomfilter_counting_object;
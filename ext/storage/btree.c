@@ -19,6 +19,8 @@
 */
 
 #include "storage/btree.h"
+#include "storage/btree/iterator.h"
+#include "storage/btree/private/compressor.h"
 #include "storage/exception.h"
 
 #include "zend_smart_str.h"
@@ -43,9 +45,15 @@ PHP_METHOD(Phalcon_Storage_Btree, __construct);
 PHP_METHOD(Phalcon_Storage_Btree, set);
 PHP_METHOD(Phalcon_Storage_Btree, get);
 PHP_METHOD(Phalcon_Storage_Btree, delete);
+PHP_METHOD(Phalcon_Storage_Btree, setMany);
+PHP_METHOD(Phalcon_Storage_Btree, range);
+PHP_METHOD(Phalcon_Storage_Btree, compact);
+PHP_METHOD(Phalcon_Storage_Btree, sync);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_btree___construct, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, db, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, compression, IS_LONG, 1)
+	ZEND_ARG_TYPE_INFO(0, options, IS_ARRAY, 1)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_btree_set, 0, 0, 2)
@@ -61,11 +69,24 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_btree_delete, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_btree_setmany, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, values, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_btree_range, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, start, IS_STRING, 1)
+	ZEND_ARG_TYPE_INFO(0, end, IS_STRING, 1)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry phalcon_storage_btree_method_entry[] = {
 	PHP_ME(Phalcon_Storage_Btree, __construct, arginfo_phalcon_storage_btree___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Storage_Btree, set, arginfo_phalcon_storage_btree_set, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Btree, get, arginfo_phalcon_storage_btree_get, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Btree, delete, arginfo_phalcon_storage_btree_delete, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Btree, setMany, arginfo_phalcon_storage_btree_setmany, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Btree, range, arginfo_phalcon_storage_btree_range, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Btree, compact, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Btree, sync, NULL, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -86,7 +107,11 @@ void phalcon_storage_btree_object_free_handler(zend_object *object)
 {
 	phalcon_storage_btree_object *intern = phalcon_storage_btree_object_from_obj(object);
 
-	phalcon_storage_btree_close(&intern->db);
+	if (intern->opened) {
+		phalcon_storage_btree_close(&intern->db);
+	}
+
+	zend_object_std_dtor(object);
 }
 
 /**
@@ -98,29 +123,74 @@ PHALCON_INIT_CLASS(Phalcon_Storage_Btree){
 
 	zend_declare_property_null(phalcon_storage_btree_ce, SL("_db"), ZEND_ACC_PROTECTED);
 
+	zend_declare_class_constant_long(phalcon_storage_btree_ce, SL("COMPRESSION_NONE"), kCodecStore);
+	zend_declare_class_constant_long(phalcon_storage_btree_ce, SL("COMPRESSION_LZ4"), kCodecLz4);
+	zend_declare_class_constant_long(phalcon_storage_btree_ce, SL("COMPRESSION_ZSTD"), kCodecZstd);
+
 	return SUCCESS;
 }
 
 /**
  * Phalcon\Storage\Btree constructor
  *
+ *<code>
+ * $btree = new Phalcon\Storage\Btree('data.db', Phalcon\Storage\Btree::COMPRESSION_LZ4, array(
+ *     'cacheSize' => 8388608,
+ *     'mmap' => true
+ * ));
+ *</code>
+ *
+ * The codec applies to the pages and values written from now on and is recorded in the file head,
+ * existing pages keep the codec they were written with. Defaults to LZ4 when available
+ *
+ * Options:
+ *  - cacheSize: bytes of decoded pages kept in memory, 0 disables the cache (default 4MB)
+ *  - mmap: read through a read-only mapping of the file instead of pread (default false)
+ *
  * @param string $db
+ * @param int $compression
+ * @param array $options
  */
 PHP_METHOD(Phalcon_Storage_Btree, __construct)
 {
-	zval *db;
+	zval *db, *compression = NULL, *options = NULL, cache_size = {}, mmap = {};
 	phalcon_storage_btree_object *intern;
+	int codec = PHALCON_STORAGE_BTREE_DEFAULT_CODEC;
+	zend_long size = PHALCON_STORAGE_BTREE_DEFAULT_CACHE_SIZE;
+
+	phalcon_fetch_params(0, 1, 2, &db, &compression, &options);
 
-	phalcon_fetch_params(0, 1, 0, &db);
+	if (compression && Z_TYPE_P(compression) != IS_NULL) {
+		codec = (int) phalcon_get_intval(compression);
+		if (!_phalcon_storage_btree_codec_available(codec)) {
+			PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Compression %d is not supported by this build", codec);
+			return;
+		}
+	}
 
 	phalcon_update_property(getThis(), SL("_db"), db);
 
 	intern = phalcon_storage_btree_object_from_obj(Z_OBJ_P(getThis()));
 
-	if (phalcon_storage_btree_open(&intern->db, Z_STRVAL_P(db)) != PHALCON_STORAGE_BTREE_OK){
+	if (phalcon_storage_btree_open_ex(&intern->db, Z_STRVAL_P(db), codec) != PHALCON_STORAGE_BTREE_OK){
 		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Failed to open Db %s", Z_STRVAL_P(db));
 		return;
 	}
+
+	intern->opened = 1;
+
+	if (options && Z_TYPE_P(options) == IS_ARRAY) {
+		if (phalcon_array_isset_fetch_str(&cache_size, options, SL("cacheSize"), PH_READONLY)) {
+			size = phalcon_get_intval(&cache_size);
+		}
+		if (phalcon_array_isset_fetch_str(&mmap, options, SL("mmap"), PH_READONLY) && zend_is_true(&mmap)) {
+			phalcon_storage_btree_set_mmap(&intern->db, 1);
+		}
+	}
+
+	if (size > 0) {
+		phalcon_storage_btree_set_cache_size(&intern->db, (uint64_t) size);
+	}
 }
 
 /**
@@ -163,7 +233,8 @@ PHP_METHOD(Phalcon_Storage_Btree, get)
 	intern = phalcon_storage_btree_object_from_obj(Z_OBJ_P(getThis()));
 
 	if (phalcon_storage_btree_gets(&intern->db, Z_STRVAL_P(key), &value) == PHALCON_STORAGE_BTREE_OK){
-		RETURN_STRING(value);
+		RETVAL_STRING(value);
+		efree(value);
 		return;
 	}
 
@@ -191,3 +262,151 @@ PHP_METHOD(Phalcon_Storage_Btree, delete)
 
 	RETURN_TRUE;
 }
+
+typedef struct {
+	phalcon_storage_btree_key_t key;
+	phalcon_storage_btree_value_t value;
+} phalcon_storage_btree_pair;
+
+static int phalcon_storage_btree_pair_compare(const void *a, const void *b)
+{
+	return _phalcon_storage_btree_default_compare_cb(&((const phalcon_storage_btree_pair *)a)->key, &((const phalcon_storage_btree_pair *)b)->key);
+}
+
+/**
+ * Stores many contents at once, the keys are sorted and inserted in one pass so
+ * every touched page is written once per call
+ *
+ *<code>
+ * $btree->setMany(array('key1' => 'value1', 'key2' => 'value2'));
+ *</code>
+ *
+ * @param array $values
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Btree, setMany)
+{
+	zval *values, *value;
+	zend_string *str_key, **strings;
+	zend_ulong num_key;
+	phalcon_storage_btree_object *intern;
+	phalcon_storage_btree_pair *pairs;
+	phalcon_storage_btree_key_t *bkeys;
+	phalcon_storage_btree_value_t *bvalues;
+	uint32_t count, num_strings = 0, i = 0;
+	int ret;
+
+	phalcon_fetch_params(0, 1, 0, &values);
+
+	count = zend_hash_num_elements(Z_ARRVAL_P(values));
+	if (!count) {
+		RETURN_TRUE;
+	}
+
+	intern = phalcon_storage_btree_object_from_obj(Z_OBJ_P(getThis()));
+
+	pairs = emalloc(sizeof(phalcon_storage_btree_pair) * count);
+	strings = emalloc(sizeof(zend_string*) * count * 2);
+
+	ZEND_HASH_FOREACH_KEY_VAL(Z_ARRVAL_P(values), num_key, str_key, value) {
+		zend_string *k = str_key ? zend_string_copy(str_key) : zend_long_to_str((zend_long)num_key);
+		zend_string *v = zval_get_string(value);
+
+		strings[num_strings++] = k;
+		strings[num_strings++] = v;
+
+		/* keys and values keep their terminating NUL like set() does */
+		pairs[i].key.value = ZSTR_VAL(k);
+		pairs[i].key.length = ZSTR_LEN(k) + 1;
+		pairs[i].value.value = ZSTR_VAL(v);
+		pairs[i].value.length = ZSTR_LEN(v) + 1;
+		i++;
+	} ZEND_HASH_FOREACH_END();
+
+	qsort(pairs, count, sizeof(phalcon_storage_btree_pair), phalcon_storage_btree_pair_compare);
+
+	bkeys = emalloc(sizeof(phalcon_storage_btree_key_t) * count);
+	bvalues = emalloc(sizeof(phalcon_storage_btree_value_t) * count);
+	for (i = 0; i < count; i++) {
+		bkeys[i] = pairs[i].key;
+		bvalues[i] = pairs[i].value;
+	}
+	efree(pairs);
+
+	ret = phalcon_storage_btree_bulk_set(&intern->db, count, (const phalcon_storage_btree_key_t **) &bkeys, (const phalcon_storage_btree_value_t **) &bvalues);
+
+	efree(bkeys);
+	efree(bvalues);
+	for (i = 0; i < num_strings; i++) {
+		zend_string_release(strings[i]);
+	}
+	efree(strings);
+
+	RETURN_BOOL(ret == PHALCON_STORAGE_BTREE_OK);
+}
+
+/**
+ * Returns an iterator over the keys between start and end (both included), pages are read while iterating
+ *
+ *<code>
+ * foreach ($btree->range('2017-01-01', '2017-01-31') as $key => $value) {
+ *     echo $key, ' => ', $value, PHP_EOL;
+ * }
+ *</code>
+ *
+ * @param string $start
+ * @param string $end
+ * @return Phalcon\Storage\Btree\Iterator
+ */
+PHP_METHOD(Phalcon_Storage_Btree, range)
+{
+	zval *start = NULL, *end = NULL;
+	phalcon_storage_btree_object *intern;
+	phalcon_storage_btree_iterator_object *iterator_intern;
+
+	phalcon_fetch_params(0, 0, 2, &start, &end);
+
+	intern = phalcon_storage_btree_object_from_obj(Z_OBJ_P(getThis()));
+
+	object_init_ex(return_value, phalcon_storage_btree_iterator_ce);
+	iterator_intern = phalcon_storage_btree_iterator_object_from_obj(Z_OBJ_P(return_value));
+
+	ZVAL_COPY(&iterator_intern->btree, getThis());
+	iterator_intern->db = &intern->db;
+
+	if (start && Z_TYPE_P(start) == IS_STRING) {
+		iterator_intern->start = zend_string_copy(Z_STR_P(start));
+	}
+
+	if (end && Z_TYPE_P(end) == IS_STRING) {
+		iterator_intern->end = zend_string_copy(Z_STR_P(end));
+	}
+}
+
+/**
+ * Rewrites the live pages and values into a new file, dropping the previous versions
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Btree, compact)
+{
+	phalcon_storage_btree_object *intern;
+
+	intern = phalcon_storage_btree_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_BOOL(phalcon_storage_btree_compact(&intern->db) == PHALCON_STORAGE_BTREE_OK);
+}
+
+/**
+ * Flushes the written data to disk
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Btree, sync)
+{
+	phalcon_storage_btree_object *intern;
+
+	intern = phalcon_storage_btree_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_BOOL(phalcon_storage_btree_fsync(&intern->db) == PHALCON_STORAGE_BTREE_OK);
+}
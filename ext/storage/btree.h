@@ -24,8 +24,11 @@
 #include "php_phalcon.h"
 #include "storage/btree/bplus.h"
 
+#define PHALCON_STORAGE_BTREE_DEFAULT_CACHE_SIZE 4194304
+
 typedef struct {
 	phalcon_storage_btree_db_t db;
+	int opened;
 	zend_object std;
 } phalcon_storage_btree_object;
 
@@ -1,15 +1,31 @@
 #include "storage/btree/bplus.h"
 #include "storage/btree/private/utils.h"
+#include "storage/btree/private/compressor.h"
 
 #include "kernel/main.h"
 
 int phalcon_storage_btree_open(phalcon_storage_btree_db_t *tree, const char* filename)
+{
+    return phalcon_storage_btree_open_ex(tree, filename, PHALCON_STORAGE_BTREE_DEFAULT_CODEC);
+}
+
+int phalcon_storage_btree_open_ex(phalcon_storage_btree_db_t *tree, const char* filename, const int codec)
 {
     int ret;
 
+    if (!_phalcon_storage_btree_codec_available(codec)) return PHALCON_STORAGE_BTREE_ECODEC;
+
+    /* may be reset to kCodecLegacy by the head of an existing file */
+    tree->codec = codec;
+    tree->use_mmap = 0;
+    tree->generation = 0;
+
     ret = pthread_rwlock_init(&tree->rwlock, NULL) ? PHALCON_STORAGE_BTREE_ERWLOCK : PHALCON_STORAGE_BTREE_OK;
     if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
 
+    /* page cache is disabled until phalcon_storage_btree_set_cache_size */
+    _phalcon_storage_btree_cache_init(&tree->cache);
+
     ret = _phalcon_storage_btree_writer_create((_phalcon_storage_btree_writer_t*) tree, filename);
     if (ret != PHALCON_STORAGE_BTREE_OK) goto fatal;
 
@@ -21,6 +37,7 @@ int phalcon_storage_btree_open(phalcon_storage_btree_db_t *tree, const char* fil
     return PHALCON_STORAGE_BTREE_OK;
 
 fatal:
+    _phalcon_storage_btree_cache_destroy(&tree->cache);
     pthread_rwlock_destroy(&tree->rwlock);
     return ret;
 }
@@ -31,6 +48,7 @@ int phalcon_storage_btree_close(phalcon_storage_btree_db_t *tree)
     _phalcon_storage_btree_destroy(tree);
     pthread_rwlock_unlock(&tree->rwlock);
 
+    _phalcon_storage_btree_cache_destroy(&tree->cache);
     pthread_rwlock_destroy(&tree->rwlock);
     return PHALCON_STORAGE_BTREE_OK;
 }
@@ -107,6 +125,7 @@ int phalcon_storage_btree_update(phalcon_storage_btree_db_t *tree,
     if (ret == PHALCON_STORAGE_BTREE_OK) {
         ret = _phalcon_storage_btree_tree_write_head((_phalcon_storage_btree_writer_t*) tree, NULL);
     }
+    tree->generation++;
 
     pthread_rwlock_unlock(&tree->rwlock);
 
@@ -138,6 +157,7 @@ int phalcon_storage_btree_bulk_update(phalcon_storage_btree_db_t *tree,
     if (ret == PHALCON_STORAGE_BTREE_OK) {
         ret =  _phalcon_storage_btree_tree_write_head((_phalcon_storage_btree_writer_t *) tree, NULL);
     }
+    tree->generation++;
 
     pthread_rwlock_unlock(&tree->rwlock);
 
@@ -173,6 +193,7 @@ int phalcon_storage_btree_removev(phalcon_storage_btree_db_t *tree,
     if (ret == PHALCON_STORAGE_BTREE_OK) {
         ret = _phalcon_storage_btree_tree_write_head((_phalcon_storage_btree_writer_t *) tree, NULL);
     }
+    tree->generation++;
 
     pthread_rwlock_unlock(&tree->rwlock);
 
@@ -194,8 +215,10 @@ int phalcon_storage_btree_compact(phalcon_storage_btree_db_t *tree)
     ret = _phalcon_storage_btree_writer_compact_name((_phalcon_storage_btree_writer_t *) tree, &compacted_name);
     if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
 
-    /* open it */
-    ret = phalcon_storage_btree_open(&compacted, compacted_name);
+    /* open it, files written before page frames are upgraded on the way */
+    ret = phalcon_storage_btree_open_ex(&compacted,
+                                     compacted_name,
+                                     tree->codec == kCodecLegacy ? PHALCON_STORAGE_BTREE_DEFAULT_CODEC : tree->codec);
     efree(compacted_name);
     if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
 
@@ -220,6 +243,7 @@ int phalcon_storage_btree_compact(phalcon_storage_btree_db_t *tree)
 
     ret = _phalcon_storage_btree_writer_compact_finalize((_phalcon_storage_btree_writer_t *) tree,
                                       (_phalcon_storage_btree_writer_t *) &compacted);
+    tree->generation++;
     pthread_rwlock_unlock(&tree->rwlock);
 
     return ret;
@@ -263,6 +287,39 @@ int phalcon_storage_btree_get_range(phalcon_storage_btree_db_t *tree,
                                  arg);
 }
 
+int phalcon_storage_btree_seek(phalcon_storage_btree_db_t *tree,
+            const phalcon_storage_btree_key_t *key,
+            const int inclusive,
+            _phalcon_storage_btree_page_t **leaf,
+            uint64_t *index)
+{
+    int ret;
+
+    pthread_rwlock_rdlock(&tree->rwlock);
+
+    ret = _phalcon_storage_btree_page_seek(tree, tree->head.page, key, inclusive, leaf, index);
+
+    pthread_rwlock_unlock(&tree->rwlock);
+
+    return ret;
+}
+
+void phalcon_storage_btree_release_leaf(phalcon_storage_btree_db_t *tree, _phalcon_storage_btree_page_t *leaf)
+{
+    _phalcon_storage_btree_page_destroy(tree, leaf);
+}
+
+uint64_t phalcon_storage_btree_generation(phalcon_storage_btree_db_t *tree)
+{
+    uint64_t generation;
+
+    pthread_rwlock_rdlock(&tree->rwlock);
+    generation = tree->generation;
+    pthread_rwlock_unlock(&tree->rwlock);
+
+    return generation;
+}
+
 /* Wrappers to allow string to string set/get/remove */
 
 int phalcon_storage_btree_gets(phalcon_storage_btree_db_t *tree, const char *key, char **value)
@@ -406,6 +463,25 @@ void phalcon_storage_btree_set_compare_cb(phalcon_storage_btree_db_t *tree, phal
 }
 
 
+void phalcon_storage_btree_set_cache_size(phalcon_storage_btree_db_t *tree, const uint64_t size)
+{
+    _phalcon_storage_btree_cache_resize(&tree->cache, size);
+}
+
+
+void phalcon_storage_btree_set_mmap(phalcon_storage_btree_db_t *tree, const int enabled)
+{
+    pthread_rwlock_wrlock(&tree->rwlock);
+    tree->use_mmap = enabled;
+    if (enabled) {
+        _phalcon_storage_btree_writer_map((_phalcon_storage_btree_writer_t *) tree);
+    } else {
+        _phalcon_storage_btree_writer_unmap((_phalcon_storage_btree_writer_t *) tree);
+    }
+    pthread_rwlock_unlock(&tree->rwlock);
+}
+
+
 int phalcon_storage_btree_fsync(phalcon_storage_btree_db_t *tree)
 {
     int ret;
@@ -419,22 +495,44 @@ int phalcon_storage_btree_fsync(phalcon_storage_btree_db_t *tree)
 
 /* internal utils */
 
+static uint64_t _phalcon_storage_btree_head_hash(const uint64_t offset, const uint64_t page_size)
+{
+    uint64_t hash = _phalcon_storage_btree_compute_hashl(offset);
+
+    /* legacy heads only cover the offset */
+    if ((page_size >> PHALCON_STORAGE_BTREE__HEAD_CODEC_SHIFT) == kCodecLegacy) return hash;
+
+    return hash ^ _phalcon_storage_btree_compute_hashl(page_size);
+}
+
 int _phalcon_storage_btree_tree_read_head(_phalcon_storage_btree_writer_t *w, void *data)
 {
     int ret;
     phalcon_storage_btree_db_t *t = (phalcon_storage_btree_db_t *) w;
     _phalcon_storage_btree_tree_head_t* head = (_phalcon_storage_btree_tree_head_t *) data;
 
+    uint64_t page_size;
+    int codec;
+
     t->head.offset = _phalcon_ntohll(head->offset);
     t->head.config = _phalcon_ntohll(head->config);
-    t->head.page_size = _phalcon_ntohll(head->page_size);
+    page_size = _phalcon_ntohll(head->page_size);
     t->head.hash = _phalcon_ntohll(head->hash);
 
     /* we've copied all data - efree it */
     efree(data);
 
     /* Check hash first */
-    if (_phalcon_storage_btree_compute_hashl(t->head.offset) != t->head.hash) return 1;
+    if (_phalcon_storage_btree_head_hash(t->head.offset, page_size) != t->head.hash) return 1;
+
+    /* the codec of the last writer lives in the top byte of the page size */
+    codec = (int) (page_size >> PHALCON_STORAGE_BTREE__HEAD_CODEC_SHIFT);
+    t->head.page_size = page_size & ~((uint64_t) 0xFF << PHALCON_STORAGE_BTREE__HEAD_CODEC_SHIFT);
+
+    /* unframed files keep being written unframed until compaction */
+    if (codec == kCodecLegacy) {
+        t->codec = kCodecLegacy;
+    }
 
     ret = _phalcon_storage_btree_page_load(t, t->head.offset, t->head.config, &t->head.page);
     if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
@@ -451,6 +549,7 @@ int _phalcon_storage_btree_tree_write_head(_phalcon_storage_btree_writer_t *w, v
     _phalcon_storage_btree_tree_head_t nhead;
     uint64_t offset;
     uint64_t size;
+    uint64_t page_size;
 
     if (t->head.page == NULL) {
         /* TODO: page size should be configurable */
@@ -467,12 +566,13 @@ int _phalcon_storage_btree_tree_write_head(_phalcon_storage_btree_writer_t *w, v
     t->head.offset = t->head.page->offset;
     t->head.config = t->head.page->config;
 
-    t->head.hash = _phalcon_storage_btree_compute_hashl(t->head.offset);
+    page_size = t->head.page_size | ((uint64_t) t->codec << PHALCON_STORAGE_BTREE__HEAD_CODEC_SHIFT);
+    t->head.hash = _phalcon_storage_btree_head_hash(t->head.offset, page_size);
 
     /* Create temporary head with fields in network byte order */
     nhead.offset = _phalcon_htonll(t->head.offset);
     nhead.config = _phalcon_htonll(t->head.config);
-    nhead.page_size = _phalcon_htonll(t->head.page_size);
+    nhead.page_size = _phalcon_htonll(page_size);
     nhead.hash = _phalcon_htonll(t->head.hash);
 
     size = PHALCON_STORAGE_BTREE__HEAD_SIZE;
@@ -482,6 +582,16 @@ int _phalcon_storage_btree_tree_write_head(_phalcon_storage_btree_writer_t *w, v
                            &offset,
                            &size);
 
+    /*
+     * Every update ends here with the write lock held, so this is the only safe place
+     * to move the mapping. Remap once the unmapped tail is worth it, reads past
+     * the mapping fall back to pread meanwhile
+     */
+    if (ret == PHALCON_STORAGE_BTREE_OK && w->use_mmap
+        && w->filesize - w->map_size > PHALCON_STORAGE_BTREE__REMAP_THRESHOLD(w->map_size)) {
+        _phalcon_storage_btree_writer_map(w);
+    }
+
     return ret;
 }
 
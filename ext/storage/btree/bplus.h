@@ -32,6 +32,7 @@ typedef int (*phalcon_storage_btree_filter_cb)(void* arg, const phalcon_storage_
  * Open and close database
  */
 int phalcon_storage_btree_open(phalcon_storage_btree_db_t *tree, const char *filename);
+int phalcon_storage_btree_open_ex(phalcon_storage_btree_db_t *tree, const char *filename, const int codec);
 int phalcon_storage_btree_close(phalcon_storage_btree_db_t *tree);
 
 /*
@@ -149,6 +150,23 @@ int phalcon_storage_btree_get_filtered_ranges(phalcon_storage_btree_db_t *tree,
                            phalcon_storage_btree_range_cb cb,
                            void *arg);
 
+/*
+ * Find the leaf page holding the first key greater than (or equal to, if inclusive) key
+ * Note: leaf page should be released with phalcon_storage_btree_release_leaf,
+ * its value offsets are only meaningful while phalcon_storage_btree_generation is unchanged
+ */
+int phalcon_storage_btree_seek(phalcon_storage_btree_db_t *tree,
+            const phalcon_storage_btree_key_t *key,
+            const int inclusive,
+            _phalcon_storage_btree_page_t **leaf,
+            uint64_t *index);
+void phalcon_storage_btree_release_leaf(phalcon_storage_btree_db_t *tree, _phalcon_storage_btree_page_t *leaf);
+
+/*
+ * Counter bumped by every write and by compaction, pages loaded under an older one may be stale
+ */
+uint64_t phalcon_storage_btree_generation(phalcon_storage_btree_db_t *tree);
+
 /*
  * Run compaction on database
  */
@@ -159,6 +177,16 @@ int phalcon_storage_btree_compact(phalcon_storage_btree_db_t *tree);
  */
 void phalcon_storage_btree_set_compare_cb(phalcon_storage_btree_db_t *tree, phalcon_storage_btree_compare_cb cb);
 
+/*
+ * Keep up to size bytes of decoded pages in memory (0 disables the cache)
+ */
+void phalcon_storage_btree_set_cache_size(phalcon_storage_btree_db_t *tree, const uint64_t size);
+
+/*
+ * Read pages and values through a read-only mapping of the file instead of pread
+ */
+void phalcon_storage_btree_set_mmap(phalcon_storage_btree_db_t *tree, const int enabled);
+
 /*
  * Ensure that all data is written to disk
  */
@@ -0,0 +1,216 @@
+#include "storage/btree/private/cache.h"
+
+#include "kernel/main.h"
+
+#define PHALCON_STORAGE_BTREE__CACHE_ENTRY_SIZE(entry) ((entry)->size + (entry)->page_size + sizeof(_phalcon_storage_btree_cache_entry_t))
+
+static void _phalcon_storage_btree_cache_free_entry(_phalcon_storage_btree_cache_entry_t *entry)
+{
+    /* keys of the shared page point into data, nothing else to free */
+    if (entry->page != NULL) {
+        efree(entry->page);
+    }
+    efree(entry->data);
+    efree(entry);
+}
+
+static void _phalcon_storage_btree_cache_unlink(_phalcon_storage_btree_cache_t *cache, _phalcon_storage_btree_cache_entry_t *entry)
+{
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->head = entry->next;
+    }
+
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void _phalcon_storage_btree_cache_link(_phalcon_storage_btree_cache_t *cache, _phalcon_storage_btree_cache_entry_t *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache->head;
+
+    if (cache->head != NULL) {
+        cache->head->prev = entry;
+    } else {
+        cache->tail = entry;
+    }
+
+    cache->head = entry;
+}
+
+static void _phalcon_storage_btree_cache_evict(_phalcon_storage_btree_cache_t *cache, _phalcon_storage_btree_cache_entry_t *entry)
+{
+    _phalcon_storage_btree_cache_unlink(cache, entry);
+    zend_hash_index_del(cache->entries, (zend_ulong) entry->offset);
+
+    cache->used -= PHALCON_STORAGE_BTREE__CACHE_ENTRY_SIZE(entry);
+    entry->linked = 0;
+
+    /* pages still pointing into the buffer free it on release */
+    if (entry->refcount == 0) {
+        _phalcon_storage_btree_cache_free_entry(entry);
+    }
+}
+
+static void _phalcon_storage_btree_cache_shrink(_phalcon_storage_btree_cache_t *cache, const uint64_t capacity)
+{
+    while (cache->used > capacity && cache->tail != NULL) {
+        _phalcon_storage_btree_cache_evict(cache, cache->tail);
+    }
+}
+
+void _phalcon_storage_btree_cache_init(_phalcon_storage_btree_cache_t *cache)
+{
+    cache->entries = NULL;
+    cache->head = NULL;
+    cache->tail = NULL;
+    cache->capacity = 0;
+    cache->used = 0;
+
+    pthread_mutex_init(&cache->mutex, NULL);
+}
+
+void _phalcon_storage_btree_cache_destroy(_phalcon_storage_btree_cache_t *cache)
+{
+    _phalcon_storage_btree_cache_clear(cache);
+
+    if (cache->entries != NULL) {
+        zend_hash_destroy(cache->entries);
+        FREE_HASHTABLE(cache->entries);
+        cache->entries = NULL;
+    }
+
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+void _phalcon_storage_btree_cache_clear(_phalcon_storage_btree_cache_t *cache)
+{
+    pthread_mutex_lock(&cache->mutex);
+    _phalcon_storage_btree_cache_shrink(cache, 0);
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void _phalcon_storage_btree_cache_resize(_phalcon_storage_btree_cache_t *cache, const uint64_t capacity)
+{
+    pthread_mutex_lock(&cache->mutex);
+
+    cache->capacity = capacity;
+    _phalcon_storage_btree_cache_shrink(cache, capacity);
+
+    if (capacity > 0 && cache->entries == NULL) {
+        ALLOC_HASHTABLE(cache->entries);
+        zend_hash_init(cache->entries, 64, NULL, NULL, 0);
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+_phalcon_storage_btree_cache_entry_t *_phalcon_storage_btree_cache_get(_phalcon_storage_btree_cache_t *cache, const uint64_t offset)
+{
+    _phalcon_storage_btree_cache_entry_t *entry;
+
+    if (cache->capacity == 0) return NULL;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    entry = zend_hash_index_find_ptr(cache->entries, (zend_ulong) offset);
+    if (entry != NULL) {
+        entry->refcount++;
+
+        /* move to the most recently used end */
+        if (cache->head != entry) {
+            _phalcon_storage_btree_cache_unlink(cache, entry);
+            _phalcon_storage_btree_cache_link(cache, entry);
+        }
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return entry;
+}
+
+_phalcon_storage_btree_cache_entry_t *_phalcon_storage_btree_cache_put(_phalcon_storage_btree_cache_t *cache,
+                    const uint64_t offset,
+                    char *data,
+                    const uint64_t size)
+{
+    _phalcon_storage_btree_cache_entry_t *entry;
+
+    if (cache->capacity == 0 || size + sizeof(*entry) > cache->capacity) return NULL;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    /* another reader may have decoded the same page meanwhile */
+    entry = zend_hash_index_find_ptr(cache->entries, (zend_ulong) offset);
+    if (entry != NULL) {
+        entry->refcount++;
+        pthread_mutex_unlock(&cache->mutex);
+
+        efree(data);
+        return entry;
+    }
+
+    entry = emalloc(sizeof(*entry));
+    entry->offset = offset;
+    entry->size = size;
+    entry->data = data;
+    entry->page = NULL;
+    entry->page_size = 0;
+    entry->refcount = 1;
+    entry->linked = 1;
+
+    _phalcon_storage_btree_cache_shrink(cache, cache->capacity - PHALCON_STORAGE_BTREE__CACHE_ENTRY_SIZE(entry));
+
+    zend_hash_index_update_ptr(cache->entries, (zend_ulong) offset, entry);
+    _phalcon_storage_btree_cache_link(cache, entry);
+    cache->used += PHALCON_STORAGE_BTREE__CACHE_ENTRY_SIZE(entry);
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return entry;
+}
+
+void _phalcon_storage_btree_cache_release(_phalcon_storage_btree_cache_t *cache, _phalcon_storage_btree_cache_entry_t *entry)
+{
+    pthread_mutex_lock(&cache->mutex);
+
+    entry->refcount--;
+    if (entry->refcount == 0 && !entry->linked) {
+        _phalcon_storage_btree_cache_free_entry(entry);
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+struct _phalcon_storage_btree_page_s *_phalcon_storage_btree_cache_share(_phalcon_storage_btree_cache_t *cache,
+                    _phalcon_storage_btree_cache_entry_t *entry,
+                    struct _phalcon_storage_btree_page_s *page,
+                    const uint64_t size)
+{
+    pthread_mutex_lock(&cache->mutex);
+
+    if (entry->page != NULL) {
+        page = entry->page;
+    } else {
+        entry->page = page;
+        entry->page_size = size;
+
+        /* evicted entries are no longer accounted */
+        if (entry->linked) {
+            cache->used += size;
+            _phalcon_storage_btree_cache_shrink(cache, cache->capacity);
+        }
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return page;
+}
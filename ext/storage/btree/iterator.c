@@ -0,0 +1,293 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "storage/btree/iterator.h"
+#include "storage/exception.h"
+
+#include "kernel/main.h"
+#include "kernel/memory.h"
+#include "kernel/object.h"
+#include "kernel/exception.h"
+
+#include "internal/arginfo.h"
+
+/**
+ * Phalcon\Storage\Btree\Iterator
+ *
+ * Iterates over a range of keys of Phalcon\Storage\Btree. Only the current leaf page is kept
+ * in memory and values are read when requested
+ */
+zend_class_entry *phalcon_storage_btree_iterator_ce;
+
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, __construct);
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, current);
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, key);
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, next);
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, rewind);
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, valid);
+
+static const zend_function_entry phalcon_storage_btree_iterator_method_entry[] = {
+	PHP_ME(Phalcon_Storage_Btree_Iterator, __construct, NULL, ZEND_ACC_PRIVATE|ZEND_ACC_CTOR|ZEND_ACC_FINAL)
+	PHP_ME(Phalcon_Storage_Btree_Iterator, current, arginfo_iterator_current, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Btree_Iterator, key, arginfo_iterator_key, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Btree_Iterator, next, arginfo_iterator_next, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Btree_Iterator, rewind, arginfo_iterator_rewind, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Btree_Iterator, valid, arginfo_iterator_valid, ZEND_ACC_PUBLIC)
+	PHP_FE_END
+};
+
+static void phalcon_storage_btree_iterator_release(phalcon_storage_btree_iterator_object *intern)
+{
+	if (intern->leaf) {
+		phalcon_storage_btree_release_leaf(intern->db, intern->leaf);
+		intern->leaf = NULL;
+	}
+}
+
+zend_object_handlers phalcon_storage_btree_iterator_object_handlers;
+zend_object* phalcon_storage_btree_iterator_object_create_handler(zend_class_entry *ce)
+{
+	phalcon_storage_btree_iterator_object *intern = ecalloc(1, sizeof(phalcon_storage_btree_iterator_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_storage_btree_iterator_object_handlers;
+
+	ZVAL_UNDEF(&intern->btree);
+
+	return &intern->std;
+}
+
+void phalcon_storage_btree_iterator_object_free_handler(zend_object *object)
+{
+	phalcon_storage_btree_iterator_object *intern = phalcon_storage_btree_iterator_object_from_obj(object);
+
+	phalcon_storage_btree_iterator_release(intern);
+
+	if (intern->start) {
+		zend_string_release(intern->start);
+	}
+
+	if (intern->end) {
+		zend_string_release(intern->end);
+	}
+
+	zval_ptr_dtor(&intern->btree);
+
+	zend_object_std_dtor(object);
+}
+
+/**
+ * Phalcon\Storage\Btree\Iterator initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Storage_Btree_Iterator){
+
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT(Phalcon\\Storage\\Btree, Iterator, storage_btree_iterator, phalcon_storage_btree_iterator_method_entry, 0);
+
+	zend_class_implements(phalcon_storage_btree_iterator_ce, 1, zend_ce_iterator);
+
+	return SUCCESS;
+}
+
+/**
+ * Positions the iterator on the first key after the given one, stopping past the end key
+ */
+static void phalcon_storage_btree_iterator_seek(phalcon_storage_btree_iterator_object *intern, const char *key, uint64_t length, int inclusive)
+{
+	phalcon_storage_btree_key_t bkey;
+	_phalcon_storage_btree_page_t *leaf = NULL;
+	uint64_t index = 0;
+
+	bkey.value = (char *) key;
+	bkey.length = length;
+
+	/* taken before seeking, a write in between only makes the next call seek again */
+	if (intern->db) {
+		intern->generation = phalcon_storage_btree_generation(intern->db);
+	}
+
+	/* the key may point into the current leaf, it is released after seeking */
+	if (!intern->db || phalcon_storage_btree_seek(intern->db, &bkey, inclusive, &leaf, &index) != PHALCON_STORAGE_BTREE_OK) {
+		leaf = NULL;
+	}
+
+	phalcon_storage_btree_iterator_release(intern);
+
+	intern->leaf = leaf;
+	intern->index = index;
+}
+
+static void phalcon_storage_btree_iterator_check_end(phalcon_storage_btree_iterator_object *intern)
+{
+	phalcon_storage_btree_key_t end;
+
+	if (!intern->leaf || !intern->end) {
+		return;
+	}
+
+	end.value = ZSTR_VAL(intern->end);
+	end.length = ZSTR_LEN(intern->end) + 1;
+
+	if (_phalcon_storage_btree_default_compare_cb((phalcon_storage_btree_key_t *) &intern->leaf->keys[intern->index], &end) > 0) {
+		phalcon_storage_btree_iterator_release(intern);
+	}
+}
+
+/**
+ * Finds the current key again when the tree was written or compacted since its leaf was loaded,
+ * value offsets of a leaf loaded before compaction point into the replaced file
+ */
+static void phalcon_storage_btree_iterator_revalidate(phalcon_storage_btree_iterator_object *intern)
+{
+	_phalcon_storage_btree_kv_t *kv;
+
+	if (!intern->leaf || intern->generation == phalcon_storage_btree_generation(intern->db)) {
+		return;
+	}
+
+	kv = &intern->leaf->keys[intern->index];
+	phalcon_storage_btree_iterator_seek(intern, kv->value, kv->length, 1);
+	phalcon_storage_btree_iterator_check_end(intern);
+}
+
+/**
+ * Phalcon\Storage\Btree\Iterator constructor
+ *
+ */
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, __construct)
+{
+	/* this constructor shouldn't be called as it's private */
+	zend_throw_exception(NULL, "An object of this type cannot be created with the new operator.", 0);
+}
+
+/**
+ * Return current element
+ *
+ * @return string
+ */
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, current)
+{
+	phalcon_storage_btree_iterator_object *intern;
+	phalcon_storage_btree_value_t value;
+	uint64_t length;
+
+	intern = phalcon_storage_btree_iterator_object_from_obj(Z_OBJ_P(getThis()));
+	phalcon_storage_btree_iterator_revalidate(intern);
+
+	if (!intern->leaf || _phalcon_storage_btree_page_load_value(intern->db, intern->leaf, intern->index, &value) != PHALCON_STORAGE_BTREE_OK) {
+		RETURN_FALSE;
+	}
+
+	/* values stored by Phalcon\Storage\Btree end with a NUL byte */
+	length = value.length;
+	if (length && value.value[length - 1] == '\0') {
+		length--;
+	}
+
+	RETVAL_STRINGL(value.value, length);
+	efree(value.value);
+}
+
+/**
+ * Returns the key of current element
+ *
+ * @return string
+ */
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, key)
+{
+	phalcon_storage_btree_iterator_object *intern;
+	_phalcon_storage_btree_kv_t *kv;
+	uint64_t length;
+
+	intern = phalcon_storage_btree_iterator_object_from_obj(Z_OBJ_P(getThis()));
+	phalcon_storage_btree_iterator_revalidate(intern);
+
+	if (!intern->leaf) {
+		RETURN_FALSE;
+	}
+
+	kv = &intern->leaf->keys[intern->index];
+
+	length = kv->length;
+	if (length && kv->value[length - 1] == '\0') {
+		length--;
+	}
+
+	RETURN_STRINGL(kv->value, length);
+}
+
+/**
+ * Moves forward to the next element
+ */
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, next)
+{
+	phalcon_storage_btree_iterator_object *intern;
+	_phalcon_storage_btree_kv_t *kv;
+
+	intern = phalcon_storage_btree_iterator_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (!intern->leaf) {
+		return;
+	}
+
+	if (intern->generation == phalcon_storage_btree_generation(intern->db) && intern->index + 1 < intern->leaf->length) {
+		intern->index++;
+	} else {
+		/* leaf exhausted or stale, descend again from the last key seen */
+		kv = &intern->leaf->keys[intern->index];
+		phalcon_storage_btree_iterator_seek(intern, kv->value, kv->length, 0);
+	}
+
+	phalcon_storage_btree_iterator_check_end(intern);
+}
+
+/**
+ * Rewinds back to the first element of the range
+ */
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, rewind)
+{
+	phalcon_storage_btree_iterator_object *intern;
+
+	intern = phalcon_storage_btree_iterator_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (intern->start) {
+		phalcon_storage_btree_iterator_seek(intern, ZSTR_VAL(intern->start), ZSTR_LEN(intern->start) + 1, 1);
+	} else {
+		phalcon_storage_btree_iterator_seek(intern, "", 0, 1);
+	}
+
+	phalcon_storage_btree_iterator_check_end(intern);
+}
+
+/**
+ * Checks if current position is valid
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Btree_Iterator, valid)
+{
+	phalcon_storage_btree_iterator_object *intern;
+
+	intern = phalcon_storage_btree_iterator_object_from_obj(Z_OBJ_P(getThis()));
+	phalcon_storage_btree_iterator_revalidate(intern);
+
+	RETURN_BOOL(intern->leaf != NULL);
+}
@@ -38,15 +38,35 @@ int _phalcon_storage_btree_page_create(phalcon_storage_btree_db_t *t,
     p->config = config;
 
     p->buff_ = NULL;
+    p->cached_ = NULL;
     p->is_head = 0;
+    p->shared_ = 0;
 
     *page = p;
     return PHALCON_STORAGE_BTREE_OK;
 }
 
+static void _phalcon_storage_btree_page_release_buff(phalcon_storage_btree_db_t *t, _phalcon_storage_btree_page_t *page)
+{
+    if (page->cached_ != NULL) {
+        _phalcon_storage_btree_cache_release(&t->cache, page->cached_);
+        page->cached_ = NULL;
+    } else if (page->buff_ != NULL) {
+        efree(page->buff_);
+    }
+    page->buff_ = NULL;
+}
+
 void _phalcon_storage_btree_page_destroy(phalcon_storage_btree_db_t *t, _phalcon_storage_btree_page_t *page)
 {
     uint64_t i;
+
+    /* borrowed pages belong to their cache entry */
+    if (page->shared_) {
+        _phalcon_storage_btree_cache_release(&t->cache, page->cached_);
+        return;
+    }
+
     /* Free all keys */
     for (i = 0; i < page->length; i++) {
         if (page->keys[i].allocated) {
@@ -55,10 +75,7 @@ void _phalcon_storage_btree_page_destroy(phalcon_storage_btree_db_t *t, _phalcon
         }
     }
 
-    if (page->buff_ != NULL) {
-        efree(page->buff_);
-        page->buff_ = NULL;
-    }
+    _phalcon_storage_btree_page_release_buff(t, page);
 
     /* Free page itself */
     efree(page);
@@ -87,24 +104,10 @@ int _phalcon_storage_btree_page_clone(phalcon_storage_btree_db_t *t, _phalcon_st
     return ret;
 }
 
-int _phalcon_storage_btree_page_read(phalcon_storage_btree_db_t *t, _phalcon_storage_btree_page_t *page)
+static void _phalcon_storage_btree_page_parse(_phalcon_storage_btree_page_t *page, char *buff, const uint64_t size)
 {
-    int ret;
-    uint64_t size, o;
-    uint64_t i;
-    _phalcon_storage_btree_writer_t *w = (_phalcon_storage_btree_writer_t *) t;
-
-    char *buff = NULL;
+    uint64_t i, o;
 
-    /* Read page size and leaf flag */
-    size = page->config >> 1;
-    page->type = page->config & 1 ? kLeaf : kPage;
-
-    /* Read page data */
-    ret = _phalcon_storage_btree_writer_read(w, kCompressed, page->offset, &size, (void**) &buff);
-    if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
-
-    /* Parse data */
     i = 0;
     o = 0;
     while (o < size) {
@@ -119,11 +122,39 @@ int _phalcon_storage_btree_page_read(phalcon_storage_btree_db_t *t, _phalcon_sto
     }
     page->length = i;
     page->byte_size = size;
+}
 
-    if (page->buff_ != NULL) {
-        efree(page->buff_);
+int _phalcon_storage_btree_page_read(phalcon_storage_btree_db_t *t, _phalcon_storage_btree_page_t *page)
+{
+    int ret;
+    uint64_t size;
+    _phalcon_storage_btree_writer_t *w = (_phalcon_storage_btree_writer_t *) t;
+    _phalcon_storage_btree_cache_entry_t *entry;
+
+    char *buff = NULL;
+
+    /* Read page size and leaf flag */
+    size = page->config >> 1;
+    page->type = page->config & 1 ? kLeaf : kPage;
+
+    /* Hot pages are decoded once and shared by every page struct pointing at them */
+    entry = _phalcon_storage_btree_cache_get(&t->cache, page->offset);
+    if (entry != NULL) {
+        buff = entry->data;
+        size = entry->size;
+    } else {
+        ret = _phalcon_storage_btree_writer_read(w, kCompressed, page->offset, &size, (void**) &buff);
+        if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
+
+        entry = _phalcon_storage_btree_cache_put(&t->cache, page->offset, buff, size);
+        if (entry != NULL) buff = entry->data;
     }
+
+    _phalcon_storage_btree_page_parse(page, buff, size);
+
+    _phalcon_storage_btree_page_release_buff(t, page);
     page->buff_ = buff;
+    page->cached_ = entry;
 
     return PHALCON_STORAGE_BTREE_OK;
 }
@@ -151,6 +182,49 @@ int _phalcon_storage_btree_page_load(phalcon_storage_btree_db_t *t,
     return PHALCON_STORAGE_BTREE_OK;
 }
 
+int _phalcon_storage_btree_page_acquire(phalcon_storage_btree_db_t *t,
+                  const uint64_t offset,
+                  const uint64_t config,
+                  _phalcon_storage_btree_page_t **page)
+{
+    int ret;
+    _phalcon_storage_btree_cache_entry_t *entry;
+    _phalcon_storage_btree_page_t *shared;
+
+    entry = _phalcon_storage_btree_cache_get(&t->cache, offset);
+    if (entry == NULL) {
+        /* miss or cache disabled, the loaded page joins the cache entry it was decoded into */
+        ret = _phalcon_storage_btree_page_load(t, offset, config, page);
+        if (ret != PHALCON_STORAGE_BTREE_OK || (*page)->cached_ == NULL) return ret;
+
+        entry = (*page)->cached_;
+        shared = *page;
+    } else if (entry->page != NULL) {
+        /* hit, the reference taken by _phalcon_storage_btree_cache_get is the caller's */
+        *page = entry->page;
+        return PHALCON_STORAGE_BTREE_OK;
+    } else {
+        ret = _phalcon_storage_btree_page_create(t, config & 1 ? kLeaf : kPage, offset, config, &shared);
+        if (ret != PHALCON_STORAGE_BTREE_OK) {
+            _phalcon_storage_btree_cache_release(&t->cache, entry);
+            return ret;
+        }
+
+        _phalcon_storage_btree_page_parse(shared, entry->data, entry->size);
+        shared->buff_ = entry->data;
+        shared->cached_ = entry;
+    }
+
+    shared->shared_ = 1;
+    *page = _phalcon_storage_btree_cache_share(&t->cache,
+                            entry,
+                            shared,
+                            sizeof(*shared) + sizeof(shared->keys[0]) * (t->head.page_size - 1));
+    if (*page != shared) efree(shared);
+
+    return PHALCON_STORAGE_BTREE_OK;
+}
+
 int _phalcon_storage_btree_page_save(phalcon_storage_btree_db_t *t, _phalcon_storage_btree_page_t *page)
 {
     int ret;
@@ -187,6 +261,15 @@ int _phalcon_storage_btree_page_save(phalcon_storage_btree_db_t *t, _phalcon_sto
                            &page->config);
     page->config = (page->config << 1) | (page->type == kLeaf);
 
+    /* the next lookup through this offset won't have to go to disk */
+    if (ret == PHALCON_STORAGE_BTREE_OK) {
+        _phalcon_storage_btree_cache_entry_t *entry = _phalcon_storage_btree_cache_put(&t->cache, page->offset, buff, page->byte_size);
+        if (entry != NULL) {
+            _phalcon_storage_btree_cache_release(&t->cache, entry);
+            return ret;
+        }
+    }
+
     efree(buff);
     return ret;
 }
@@ -297,8 +380,8 @@ int _phalcon_storage_btree_page_search(phalcon_storage_btree_db_t *t,
         assert(i > 0);
         if (cmp != 0) i--;
 
-        if (type == kLoad) {
-            ret = _phalcon_storage_btree_page_load(t,
+        if (type != kNotLoad) {
+            ret = (type == kBorrow ? _phalcon_storage_btree_page_acquire : _phalcon_storage_btree_page_load)(t,
                                 page->keys[i].offset,
                                 page->keys[i].config,
                                 &child);
@@ -322,7 +405,7 @@ int _phalcon_storage_btree_page_get(phalcon_storage_btree_db_t *t,
 {
     int ret;
     _phalcon_storage_btree_page_search_res_t res;
-    ret = _phalcon_storage_btree_page_search(t, page, key, kLoad, &res);
+    ret = _phalcon_storage_btree_page_search(t, page, key, kBorrow, &res);
     if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
 
     if (res.child == NULL) {
@@ -371,7 +454,7 @@ int _phalcon_storage_btree_page_get_range(phalcon_storage_btree_db_t *t,
             /* load child page and apply range get to it */
             _phalcon_storage_btree_page_t* child;
 
-            ret = _phalcon_storage_btree_page_load(t,
+            ret = _phalcon_storage_btree_page_acquire(t,
                                 page->keys[i].offset,
                                 page->keys[i].config,
                                 &child);
@@ -398,6 +481,61 @@ int _phalcon_storage_btree_page_get_range(phalcon_storage_btree_db_t *t,
     return PHALCON_STORAGE_BTREE_OK;
 }
 
+int _phalcon_storage_btree_page_seek(phalcon_storage_btree_db_t *t,
+                  _phalcon_storage_btree_page_t *page,
+                  const phalcon_storage_btree_key_t *key,
+                  const int inclusive,
+                  _phalcon_storage_btree_page_t **leaf,
+                  uint64_t *index)
+{
+    int ret;
+    uint64_t i;
+    _phalcon_storage_btree_page_search_res_t res;
+
+    ret = _phalcon_storage_btree_page_search(t, page, key, kNotLoad, &res);
+    if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
+
+    if (page->type == kLeaf) {
+        i = res.index;
+        if (i < page->length && res.cmp == 0 && !inclusive) i++;
+        if (i >= page->length) return PHALCON_STORAGE_BTREE_ENOTFOUND;
+
+        /* head page is owned by the tree, hand out a copy of it */
+        if (page->is_head) {
+            ret = _phalcon_storage_btree_page_clone(t, page, leaf);
+            if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
+            (*leaf)->is_head = 0;
+        } else {
+            *leaf = page;
+        }
+        *index = i;
+
+        return PHALCON_STORAGE_BTREE_OK;
+    }
+
+    /* keys of the following children are all greater than the searched one */
+    for (i = res.index; i < page->length; i++) {
+        _phalcon_storage_btree_page_t *child;
+
+        ret = _phalcon_storage_btree_page_acquire(t,
+                            page->keys[i].offset,
+                            page->keys[i].config,
+                            &child);
+        if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
+
+        ret = _phalcon_storage_btree_page_seek(t, child, key, inclusive, leaf, index);
+
+        /* leaf pages found are handed to the caller */
+        if (ret != PHALCON_STORAGE_BTREE_OK || *leaf != child) {
+            _phalcon_storage_btree_page_destroy(t, child);
+        }
+
+        if (ret != PHALCON_STORAGE_BTREE_ENOTFOUND) return ret;
+    }
+
+    return PHALCON_STORAGE_BTREE_ENOTFOUND;
+}
+
 int _phalcon_storage_btree_page_insert(phalcon_storage_btree_db_t *t,
                     _phalcon_storage_btree_page_t *page,
                     const phalcon_storage_btree_key_t *key,
@@ -0,0 +1,74 @@
+#ifndef PHALCON_STORAGE_BTREE_CACHE_H_
+#define PHALCON_STORAGE_BTREE_CACHE_H_
+
+#include "php.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * Decoded page buffers keyed by file offset.
+ * Pages are never rewritten in place, so an offset always maps to the same bytes
+ * and entries need no invalidation until the file is replaced by compaction.
+ */
+typedef struct _phalcon_storage_btree_cache_entry_s _phalcon_storage_btree_cache_entry_t;
+typedef struct _phalcon_storage_btree_cache_s _phalcon_storage_btree_cache_t;
+
+void _phalcon_storage_btree_cache_init(_phalcon_storage_btree_cache_t *cache);
+void _phalcon_storage_btree_cache_destroy(_phalcon_storage_btree_cache_t *cache);
+void _phalcon_storage_btree_cache_clear(_phalcon_storage_btree_cache_t *cache);
+void _phalcon_storage_btree_cache_resize(_phalcon_storage_btree_cache_t *cache, const uint64_t capacity);
+
+/*
+ * Returns a referenced entry or NULL, entries should be given back with _phalcon_storage_btree_cache_release
+ */
+_phalcon_storage_btree_cache_entry_t *_phalcon_storage_btree_cache_get(_phalcon_storage_btree_cache_t *cache, const uint64_t offset);
+
+/*
+ * Takes ownership of data and returns a referenced entry,
+ * returns NULL (data still owned by the caller) when the cache is disabled or data is too large
+ */
+_phalcon_storage_btree_cache_entry_t *_phalcon_storage_btree_cache_put(_phalcon_storage_btree_cache_t *cache,
+                    const uint64_t offset,
+                    char *data,
+                    const uint64_t size);
+void _phalcon_storage_btree_cache_release(_phalcon_storage_btree_cache_t *cache, _phalcon_storage_btree_cache_entry_t *entry);
+
+/*
+ * Attaches a read-only page decoded from the entry's data, freed together with the entry.
+ * Returns the page attached first when another reader won the race (the caller frees its own)
+ */
+struct _phalcon_storage_btree_page_s *_phalcon_storage_btree_cache_share(_phalcon_storage_btree_cache_t *cache,
+                    _phalcon_storage_btree_cache_entry_t *entry,
+                    struct _phalcon_storage_btree_page_s *page,
+                    const uint64_t size);
+
+struct _phalcon_storage_btree_cache_entry_s {
+    uint64_t offset;
+    uint64_t size;
+    char *data;
+
+    /* decoded page handed out to readers without copying */
+    struct _phalcon_storage_btree_page_s *page;
+    uint64_t page_size;
+
+    uint32_t refcount;
+    int linked;
+
+    _phalcon_storage_btree_cache_entry_t *prev;
+    _phalcon_storage_btree_cache_entry_t *next;
+};
+
+struct _phalcon_storage_btree_cache_s {
+    HashTable *entries;
+
+    _phalcon_storage_btree_cache_entry_t *head;
+    _phalcon_storage_btree_cache_entry_t *tail;
+
+    uint64_t capacity;
+    uint64_t used;
+
+    pthread_mutex_t mutex;
+};
+
+#endif /* PHALCON_STORAGE_BTREE_CACHE_H_ */
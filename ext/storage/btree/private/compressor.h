@@ -2,40 +2,269 @@
 #define PHALCON_STORAGE_BTREE_COMPRESSOR_H_
 
 #include "storage/btree/private/errors.h"
+#include "storage/btree/private/writer.h"
+#include "storage/btree/private/utils.h"
+
+#include "php.h"
+#include "ext/standard/crc32.h"
 
 #include <unistd.h> /* size_t */
 #include <string.h> /* memcpy */
+#include <arpa/inet.h> /* htonl, ntohl */
+
+#ifdef PHALCON_USE_LZ4
+# include <lz4.h>
+#endif
+
+#ifdef PHALCON_USE_ZSTD
+# include <zstd.h>
+#endif
+
+/*
+ * Files created by codec-aware writers wrap every page and value in a frame:
+ *
+ *   | codec (1) | reserved (3) | crc32 (4) | uncompressed length (8) | payload |
+ *
+ * The crc32 covers the other header fields as well as the payload, so a damaged length is caught
+ * before anything is allocated from it.
+ * Frames are self-describing, so a file may mix codecs after being reopened with another one.
+ * Files written before frames existed carry kCodecLegacy in their head and are read as is.
+ */
+#define PHALCON_STORAGE_BTREE__FRAME_SIZE 16
+
+#ifndef PHALCON_STORAGE_BTREE_ZSTD_LEVEL
+# define PHALCON_STORAGE_BTREE_ZSTD_LEVEL 1
+#endif
+
+static inline int _phalcon_storage_btree_codec_available(const int codec)
+{
+    switch (codec) {
+        case kCodecStore:
+            return 1;
+#ifdef PHALCON_USE_LZ4
+        case kCodecLz4:
+            return 1;
+#endif
+#ifdef PHALCON_USE_ZSTD
+        case kCodecZstd:
+            return 1;
+#endif
+        default:
+            return 0;
+    }
+}
+
+static inline uint32_t _phalcon_storage_btree_checksum(uint32_t crc, const char *data, size_t length)
+{
+    const unsigned char *p = (const unsigned char *) data;
 
-static inline size_t _phalcon_storage_btree_max_compressed_size(size_t size)
+    while (length--) {
+        CRC32(crc, *p++);
+    }
+
+    return crc;
+}
+
+static inline uint32_t _phalcon_storage_btree_frame_checksum(const char *frame, size_t payload_length)
+{
+    uint32_t crc = 0xFFFFFFFF;
+
+    crc = _phalcon_storage_btree_checksum(crc, frame, 4);
+    crc = _phalcon_storage_btree_checksum(crc, frame + 8, PHALCON_STORAGE_BTREE__FRAME_SIZE - 8 + payload_length);
+
+    return ~crc;
+}
+
+static inline size_t _phalcon_storage_btree_max_compressed_size(const int codec, size_t size)
 {
-    return size;
+    size_t bound = size;
+
+    if (codec == kCodecLegacy) {
+        return size;
+    }
+
+#ifdef PHALCON_USE_LZ4
+    if (codec == kCodecLz4) {
+        bound = (size_t) LZ4_compressBound((int) size);
+    }
+#endif
+#ifdef PHALCON_USE_ZSTD
+    if (codec == kCodecZstd) {
+        bound = ZSTD_compressBound(size);
+    }
+#endif
+
+    /* incompressible data is stored as is, so the bound is never below the input */
+    return PHALCON_STORAGE_BTREE__FRAME_SIZE + (bound > size ? bound : size);
 }
 
-static inline int _phalcon_storage_btree_compress(const char *input,
+static inline int _phalcon_storage_btree_compress(const int codec,
+                 const char *input,
                  size_t input_length,
                  char *compressed,
                  size_t *compressed_length)
 {
-    memcpy(compressed, input, input_length);
-    *compressed_length = input_length;
+    char *payload = compressed + PHALCON_STORAGE_BTREE__FRAME_SIZE;
+    size_t capacity, payload_length = 0;
+    int used = kCodecStore;
+
+    if (codec == kCodecLegacy) {
+        memcpy(compressed, input, input_length);
+        *compressed_length = input_length;
+        return PHALCON_STORAGE_BTREE_OK;
+    }
+
+    if (*compressed_length < PHALCON_STORAGE_BTREE__FRAME_SIZE + input_length) {
+        return PHALCON_STORAGE_BTREE_ECOMP;
+    }
+    capacity = *compressed_length - PHALCON_STORAGE_BTREE__FRAME_SIZE;
+
+#ifdef PHALCON_USE_LZ4
+    if (codec == kCodecLz4) {
+        int result = LZ4_compress_default(input, payload, (int) input_length, (int) capacity);
+        if (result > 0) {
+            payload_length = (size_t) result;
+            used = kCodecLz4;
+        }
+    }
+#endif
+#ifdef PHALCON_USE_ZSTD
+    if (codec == kCodecZstd) {
+        size_t result = ZSTD_compress(payload, capacity, input, input_length, PHALCON_STORAGE_BTREE_ZSTD_LEVEL);
+        if (!ZSTD_isError(result)) {
+            payload_length = result;
+            used = kCodecZstd;
+        }
+    }
+#endif
+
+    /* keep the raw bytes when the codec does not pay off */
+    if (used == kCodecStore || payload_length >= input_length) {
+        memcpy(payload, input, input_length);
+        payload_length = input_length;
+        used = kCodecStore;
+    }
+
+    memset(compressed, 0, PHALCON_STORAGE_BTREE__FRAME_SIZE);
+    compressed[0] = (char) used;
+    *(uint64_t *) (compressed + 8) = _phalcon_htonll((uint64_t) input_length);
+    *(uint32_t *) (compressed + 4) = htonl(_phalcon_storage_btree_frame_checksum(compressed, payload_length));
+
+    *compressed_length = PHALCON_STORAGE_BTREE__FRAME_SIZE + payload_length;
     return PHALCON_STORAGE_BTREE_OK;
 }
 
-static inline int _phalcon_storage_btree_uncompressed_length(const char *compressed,
+/*
+ * Validates the frame and returns the size of the buffer _phalcon_storage_btree_uncompress needs,
+ * the length is only trusted once the checksum matched and it is plausible for the codec.
+ */
+static inline int _phalcon_storage_btree_uncompressed_length(const int codec,
+                            const char *compressed,
                             size_t compressed_length,
                             size_t *result)
 {
-    *result = compressed_length;
+    size_t payload_length;
+    uint64_t expected;
+
+    if (codec == kCodecLegacy) {
+        *result = compressed_length;
+        return PHALCON_STORAGE_BTREE_OK;
+    }
+
+    if (compressed_length < PHALCON_STORAGE_BTREE__FRAME_SIZE) {
+        return PHALCON_STORAGE_BTREE_EDECOMP;
+    }
+
+    payload_length = compressed_length - PHALCON_STORAGE_BTREE__FRAME_SIZE;
+    expected = _phalcon_ntohll(*(uint64_t *) (compressed + 8));
+
+    /* torn or corrupted writes must never reach the allocator or the decoder */
+    if (ntohl(*(uint32_t *) (compressed + 4)) != _phalcon_storage_btree_frame_checksum(compressed, payload_length)) {
+        return PHALCON_STORAGE_BTREE_ECHECKSUM;
+    }
+
+    switch ((unsigned char) compressed[0]) {
+        case kCodecStore:
+            if (expected != payload_length) return PHALCON_STORAGE_BTREE_EDECOMP;
+            break;
+#ifdef PHALCON_USE_LZ4
+        case kCodecLz4:
+            /* a lz4 sequence never expands more than 255 times */
+            if (expected > (uint64_t) LZ4_MAX_INPUT_SIZE || expected > (uint64_t) payload_length * 255) {
+                return PHALCON_STORAGE_BTREE_EDECOMP;
+            }
+            break;
+#endif
+#ifdef PHALCON_USE_ZSTD
+        case kCodecZstd:
+            /* ZSTD_compress records the content size in the frame */
+            if (ZSTD_getFrameContentSize(compressed + PHALCON_STORAGE_BTREE__FRAME_SIZE, payload_length) != expected) {
+                return PHALCON_STORAGE_BTREE_EDECOMP;
+            }
+            break;
+#endif
+        default:
+            return PHALCON_STORAGE_BTREE_EDECOMP;
+    }
+
+    *result = (size_t) expected;
     return PHALCON_STORAGE_BTREE_OK;
 }
 
-static inline int _phalcon_storage_btree_uncompress(const char *compressed,
+/*
+ * Expects a frame already validated by _phalcon_storage_btree_uncompressed_length
+ */
+
+static inline int _phalcon_storage_btree_uncompress(const int codec,
+                   const char *compressed,
                    size_t compressed_length,
                    char *uncompressed,
                    size_t *uncompressed_length)
 {
-    memcpy(uncompressed, compressed, compressed_length);
-    *uncompressed_length = compressed_length;
+    const char *payload = compressed + PHALCON_STORAGE_BTREE__FRAME_SIZE;
+    size_t payload_length, expected;
+
+    if (codec == kCodecLegacy) {
+        memcpy(uncompressed, compressed, compressed_length);
+        *uncompressed_length = compressed_length;
+        return PHALCON_STORAGE_BTREE_OK;
+    }
+
+    if (compressed_length < PHALCON_STORAGE_BTREE__FRAME_SIZE) {
+        return PHALCON_STORAGE_BTREE_EDECOMP;
+    }
+
+    payload_length = compressed_length - PHALCON_STORAGE_BTREE__FRAME_SIZE;
+    expected = (size_t) _phalcon_ntohll(*(uint64_t *) (compressed + 8));
+
+    if (expected > *uncompressed_length) {
+        return PHALCON_STORAGE_BTREE_EDECOMP;
+    }
+
+    switch ((unsigned char) compressed[0]) {
+        case kCodecStore:
+            if (payload_length != expected) return PHALCON_STORAGE_BTREE_EDECOMP;
+            memcpy(uncompressed, payload, payload_length);
+            break;
+#ifdef PHALCON_USE_LZ4
+        case kCodecLz4:
+            if (LZ4_decompress_safe(payload, uncompressed, (int) payload_length, (int) expected) != (int) expected) {
+                return PHALCON_STORAGE_BTREE_EDECOMP;
+            }
+            break;
+#endif
+#ifdef PHALCON_USE_ZSTD
+        case kCodecZstd:
+            if (ZSTD_decompress(uncompressed, expected, payload, payload_length) != expected) {
+                return PHALCON_STORAGE_BTREE_EDECOMP;
+            }
+            break;
+#endif
+        default:
+            return PHALCON_STORAGE_BTREE_EDECOMP;
+    }
+
+    *uncompressed_length = expected;
     return PHALCON_STORAGE_BTREE_OK;
 }
 
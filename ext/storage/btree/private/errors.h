@@ -13,6 +13,8 @@
 
 #define PHALCON_STORAGE_BTREE_ECOMP           0x201
 #define PHALCON_STORAGE_BTREE_EDECOMP         0x202
+#define PHALCON_STORAGE_BTREE_ECHECKSUM       0x203
+#define PHALCON_STORAGE_BTREE_ECODEC          0x204
 
 #define PHALCON_STORAGE_BTREE_EALLOC          0x301
 #define PHALCON_STORAGE_BTREE_EMUTEX          0x302
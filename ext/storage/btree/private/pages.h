@@ -14,7 +14,8 @@ enum page_type {
 
 enum search_type {
     kNotLoad = 0,
-    kLoad = 1
+    kLoad = 1,
+    kBorrow = 2
 };
 
 int _phalcon_storage_btree_page_create(phalcon_storage_btree_db_t *t,
@@ -32,6 +33,15 @@ int _phalcon_storage_btree_page_load(phalcon_storage_btree_db_t *t,
                   _phalcon_storage_btree_page_t **page);
 int _phalcon_storage_btree_page_save(phalcon_storage_btree_db_t *t, _phalcon_storage_btree_page_t *page);
 
+/*
+ * Read-only variant of _phalcon_storage_btree_page_load, a cached page is borrowed without copying.
+ * The page must not be modified and is given back with _phalcon_storage_btree_page_destroy
+ */
+int _phalcon_storage_btree_page_acquire(phalcon_storage_btree_db_t *t,
+                  const uint64_t offset,
+                  const uint64_t config,
+                  _phalcon_storage_btree_page_t **page);
+
 int _phalcon_storage_btree_page_load_value(phalcon_storage_btree_db_t *t,
                         _phalcon_storage_btree_page_t *page,
                         const uint64_t index,
@@ -61,6 +71,12 @@ int _phalcon_storage_btree_page_get_range(phalcon_storage_btree_db_t *t,
                        phalcon_storage_btree_filter_cb filter,
                        phalcon_storage_btree_range_cb cb,
                        void *arg);
+int _phalcon_storage_btree_page_seek(phalcon_storage_btree_db_t *t,
+                  _phalcon_storage_btree_page_t *page,
+                  const phalcon_storage_btree_key_t *key,
+                  const int inclusive,
+                  _phalcon_storage_btree_page_t **leaf,
+                  uint64_t *index);
 int _phalcon_storage_btree_page_insert(phalcon_storage_btree_db_t *t,
                     _phalcon_storage_btree_page_t *page,
                     const phalcon_storage_btree_key_t *key,
@@ -102,7 +118,9 @@ struct _phalcon_storage_btree_page_s {
     uint64_t config;
 
     void *buff_;
+    _phalcon_storage_btree_cache_entry_t *cached_;
     int is_head;
+    int shared_;
 
     _phalcon_storage_btree_kv_t keys[1];
 };
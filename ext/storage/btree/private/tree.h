@@ -2,16 +2,20 @@
 #define PHALCON_STORAGE_BTREE_TREE_H_
 
 #include "storage/btree/private/writer.h"
+#include "storage/btree/private/cache.h"
 #include "storage/btree/private/pages.h"
 
 #include <pthread.h>
 
 #define PHALCON_STORAGE_BTREE__HEAD_SIZE  sizeof(uint64_t) * 4
+#define PHALCON_STORAGE_BTREE__HEAD_CODEC_SHIFT 56
 
 #define PHALCON_STORAGE_BTREE_TREE_PRIVATE         \
     PHALCON_STORAGE_BTREE_WRITER_PRIVATE           \
     pthread_rwlock_t rwlock;    \
     _phalcon_storage_btree_tree_head_t head;       \
+    _phalcon_storage_btree_cache_t cache;          \
+    uint64_t generation;        \
     phalcon_storage_btree_compare_cb compare_cb;
 
 typedef struct _phalcon_storage_btree_tree_head_s _phalcon_storage_btree_tree_head_t;
@@ -7,8 +7,15 @@
     int fd;                     \
     char *filename;             \
     uint64_t filesize;          \
+    int codec;                  \
+    int use_mmap;               \
+    char *map;                  \
+    uint64_t map_size;          \
     char padding[PHALCON_STORAGE_BTREE_PADDING];
 
+/* remap after 1MB or an eighth of the mapping has been appended, whichever is larger */
+#define PHALCON_STORAGE_BTREE__REMAP_THRESHOLD(size) ((size) >> 3 > 1048576 ? (size) >> 3 : 1048576)
+
 typedef struct _phalcon_storage_btree_writer_s _phalcon_storage_btree_writer_t;
 typedef int (*_phalcon_storage_btree_writer_cb)(_phalcon_storage_btree_writer_t *w, void *data);
 
@@ -17,9 +24,27 @@ enum comp_type {
     kCompressed = 1
 };
 
+enum codec_type {
+    kCodecLegacy = 0,
+    kCodecStore = 1,
+    kCodecLz4 = 2,
+    kCodecZstd = 3
+};
+
+#ifdef PHALCON_USE_LZ4
+# define PHALCON_STORAGE_BTREE_DEFAULT_CODEC kCodecLz4
+#elif defined(PHALCON_USE_ZSTD)
+# define PHALCON_STORAGE_BTREE_DEFAULT_CODEC kCodecZstd
+#else
+# define PHALCON_STORAGE_BTREE_DEFAULT_CODEC kCodecStore
+#endif
+
 int _phalcon_storage_btree_writer_create(_phalcon_storage_btree_writer_t *w, const char *filename);
 int _phalcon_storage_btree_writer_destroy(_phalcon_storage_btree_writer_t *w);
 
+int _phalcon_storage_btree_writer_map(_phalcon_storage_btree_writer_t *w);
+void _phalcon_storage_btree_writer_unmap(_phalcon_storage_btree_writer_t *w);
+
 int _phalcon_storage_btree_writer_fsync(_phalcon_storage_btree_writer_t *w);
 
 int _phalcon_storage_btree_writer_compact_name(_phalcon_storage_btree_writer_t *w, char **compact_name);
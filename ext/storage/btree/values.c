@@ -23,6 +23,11 @@ int _phalcon_storage_btree_value_load(phalcon_storage_btree_db_t *t,
                           (void **) &buff);
     if (ret != PHALCON_STORAGE_BTREE_OK) return ret;
 
+    if (buff_len < 16) {
+        efree(buff);
+        return PHALCON_STORAGE_BTREE_EFILEREAD;
+    }
+
     value->value = emalloc(buff_len - 16);
     if (value->value == NULL) {
         efree(buff);
@@ -4,6 +4,7 @@
 
 #include "kernel/main.h"
 
+#include <sys/mman.h> /* mmap, munmap */
 #include <fcntl.h> /* open */
 #include <unistd.h> /* close, write, read */
 #include <sys/stat.h> /* S_IWUSR, S_IRUSR */
@@ -33,6 +34,10 @@ int _phalcon_storage_btree_writer_create(_phalcon_storage_btree_writer_t *w, con
 
     w->filesize = (uint64_t) filesize;
 
+    w->map = NULL;
+    w->map_size = 0;
+    if (w->use_mmap) _phalcon_storage_btree_writer_map(w);
+
     /* Nullify padding to shut up valgrind */
     memset(&w->padding, 0, sizeof(w->padding));
 
@@ -45,12 +50,40 @@ error:
 
 int _phalcon_storage_btree_writer_destroy(_phalcon_storage_btree_writer_t *w)
 {
+    _phalcon_storage_btree_writer_unmap(w);
     efree(w->filename);
     w->filename = NULL;
     if (close(w->fd)) return PHALCON_STORAGE_BTREE_EFILE;
     return PHALCON_STORAGE_BTREE_OK;
 }
 
+int _phalcon_storage_btree_writer_map(_phalcon_storage_btree_writer_t *w)
+{
+    void *map;
+
+    if (w->filesize == 0 || w->filesize == w->map_size) return PHALCON_STORAGE_BTREE_OK;
+
+    /* the file is append-only, so everything below filesize is immutable */
+    map = mmap(NULL, (size_t) w->filesize, PROT_READ, MAP_SHARED, w->fd, 0);
+    if (map == MAP_FAILED) return PHALCON_STORAGE_BTREE_EFILE;
+
+    _phalcon_storage_btree_writer_unmap(w);
+
+    w->map = (char *) map;
+    w->map_size = w->filesize;
+
+    return PHALCON_STORAGE_BTREE_OK;
+}
+
+void _phalcon_storage_btree_writer_unmap(_phalcon_storage_btree_writer_t *w)
+{
+    if (w->map != NULL) {
+        munmap(w->map, (size_t) w->map_size);
+        w->map = NULL;
+        w->map_size = 0;
+    }
+}
+
 int _phalcon_storage_btree_writer_fsync(_phalcon_storage_btree_writer_t *w)
 {
 #ifdef F_FULLFSYNC
@@ -81,14 +114,18 @@ int _phalcon_storage_btree_writer_compact_finalize(_phalcon_storage_btree_writer
     int ret;
     char *name, *compacted_name;
 
+    /* the compacted file may have been written with another codec */
+    s->codec = t->codec;
+
     /* save filename and prevent efreeing it */
     name = s->filename;
     compacted_name = t->filename;
     s->filename = NULL;
     t->filename = NULL;
 
-    /* close both trees */
+    /* close both trees, cached pages point into the replaced file */
     _phalcon_storage_btree_destroy((phalcon_storage_btree_db_t *) s);
+    _phalcon_storage_btree_cache_clear(&((phalcon_storage_btree_db_t *) s)->cache);
     ret = phalcon_storage_btree_close((phalcon_storage_btree_db_t *) t);
     if (ret != PHALCON_STORAGE_BTREE_OK) goto fatal;
 
@@ -113,7 +150,7 @@ int _phalcon_storage_btree_writer_read(_phalcon_storage_btree_writer_t *w,
                     void **data)
 {
     ssize_t bytes_read;
-    char *cdata;
+    char *cdata, *owned = NULL;
 
     if (w->filesize < offset + *size) return PHALCON_STORAGE_BTREE_EFILEREAD_OOB;
 
@@ -123,39 +160,49 @@ int _phalcon_storage_btree_writer_read(_phalcon_storage_btree_writer_t *w,
         return PHALCON_STORAGE_BTREE_OK;
     }
 
-    cdata = emalloc(*size);
-    if (cdata == NULL) return PHALCON_STORAGE_BTREE_EALLOC;
+    if (w->map != NULL && offset + *size <= w->map_size) {
+        /* decode straight from the mapping, no syscall and no intermediate copy */
+        cdata = w->map + offset;
+    } else {
+        owned = cdata = emalloc(*size);
+        if (cdata == NULL) return PHALCON_STORAGE_BTREE_EALLOC;
 
-    bytes_read = pread(w->fd, cdata, (size_t) *size, (off_t) offset);
-    if ((uint64_t) bytes_read != *size) {
-        efree(cdata);
-        return PHALCON_STORAGE_BTREE_EFILEREAD;
+        bytes_read = pread(w->fd, cdata, (size_t) *size, (off_t) offset);
+        if ((uint64_t) bytes_read != *size) {
+            efree(cdata);
+            return PHALCON_STORAGE_BTREE_EFILEREAD;
+        }
     }
 
     /* no compression for head */
     if (comp == kNotCompressed) {
-        *data = cdata;
+        if (owned == NULL) {
+            owned = emalloc(*size);
+            memcpy(owned, cdata, (size_t) *size);
+        }
+        *data = owned;
     } else {
         int ret = 0;
 
         char *uncompressed = NULL;
         size_t usize;
 
-        if (_phalcon_storage_btree_uncompressed_length(cdata, *size, &usize) != PHALCON_STORAGE_BTREE_OK) {
-            ret = PHALCON_STORAGE_BTREE_EDECOMP;
-        } else {
+        /* checksum mismatches are reported apart from decoder failures */
+        ret = _phalcon_storage_btree_uncompressed_length(w->codec, cdata, *size, &usize);
+        if (ret == PHALCON_STORAGE_BTREE_OK) {
             uncompressed = emalloc(usize);
             if (uncompressed == NULL) {
                 ret = PHALCON_STORAGE_BTREE_EALLOC;
-            } else if (_phalcon_storage_btree_uncompress(cdata, *size, uncompressed, &usize) != PHALCON_STORAGE_BTREE_OK) {
-                ret = PHALCON_STORAGE_BTREE_EDECOMP;
             } else {
-                *data = uncompressed;
-                *size = usize;
+                ret = _phalcon_storage_btree_uncompress(w->codec, cdata, *size, uncompressed, &usize);
+                if (ret == PHALCON_STORAGE_BTREE_OK) {
+                    *data = uncompressed;
+                    *size = usize;
+                }
             }
         }
 
-        efree(cdata);
+        if (owned != NULL) efree(owned);
 
         if (ret != PHALCON_STORAGE_BTREE_OK) {
             efree(uncompressed);
@@ -193,13 +240,13 @@ int _phalcon_storage_btree_writer_write(_phalcon_storage_btree_writer_t *w,
         written = write(w->fd, data, *size);
     } else {
         int ret;
-        size_t max_csize = _phalcon_storage_btree_max_compressed_size(*size);
+        size_t max_csize = _phalcon_storage_btree_max_compressed_size(w->codec, *size);
         size_t result_size;
         char *compressed = emalloc(max_csize);
         if (compressed == NULL) return PHALCON_STORAGE_BTREE_EALLOC;
 
         result_size = max_csize;
-        ret = _phalcon_storage_btree_compress(data, *size, compressed, &result_size);
+        ret = _phalcon_storage_btree_compress(w->codec, data, *size, compressed, &result_size);
         if (ret != PHALCON_STORAGE_BTREE_OK) {
             efree(compressed);
             return PHALCON_STORAGE_BTREE_ECOMP;
@@ -52,6 +52,7 @@ ZEND_END_ARG_INFO()
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_datrie_search, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, str, IS_STRING, 0)
 	ZEND_ARG_TYPE_INFO(0, all, _IS_BOOL, 1)
+	ZEND_ARG_TYPE_INFO(0, chars, _IS_BOOL, 1)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_datrie_add, 0, 0, 1)
@@ -94,7 +95,21 @@ zend_object* phalcon_storage_datrie_object_create_handler(zend_class_entry *ce)
 void phalcon_storage_datrie_object_free_handler(zend_object *object)
 {
 	phalcon_storage_datrie_object *intern = phalcon_storage_datrie_object_from_obj(object);
+	if (intern->matcher) ac_matcher_free(intern->matcher);
 	if (intern->trie) trie_free(intern->trie);
+
+	zend_object_std_dtor(object);
+}
+
+/**
+ * The automaton is a snapshot of the keys, drop it whenever the trie changes
+ */
+static void phalcon_storage_datrie_invalidate(phalcon_storage_datrie_object *intern)
+{
+	if (intern->matcher) {
+		ac_matcher_free(intern->matcher);
+		intern->matcher = NULL;
+	}
 }
 
 /**
@@ -125,7 +140,15 @@ PHP_METHOD(Phalcon_Storage_Datrie, __construct)
 
 	intern = phalcon_storage_datrie_object_from_obj(Z_OBJ_P(getThis()));
 	if (phalcon_file_exists(filename) == SUCCESS) {
-		intern->trie = trie_new_from_file(Z_STRVAL_P(filename));
+		FILE *file = fopen(Z_STRVAL_P(filename), "rb");
+		if (file) {
+			intern->trie = trie_fread(file);
+			/* files saved by older versions have no automaton, it is built on first search */
+			if (intern->trie) {
+				intern->matcher = ac_matcher_fread(file);
+			}
+			fclose(file);
+		}
 		if (!intern->trie) {
 			PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Unable to load %s", Z_STRVAL_P(filename));
 			return;
@@ -165,90 +188,119 @@ PHP_METHOD(Phalcon_Storage_Datrie, __construct)
 	}
 }
 
-static int phalcon_storage_datrie_search(zval *return_value, Trie *trie, const AlphaChar *text, zend_bool all)
+typedef struct {
+	zval *matches;
+	zend_bool all;
+	zend_bool chars;
+	const unsigned char *text;
+	size_t scanned;
+	size_t position;
+} phalcon_storage_datrie_match_ctx;
+
+static Bool phalcon_storage_datrie_match(size_t end, int length, int chars, TrieData data, void *user_data)
 {
-	TrieState *s;
-	const AlphaChar *p;
-	const AlphaChar *base;
-	int ret = 0;
-
-	base = text;
-	if (! (s = trie_root(trie))) {
-		return -1;
+	phalcon_storage_datrie_match_ctx *ctx = (phalcon_storage_datrie_match_ctx *) user_data;
+	zval word = {};
+
+	array_init_size(&word, 2);
+	if (ctx->chars) {
+		/* count code points up to the end of the match, the text is only scanned once */
+		while (ctx->scanned < end) {
+			if ((ctx->text[ctx->scanned++] & 0xC0) != 0x80) {
+				ctx->position++;
+			}
+		}
+		add_next_index_long(&word, ctx->position - chars);
+		add_next_index_long(&word, chars);
+	} else {
+		add_next_index_long(&word, end - length);
+		add_next_index_long(&word, length);
 	}
+	add_next_index_zval(ctx->matches, &word);
 
-	while (*text) {   
-		p = text;
-		if(! trie_state_is_walkable(s, *p)) {
-			trie_state_rewind(s);
-			text++;
-			continue;
-		}
+	return ctx->all ? TRUE : FALSE;
+}
 
-		while(*p && trie_state_is_walkable(s, *p) && ! trie_state_is_leaf(s)) {
-			trie_state_walk(s, *p++);  
-			if (trie_state_is_terminal(s)) {
-				zval word = {};
-				array_init(&word);
-				add_next_index_long(&word, text - base);
-				add_next_index_long(&word, p - text);
-				add_next_index_zval(return_value, &word);
-				ret++;
-				if (!all) {
-					return ret;
-				}
-			}		
-		}
-		trie_state_rewind(s);
-		text++;
+static int phalcon_storage_datrie_compare_matches(const void *a, const void *b)
+{
+	zval *first = &((Bucket *) a)->val, *second = &((Bucket *) b)->val;
+	zend_long offset_a, offset_b, length_a, length_b;
+
+	offset_a = Z_LVAL_P(zend_hash_index_find(Z_ARRVAL_P(first), 0));
+	offset_b = Z_LVAL_P(zend_hash_index_find(Z_ARRVAL_P(second), 0));
+	if (offset_a != offset_b) {
+		return offset_a < offset_b ? -1 : 1;
+	}
+
+	length_a = Z_LVAL_P(zend_hash_index_find(Z_ARRVAL_P(first), 1));
+	length_b = Z_LVAL_P(zend_hash_index_find(Z_ARRVAL_P(second), 1));
+	if (length_a != length_b) {
+		return length_a < length_b ? -1 : 1;
 	}
-	trie_state_free(s);
 
-	return ret;
+	return 0;
 }
 
 /**
- * Search
+ * Search the keywords occurring in a text
+ *
+ * The text is scanned once through an Aho-Corasick automaton built from the keywords,
+ * whatever their number. Each match is returned as array(offset, length), ordered by offset,
+ * when $all is false only the first match to end is returned
+ *
+ *<code>
+ * $trie->add('敏感');
+ * $trie->search('一些敏感内容', true);        // array(array(6, 6))
+ * $trie->search('一些敏感内容', true, true);  // array(array(2, 2))
+ *</code>
  *
  * @param string $str
  * @param boolean $all
+ * @param boolean $chars offsets and lengths in UTF-8 code points instead of bytes
  * @return array|boolean
  */
 PHP_METHOD(Phalcon_Storage_Datrie, search)
 {
-	zval *str, *all = NULL;
-	AlphaChar *alpha_text;
+	zval *str, *all = NULL, *chars = NULL;
 	phalcon_storage_datrie_object *intern;
-	int i, ret;
-
-	phalcon_fetch_params(0, 1, 1, &str, &all);
+	phalcon_storage_datrie_match_ctx ctx;
+	int ret;
 
-	if (!all) {
-		all = &PHALCON_GLOBAL(z_false);
-	}
+	phalcon_fetch_params(0, 1, 2, &str, &all, &chars);
 
 	if (PHALCON_IS_EMPTY(str)) {
 		RETURN_FALSE;
 	}
 
-	array_init(return_value);
-
 	intern = phalcon_storage_datrie_object_from_obj(Z_OBJ_P(getThis()));
 
-	alpha_text = emalloc(sizeof(AlphaChar) * (Z_STRLEN_P(str) + 1));
-
-	for (i = 0; i < Z_STRLEN_P(str); i++) {
-		alpha_text[i] = (AlphaChar) Z_STRVAL_P(str)[i];
+	if (!intern->matcher) {
+		intern->matcher = ac_matcher_new(intern->trie);
+		if (!intern->matcher) {
+			PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Unable to build the search automaton");
+			return;
+		}
 	}
 
-	alpha_text[Z_STRLEN_P(str)] = TRIE_CHAR_TERM;
+	array_init(return_value);
+
+	ctx.matches = return_value;
+	ctx.all = all && zend_is_true(all);
+	ctx.chars = chars && zend_is_true(chars);
+	ctx.text = (const unsigned char *) Z_STRVAL_P(str);
+	ctx.scanned = 0;
+	ctx.position = 0;
 
-	ret = phalcon_storage_datrie_search(return_value, intern->trie, alpha_text, zend_is_true(all));
-	efree(alpha_text);
+	ret = ac_matcher_match(intern->matcher, ctx.text, Z_STRLEN_P(str), phalcon_storage_datrie_match, &ctx);
 	if (ret <= 0) {
 		zval_ptr_dtor(return_value);
 		RETURN_FALSE;
 	}
+
+	/* matches are found by their end, keep returning them by offset */
+	if (ret > 1) {
+		zend_hash_sort(Z_ARRVAL_P(return_value), phalcon_storage_datrie_compare_matches, 1);
+	}
 }
 
 /**
@@ -281,6 +333,8 @@ PHP_METHOD(Phalcon_Storage_Datrie, add)
 
 	alpha_key[Z_STRLEN_P(keyword)] = TRIE_CHAR_TERM;
 
+	phalcon_storage_datrie_invalidate(intern);
+
 	if (!trie_store(intern->trie, alpha_key, data)) {
         RETVAL_FALSE;
     }
@@ -355,6 +409,8 @@ PHP_METHOD(Phalcon_Storage_Datrie, delete)
 
 	alpha_key[Z_STRLEN_P(keyword)] = TRIE_CHAR_TERM;
 
+	phalcon_storage_datrie_invalidate(intern);
+
 	if (!trie_delete(intern->trie, alpha_key)) {
 		RETVAL_FALSE;
 	} else {
@@ -372,14 +428,26 @@ PHP_METHOD(Phalcon_Storage_Datrie, save)
 {
 	zval file = {};
 	phalcon_storage_datrie_object *intern;
+	FILE *fp;
 
 	phalcon_read_property(&file, getThis(), SL("_filename"), PH_NOISY|PH_READONLY);
 
 	intern = phalcon_storage_datrie_object_from_obj(Z_OBJ_P(getThis()));
 
-	if (trie_save(intern->trie, Z_STRVAL(file)) != 0) {
+	if (!intern->matcher) {
+		intern->matcher = ac_matcher_new(intern->trie);
+	}
+
+	fp = fopen(Z_STRVAL(file), "wb+");
+	if (!fp) {
+		RETURN_FALSE;
+	}
+
+	/* the automaton follows the trie data, so the file stays readable by trie_new_from_file */
+	if (trie_fwrite(intern->trie, fp) != 0 || (intern->matcher && ac_matcher_fwrite(intern->matcher, fp) != 0)) {
 		RETVAL_FALSE;
 	} else {
 		RETVAL_TRUE;
 	}
+	fclose(fp);
 }
@@ -23,9 +23,11 @@
 
 #include "php_phalcon.h"
 #include "kernel/datrie/trie.h"
+#include "kernel/datrie/acmatcher.h"
 
 typedef struct {
 	Trie *trie;
+	ACMatcher *matcher;
 	zend_object std;
 } phalcon_storage_datrie_object;
 
@@ -34,6 +34,9 @@
 #include "kernel/operators.h"
 #include "kernel/file.h"
 #include "kernel/exception.h"
+#include "kernel/time.h"
+
+#include "internal/arginfo.h"
 
 /**
  * Phalcon\Storage\Leveldb
@@ -47,6 +50,9 @@ PHP_METHOD(Phalcon_Storage_Leveldb, put);
 PHP_METHOD(Phalcon_Storage_Leveldb, write);
 PHP_METHOD(Phalcon_Storage_Leveldb, delete);
 PHP_METHOD(Phalcon_Storage_Leveldb, iterator);
+PHP_METHOD(Phalcon_Storage_Leveldb, setBatching);
+PHP_METHOD(Phalcon_Storage_Leveldb, flush);
+PHP_METHOD(Phalcon_Storage_Leveldb, pending);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_leveldb___construct, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
@@ -73,17 +79,35 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_leveldb_delete, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, options, IS_ARRAY, 1)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_leveldb_iterator, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, options, IS_ARRAY, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_leveldb_setbatching, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, size, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, interval, IS_DOUBLE, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_leveldb_flush, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, sync, _IS_BOOL, 1)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry phalcon_storage_leveldb_method_entry[] = {
 	PHP_ME(Phalcon_Storage_Leveldb, __construct, arginfo_phalcon_storage_leveldb___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Storage_Leveldb, get, arginfo_phalcon_storage_leveldb_get, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Leveldb, put, arginfo_phalcon_storage_leveldb_put, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Leveldb, write, arginfo_phalcon_storage_leveldb_write, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Leveldb, delete, arginfo_phalcon_storage_leveldb_delete, ZEND_ACC_PUBLIC)
-	PHP_ME(Phalcon_Storage_Leveldb, iterator, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Leveldb, iterator, arginfo_phalcon_storage_leveldb_iterator, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Leveldb, setBatching, arginfo_phalcon_storage_leveldb_setbatching, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Leveldb, flush, arginfo_phalcon_storage_leveldb_flush, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Leveldb, pending, arginfo_empty, ZEND_ACC_PUBLIC)
 	PHP_MALIAS(Phalcon_Storage_Leveldb, set, put, arginfo_phalcon_storage_leveldb_put, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
+static void phalcon_storage_leveldb_flush(phalcon_storage_leveldb_object *intern, int sync, char **err);
+
 zend_object_handlers phalcon_storage_leveldb_object_handlers;
 zend_object* phalcon_storage_leveldb_object_create_handler(zend_class_entry *ce)
 {
@@ -103,9 +127,93 @@ void phalcon_storage_leveldb_object_free_handler(zend_object *object)
 
 	intern = phalcon_storage_leveldb_object_from_obj(object);
 
+	if (intern->batch) {
+		if (intern->db && intern->pending) {
+			zend_long pending = intern->pending;
+			char *err = NULL;
+			phalcon_storage_leveldb_flush(intern, 0, &err);
+			if (err != NULL) {
+				php_error_docref(NULL, E_WARNING, "Error write a batch of " ZEND_LONG_FMT " writes: %s", pending, err);
+				free(err);
+			}
+		}
+		leveldb_writebatch_destroy(intern->batch);
+	}
+
 	if (intern->db) {
 		leveldb_close(intern->db);
 	}
+	zend_object_std_dtor(object);
+}
+
+/* writes the pending batch, err is set by leveldb on failure */
+static void phalcon_storage_leveldb_flush(phalcon_storage_leveldb_object *intern, int sync, char **err)
+{
+	leveldb_writeoptions_t *options;
+
+	if (!intern->pending) {
+		return;
+	}
+
+	options = leveldb_writeoptions_create();
+	leveldb_writeoptions_set_sync(options, sync);
+	leveldb_write(intern->db, options, intern->batch, err);
+	leveldb_writeoptions_destroy(options);
+
+	/* a failed batch is dropped too, retrying it would fail the same way */
+	leveldb_writebatch_clear(intern->batch);
+	intern->pending = 0;
+}
+
+/* the writes of a failed batch already returned true, report all of them */
+static void phalcon_storage_leveldb_batch_error(zend_long pending, char *err)
+{
+	PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error write a batch of " ZEND_LONG_FMT " writes: %s", pending, err);
+	free(err);
+}
+
+/* flushes the pending batch once a threshold is reached, sync writes flush right away */
+static int phalcon_storage_leveldb_batched(phalcon_storage_leveldb_object *intern, int sync)
+{
+	char *err = NULL;
+	zend_long pending;
+	double now;
+
+	if (intern->pending++ == 0 && intern->batch_interval > 0) {
+		intern->batch_started = phalcon_get_microtime();
+	}
+
+	if (!sync && (!intern->batch_size || intern->pending < intern->batch_size)) {
+		if (intern->batch_interval <= 0) {
+			return SUCCESS;
+		}
+		now = phalcon_get_microtime();
+		if (now - intern->batch_started < intern->batch_interval) {
+			return SUCCESS;
+		}
+	}
+
+	pending = intern->pending;
+	phalcon_storage_leveldb_flush(intern, sync, &err);
+	if (err != NULL) {
+		phalcon_storage_leveldb_batch_error(pending, err);
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+/* reads and explicit batches must observe the writes queued before them */
+static int phalcon_storage_leveldb_flush_pending(phalcon_storage_leveldb_object *intern)
+{
+	zend_long pending = intern->pending;
+	char *err = NULL;
+
+	phalcon_storage_leveldb_flush(intern, 0, &err);
+	if (err != NULL) {
+		phalcon_storage_leveldb_batch_error(pending, err);
+		return FAILURE;
+	}
+	return SUCCESS;
 }
 
 /**
@@ -124,6 +232,9 @@ PHALCON_INIT_CLASS(Phalcon_Storage_Leveldb){
 /**
  * Phalcon\Storage\Leveldb constructor
  *
+ * With batch_size (operations) or batch_interval (seconds) in the options, puts and deletes are
+ * queued in a write batch and written together, see setBatching()
+ *
  * @param string $path
  * @param string $options
  */
@@ -182,6 +293,14 @@ PHP_METHOD(Phalcon_Storage_Leveldb, __construct)
 			leveldb_options_set_block_restart_interval(options, Z_LVAL(value));
 		}
 
+		if (phalcon_array_isset_fetch_str(&value, _options, SL("batch_size"), PH_READONLY)) {
+			intern->batch_size = zval_get_long(&value);
+		}
+
+		if (phalcon_array_isset_fetch_str(&value, _options, SL("batch_interval"), PH_READONLY)) {
+			intern->batch_interval = zval_get_double(&value);
+		}
+
 		if (phalcon_array_isset_fetch_str(&value, _options, SL("compression"), PH_READONLY)) {
 			convert_to_long(&value);
 			if (Z_LVAL(value) != leveldb_no_compression && Z_LVAL(value) != leveldb_snappy_compression) {
@@ -192,6 +311,10 @@ PHP_METHOD(Phalcon_Storage_Leveldb, __construct)
 		}
 	}
 
+	if (intern->batch_size > 0 || intern->batch_interval > 0) {
+		intern->batch = leveldb_writebatch_create();
+	}
+
 	intern->db = leveldb_open(options, Z_STRVAL_P(path), &err);
 	leveldb_options_destroy(options);
 	if (err != NULL) {
@@ -220,6 +343,10 @@ PHP_METHOD(Phalcon_Storage_Leveldb, get)
 
 	intern = phalcon_storage_leveldb_object_from_obj(Z_OBJ_P(getThis()));
 
+	if (phalcon_storage_leveldb_flush_pending(intern) == FAILURE) {
+		return;
+	}
+
 	options = leveldb_readoptions_create();
 
 	if (_options && Z_TYPE_P(_options) == IS_ARRAY) {
@@ -270,6 +397,18 @@ PHP_METHOD(Phalcon_Storage_Leveldb, put)
 
 	intern = phalcon_storage_leveldb_object_from_obj(Z_OBJ_P(getThis()));
 
+	if (intern->batch) {
+		zval sync = {};
+		leveldb_writebatch_put(intern->batch, Z_STRVAL_P(key), Z_STRLEN_P(key), Z_STRVAL_P(value), Z_STRLEN_P(value));
+		if (_options && Z_TYPE_P(_options) == IS_ARRAY) {
+			phalcon_array_isset_fetch_str(&sync, _options, SL("sync"), PH_READONLY);
+		}
+		if (phalcon_storage_leveldb_batched(intern, zend_is_true(&sync)) == FAILURE) {
+			return;
+		}
+		RETURN_TRUE;
+	}
+
 	options = leveldb_writeoptions_create();
 
 	if (_options && Z_TYPE_P(_options) == IS_ARRAY) {
@@ -312,6 +451,10 @@ PHP_METHOD(Phalcon_Storage_Leveldb, write)
 	intern = phalcon_storage_leveldb_object_from_obj(Z_OBJ_P(getThis()));
 	batch_intern = phalcon_storage_leveldb_writebatch_object_from_obj(Z_OBJ_P(batch));
 
+	if (phalcon_storage_leveldb_flush_pending(intern) == FAILURE) {
+		return;
+	}
+
 	options = leveldb_writeoptions_create();
 
 	if (_options && Z_TYPE_P(_options) == IS_ARRAY) {
@@ -347,10 +490,22 @@ PHP_METHOD(Phalcon_Storage_Leveldb, delete)
 	phalcon_storage_leveldb_object *intern;
 	char *err = NULL;
 
-	phalcon_fetch_params(0, 1, 0, &key, &_options);
+	phalcon_fetch_params(0, 1, 1, &key, &_options);
 
 	intern = phalcon_storage_leveldb_object_from_obj(Z_OBJ_P(getThis()));
 
+	if (intern->batch) {
+		zval sync = {};
+		leveldb_writebatch_delete(intern->batch, Z_STRVAL_P(key), Z_STRLEN_P(key));
+		if (_options && Z_TYPE_P(_options) == IS_ARRAY) {
+			phalcon_array_isset_fetch_str(&sync, _options, SL("sync"), PH_READONLY);
+		}
+		if (phalcon_storage_leveldb_batched(intern, zend_is_true(&sync)) == FAILURE) {
+			return;
+		}
+		RETURN_TRUE;
+	}
+
 	options = leveldb_writeoptions_create();
 
 	if (_options && Z_TYPE_P(_options) == IS_ARRAY) {
@@ -376,6 +531,16 @@ PHP_METHOD(Phalcon_Storage_Leveldb, delete)
 /**
  * Gets a new iterator for the db
  *
+ * Besides the read options, prefix, start (inclusive), end (exclusive), keysOnly, limit
+ * and reverse bound the iteration, it stops at the boundary instead of running to the end
+ *
+ *<code>
+ *	foreach ($db->iterator(['start' => 'idx:2024-01', 'end' => 'idx:2024-02', 'keysOnly' => true]) as $key) {
+ *		echo $key, PHP_EOL;
+ *	}
+ *</code>
+ *
+ * @param array $options
  * @return Phalcon\Storage\Leveldb\Iterator
  */
 PHP_METHOD(Phalcon_Storage_Leveldb, iterator)
@@ -389,6 +554,10 @@ PHP_METHOD(Phalcon_Storage_Leveldb, iterator)
 
 	intern = phalcon_storage_leveldb_object_from_obj(Z_OBJ_P(getThis()));
 
+	if (phalcon_storage_leveldb_flush_pending(intern) == FAILURE) {
+		return;
+	}
+
 	options = leveldb_readoptions_create();
 
 	if (_options && Z_TYPE_P(_options) == IS_ARRAY) {
@@ -408,4 +577,117 @@ PHP_METHOD(Phalcon_Storage_Leveldb, iterator)
 
 	iterator_intern->iterator = leveldb_create_iterator(intern->db, options);
 	leveldb_readoptions_destroy(options);
+
+	phalcon_storage_leveldb_iterator_set_options(iterator_intern, _options);
+}
+
+/**
+ * Queues puts and deletes and writes them as one batch once $size operations are pending
+ * or $interval seconds passed since the first of them, whichever comes first
+ *
+ * Batched writes are only acknowledged when their batch is written: put() and delete() return
+ * true once the write is queued, and a failed batch throws for all of its writes, so writes that
+ * already returned true may be lost. Use flush() where a write must be known durable.
+ *
+ * The interval is checked when the next write comes in, pending writes are also flushed
+ * before reads and when the object is destroyed (failures are then only reported as warnings).
+ * Batches are written with sync=false, use flush(true) for durability points.
+ * A size of 0 without interval disables batching.
+ *
+ *<code>
+ *	$db = new Phalcon\Storage\Leveldb('/var/data/events');
+ *	$db->setBatching(1000, 0.05);
+ *	foreach ($events as $key => $event) {
+ *		$db->put($key, $event);
+ *	}
+ *	$db->flush(true);
+ *</code>
+ *
+ * @param int $size
+ * @param float $interval
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Leveldb, setBatching)
+{
+	zval *size, *interval = NULL;
+	phalcon_storage_leveldb_object *intern;
+
+	phalcon_fetch_params(0, 1, 1, &size, &interval);
+
+	intern = phalcon_storage_leveldb_object_from_obj(Z_OBJ_P(getThis()));
+
+	intern->batch_size = zval_get_long(size);
+	intern->batch_interval = interval ? zval_get_double(interval) : 0;
+
+	if (intern->batch_size > 0 || intern->batch_interval > 0) {
+		if (!intern->batch) {
+			intern->batch = leveldb_writebatch_create();
+		}
+	} else if (intern->batch) {
+		if (phalcon_storage_leveldb_flush_pending(intern) == FAILURE) {
+			return;
+		}
+		leveldb_writebatch_destroy(intern->batch);
+		intern->batch = NULL;
+	}
+
+	RETURN_TRUE;
+}
+
+/**
+ * Writes the pending batch
+ *
+ * @param boolean $sync
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Leveldb, flush)
+{
+	zval *sync = NULL;
+	phalcon_storage_leveldb_object *intern;
+	char *err = NULL;
+
+	phalcon_fetch_params(0, 0, 1, &sync);
+
+	intern = phalcon_storage_leveldb_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (!intern->pending) {
+		/* nothing queued, an empty synced write still forces the log to disk */
+		if (sync && zend_is_true(sync)) {
+			leveldb_writebatch_t *batch = leveldb_writebatch_create();
+			leveldb_writeoptions_t *options = leveldb_writeoptions_create();
+			leveldb_writeoptions_set_sync(options, 1);
+			leveldb_write(intern->db, options, batch, &err);
+			leveldb_writeoptions_destroy(options);
+			leveldb_writebatch_destroy(batch);
+		}
+	} else {
+		zend_long pending = intern->pending;
+		phalcon_storage_leveldb_flush(intern, sync && zend_is_true(sync), &err);
+		if (err != NULL) {
+			phalcon_storage_leveldb_batch_error(pending, err);
+			return;
+		}
+	}
+
+	if (err != NULL) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, err);
+		free(err);
+		return;
+	}
+
+	RETURN_TRUE;
+}
+
+/**
+ * Returns the number of queued writes
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Storage_Leveldb, pending)
+{
+	phalcon_storage_leveldb_object *intern;
+
+	intern = phalcon_storage_leveldb_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_LONG(intern->pending);
 }
@@ -27,6 +27,11 @@
 
 typedef struct {
 	leveldb_t *db;
+	leveldb_writebatch_t *batch; /* pending writes of the auto-batching mode */
+	zend_long batch_size;
+	zend_long pending;
+	double batch_interval;
+	double batch_started;
 	zend_object std;
 } phalcon_storage_leveldb_object;
 
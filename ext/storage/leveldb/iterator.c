@@ -81,6 +81,159 @@ void phalcon_storage_leveldb_iterator_object_free_handler(zend_object *object)
 		leveldb_iter_destroy(intern->iterator);
 		intern->iterator = NULL;
 	}
+	if (intern->prefix) {
+		zend_string_release(intern->prefix);
+	}
+	if (intern->lower) {
+		zend_string_release(intern->lower);
+	}
+	if (intern->upper) {
+		zend_string_release(intern->upper);
+	}
+	zend_object_std_dtor(object);
+}
+
+/* the first key after every key carrying the prefix, NULL when the prefix is all 0xFF */
+static zend_string *phalcon_storage_leveldb_iterator_successor(const zend_string *prefix)
+{
+	zend_string *s;
+	size_t len = ZSTR_LEN(prefix);
+
+	while (len > 0 && (unsigned char) ZSTR_VAL(prefix)[len - 1] == 0xFF) {
+		len--;
+	}
+	if (len == 0) {
+		return NULL;
+	}
+
+	s = zend_string_init(ZSTR_VAL(prefix), len, 0);
+	ZSTR_VAL(s)[len - 1]++;
+	return s;
+}
+
+/**
+ * Applies the options given to Phalcon\Storage\Leveldb::iterator()
+ */
+void phalcon_storage_leveldb_iterator_set_options(phalcon_storage_leveldb_iterator_object *intern, zval *options)
+{
+	zval value = {};
+	zend_string *successor;
+
+	if (!options || Z_TYPE_P(options) != IS_ARRAY) {
+		return;
+	}
+
+	/* "0" is a valid prefix, only an empty one means none */
+	if (phalcon_array_isset_fetch_str(&value, options, SL("prefix"), PH_READONLY) && Z_TYPE(value) != IS_NULL) {
+		intern->prefix = zval_get_string(&value);
+		if (!ZSTR_LEN(intern->prefix)) {
+			zend_string_release(intern->prefix);
+			intern->prefix = NULL;
+		}
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("start"), PH_READONLY) && Z_TYPE(value) != IS_NULL) {
+		intern->lower = zval_get_string(&value);
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("end"), PH_READONLY) && Z_TYPE(value) != IS_NULL) {
+		intern->upper = zval_get_string(&value);
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("keysOnly"), PH_READONLY)) {
+		intern->keys_only = zend_is_true(&value);
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("reverse"), PH_READONLY)) {
+		intern->reverse = zend_is_true(&value);
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("limit"), PH_READONLY)) {
+		intern->limit = zval_get_long(&value);
+	}
+
+	/* narrow the range to the prefix, so seeks land on it directly */
+	if (intern->prefix) {
+		if (!intern->lower || zend_binary_strcmp(ZSTR_VAL(intern->lower), ZSTR_LEN(intern->lower), ZSTR_VAL(intern->prefix), ZSTR_LEN(intern->prefix)) < 0) {
+			if (intern->lower) {
+				zend_string_release(intern->lower);
+			}
+			intern->lower = zend_string_copy(intern->prefix);
+		}
+
+		successor = phalcon_storage_leveldb_iterator_successor(intern->prefix);
+		if (successor && (!intern->upper || zend_binary_strcmp(ZSTR_VAL(successor), ZSTR_LEN(successor), ZSTR_VAL(intern->upper), ZSTR_LEN(intern->upper)) < 0)) {
+			if (intern->upper) {
+				zend_string_release(intern->upper);
+			}
+			intern->upper = successor;
+		} else if (successor) {
+			zend_string_release(successor);
+		}
+	}
+}
+
+/* ends the iteration once the iterator leaves the range or the limit is reached */
+static void phalcon_storage_leveldb_iterator_bound(phalcon_storage_leveldb_iterator_object *intern)
+{
+	const char *key;
+	size_t key_len;
+
+	intern->done = 0;
+	if (!leveldb_iter_valid(intern->iterator)) {
+		return;
+	}
+
+	key = leveldb_iter_key(intern->iterator, &key_len);
+
+	if ((intern->limit > 0 && intern->position >= intern->limit)
+		|| (intern->prefix && (key_len < ZSTR_LEN(intern->prefix) || memcmp(key, ZSTR_VAL(intern->prefix), ZSTR_LEN(intern->prefix))))
+		|| (intern->lower && zend_binary_strcmp(key, key_len, ZSTR_VAL(intern->lower), ZSTR_LEN(intern->lower)) < 0)
+		|| (intern->upper && zend_binary_strcmp(key, key_len, ZSTR_VAL(intern->upper), ZSTR_LEN(intern->upper)) >= 0)) {
+		intern->done = 1;
+	}
+}
+
+/* positions on the lowest (or highest) key of the range */
+static void phalcon_storage_leveldb_iterator_seek_range(phalcon_storage_leveldb_iterator_object *intern, int highest)
+{
+	intern->position = 0;
+
+	if (!highest) {
+		if (intern->lower) {
+			leveldb_iter_seek(intern->iterator, ZSTR_VAL(intern->lower), ZSTR_LEN(intern->lower));
+		} else {
+			leveldb_iter_seek_to_first(intern->iterator);
+		}
+	} else if (intern->upper) {
+		leveldb_iter_seek(intern->iterator, ZSTR_VAL(intern->upper), ZSTR_LEN(intern->upper));
+		if (leveldb_iter_valid(intern->iterator)) {
+			leveldb_iter_prev(intern->iterator);
+		} else {
+			leveldb_iter_seek_to_last(intern->iterator);
+		}
+	} else {
+		leveldb_iter_seek_to_last(intern->iterator);
+	}
+
+	phalcon_storage_leveldb_iterator_bound(intern);
+}
+
+static int phalcon_storage_leveldb_iterator_step(phalcon_storage_leveldb_iterator_object *intern, int backward)
+{
+	if (!leveldb_iter_valid(intern->iterator)) {
+		return 0;
+	}
+
+	intern->position += backward == intern->reverse ? 1 : -1;
+	if (backward) {
+		leveldb_iter_prev(intern->iterator);
+	} else {
+		leveldb_iter_next(intern->iterator);
+	}
+
+	phalcon_storage_leveldb_iterator_bound(intern);
+	return 1;
+}
+
+static int phalcon_storage_leveldb_iterator_valid(phalcon_storage_leveldb_iterator_object *intern)
+{
+	return !intern->done && leveldb_iter_valid(intern->iterator);
 }
 
 /**
@@ -106,7 +259,7 @@ PHP_METHOD(Phalcon_Storage_Leveldb_Iterator, __construct)
 }
 
 /**
- * Return current element
+ * Return current element, the key when the iterator was created with keysOnly
  *
  * @return string
  */
@@ -118,7 +271,16 @@ PHP_METHOD(Phalcon_Storage_Leveldb_Iterator, current)
 
 	intern = phalcon_storage_leveldb_iterator_object_from_obj(Z_OBJ_P(getThis()));
 
-	if (!leveldb_iter_valid(intern->iterator) || !(value = (char *)leveldb_iter_value(intern->iterator, &value_len))) {
+	if (!phalcon_storage_leveldb_iterator_valid(intern)) {
+		RETURN_FALSE;
+	}
+
+	if (intern->keys_only) {
+		value = (char *)leveldb_iter_key(intern->iterator, &value_len);
+	} else {
+		value = (char *)leveldb_iter_value(intern->iterator, &value_len);
+	}
+	if (!value) {
 		RETURN_FALSE;
 	}
 
@@ -138,7 +300,7 @@ PHP_METHOD(Phalcon_Storage_Leveldb_Iterator, key)
 
 	intern = phalcon_storage_leveldb_iterator_object_from_obj(Z_OBJ_P(getThis()));
 
-	if (!leveldb_iter_valid(intern->iterator) || !(key = (char *)leveldb_iter_key(intern->iterator, &key_len))) {
+	if (!phalcon_storage_leveldb_iterator_valid(intern) || !(key = (char *)leveldb_iter_key(intern->iterator, &key_len))) {
 		RETURN_FALSE;
 	}
 
@@ -156,12 +318,7 @@ PHP_METHOD(Phalcon_Storage_Leveldb_Iterator, next)
 
 	intern = phalcon_storage_leveldb_iterator_object_from_obj(Z_OBJ_P(getThis()));
 
-	if (leveldb_iter_valid(intern->iterator)) {
-		leveldb_iter_next(intern->iterator);
-		RETURN_TRUE;
-	} else {
-		RETURN_FALSE;
-	}
+	RETURN_BOOL(phalcon_storage_leveldb_iterator_step(intern, intern->reverse));
 }
 
 /**
@@ -175,9 +332,7 @@ PHP_METHOD(Phalcon_Storage_Leveldb_Iterator, prev)
 
 	intern = phalcon_storage_leveldb_iterator_object_from_obj(Z_OBJ_P(getThis()));
 
-	if (leveldb_iter_valid(intern->iterator)) {
-		leveldb_iter_prev(intern->iterator);
-	}
+	phalcon_storage_leveldb_iterator_step(intern, !intern->reverse);
 	RETURN_TRUE;
 }
 
@@ -192,7 +347,7 @@ PHP_METHOD(Phalcon_Storage_Leveldb_Iterator, rewind)
 
 	intern = phalcon_storage_leveldb_iterator_object_from_obj(Z_OBJ_P(getThis()));
 
-    leveldb_iter_seek_to_first(intern->iterator);
+	phalcon_storage_leveldb_iterator_seek_range(intern, intern->reverse);
 	RETURN_TRUE;
 }
 
@@ -207,7 +362,7 @@ PHP_METHOD(Phalcon_Storage_Leveldb_Iterator, last)
 
 	intern = phalcon_storage_leveldb_iterator_object_from_obj(Z_OBJ_P(getThis()));
 
-    leveldb_iter_seek_to_last(intern->iterator);
+	phalcon_storage_leveldb_iterator_seek_range(intern, !intern->reverse);
 	RETURN_TRUE;
 }
 
@@ -226,6 +381,8 @@ PHP_METHOD(Phalcon_Storage_Leveldb_Iterator, seek)
 	intern = phalcon_storage_leveldb_iterator_object_from_obj(Z_OBJ_P(getThis()));
 
 	leveldb_iter_seek(intern->iterator, Z_STRVAL_P(key), Z_STRLEN_P(key));
+	intern->position = 0;
+	phalcon_storage_leveldb_iterator_bound(intern);
 	RETURN_TRUE;
 }
 
@@ -240,5 +397,5 @@ PHP_METHOD(Phalcon_Storage_Leveldb_Iterator, valid)
 
 	intern = phalcon_storage_leveldb_iterator_object_from_obj(Z_OBJ_P(getThis()));
 
-	RETURN_BOOL(leveldb_iter_valid(intern->iterator));
+	RETURN_BOOL(phalcon_storage_leveldb_iterator_valid(intern));
 }
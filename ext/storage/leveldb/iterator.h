@@ -27,6 +27,14 @@
 
 typedef struct {
 	leveldb_iterator_t *iterator;
+	zend_string *prefix;
+	zend_string *lower; /* inclusive */
+	zend_string *upper; /* exclusive */
+	int keys_only;
+	int reverse;
+	int done;
+	zend_long limit;
+	zend_long position;
 	zend_object std;
 } phalcon_storage_leveldb_iterator_object;
 
@@ -36,6 +44,8 @@ static inline phalcon_storage_leveldb_iterator_object *phalcon_storage_leveldb_i
 
 extern zend_class_entry *phalcon_storage_leveldb_iterator_ce;
 
+void phalcon_storage_leveldb_iterator_set_options(phalcon_storage_leveldb_iterator_object *intern, zval *options);
+
 PHALCON_INIT_CLASS(Phalcon_Storage_Leveldb_Iterator);
 # endif
 #endif /* PHALCON_STORAGE_LEVELDB_ITERATOR_H */
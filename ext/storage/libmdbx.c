@@ -20,6 +20,7 @@
 
 #include "storage/libmdbx.h"
 #include "storage/libmdbx/cursor.h"
+#include "storage/libmdbx/view.h"
 #include "storage/exception.h"
 
 #include <ext/standard/file.h>
@@ -48,6 +49,8 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, renew);
 PHP_METHOD(Phalcon_Storage_Libmdbx, reset);
 PHP_METHOD(Phalcon_Storage_Libmdbx, getAll);
 PHP_METHOD(Phalcon_Storage_Libmdbx, get);
+PHP_METHOD(Phalcon_Storage_Libmdbx, getMany);
+PHP_METHOD(Phalcon_Storage_Libmdbx, view);
 PHP_METHOD(Phalcon_Storage_Libmdbx, put);
 PHP_METHOD(Phalcon_Storage_Libmdbx, del);
 PHP_METHOD(Phalcon_Storage_Libmdbx, cursor);
@@ -66,10 +69,23 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_libmdbx_begin, 0, 0, 0)
 	ZEND_ARG_TYPE_INFO(0, flags, IS_LONG, 1)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_libmdbx_getall, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, views, _IS_BOOL, 1)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_libmdbx_get, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_libmdbx_getmany, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, keys, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO(0, views, _IS_BOOL, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_libmdbx_view, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_libmdbx_put, 0, 0, 2)
 	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
 	ZEND_ARG_INFO(0, value)
@@ -80,6 +96,10 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_libmdbx_del, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_libmdbx_cursor, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, options, IS_ARRAY, 1)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_libmdbx_copy, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
 	ZEND_ARG_TYPE_INFO(0, flags, IS_LONG, 1)
@@ -95,11 +115,13 @@ static const zend_function_entry phalcon_storage_libmdbx_method_entry[] = {
 	PHP_ME(Phalcon_Storage_Libmdbx, commit, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Libmdbx, renew, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Libmdbx, reset, NULL, ZEND_ACC_PUBLIC)
-	PHP_ME(Phalcon_Storage_Libmdbx, getAll, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Libmdbx, getAll, arginfo_phalcon_storage_libmdbx_getall, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Libmdbx, get, arginfo_phalcon_storage_libmdbx_get, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Libmdbx, getMany, arginfo_phalcon_storage_libmdbx_getmany, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Libmdbx, view, arginfo_phalcon_storage_libmdbx_view, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Libmdbx, put, arginfo_phalcon_storage_libmdbx_put, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Libmdbx, del, arginfo_phalcon_storage_libmdbx_del, ZEND_ACC_PUBLIC)
-	PHP_ME(Phalcon_Storage_Libmdbx, cursor, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Libmdbx, cursor, arginfo_phalcon_storage_libmdbx_cursor, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Libmdbx, copy, arginfo_phalcon_storage_libmdbx_copy, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Libmdbx, drop, arginfo_phalcon_storage_libmdbx_drop, ZEND_ACC_PUBLIC)
 	PHP_MALIAS(Phalcon_Storage_Libmdbx, set, put, arginfo_phalcon_storage_libmdbx_put, ZEND_ACC_PUBLIC)
@@ -142,6 +164,37 @@ void phalcon_storage_libmdbx_object_free_handler(zend_object *object)
 	}
 }
 
+/* values are only referenced in place while no write can move the pages under them */
+static int phalcon_storage_libmdbx_check_views(phalcon_storage_libmdbx_object *intern)
+{
+	if (!(intern->txn_flags & MDBX_RDONLY)) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Views require a read-only transaction, begin it with Libmdbx::RDONLY");
+		return 0;
+	}
+	return 1;
+}
+
+static void phalcon_storage_libmdbx_value(zval *return_value, phalcon_storage_libmdbx_object *intern, const MDBX_val *v, int views)
+{
+	zval s = {};
+
+	if (views) {
+		phalcon_storage_libmdbx_view_create(return_value, &intern->std, v, intern->generation);
+		return;
+	}
+
+	ZVAL_STRINGL(&s, (char *) v->iov_base, (int) v->iov_len);
+	phalcon_unserialize(return_value, &s);
+	zval_ptr_dtor(&s);
+}
+
+static int phalcon_storage_libmdbx_key_compare(const void *a, const void *b)
+{
+	const zend_string *s1 = *(const zend_string **) a, *s2 = *(const zend_string **) b;
+
+	return zend_binary_strcmp(ZSTR_VAL(s1), ZSTR_LEN(s1), ZSTR_VAL(s2), ZSTR_LEN(s2));
+}
+
 /**
  * Phalcon\Storage\Libmdbx initializer
  */
@@ -302,11 +355,10 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, begin)
 	phalcon_fetch_params(0, 0, 1, &flags);
 
 	intern = phalcon_storage_libmdbx_object_from_obj(Z_OBJ_P(getThis()));
-	if (flags && Z_TYPE_P(flags) == IS_LONG) {
-		rc = mdbx_txn_begin(intern->env, NULL, Z_LVAL_P(flags), &intern->txn);
-	} else {
-		rc = mdbx_txn_begin(intern->env, NULL, 0, &intern->txn);
-	}
+	intern->txn_flags = flags && Z_TYPE_P(flags) == IS_LONG ? Z_LVAL_P(flags) : 0;
+	intern->generation++;
+
+	rc = mdbx_txn_begin(intern->env, NULL, intern->txn_flags, &intern->txn);
 	if (rc != MDBX_SUCCESS) {
 		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Failed to create a transaction for use with the environment (%s)", mdbx_strerror(rc));
 		return;
@@ -325,6 +377,7 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, commit)
 	int rc;
 
 	intern = phalcon_storage_libmdbx_object_from_obj(Z_OBJ_P(getThis()));
+	intern->generation++;
 
 	rc = mdbx_txn_commit(intern->txn);
 	if (rc != MDBX_SUCCESS) {
@@ -343,6 +396,7 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, renew)
 	phalcon_storage_libmdbx_object *intern;
 
 	intern = phalcon_storage_libmdbx_object_from_obj(Z_OBJ_P(getThis()));
+	intern->generation++;
 
 	mdbx_txn_renew(intern->txn);
 }
@@ -356,6 +410,7 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, reset)
 	phalcon_storage_libmdbx_object *intern;
 
 	intern = phalcon_storage_libmdbx_object_from_obj(Z_OBJ_P(getThis()));
+	intern->generation++;
 
 	mdbx_txn_reset(intern->txn);
 }
@@ -363,17 +418,28 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, reset)
 /**
  * Get all items from a database
  *
+ * With $views the values are Phalcon\Storage\Libmdbx\View objects referencing the map
+ *
+ * @param boolean $views
  * @return array
  */
 PHP_METHOD(Phalcon_Storage_Libmdbx, getAll)
 {
+	zval *views = NULL;
 	MDBX_val k, v;
 	MDBX_cursor *cursor;
 	phalcon_storage_libmdbx_object *intern;
-	int rc;
+	int rc, as_views;
+
+	phalcon_fetch_params(0, 0, 1, &views);
 
 	intern = phalcon_storage_libmdbx_object_from_obj(Z_OBJ_P(getThis()));
 
+	as_views = views && zend_is_true(views);
+	if (as_views && !phalcon_storage_libmdbx_check_views(intern)) {
+		return;
+	}
+
 	rc = mdbx_cursor_open(intern->txn, intern->dbi, &cursor);
 	if (rc != MDBX_SUCCESS) {
 		mdbx_dbi_close(intern->env, intern->dbi);
@@ -383,10 +449,8 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, getAll)
 	}
 	array_init(return_value);
 	while ((rc = mdbx_cursor_get(cursor, &k, &v, MDBX_NEXT)) == 0) {
-		zval s = {}, u = {};
-		ZVAL_STRINGL(&s, (char *) v.iov_base, (int) v.iov_len);
-		phalcon_unserialize(&u, &s);
-		zval_ptr_dtor(&s);
+		zval u = {};
+		phalcon_storage_libmdbx_value(&u, intern, &v, as_views);
 		phalcon_array_update_str(return_value, (char *) k.iov_base, (int) k.iov_len, &u, 0);
 	}
 	mdbx_cursor_close(cursor);
@@ -425,6 +489,120 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, get)
 	}
 }
 
+/**
+ * Get several items in one pass
+ *
+ * Keys are looked up in sorted order through one cursor, so neighbouring keys are found
+ * on the page the cursor already sits on. Missing keys are left out of the result.
+ *
+ *<code>
+ *	$db->begin(Phalcon\Storage\Libmdbx::RDONLY);
+ *	$prices = $db->getMany(['sku:1', 'sku:7', 'sku:3'], true);
+ *	$db->reset();
+ *</code>
+ *
+ * @param array $keys
+ * @param boolean $views
+ * @return array
+ */
+PHP_METHOD(Phalcon_Storage_Libmdbx, getMany)
+{
+	zval *keys, *views = NULL, *key;
+	zend_string **sorted;
+	MDBX_val k, v;
+	MDBX_cursor *cursor;
+	phalcon_storage_libmdbx_object *intern;
+	uint32_t n = 0, i;
+	int rc = MDBX_SUCCESS, as_views;
+
+	phalcon_fetch_params(0, 1, 1, &keys, &views);
+
+	intern = phalcon_storage_libmdbx_object_from_obj(Z_OBJ_P(getThis()));
+
+	as_views = views && zend_is_true(views);
+	if (as_views && !phalcon_storage_libmdbx_check_views(intern)) {
+		return;
+	}
+
+	array_init(return_value);
+	if (!zend_hash_num_elements(Z_ARRVAL_P(keys))) {
+		return;
+	}
+
+	rc = mdbx_cursor_open(intern->txn, intern->dbi, &cursor);
+	if (rc != MDBX_SUCCESS) {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Failed to create a cursor handle (%s)", mdbx_strerror(rc));
+		return;
+	}
+
+	sorted = safe_emalloc(zend_hash_num_elements(Z_ARRVAL_P(keys)), sizeof(zend_string *), 0);
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(keys), key) {
+		sorted[n++] = zval_get_string(key);
+	} ZEND_HASH_FOREACH_END();
+
+	/* byte order matches the default comparator */
+	qsort(sorted, n, sizeof(zend_string *), phalcon_storage_libmdbx_key_compare);
+
+	for (i = 0; i < n; i++) {
+		k.iov_len = ZSTR_LEN(sorted[i]);
+		k.iov_base = ZSTR_VAL(sorted[i]);
+
+		rc = mdbx_cursor_get(cursor, &k, &v, MDBX_SET);
+		if (rc == MDBX_SUCCESS) {
+			zval u = {};
+			phalcon_storage_libmdbx_value(&u, intern, &v, as_views);
+			phalcon_array_update_str(return_value, ZSTR_VAL(sorted[i]), ZSTR_LEN(sorted[i]), &u, 0);
+		} else if (rc != MDBX_NOTFOUND) {
+			break;
+		}
+	}
+
+	mdbx_cursor_close(cursor);
+	for (i = 0; i < n; i++) {
+		zend_string_release(sorted[i]);
+	}
+	efree(sorted);
+
+	if (rc != MDBX_SUCCESS && rc != MDBX_NOTFOUND) {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Failed to get item from a database (%s)", mdbx_strerror(rc));
+		return;
+	}
+}
+
+/**
+ * Get an item without copying it out of the map, requires a read-only transaction
+ *
+ * @param string $key
+ * @return Phalcon\Storage\Libmdbx\View|boolean
+ */
+PHP_METHOD(Phalcon_Storage_Libmdbx, view)
+{
+	zval *key;
+	MDBX_val k, v;
+	phalcon_storage_libmdbx_object *intern;
+	int rc;
+
+	phalcon_fetch_params(0, 1, 0, &key);
+
+	intern = phalcon_storage_libmdbx_object_from_obj(Z_OBJ_P(getThis()));
+	if (!phalcon_storage_libmdbx_check_views(intern)) {
+		return;
+	}
+
+	k.iov_len = Z_STRLEN_P(key);
+	k.iov_base = Z_STRVAL_P(key);
+
+	rc = mdbx_get(intern->txn, intern->dbi, &k, &v);
+	if (rc == MDBX_SUCCESS) {
+		phalcon_storage_libmdbx_view_create(return_value, &intern->std, &v, intern->generation);
+	} else if (rc == MDBX_NOTFOUND) {
+		RETVAL_FALSE;
+	} else {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Failed to get item from a database (%s)", mdbx_strerror(rc));
+		return;
+	}
+}
+
 /**
  * Store items into a database
  *
@@ -494,15 +672,28 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, del)
 /**
  * Create a cursor handle
  *
+ * Options are applied while walking the tree, so a bounded scan stops at its boundary:
+ * prefix, start (inclusive), end (exclusive), keysOnly, limit and reverse
+ *
+ *<code>
+ *	foreach ($db->cursor(['prefix' => 'user:', 'keysOnly' => true, 'limit' => 10]) as $key) {
+ *		echo $key, PHP_EOL;
+ *	}
+ *</code>
+ *
+ * @param array $options
  * @return Phalcon\Storage\Libmdbx\Cursor
  */
 PHP_METHOD(Phalcon_Storage_Libmdbx, cursor)
 {
+	zval *options = NULL;
 	MDBX_cursor *cursor;
 	phalcon_storage_libmdbx_object *intern;
 	phalcon_storage_libmdbx_cursor_object *cursor_intern;
 	int rc;
 
+	phalcon_fetch_params(0, 0, 1, &options);
+
 	intern = phalcon_storage_libmdbx_object_from_obj(Z_OBJ_P(getThis()));
 
 	rc = mdbx_cursor_open(intern->txn, intern->dbi, &cursor);
@@ -514,6 +705,8 @@ PHP_METHOD(Phalcon_Storage_Libmdbx, cursor)
 	object_init_ex(return_value, phalcon_storage_libmdbx_cursor_ce);
 	cursor_intern = phalcon_storage_libmdbx_cursor_object_from_obj(Z_OBJ_P(return_value));
 	cursor_intern->cursor = cursor;
+
+	phalcon_storage_libmdbx_cursor_set_options(cursor_intern, options);
 }
 
 /**
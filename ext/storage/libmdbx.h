@@ -31,6 +31,8 @@ typedef struct {
 	MDBX_env *env;
 	MDBX_dbi dbi;
 	MDBX_txn *txn;
+	unsigned int txn_flags;
+	zend_ulong generation; /* bumped whenever the pages seen by txn may go away */
 	zend_object std;
 } phalcon_storage_libmdbx_object;
 
@@ -33,6 +33,13 @@ typedef struct {
 	MDBX_val v;
 	int start;
 	int rc;
+	zend_string *prefix;
+	zend_string *lower; /* inclusive */
+	zend_string *upper; /* exclusive */
+	int keys_only;
+	int reverse;
+	zend_long limit;
+	zend_long position;
 	zend_object std;
 } phalcon_storage_libmdbx_cursor_object;
 
@@ -42,6 +49,8 @@ static inline phalcon_storage_libmdbx_cursor_object *phalcon_storage_libmdbx_cur
 
 extern zend_class_entry *phalcon_storage_libmdbx_cursor_ce;
 
+void phalcon_storage_libmdbx_cursor_set_options(phalcon_storage_libmdbx_cursor_object *intern, zval *options);
+
 PHALCON_INIT_CLASS(Phalcon_Storage_Libmdbx_Cursor);
 
 #endif
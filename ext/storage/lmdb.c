@@ -20,6 +20,7 @@
 
 #include "storage/lmdb.h"
 #include "storage/lmdb/cursor.h"
+#include "storage/lmdb/view.h"
 #include "storage/exception.h"
 
 #include <ext/standard/file.h>
@@ -48,6 +49,8 @@ PHP_METHOD(Phalcon_Storage_Lmdb, renew);
 PHP_METHOD(Phalcon_Storage_Lmdb, reset);
 PHP_METHOD(Phalcon_Storage_Lmdb, getAll);
 PHP_METHOD(Phalcon_Storage_Lmdb, get);
+PHP_METHOD(Phalcon_Storage_Lmdb, getMany);
+PHP_METHOD(Phalcon_Storage_Lmdb, view);
 PHP_METHOD(Phalcon_Storage_Lmdb, put);
 PHP_METHOD(Phalcon_Storage_Lmdb, del);
 PHP_METHOD(Phalcon_Storage_Lmdb, cursor);
@@ -66,10 +69,23 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_begin, 0, 0, 0)
 	ZEND_ARG_TYPE_INFO(0, flags, IS_LONG, 1)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_getall, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, views, _IS_BOOL, 1)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_get, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_getmany, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, keys, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO(0, views, _IS_BOOL, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_view, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_put, 0, 0, 2)
 	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
 	ZEND_ARG_INFO(0, value)
@@ -80,6 +96,10 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_del, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_cursor, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, options, IS_ARRAY, 1)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_copy, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, path, IS_STRING, 0)
 	ZEND_ARG_TYPE_INFO(0, flags, IS_LONG, 1)
@@ -95,11 +115,13 @@ static const zend_function_entry phalcon_storage_lmdb_method_entry[] = {
 	PHP_ME(Phalcon_Storage_Lmdb, commit, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Lmdb, renew, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Lmdb, reset, NULL, ZEND_ACC_PUBLIC)
-	PHP_ME(Phalcon_Storage_Lmdb, getAll, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Lmdb, getAll, arginfo_phalcon_storage_lmdb_getall, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Lmdb, get, arginfo_phalcon_storage_lmdb_get, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Lmdb, getMany, arginfo_phalcon_storage_lmdb_getmany, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Lmdb, view, arginfo_phalcon_storage_lmdb_view, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Lmdb, put, arginfo_phalcon_storage_lmdb_put, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Lmdb, del, arginfo_phalcon_storage_lmdb_del, ZEND_ACC_PUBLIC)
-	PHP_ME(Phalcon_Storage_Lmdb, cursor, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Lmdb, cursor, arginfo_phalcon_storage_lmdb_cursor, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Lmdb, copy, arginfo_phalcon_storage_lmdb_copy, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Lmdb, drop, arginfo_phalcon_storage_lmdb_drop, ZEND_ACC_PUBLIC)
 	PHP_MALIAS(Phalcon_Storage_Lmdb, set, put, arginfo_phalcon_storage_lmdb_put, ZEND_ACC_PUBLIC)
@@ -137,6 +159,37 @@ void phalcon_storage_lmdb_object_free_handler(zend_object *object)
 	}
 }
 
+/* values are only referenced in place while no write can move the pages under them */
+static int phalcon_storage_lmdb_check_views(phalcon_storage_lmdb_object *intern)
+{
+	if (!(intern->txn_flags & MDB_RDONLY)) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "Views require a read-only transaction, begin it with Lmdb::RDONLY");
+		return 0;
+	}
+	return 1;
+}
+
+static void phalcon_storage_lmdb_value(zval *return_value, phalcon_storage_lmdb_object *intern, const MDB_val *v, int views)
+{
+	zval s = {};
+
+	if (views) {
+		phalcon_storage_lmdb_view_create(return_value, &intern->std, v, intern->generation);
+		return;
+	}
+
+	ZVAL_STRINGL(&s, (char *) v->mv_data, (int) v->mv_size);
+	phalcon_unserialize(return_value, &s);
+	zval_ptr_dtor(&s);
+}
+
+static int phalcon_storage_lmdb_key_compare(const void *a, const void *b)
+{
+	const zend_string *s1 = *(const zend_string **) a, *s2 = *(const zend_string **) b;
+
+	return zend_binary_strcmp(ZSTR_VAL(s1), ZSTR_LEN(s1), ZSTR_VAL(s2), ZSTR_LEN(s2));
+}
+
 /**
  * Phalcon\Storage\Lmdb initializer
  */
@@ -307,11 +360,10 @@ PHP_METHOD(Phalcon_Storage_Lmdb, begin)
 	phalcon_fetch_params(0, 0, 1, &flags);
 
 	intern = phalcon_storage_lmdb_object_from_obj(Z_OBJ_P(getThis()));
-	if (flags && Z_TYPE_P(flags) == IS_LONG) {
-		rc = mdb_txn_begin(intern->env, NULL, Z_LVAL_P(flags), &intern->txn);
-	} else {
-		rc = mdb_txn_begin(intern->env, NULL, 0, &intern->txn);
-	}
+	intern->txn_flags = flags && Z_TYPE_P(flags) == IS_LONG ? Z_LVAL_P(flags) : 0;
+	intern->generation++;
+
+	rc = mdb_txn_begin(intern->env, NULL, intern->txn_flags, &intern->txn);
 	if (rc != MDB_SUCCESS) {
 		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Failed to create a transaction for use with the environment (%s)", mdb_strerror(rc));
 		return;
@@ -329,6 +381,7 @@ PHP_METHOD(Phalcon_Storage_Lmdb, commit)
 	int rc;
 
 	intern = phalcon_storage_lmdb_object_from_obj(Z_OBJ_P(getThis()));
+	intern->generation++;
 
 	rc = mdb_txn_commit(intern->txn);
 	if (rc != MDB_SUCCESS) {
@@ -347,6 +400,7 @@ PHP_METHOD(Phalcon_Storage_Lmdb, renew)
 	phalcon_storage_lmdb_object *intern;
 
 	intern = phalcon_storage_lmdb_object_from_obj(Z_OBJ_P(getThis()));
+	intern->generation++;
 
 	mdb_txn_renew(intern->txn);
 }
@@ -360,6 +414,7 @@ PHP_METHOD(Phalcon_Storage_Lmdb, reset)
 	phalcon_storage_lmdb_object *intern;
 
 	intern = phalcon_storage_lmdb_object_from_obj(Z_OBJ_P(getThis()));
+	intern->generation++;
 
 	mdb_txn_reset(intern->txn);
 }
@@ -367,17 +422,28 @@ PHP_METHOD(Phalcon_Storage_Lmdb, reset)
 /**
  * Get all items from a database
  *
+ * With $views the values are Phalcon\Storage\Lmdb\View objects referencing the map
+ *
+ * @param boolean $views
  * @return array
  */
 PHP_METHOD(Phalcon_Storage_Lmdb, getAll)
 {
+	zval *views = NULL;
 	MDB_val k, v;
 	MDB_cursor *cursor;
 	phalcon_storage_lmdb_object *intern;
-	int rc;
+	int rc, as_views;
+
+	phalcon_fetch_params(0, 0, 1, &views);
 
 	intern = phalcon_storage_lmdb_object_from_obj(Z_OBJ_P(getThis()));
 
+	as_views = views && zend_is_true(views);
+	if (as_views && !phalcon_storage_lmdb_check_views(intern)) {
+		return;
+	}
+
 	rc = mdb_cursor_open(intern->txn, intern->dbi, &cursor);
 	if (rc != MDB_SUCCESS) {
 		mdb_dbi_close(intern->env, intern->dbi);
@@ -387,10 +453,8 @@ PHP_METHOD(Phalcon_Storage_Lmdb, getAll)
 	}
 	array_init(return_value);
 	while ((rc = mdb_cursor_get(cursor, &k, &v, MDB_NEXT)) == 0) {
-		zval s = {}, u = {};
-		ZVAL_STRINGL(&s, (char *) v.mv_data, (int) v.mv_size);
-		phalcon_unserialize(&u, &s);
-		zval_ptr_dtor(&s);
+		zval u = {};
+		phalcon_storage_lmdb_value(&u, intern, &v, as_views);
 		phalcon_array_update_str(return_value, (char *) k.mv_data, (int) k.mv_size, &u, 0);
 	}
 	mdb_cursor_close(cursor);
@@ -429,6 +493,120 @@ PHP_METHOD(Phalcon_Storage_Lmdb, get)
 	}
 }
 
+/**
+ * Get several items in one pass
+ *
+ * Keys are looked up in sorted order through one cursor, so neighbouring keys are found
+ * on the page the cursor already sits on. Missing keys are left out of the result.
+ *
+ *<code>
+ *	$db->begin(Phalcon\Storage\Lmdb::RDONLY);
+ *	$prices = $db->getMany(['sku:1', 'sku:7', 'sku:3'], true);
+ *	$db->reset();
+ *</code>
+ *
+ * @param array $keys
+ * @param boolean $views
+ * @return array
+ */
+PHP_METHOD(Phalcon_Storage_Lmdb, getMany)
+{
+	zval *keys, *views = NULL, *key;
+	zend_string **sorted;
+	MDB_val k, v;
+	MDB_cursor *cursor;
+	phalcon_storage_lmdb_object *intern;
+	uint32_t n = 0, i;
+	int rc = MDB_SUCCESS, as_views;
+
+	phalcon_fetch_params(0, 1, 1, &keys, &views);
+
+	intern = phalcon_storage_lmdb_object_from_obj(Z_OBJ_P(getThis()));
+
+	as_views = views && zend_is_true(views);
+	if (as_views && !phalcon_storage_lmdb_check_views(intern)) {
+		return;
+	}
+
+	array_init(return_value);
+	if (!zend_hash_num_elements(Z_ARRVAL_P(keys))) {
+		return;
+	}
+
+	rc = mdb_cursor_open(intern->txn, intern->dbi, &cursor);
+	if (rc != MDB_SUCCESS) {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Failed to create a cursor handle (%s)", mdb_strerror(rc));
+		return;
+	}
+
+	sorted = safe_emalloc(zend_hash_num_elements(Z_ARRVAL_P(keys)), sizeof(zend_string *), 0);
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(keys), key) {
+		sorted[n++] = zval_get_string(key);
+	} ZEND_HASH_FOREACH_END();
+
+	/* byte order matches the default comparator */
+	qsort(sorted, n, sizeof(zend_string *), phalcon_storage_lmdb_key_compare);
+
+	for (i = 0; i < n; i++) {
+		k.mv_size = ZSTR_LEN(sorted[i]);
+		k.mv_data = ZSTR_VAL(sorted[i]);
+
+		rc = mdb_cursor_get(cursor, &k, &v, MDB_SET);
+		if (rc == MDB_SUCCESS) {
+			zval u = {};
+			phalcon_storage_lmdb_value(&u, intern, &v, as_views);
+			phalcon_array_update_str(return_value, ZSTR_VAL(sorted[i]), ZSTR_LEN(sorted[i]), &u, 0);
+		} else if (rc != MDB_NOTFOUND) {
+			break;
+		}
+	}
+
+	mdb_cursor_close(cursor);
+	for (i = 0; i < n; i++) {
+		zend_string_release(sorted[i]);
+	}
+	efree(sorted);
+
+	if (rc != MDB_SUCCESS && rc != MDB_NOTFOUND) {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Failed to get item from a database (%s)", mdb_strerror(rc));
+		return;
+	}
+}
+
+/**
+ * Get an item without copying it out of the map, requires a read-only transaction
+ *
+ * @param string $key
+ * @return Phalcon\Storage\Lmdb\View|boolean
+ */
+PHP_METHOD(Phalcon_Storage_Lmdb, view)
+{
+	zval *key;
+	MDB_val k, v;
+	phalcon_storage_lmdb_object *intern;
+	int rc;
+
+	phalcon_fetch_params(0, 1, 0, &key);
+
+	intern = phalcon_storage_lmdb_object_from_obj(Z_OBJ_P(getThis()));
+	if (!phalcon_storage_lmdb_check_views(intern)) {
+		return;
+	}
+
+	k.mv_size = Z_STRLEN_P(key);
+	k.mv_data = Z_STRVAL_P(key);
+
+	rc = mdb_get(intern->txn, intern->dbi, &k, &v);
+	if (rc == MDB_SUCCESS) {
+		phalcon_storage_lmdb_view_create(return_value, &intern->std, &v, intern->generation);
+	} else if (rc == MDB_NOTFOUND) {
+		RETVAL_FALSE;
+	} else {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Failed to get item from a database (%s)", mdb_strerror(rc));
+		return;
+	}
+}
+
 /**
  * Store items into a database
  *
@@ -498,15 +676,28 @@ PHP_METHOD(Phalcon_Storage_Lmdb, del)
 /**
  * Create a cursor handle
  *
+ * Options are applied while walking the tree, so a bounded scan stops at its boundary:
+ * prefix, start (inclusive), end (exclusive), keysOnly, limit and reverse
+ *
+ *<code>
+ *	foreach ($db->cursor(['prefix' => 'user:', 'keysOnly' => true, 'limit' => 10]) as $key) {
+ *		echo $key, PHP_EOL;
+ *	}
+ *</code>
+ *
+ * @param array $options
  * @return Phalcon\Storage\Lmdb\Cursor
  */
 PHP_METHOD(Phalcon_Storage_Lmdb, cursor)
 {
+	zval *options = NULL;
 	MDB_cursor *cursor;
 	phalcon_storage_lmdb_object *intern;
 	phalcon_storage_lmdb_cursor_object *cursor_intern;
 	int rc;
 
+	phalcon_fetch_params(0, 0, 1, &options);
+
 	intern = phalcon_storage_lmdb_object_from_obj(Z_OBJ_P(getThis()));
 
 	rc = mdb_cursor_open(intern->txn, intern->dbi, &cursor);
@@ -518,6 +709,8 @@ PHP_METHOD(Phalcon_Storage_Lmdb, cursor)
 	object_init_ex(return_value, phalcon_storage_lmdb_cursor_ce);
 	cursor_intern = phalcon_storage_lmdb_cursor_object_from_obj(Z_OBJ_P(return_value));
 	cursor_intern->cursor = cursor;
+
+	phalcon_storage_lmdb_cursor_set_options(cursor_intern, options);
 }
 
 /**
@@ -28,6 +28,8 @@ typedef struct {
 	MDB_env *env;
 	MDB_dbi dbi;
 	MDB_txn *txn;
+	unsigned int txn_flags;
+	zend_ulong generation; /* bumped whenever the pages seen by txn may go away */
 	zend_object std;
 } phalcon_storage_lmdb_object;
 
@@ -79,6 +79,160 @@ void phalcon_storage_lmdb_cursor_object_free_handler(zend_object *object)
 	if (intern->cursor) {
 		mdb_cursor_close(intern->cursor);
 	}
+	if (intern->prefix) {
+		zend_string_release(intern->prefix);
+	}
+	if (intern->lower) {
+		zend_string_release(intern->lower);
+	}
+	if (intern->upper) {
+		zend_string_release(intern->upper);
+	}
+	zend_object_std_dtor(object);
+}
+
+static int phalcon_storage_lmdb_cursor_compare(const char *key, size_t key_len, const zend_string *s)
+{
+	return zend_binary_strcmp(key, key_len, ZSTR_VAL(s), ZSTR_LEN(s));
+}
+
+/* the first key after every key carrying the prefix, NULL when the prefix is all 0xFF */
+static zend_string *phalcon_storage_lmdb_cursor_successor(const zend_string *prefix)
+{
+	zend_string *s;
+	size_t len = ZSTR_LEN(prefix);
+
+	while (len > 0 && (unsigned char) ZSTR_VAL(prefix)[len - 1] == 0xFF) {
+		len--;
+	}
+	if (len == 0) {
+		return NULL;
+	}
+
+	s = zend_string_init(ZSTR_VAL(prefix), len, 0);
+	ZSTR_VAL(s)[len - 1]++;
+	return s;
+}
+
+/**
+ * Applies the options given to Phalcon\Storage\Lmdb::cursor()
+ */
+void phalcon_storage_lmdb_cursor_set_options(phalcon_storage_lmdb_cursor_object *intern, zval *options)
+{
+	zval value = {};
+	zend_string *successor;
+
+	if (!options || Z_TYPE_P(options) != IS_ARRAY) {
+		return;
+	}
+
+	/* "0" is a valid prefix, only an empty one means none */
+	if (phalcon_array_isset_fetch_str(&value, options, SL("prefix"), PH_READONLY) && Z_TYPE(value) != IS_NULL) {
+		intern->prefix = zval_get_string(&value);
+		if (!ZSTR_LEN(intern->prefix)) {
+			zend_string_release(intern->prefix);
+			intern->prefix = NULL;
+		}
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("start"), PH_READONLY) && Z_TYPE(value) != IS_NULL) {
+		intern->lower = zval_get_string(&value);
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("end"), PH_READONLY) && Z_TYPE(value) != IS_NULL) {
+		intern->upper = zval_get_string(&value);
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("keysOnly"), PH_READONLY)) {
+		intern->keys_only = zend_is_true(&value);
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("reverse"), PH_READONLY)) {
+		intern->reverse = zend_is_true(&value);
+	}
+	if (phalcon_array_isset_fetch_str(&value, options, SL("limit"), PH_READONLY)) {
+		intern->limit = zval_get_long(&value);
+	}
+
+	/* narrow the range to the prefix, so seeks land on it directly */
+	if (intern->prefix) {
+		if (!intern->lower || zend_binary_strcmp(ZSTR_VAL(intern->lower), ZSTR_LEN(intern->lower), ZSTR_VAL(intern->prefix), ZSTR_LEN(intern->prefix)) < 0) {
+			if (intern->lower) {
+				zend_string_release(intern->lower);
+			}
+			intern->lower = zend_string_copy(intern->prefix);
+		}
+
+		successor = phalcon_storage_lmdb_cursor_successor(intern->prefix);
+		if (successor && (!intern->upper || zend_binary_strcmp(ZSTR_VAL(successor), ZSTR_LEN(successor), ZSTR_VAL(intern->upper), ZSTR_LEN(intern->upper)) < 0)) {
+			if (intern->upper) {
+				zend_string_release(intern->upper);
+			}
+			intern->upper = successor;
+		} else if (successor) {
+			zend_string_release(successor);
+		}
+	}
+}
+
+/* ends the iteration once the cursor leaves the range or the limit is reached */
+static void phalcon_storage_lmdb_cursor_bound(phalcon_storage_lmdb_cursor_object *intern)
+{
+	const char *key = (const char *) intern->k.mv_data;
+	size_t key_len = intern->k.mv_size;
+
+	if (intern->rc != MDB_SUCCESS) {
+		return;
+	}
+
+	if ((intern->limit > 0 && intern->position >= intern->limit)
+		|| (intern->prefix && (key_len < ZSTR_LEN(intern->prefix) || memcmp(key, ZSTR_VAL(intern->prefix), ZSTR_LEN(intern->prefix))))
+		|| (intern->lower && phalcon_storage_lmdb_cursor_compare(key, key_len, intern->lower) < 0)
+		|| (intern->upper && phalcon_storage_lmdb_cursor_compare(key, key_len, intern->upper) >= 0)) {
+		intern->rc = MDB_NOTFOUND;
+	}
+}
+
+/* positions on the lowest (or highest) key of the range */
+static void phalcon_storage_lmdb_cursor_seek(phalcon_storage_lmdb_cursor_object *intern, int highest)
+{
+	intern->position = 0;
+	intern->start = 1;
+
+	if (!highest) {
+		if (intern->lower) {
+			intern->k.mv_size = ZSTR_LEN(intern->lower);
+			intern->k.mv_data = ZSTR_VAL(intern->lower);
+			intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_SET_RANGE);
+		} else {
+			intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_FIRST);
+		}
+	} else if (intern->upper) {
+		intern->k.mv_size = ZSTR_LEN(intern->upper);
+		intern->k.mv_data = ZSTR_VAL(intern->upper);
+		intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_SET_RANGE);
+		if (intern->rc == MDB_SUCCESS) {
+			intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_PREV);
+		} else if (intern->rc == MDB_NOTFOUND) {
+			intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_LAST);
+		}
+	} else {
+		intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_LAST);
+	}
+
+	phalcon_storage_lmdb_cursor_bound(intern);
+}
+
+static void phalcon_storage_lmdb_cursor_step(phalcon_storage_lmdb_cursor_object *intern, int backward)
+{
+	intern->position += backward == intern->reverse ? 1 : -1;
+	intern->start = 1;
+	intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, backward ? MDB_PREV : MDB_NEXT);
+
+	phalcon_storage_lmdb_cursor_bound(intern);
+}
+
+static void phalcon_storage_lmdb_cursor_fetch(phalcon_storage_lmdb_cursor_object *intern)
+{
+	if (!intern->start) {
+		phalcon_storage_lmdb_cursor_seek(intern, intern->reverse);
+	}
 }
 
 /**
@@ -104,9 +258,9 @@ PHP_METHOD(Phalcon_Storage_Lmdb_Cursor, __construct)
 }
 
 /**
- * Gets current value
+ * Gets current value, the key when the cursor was opened with keysOnly
  *
- * @return string
+ * @return mixed
  */
 PHP_METHOD(Phalcon_Storage_Lmdb_Cursor, current)
 {
@@ -114,15 +268,16 @@ PHP_METHOD(Phalcon_Storage_Lmdb_Cursor, current)
 
 	intern = phalcon_storage_lmdb_cursor_object_from_obj(Z_OBJ_P(getThis()));
 
-	if (!intern->start) {
-		intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_NEXT);
-		intern->start = 1;
-	}
+	phalcon_storage_lmdb_cursor_fetch(intern);
 
 	if (intern->rc == MDB_SUCCESS) {
 		zval s = {};
+		if (intern->keys_only) {
+			RETURN_STRINGL((char *) intern->k.mv_data, (int) intern->k.mv_size);
+		}
 		ZVAL_STRINGL(&s, (char *) intern->v.mv_data, (int) intern->v.mv_size);
 		phalcon_unserialize(return_value, &s);
+		zval_ptr_dtor(&s);
 	} else if (intern->rc == MDB_NOTFOUND) {
 		RETVAL_FALSE;
 	} else {
@@ -142,10 +297,7 @@ PHP_METHOD(Phalcon_Storage_Lmdb_Cursor, key)
 
 	intern = phalcon_storage_lmdb_cursor_object_from_obj(Z_OBJ_P(getThis()));
 
-	if (!intern->start) {
-		intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_NEXT);
-		intern->start = 1;
-	}
+	phalcon_storage_lmdb_cursor_fetch(intern);
 
 	if (intern->rc == MDB_SUCCESS) {
 		ZVAL_STRINGL(return_value, (char *) intern->k.mv_data, (int) intern->k.mv_size);
@@ -167,8 +319,12 @@ PHP_METHOD(Phalcon_Storage_Lmdb_Cursor, next)
 	phalcon_storage_lmdb_cursor_object *intern;
 
 	intern = phalcon_storage_lmdb_cursor_object_from_obj(Z_OBJ_P(getThis()));
-    intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_NEXT);
-	intern->start = 1;
+
+	if (!intern->start) {
+		phalcon_storage_lmdb_cursor_seek(intern, intern->reverse);
+	} else {
+		phalcon_storage_lmdb_cursor_step(intern, intern->reverse);
+	}
 	if (intern->rc == MDB_SUCCESS) {
 		RETURN_TRUE;
 	} else if (intern->rc == MDB_NOTFOUND) {
@@ -190,8 +346,7 @@ PHP_METHOD(Phalcon_Storage_Lmdb_Cursor, prev)
 
 	intern = phalcon_storage_lmdb_cursor_object_from_obj(Z_OBJ_P(getThis()));
 
-    intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_PREV);
-	intern->start = 1;
+	phalcon_storage_lmdb_cursor_step(intern, !intern->reverse);
 	if (intern->rc == MDB_SUCCESS) {
 		RETURN_TRUE;
 	} else if (intern->rc == MDB_NOTFOUND) {
@@ -213,8 +368,7 @@ PHP_METHOD(Phalcon_Storage_Lmdb_Cursor, rewind)
 
 	intern = phalcon_storage_lmdb_cursor_object_from_obj(Z_OBJ_P(getThis()));
 
-    intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_FIRST);
-	intern->start = 1;
+	phalcon_storage_lmdb_cursor_seek(intern, intern->reverse);
 	if (intern->rc == MDB_SUCCESS) {
 		RETURN_TRUE;
 	} else if (intern->rc == MDB_NOTFOUND) {
@@ -236,8 +390,7 @@ PHP_METHOD(Phalcon_Storage_Lmdb_Cursor, last)
 
 	intern = phalcon_storage_lmdb_cursor_object_from_obj(Z_OBJ_P(getThis()));
 
-    intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_LAST);
-	intern->start = 1;
+	phalcon_storage_lmdb_cursor_seek(intern, !intern->reverse);
 	if (intern->rc == MDB_SUCCESS) {
 		RETURN_TRUE;
 	} else if (intern->rc == MDB_NOTFOUND) {
@@ -259,10 +412,8 @@ PHP_METHOD(Phalcon_Storage_Lmdb_Cursor, valid)
 
 	intern = phalcon_storage_lmdb_cursor_object_from_obj(Z_OBJ_P(getThis()));
 
-	if (!intern->start) {
-		intern->rc = mdb_cursor_get(intern->cursor, &intern->k, &intern->v, MDB_NEXT);
-		intern->start = 1;
-	}
+	phalcon_storage_lmdb_cursor_fetch(intern);
+
 	if (intern->rc == MDB_SUCCESS) {
 		RETVAL_TRUE;
 	} else if (intern->rc == MDB_NOTFOUND) {
@@ -30,6 +30,13 @@ typedef struct {
 	MDB_val v;
 	int start;
 	int rc;
+	zend_string *prefix;
+	zend_string *lower; /* inclusive */
+	zend_string *upper; /* exclusive */
+	int keys_only;
+	int reverse;
+	zend_long limit;
+	zend_long position;
 	zend_object std;
 } phalcon_storage_lmdb_cursor_object;
 
@@ -39,6 +46,8 @@ static inline phalcon_storage_lmdb_cursor_object *phalcon_storage_lmdb_cursor_ob
 
 extern zend_class_entry *phalcon_storage_lmdb_cursor_ce;
 
+void phalcon_storage_lmdb_cursor_set_options(phalcon_storage_lmdb_cursor_object *intern, zval *options);
+
 PHALCON_INIT_CLASS(Phalcon_Storage_Lmdb_Cursor);
 
 #endif /* PHALCON_STORAGE_LMDB_CURSOR_H */
@@ -0,0 +1,296 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#include "storage/lmdb/view.h"
+#include "storage/lmdb.h"
+#include "storage/exception.h"
+
+#include <ext/standard/php_var.h>
+
+#include "kernel/main.h"
+#include "kernel/exception.h"
+#include "kernel/memory.h"
+#include "kernel/object.h"
+#include "kernel/operators.h"
+
+#include "internal/arginfo.h"
+
+/**
+ * Phalcon\Storage\Lmdb\View
+ *
+ * A read-only window on a value inside the memory map, nothing is copied until the bytes are asked for.
+ * The view is only valid while the read transaction that produced it is open,
+ * any access after commit(), reset(), renew() or begin() throws.
+ *
+ *<code>
+ *	$db->begin(Phalcon\Storage\Lmdb::RDONLY);
+ *	$view = $db->view('pricing:42');
+ *	if ($view && $view->equals($expected)) {
+ *		$price = $view->unserialize();
+ *	}
+ *	$db->reset();
+ *</code>
+ */
+zend_class_entry *phalcon_storage_lmdb_view_ce;
+
+PHP_METHOD(Phalcon_Storage_Lmdb_View, __construct);
+PHP_METHOD(Phalcon_Storage_Lmdb_View, __toString);
+PHP_METHOD(Phalcon_Storage_Lmdb_View, length);
+PHP_METHOD(Phalcon_Storage_Lmdb_View, isValid);
+PHP_METHOD(Phalcon_Storage_Lmdb_View, substr);
+PHP_METHOD(Phalcon_Storage_Lmdb_View, equals);
+PHP_METHOD(Phalcon_Storage_Lmdb_View, unserialize);
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_view_substr, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, start, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, length, IS_LONG, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_lmdb_view_equals, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, value, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry phalcon_storage_lmdb_view_method_entry[] = {
+	PHP_ME(Phalcon_Storage_Lmdb_View, __construct, NULL, ZEND_ACC_PRIVATE|ZEND_ACC_CTOR|ZEND_ACC_FINAL)
+	PHP_ME(Phalcon_Storage_Lmdb_View, __toString, arginfo___tostring, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Lmdb_View, length, arginfo_empty, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Lmdb_View, isValid, arginfo_empty, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Lmdb_View, substr, arginfo_phalcon_storage_lmdb_view_substr, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Lmdb_View, equals, arginfo_phalcon_storage_lmdb_view_equals, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Lmdb_View, unserialize, arginfo_empty, ZEND_ACC_PUBLIC)
+	PHP_FE_END
+};
+
+zend_object_handlers phalcon_storage_lmdb_view_object_handlers;
+zend_object* phalcon_storage_lmdb_view_object_create_handler(zend_class_entry *ce)
+{
+	phalcon_storage_lmdb_view_object *intern = ecalloc(1, sizeof(phalcon_storage_lmdb_view_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_storage_lmdb_view_object_handlers;
+
+	return &intern->std;
+}
+
+void phalcon_storage_lmdb_view_object_free_handler(zend_object *object)
+{
+	phalcon_storage_lmdb_view_object *intern = phalcon_storage_lmdb_view_object_from_obj(object);
+
+	/* the environment stays mapped while a view holds it */
+	if (intern->db) {
+		OBJ_RELEASE(intern->db);
+		intern->db = NULL;
+	}
+	zend_object_std_dtor(object);
+}
+
+/**
+ * Phalcon\Storage\Lmdb\View initializer
+ */
+PHALCON_INIT_CLASS(Phalcon_Storage_Lmdb_View){
+
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT(Phalcon\\Storage\\Lmdb, View, storage_lmdb_view, phalcon_storage_lmdb_view_method_entry, 0);
+
+	return SUCCESS;
+}
+
+void phalcon_storage_lmdb_view_create(zval *return_value, zend_object *db, const MDB_val *value, zend_ulong generation)
+{
+	phalcon_storage_lmdb_view_object *intern;
+
+	object_init_ex(return_value, phalcon_storage_lmdb_view_ce);
+	intern = phalcon_storage_lmdb_view_object_from_obj(Z_OBJ_P(return_value));
+
+	GC_ADDREF(db);
+	intern->db = db;
+	intern->data = (const char *) value->mv_data;
+	intern->size = value->mv_size;
+	intern->generation = generation;
+}
+
+static int phalcon_storage_lmdb_view_valid(phalcon_storage_lmdb_view_object *intern)
+{
+	if (!intern->db) {
+		return 0;
+	}
+	return phalcon_storage_lmdb_object_from_obj(intern->db)->generation == intern->generation;
+}
+
+static phalcon_storage_lmdb_view_object *phalcon_storage_lmdb_view_fetch(zval *object)
+{
+	phalcon_storage_lmdb_view_object *intern = phalcon_storage_lmdb_view_object_from_obj(Z_OBJ_P(object));
+
+	if (!phalcon_storage_lmdb_view_valid(intern)) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_storage_exception_ce, "The transaction of this view has ended");
+		return NULL;
+	}
+	return intern;
+}
+
+/**
+ * Phalcon\Storage\Lmdb\View constructor
+ *
+ */
+PHP_METHOD(Phalcon_Storage_Lmdb_View, __construct)
+{
+	/* this constructor shouldn't be called as it's private */
+	zend_throw_exception(NULL, "An object of this type cannot be created with the new operator.", 0);
+}
+
+/**
+ * Copies the bytes into a string, a view of an ended transaction raises E_USER_ERROR
+ * before PHP 7.4 since __toString() could not throw there
+ *
+ * @return string
+ */
+PHP_METHOD(Phalcon_Storage_Lmdb_View, __toString)
+{
+	phalcon_storage_lmdb_view_object *intern;
+
+	if ((intern = phalcon_storage_lmdb_view_fetch(getThis())) == NULL) {
+#if PHP_VERSION_ID < 70400
+		zend_clear_exception();
+		zend_error(E_USER_ERROR, "The transaction of this view has ended");
+		RETURN_EMPTY_STRING();
+#else
+		return;
+#endif
+	}
+
+	RETURN_STRINGL(intern->data, intern->size);
+}
+
+/**
+ * Gets the length in bytes, available after the transaction ended
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Storage_Lmdb_View, length)
+{
+	phalcon_storage_lmdb_view_object *intern = phalcon_storage_lmdb_view_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_LONG(intern->size);
+}
+
+/**
+ * Checks whether the transaction of the view is still open
+ *
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Lmdb_View, isValid)
+{
+	phalcon_storage_lmdb_view_object *intern = phalcon_storage_lmdb_view_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_BOOL(phalcon_storage_lmdb_view_valid(intern));
+}
+
+/**
+ * Copies part of the bytes, with substr() semantics
+ *
+ * @param int $start
+ * @param int $length
+ * @return string
+ */
+PHP_METHOD(Phalcon_Storage_Lmdb_View, substr)
+{
+	zval *start, *length = NULL;
+	phalcon_storage_lmdb_view_object *intern;
+	zend_long from, len, size;
+
+	phalcon_fetch_params(0, 1, 1, &start, &length);
+
+	if ((intern = phalcon_storage_lmdb_view_fetch(getThis())) == NULL) {
+		return;
+	}
+
+	size = (zend_long) intern->size;
+	from = Z_LVAL_P(start);
+	if (from < 0) {
+		from = from + size < 0 ? 0 : from + size;
+	} else if (from > size) {
+		RETURN_EMPTY_STRING();
+	}
+
+	len = size - from;
+	if (length && Z_TYPE_P(length) == IS_LONG) {
+		if (Z_LVAL_P(length) < 0) {
+			len = len + Z_LVAL_P(length);
+		} else if (Z_LVAL_P(length) < len) {
+			len = Z_LVAL_P(length);
+		}
+	}
+
+	if (len <= 0) {
+		RETURN_EMPTY_STRING();
+	}
+
+	RETURN_STRINGL(intern->data + from, len);
+}
+
+/**
+ * Compares the bytes with a string without copying them
+ *
+ * @param string $value
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Lmdb_View, equals)
+{
+	zval *value;
+	phalcon_storage_lmdb_view_object *intern;
+
+	phalcon_fetch_params(0, 1, 0, &value);
+
+	if ((intern = phalcon_storage_lmdb_view_fetch(getThis())) == NULL) {
+		return;
+	}
+
+	RETURN_BOOL(Z_STRLEN_P(value) == intern->size && memcmp(Z_STRVAL_P(value), intern->data, intern->size) == 0);
+}
+
+/**
+ * Unserializes a value stored by Lmdb::put() straight from the map
+ *
+ * @return mixed
+ */
+PHP_METHOD(Phalcon_Storage_Lmdb_View, unserialize)
+{
+	phalcon_storage_lmdb_view_object *intern;
+	php_unserialize_data_t var_hash;
+	const unsigned char *p;
+
+	if ((intern = phalcon_storage_lmdb_view_fetch(getThis())) == NULL) {
+		return;
+	}
+
+	if (intern->size == 0) {
+		RETURN_FALSE;
+	}
+
+	p = (const unsigned char *) intern->data;
+	PHP_VAR_UNSERIALIZE_INIT(var_hash);
+	if (!php_var_unserialize(return_value, &p, p + intern->size, &var_hash)) {
+		PHP_VAR_UNSERIALIZE_DESTROY(var_hash);
+		zval_ptr_dtor(return_value);
+		RETURN_FALSE;
+	}
+	PHP_VAR_UNSERIALIZE_DESTROY(var_hash);
+}
@@ -0,0 +1,45 @@
+
+/*
+  +------------------------------------------------------------------------+
+  | Phalcon Framework                                                      |
+  +------------------------------------------------------------------------+
+  | Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+  +------------------------------------------------------------------------+
+  | This source file is subject to the New BSD License that is bundled     |
+  | with this package in the file docs/LICENSE.txt.                        |
+  |                                                                        |
+  | If you did not receive a copy of the license and are unable to         |
+  | obtain it through the world-wide-web, please send an email             |
+  | to license@phalconphp.com so we can send you a copy immediately.       |
+  +------------------------------------------------------------------------+
+  | Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+  |          Eduar Carvajal <eduar@phalconphp.com>                         |
+  |          ZhuZongXin <dreamsxin@qq.com>                                 |
+  +------------------------------------------------------------------------+
+*/
+
+#ifndef PHALCON_STORAGE_LMDB_VIEW_H
+#define PHALCON_STORAGE_LMDB_VIEW_H
+
+#include "php_phalcon.h"
+#include "storage/lmdb/lmdb.h"
+
+typedef struct {
+	zend_object *db;
+	const char *data;
+	size_t size;
+	zend_ulong generation;
+	zend_object std;
+} phalcon_storage_lmdb_view_object;
+
+static inline phalcon_storage_lmdb_view_object *phalcon_storage_lmdb_view_object_from_obj(zend_object *obj) {
+	return (phalcon_storage_lmdb_view_object*)((char*)(obj) - XtOffsetOf(phalcon_storage_lmdb_view_object, std));
+}
+
+extern zend_class_entry *phalcon_storage_lmdb_view_ce;
+
+void phalcon_storage_lmdb_view_create(zval *return_value, zend_object *db, const MDB_val *value, zend_ulong generation);
+
+PHALCON_INIT_CLASS(Phalcon_Storage_Lmdb_View);
+
+#endif /* PHALCON_STORAGE_LMDB_VIEW_H */
@@ -33,6 +33,9 @@
 #include "kernel/operators.h"
 #include "kernel/file.h"
 #include "kernel/exception.h"
+#include "kernel/time.h"
+
+#include "internal/arginfo.h"
 
 /**
  * Phalcon\Storage\Wiredtiger
@@ -50,6 +53,9 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger, begin);
 PHP_METHOD(Phalcon_Storage_Wiredtiger, commit);
 PHP_METHOD(Phalcon_Storage_Wiredtiger, rollback);
 PHP_METHOD(Phalcon_Storage_Wiredtiger, sync);
+PHP_METHOD(Phalcon_Storage_Wiredtiger, setBatching);
+PHP_METHOD(Phalcon_Storage_Wiredtiger, flush);
+PHP_METHOD(Phalcon_Storage_Wiredtiger, pending);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_wiredtiger___construct, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, home, IS_STRING, 0)
@@ -92,6 +98,15 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_wiredtiger_sync, 0, 0, 0)
 	ZEND_ARG_TYPE_INFO(0, config, IS_STRING, 1)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_wiredtiger_setbatching, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, size, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, interval, IS_DOUBLE, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_storage_wiredtiger_flush, 0, 0, 0)
+	ZEND_ARG_TYPE_INFO(0, sync, _IS_BOOL, 1)
+ZEND_END_ARG_INFO()
+
 static const zend_function_entry phalcon_storage_wiredtiger_method_entry[] = {
 	PHP_ME(Phalcon_Storage_Wiredtiger, __construct, arginfo_phalcon_storage_wiredtiger___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Storage_Wiredtiger, create, arginfo_phalcon_storage_wiredtiger_create, ZEND_ACC_PUBLIC)
@@ -102,6 +117,9 @@ static const zend_function_entry phalcon_storage_wiredtiger_method_entry[] = {
 	PHP_ME(Phalcon_Storage_Wiredtiger, commit, arginfo_phalcon_storage_wiredtiger_commit, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Wiredtiger, rollback, arginfo_phalcon_storage_wiredtiger_rollback, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Storage_Wiredtiger, sync, arginfo_phalcon_storage_wiredtiger_sync, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Wiredtiger, setBatching, arginfo_phalcon_storage_wiredtiger_setbatching, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Wiredtiger, flush, arginfo_phalcon_storage_wiredtiger_flush, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Storage_Wiredtiger, pending, arginfo_empty, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
@@ -196,6 +214,12 @@ void phalcon_storage_wiredtiger_object_free_handler(zend_object *object)
 	phalcon_storage_wiredtiger_object *intern = phalcon_storage_wiredtiger_object_from_obj(object);
 
 	if (intern->session) {
+		/* closing the session would roll the pending batch back */
+		zend_long pending = intern->pending;
+		int ret = phalcon_storage_wiredtiger_batch_commit(intern);
+		if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
+			php_error_docref(NULL, E_WARNING, "Error commit a batch of " ZEND_LONG_FMT " writes %s", pending, wiredtiger_strerror(ret));
+		}
 		intern->session->close(intern->session, NULL);
 	}
 
@@ -204,6 +228,96 @@ void phalcon_storage_wiredtiger_object_free_handler(zend_object *object)
 	}
 }
 
+/**
+ * Opens the batch transaction before a write, unless batching is off or the user runs one
+ */
+int phalcon_storage_wiredtiger_batch_begin(phalcon_storage_wiredtiger_object *intern)
+{
+	int ret;
+
+	if (intern->txn != PHALCON_STORAGE_WIREDTIGER_TXN_NONE || (intern->batch_size <= 0 && intern->batch_interval <= 0)) {
+		return PHALCON_STORAGE_WIREDTIGER_OK;
+	}
+
+	ret = intern->session->begin_transaction(intern->session, NULL);
+	if (ret == PHALCON_STORAGE_WIREDTIGER_OK) {
+		intern->txn = PHALCON_STORAGE_WIREDTIGER_TXN_BATCH;
+		intern->pending = 0;
+		if (intern->batch_interval > 0) {
+			intern->batch_started = phalcon_get_microtime();
+		}
+	}
+	return ret;
+}
+
+/**
+ * Counts a write made in the batch transaction and commits it once a threshold is reached
+ */
+int phalcon_storage_wiredtiger_batch_end(phalcon_storage_wiredtiger_object *intern, int ret)
+{
+	if (intern->txn != PHALCON_STORAGE_WIREDTIGER_TXN_BATCH) {
+		return ret;
+	}
+
+	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
+		/* a transaction that hit a conflict can only be rolled back, with the writes queued before */
+		if (ret == WT_ROLLBACK) {
+			intern->session->rollback_transaction(intern->session, NULL);
+			intern->txn = PHALCON_STORAGE_WIREDTIGER_TXN_NONE;
+			if (intern->pending > 0) {
+				PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error write, the batch of " ZEND_LONG_FMT " pending writes was rolled back %s", intern->pending, wiredtiger_strerror(ret));
+			}
+			intern->pending = 0;
+		}
+		return ret;
+	}
+
+	intern->pending++;
+	if ((intern->batch_size > 0 && intern->pending >= intern->batch_size)
+		|| (intern->batch_interval > 0 && phalcon_get_microtime() - intern->batch_started >= intern->batch_interval)) {
+		return phalcon_storage_wiredtiger_batch_flush(intern);
+	}
+	return PHALCON_STORAGE_WIREDTIGER_OK;
+}
+
+/**
+ * Commits the batch transaction, throwing for the whole batch when the commit fails
+ */
+int phalcon_storage_wiredtiger_batch_flush(phalcon_storage_wiredtiger_object *intern)
+{
+	zend_long pending = intern->pending;
+	int ret;
+
+	ret = phalcon_storage_wiredtiger_batch_commit(intern);
+	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error commit a batch of " ZEND_LONG_FMT " writes %s", pending, wiredtiger_strerror(ret));
+	}
+	return ret;
+}
+
+/**
+ * Commits the batch transaction once its interval passed, an open transaction pins its snapshot
+ */
+int phalcon_storage_wiredtiger_batch_expire(phalcon_storage_wiredtiger_object *intern)
+{
+	if (intern->txn != PHALCON_STORAGE_WIREDTIGER_TXN_BATCH || intern->batch_interval <= 0
+		|| phalcon_get_microtime() - intern->batch_started < intern->batch_interval) {
+		return PHALCON_STORAGE_WIREDTIGER_OK;
+	}
+	return phalcon_storage_wiredtiger_batch_flush(intern);
+}
+
+int phalcon_storage_wiredtiger_batch_commit(phalcon_storage_wiredtiger_object *intern)
+{
+	if (intern->txn != PHALCON_STORAGE_WIREDTIGER_TXN_BATCH) {
+		return PHALCON_STORAGE_WIREDTIGER_OK;
+	}
+
+	intern->txn = PHALCON_STORAGE_WIREDTIGER_TXN_NONE;
+	intern->pending = 0;
+	return intern->session->commit_transaction(intern->session, NULL);
+}
+
 /**
  * Phalcon\Storage\Wiredtiger initializer
  */
@@ -305,6 +419,9 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger, open)
 
 	phalcon_fetch_params(0, 1, 1, &uri, &_config);
 
+	if (phalcon_storage_wiredtiger_batch_expire(phalcon_storage_wiredtiger_object_from_obj(Z_OBJ_P(getThis()))) != PHALCON_STORAGE_WIREDTIGER_OK) {
+		return;
+	}
 
 	if (!_config || Z_TYPE_P(_config) != IS_STRING) {
 		ZVAL_NULL(&config);
@@ -391,11 +508,16 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger, begin)
 	}
 	intern = phalcon_storage_wiredtiger_object_from_obj(Z_OBJ_P(getThis()));
 
+	if (phalcon_storage_wiredtiger_batch_flush(intern) != PHALCON_STORAGE_WIREDTIGER_OK) {
+		return;
+	}
+
 	ret = intern->session->begin_transaction(intern->session, config);
 	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
 		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error open a transaction %s", wiredtiger_strerror(ret));
 		return;
 	}
+	intern->txn = PHALCON_STORAGE_WIREDTIGER_TXN_USER;
 	RETURN_TRUE;
 }
 
@@ -418,6 +540,9 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger, commit)
 	}
 	intern = phalcon_storage_wiredtiger_object_from_obj(Z_OBJ_P(getThis()));
 
+	intern->txn = PHALCON_STORAGE_WIREDTIGER_TXN_NONE;
+	intern->pending = 0;
+
 	ret = intern->session->commit_transaction(intern->session, config);
 	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
 		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error commit a transaction %s", wiredtiger_strerror(ret));
@@ -445,6 +570,9 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger, rollback)
 	}
 	intern = phalcon_storage_wiredtiger_object_from_obj(Z_OBJ_P(getThis()));
 
+	intern->txn = PHALCON_STORAGE_WIREDTIGER_TXN_NONE;
+	intern->pending = 0;
+
 	ret = intern->session->rollback_transaction(intern->session, config);
 	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
 		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error rollback a transaction %s", wiredtiger_strerror(ret));
@@ -479,3 +607,99 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger, sync)
 	}
 	RETURN_TRUE;
 }
+
+/**
+ * Wraps writes made through cursors in a transaction committed every $size writes or
+ * $interval seconds, whichever comes first
+ *
+ * Batched writes are only acknowledged by the commit of their batch: set() and delete() return
+ * true once the write is queued, and a failed commit throws for the whole batch, so writes that
+ * already returned true may be lost. Use flush() where a write must be known durable.
+ *
+ * The interval is checked on writes, on open(), pending() and cursor get(), rewind() and last(),
+ * an idle process keeps the transaction and its snapshot open until then. The pending transaction
+ * is also committed by begin() and when the object is destroyed (failures are then only reported
+ * as warnings). Commits follow the connection's transaction_sync setting (off by default),
+ * use flush(true) for durability points. A size of 0 without interval disables batching.
+ *
+ *<code>
+ *	$db = new Phalcon\Storage\Wiredtiger('/var/data/events', 'create,log=(enabled)');
+ *	$db->setBatching(1000, 0.05);
+ *	$cursor = $db->open('table:events');
+ *	foreach ($events as $key => $event) {
+ *		$cursor->set($key, $event);
+ *	}
+ *	$db->flush(true);
+ *</code>
+ *
+ * @param int $size
+ * @param float $interval
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Wiredtiger, setBatching)
+{
+	zval *size, *interval = NULL;
+	phalcon_storage_wiredtiger_object *intern;
+
+	phalcon_fetch_params(0, 1, 1, &size, &interval);
+
+	intern = phalcon_storage_wiredtiger_object_from_obj(Z_OBJ_P(getThis()));
+
+	intern->batch_size = zval_get_long(size);
+	intern->batch_interval = interval ? zval_get_double(interval) : 0;
+
+	if (intern->batch_size <= 0 && intern->batch_interval <= 0) {
+		if (phalcon_storage_wiredtiger_batch_flush(intern) != PHALCON_STORAGE_WIREDTIGER_OK) {
+			return;
+		}
+	}
+	RETURN_TRUE;
+}
+
+/**
+ * Commits the pending batch, with $sync waits until the log reached the disk
+ *
+ * @param boolean $sync
+ * @return boolean
+ */
+PHP_METHOD(Phalcon_Storage_Wiredtiger, flush)
+{
+	zval *sync = NULL;
+	phalcon_storage_wiredtiger_object *intern;
+	int ret;
+
+	phalcon_fetch_params(0, 0, 1, &sync);
+
+	intern = phalcon_storage_wiredtiger_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (phalcon_storage_wiredtiger_batch_flush(intern) != PHALCON_STORAGE_WIREDTIGER_OK) {
+		return;
+	}
+
+	if (sync && zend_is_true(sync)) {
+		ret = intern->session->transaction_sync(intern->session, NULL);
+		if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
+			PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error transaction sync %s", wiredtiger_strerror(ret));
+			return;
+		}
+	}
+	RETURN_TRUE;
+}
+
+/**
+ * Returns the number of writes in the pending batch
+ *
+ * @return int
+ */
+PHP_METHOD(Phalcon_Storage_Wiredtiger, pending)
+{
+	phalcon_storage_wiredtiger_object *intern;
+
+	intern = phalcon_storage_wiredtiger_object_from_obj(Z_OBJ_P(getThis()));
+
+	if (phalcon_storage_wiredtiger_batch_expire(intern) != PHALCON_STORAGE_WIREDTIGER_OK) {
+		return;
+	}
+
+	RETURN_LONG(intern->pending);
+}
@@ -28,9 +28,18 @@
 
 #define PHALCON_STORAGE_WIREDTIGER_OK		0
 
+#define PHALCON_STORAGE_WIREDTIGER_TXN_NONE		0
+#define PHALCON_STORAGE_WIREDTIGER_TXN_BATCH	1
+#define PHALCON_STORAGE_WIREDTIGER_TXN_USER		2
+
 typedef struct {
     WT_CONNECTION *connection;
     WT_SESSION *session;
+	int txn; /* PHALCON_STORAGE_WIREDTIGER_TXN_* */
+	zend_long batch_size;
+	zend_long pending;
+	double batch_interval;
+	double batch_started;
 	zend_object std;
 } phalcon_storage_wiredtiger_object;
 
@@ -44,6 +53,12 @@ static inline phalcon_storage_wiredtiger_object *phalcon_storage_wiredtiger_obje
 
 extern zend_class_entry *phalcon_storage_wiredtiger_ce;
 
+int phalcon_storage_wiredtiger_batch_begin(phalcon_storage_wiredtiger_object *intern);
+int phalcon_storage_wiredtiger_batch_end(phalcon_storage_wiredtiger_object *intern, int ret);
+int phalcon_storage_wiredtiger_batch_commit(phalcon_storage_wiredtiger_object *intern);
+int phalcon_storage_wiredtiger_batch_flush(phalcon_storage_wiredtiger_object *intern);
+int phalcon_storage_wiredtiger_batch_expire(phalcon_storage_wiredtiger_object *intern);
+
 PHALCON_INIT_CLASS(Phalcon_Storage_Wiredtiger);
 
 # endif
@@ -228,6 +228,7 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, reconfigure)
 PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, set)
 {
 	zval *key, *value;
+	phalcon_storage_wiredtiger_object *db_intern;
 	phalcon_storage_wiredtiger_cursor_object *intern;
 	phalcon_storage_wiredtiger_pack_item pk = { 0, }, pv = { 0, };
 	WT_ITEM item;
@@ -236,6 +237,13 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, set)
 	phalcon_fetch_params(0, 2, 0, &key, &value);
 
 	intern = phalcon_storage_wiredtiger_cursor_object_from_obj(Z_OBJ_P(getThis()));
+	db_intern = phalcon_storage_wiredtiger_object_from_obj(intern->db);
+
+	ret = phalcon_storage_wiredtiger_batch_begin(db_intern);
+	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error open a transaction %s", wiredtiger_strerror(ret));
+		return;
+	}
 
 	if (PHALCON_IS_EMPTY(key)) {
 		if (strcmp(intern->cursor->key_format, "r") != 0) {
@@ -279,12 +287,16 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, set)
 	} else {
 		ret = intern->cursor->update(intern->cursor);
 	}
+	ret = phalcon_storage_wiredtiger_batch_end(db_intern, ret);
 
 	phalcon_storage_wiredtiger_pack_item_free(&pk);
 	phalcon_storage_wiredtiger_pack_item_free(&pv);
 
 	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
-		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "%s", wiredtiger_strerror(ret));
+		/* a lost batch was already reported */
+		if (!EG(exception)) {
+			PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "%s", wiredtiger_strerror(ret));
+		}
 		return;
 	} else {
 		RETVAL_TRUE;
@@ -344,6 +356,11 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, get)
 
 	intern = phalcon_storage_wiredtiger_cursor_object_from_obj(Z_OBJ_P(getThis()));
 
+	/* committing resets the cursors, only done where the cursor is positioned anew */
+	if (phalcon_storage_wiredtiger_batch_expire(phalcon_storage_wiredtiger_object_from_obj(intern->db)) != PHALCON_STORAGE_WIREDTIGER_OK) {
+		return;
+	}
+
 	ret = phalcon_storage_wiredtiger_pack_key(intern, &pk, key);
 	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
 		phalcon_storage_wiredtiger_pack_item_free(&pk);
@@ -417,6 +434,7 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, gets)
 PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, delete)
 {
 	zval *key;
+	phalcon_storage_wiredtiger_object *db_intern;
 	phalcon_storage_wiredtiger_cursor_object *intern;
 	phalcon_storage_wiredtiger_pack_item pk = { 0, };
 	WT_ITEM item;
@@ -425,6 +443,7 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, delete)
 	phalcon_fetch_params(0, 1, 0, &key);
 
 	intern = phalcon_storage_wiredtiger_cursor_object_from_obj(Z_OBJ_P(getThis()));
+	db_intern = phalcon_storage_wiredtiger_object_from_obj(intern->db);
 
 	ret = phalcon_storage_wiredtiger_pack_key(intern, &pk, key);
 	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
@@ -433,6 +452,13 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, delete)
 		return;
 	}
 
+	ret = phalcon_storage_wiredtiger_batch_begin(db_intern);
+	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
+		phalcon_storage_wiredtiger_pack_item_free(&pk);
+		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error open a transaction %s", wiredtiger_strerror(ret));
+		return;
+	}
+
 	item.data = pk.data;
 	item.size = pk.size;
 
@@ -443,9 +469,12 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, delete)
 		RETVAL_FALSE;
 	} else {
 		ret = intern->cursor->remove(intern->cursor);
+		ret = phalcon_storage_wiredtiger_batch_end(db_intern, ret);
 		if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
 			phalcon_storage_wiredtiger_pack_item_free(&pk);
-			PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error remove value %s", wiredtiger_strerror(ret));
+			if (!EG(exception)) {
+				PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Error remove value %s", wiredtiger_strerror(ret));
+			}
 			return;
 		} else {
 			RETVAL_TRUE;
@@ -607,6 +636,10 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, rewind)
 	intern = phalcon_storage_wiredtiger_cursor_object_from_obj(Z_OBJ_P(getThis()));
 	phalcon_storage_wiredtiger_cursor_reset(intern);
 
+	if (phalcon_storage_wiredtiger_batch_expire(phalcon_storage_wiredtiger_object_from_obj(intern->db)) != PHALCON_STORAGE_WIREDTIGER_OK) {
+		RETURN_FALSE;
+	}
+
 	ret = intern->cursor->reset(intern->cursor);
 	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
 		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Invalid rewind: %s", wiredtiger_strerror(ret));
@@ -634,6 +667,10 @@ PHP_METHOD(Phalcon_Storage_Wiredtiger_Cursor, last)
 	intern = phalcon_storage_wiredtiger_cursor_object_from_obj(Z_OBJ_P(getThis()));
 	phalcon_storage_wiredtiger_cursor_reset(intern);
 
+	if (phalcon_storage_wiredtiger_batch_expire(phalcon_storage_wiredtiger_object_from_obj(intern->db)) != PHALCON_STORAGE_WIREDTIGER_OK) {
+		RETURN_FALSE;
+	}
+
 	ret = intern->cursor->reset(intern->cursor);
 	if (ret != PHALCON_STORAGE_WIREDTIGER_OK) {
 		PHALCON_THROW_EXCEPTION_FORMAT(phalcon_storage_exception_ce, "Invalid rewind: %s", wiredtiger_strerror(ret));
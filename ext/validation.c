@@ -24,6 +24,11 @@
 #include "validation/message/group.h"
 #include "validation/validator.h"
 #include "validation/validatorinterface.h"
+#include "validation/validator/presenceof.h"
+#include "validation/validator/stringlength.h"
+#include "validation/validator/numericality.h"
+#include "validation/validator/inclusionin.h"
+#include "validation/validator/regex.h"
 #include "translate/adapterinterface.h"
 #include "di.h"
 #include "di/injectable.h"
@@ -45,6 +50,10 @@
 
 #include "interned-strings.h"
 
+#ifdef PHALCON_USE_PHP_PCRE
+#include <ext/pcre/php_pcre.h>
+#endif
+
 /**
  * Phalcon\Validation
  *
@@ -55,6 +64,7 @@ zend_class_entry *phalcon_validation_ce;
 PHP_METHOD(Phalcon_Validation, __construct);
 PHP_METHOD(Phalcon_Validation, validate);
 PHP_METHOD(Phalcon_Validation, add);
+PHP_METHOD(Phalcon_Validation, compile);
 PHP_METHOD(Phalcon_Validation, setFilters);
 PHP_METHOD(Phalcon_Validation, getFilters);
 PHP_METHOD(Phalcon_Validation, getValidators);
@@ -125,6 +135,7 @@ static const zend_function_entry phalcon_validation_method_entry[] = {
 	PHP_ME(Phalcon_Validation, __construct, arginfo_phalcon_validation___construct, ZEND_ACC_PUBLIC|ZEND_ACC_CTOR)
 	PHP_ME(Phalcon_Validation, validate, arginfo_phalcon_validationinterface_validate, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Validation, add, arginfo_phalcon_validationinterface_add, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Validation, compile, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Validation, setFilters, arginfo_phalcon_validation_setfilters, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Validation, getFilters, arginfo_phalcon_validation_getfilters, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Validation, getValidators, NULL, ZEND_ACC_PUBLIC)
@@ -145,12 +156,63 @@ static const zend_function_entry phalcon_validation_method_entry[] = {
 	PHP_FE_END
 };
 
+static void phalcon_validation_free_rules(phalcon_validation_object *intern)
+{
+	phalcon_validation_rule *rule;
+	uint32_t i;
+
+	for (i = 0; i < intern->num_rules; i++) {
+		rule = &intern->rules[i];
+
+		zval_ptr_dtor(&rule->attribute);
+		zval_ptr_dtor(&rule->validator);
+
+		if (rule->domain) {
+			zend_hash_destroy(rule->domain);
+			FREE_HASHTABLE(rule->domain);
+		}
+
+		if (rule->pattern) {
+			zend_string_release(rule->pattern);
+		}
+	}
+
+	if (intern->rules) {
+		efree(intern->rules);
+	}
+
+	intern->rules = NULL;
+	intern->num_rules = 0;
+}
+
+zend_object_handlers phalcon_validation_object_handlers;
+zend_object* phalcon_validation_object_create_handler(zend_class_entry *ce)
+{
+	phalcon_validation_object *intern = ecalloc(1, sizeof(phalcon_validation_object) + zend_object_properties_size(ce));
+	intern->std.ce = ce;
+
+	zend_object_std_init(&intern->std, ce);
+	object_properties_init(&intern->std, ce);
+	intern->std.handlers = &phalcon_validation_object_handlers;
+
+	return &intern->std;
+}
+
+void phalcon_validation_object_free_handler(zend_object *object)
+{
+	phalcon_validation_object *intern = phalcon_validation_object_from_obj(object);
+
+	phalcon_validation_free_rules(intern);
+
+	zend_object_std_dtor(object);
+}
+
 /**
  * Phalcon\Validation initializer
  */
 PHALCON_INIT_CLASS(Phalcon_Validation){
 
-	PHALCON_REGISTER_CLASS_EX(Phalcon, Validation, validation, phalcon_di_injectable_ce, phalcon_validation_method_entry, 0);
+	PHALCON_REGISTER_CLASS_CREATE_OBJECT_EX(Phalcon, Validation, validation, phalcon_di_injectable_ce, phalcon_validation_method_entry, 0);
 
 	zend_declare_property_null(phalcon_validation_ce, SL("_data"), ZEND_ACC_PROTECTED);
 	zend_declare_property_null(phalcon_validation_ce, SL("_entity"), ZEND_ACC_PROTECTED);
@@ -181,6 +243,242 @@ int phalcon_validation_getdefaultmessage_helper(zval *retval, const zend_class_e
 	return ret;
 }
 
+static int phalcon_validation_check_presenceof(phalcon_validation_rule *rule, zval *value, int allow_empty)
+{
+	return PHALCON_IS_NOT_EMPTY(value);
+}
+
+static int phalcon_validation_check_numericality(phalcon_validation_rule *rule, zval *value, int allow_empty)
+{
+	if (allow_empty && PHALCON_IS_EMPTY_STRING(value)) {
+		return 1;
+	}
+
+	return phalcon_is_numeric(value);
+}
+
+static int phalcon_validation_check_stringlength(phalcon_validation_rule *rule, zval *value, int allow_empty)
+{
+	const unsigned char *str;
+	size_t i, length;
+
+	if (allow_empty && PHALCON_IS_EMPTY_STRING(value)) {
+		return 1;
+	}
+
+	if (Z_TYPE_P(value) != IS_STRING) {
+		return 0;
+	}
+
+	/* Multibyte strings are measured by the validator itself */
+	str = (const unsigned char*)Z_STRVAL_P(value);
+	length = Z_STRLEN_P(value);
+	for (i = 0; i < length; i++) {
+		if (str[i] & 0x80) {
+			return 0;
+		}
+	}
+
+	if (rule->has_max && rule->max < (zend_long)length) {
+		return 0;
+	}
+
+	if (rule->has_min && (zend_long)length < rule->min) {
+		return 0;
+	}
+
+	return 1;
+}
+
+static int phalcon_validation_check_inclusionin(phalcon_validation_rule *rule, zval *value, int allow_empty)
+{
+	zend_string *key;
+	int found;
+
+	if (allow_empty && PHALCON_IS_EMPTY_STRING(value)) {
+		return 1;
+	}
+
+	if (Z_TYPE_P(value) == IS_STRING) {
+		return zend_hash_exists(rule->domain, Z_STR_P(value));
+	}
+
+	if (Z_TYPE_P(value) == IS_LONG) {
+		key = zend_long_to_str(Z_LVAL_P(value));
+		found = zend_hash_exists(rule->domain, key);
+		zend_string_release(key);
+		return found;
+	}
+
+	return 0;
+}
+
+#ifdef PHALCON_USE_PHP_PCRE
+static int phalcon_validation_check_regex(phalcon_validation_rule *rule, zval *value, int allow_empty)
+{
+	pcre_cache_entry *pce;
+	zval matched = {}, matches = {}, *match_zero;
+	int valid = 0;
+
+	if (allow_empty && PHALCON_IS_EMPTY_STRING(value)) {
+		return 1;
+	}
+
+	if (Z_TYPE_P(value) != IS_STRING || (pce = pcre_get_compiled_regex_cache(rule->pattern)) == NULL) {
+		return 0;
+	}
+
+	ZVAL_NULL(&matches);
+#if PHP_VERSION_ID >= 70400
+	php_pcre_match_impl(pce, Z_STR_P(value), &matched, &matches, 0, 0, 0, 0);
+#else
+	php_pcre_match_impl(pce, Z_STRVAL_P(value), Z_STRLEN_P(value), &matched, &matches, 0, 0, 0, 0);
+#endif
+
+	/* The whole value must be matched */
+	if (Z_TYPE(matched) == IS_LONG && Z_LVAL(matched) > 0 && Z_TYPE(matches) == IS_ARRAY) {
+		match_zero = zend_hash_index_find(Z_ARRVAL(matches), 0);
+		valid = match_zero && Z_TYPE_P(match_zero) == IS_STRING && zend_string_equals(Z_STR_P(match_zero), Z_STR_P(value));
+	}
+	zval_ptr_dtor(&matches);
+
+	return valid;
+}
+#endif
+
+/**
+ * Reads the 'min' and 'max' options of Phalcon\Validation\Validator\StringLength, only integer limits are compiled
+ */
+static int phalcon_validation_compile_limit(zval *options, const char *name, zend_long *limit, int *has_limit)
+{
+	zval option = {};
+	zend_long lval;
+	double dval;
+
+	if (!phalcon_array_isset_fetch_str(&option, options, name, strlen(name), PH_READONLY) || Z_TYPE(option) == IS_NULL) {
+		*has_limit = 0;
+		return SUCCESS;
+	}
+
+	if (Z_TYPE(option) == IS_LONG) {
+		lval = Z_LVAL(option);
+	} else if (Z_TYPE(option) != IS_STRING || is_numeric_string(Z_STRVAL(option), Z_STRLEN(option), &lval, &dval, 0) != IS_LONG) {
+		return FAILURE;
+	}
+
+	*limit = lval;
+	*has_limit = 1;
+	return SUCCESS;
+}
+
+/**
+ * Replaces the validator method call by a native check for the built-in validators whose options allow it.
+ * Rules without a check, or whose check does not pass, are dispatched to the validator
+ */
+static void phalcon_validation_compile_rule(phalcon_validation_rule *rule)
+{
+	zval options = {}, option = {}, *item;
+	zend_class_entry *ce = Z_OBJCE(rule->validator);
+
+	rule->allow_empty = -1;
+
+	if (Z_TYPE(rule->attribute) != IS_STRING) {
+		return;
+	}
+
+	phalcon_read_property(&options, &rule->validator, SL("_options"), PH_READONLY);
+	if (Z_TYPE(options) != IS_ARRAY) {
+		return;
+	}
+
+	if (phalcon_array_isset_fetch_str(&option, &options, SL("allowEmpty"), PH_READONLY) && Z_TYPE(option) != IS_NULL) {
+		rule->allow_empty = zend_is_true(&option);
+	}
+
+	if (ce == phalcon_validation_validator_presenceof_ce) {
+		rule->check = phalcon_validation_check_presenceof;
+	} else if (ce == phalcon_validation_validator_numericality_ce) {
+		rule->check = phalcon_validation_check_numericality;
+	} else if (ce == phalcon_validation_validator_stringlength_ce) {
+		if (phalcon_validation_compile_limit(&options, "min", &rule->min, &rule->has_min) == FAILURE
+			|| phalcon_validation_compile_limit(&options, "max", &rule->max, &rule->has_max) == FAILURE
+			|| (!rule->has_min && !rule->has_max)) {
+			return;
+		}
+		rule->check = phalcon_validation_check_stringlength;
+	} else if (ce == phalcon_validation_validator_inclusionin_ce) {
+		if (!phalcon_array_isset_fetch_str(&option, &options, SL("domain"), PH_READONLY) || Z_TYPE(option) != IS_ARRAY) {
+			return;
+		}
+
+		ALLOC_HASHTABLE(rule->domain);
+		zend_hash_init(rule->domain, zend_hash_num_elements(Z_ARRVAL(option)), NULL, NULL, 0);
+
+		ZEND_HASH_FOREACH_VAL(Z_ARRVAL(option), item) {
+			ZVAL_DEREF(item);
+			if (Z_TYPE_P(item) == IS_STRING) {
+				zend_hash_add_empty_element(rule->domain, Z_STR_P(item));
+			} else if (Z_TYPE_P(item) == IS_LONG) {
+				zend_string *key = zend_long_to_str(Z_LVAL_P(item));
+				zend_hash_add_empty_element(rule->domain, key);
+				zend_string_release(key);
+			} else {
+				/* Loose comparisons against other types are left to the validator */
+				zend_hash_destroy(rule->domain);
+				FREE_HASHTABLE(rule->domain);
+				rule->domain = NULL;
+				return;
+			}
+		} ZEND_HASH_FOREACH_END();
+
+		rule->check = phalcon_validation_check_inclusionin;
+	}
+#ifdef PHALCON_USE_PHP_PCRE
+	else if (ce == phalcon_validation_validator_regex_ce) {
+		if (!phalcon_array_isset_fetch_str(&option, &options, SL("pattern"), PH_READONLY) || Z_TYPE(option) != IS_STRING) {
+			return;
+		}
+
+		/* Compiled once here, later lookups hit the PCRE cache */
+		if (pcre_get_compiled_regex_cache(Z_STR(option)) == NULL) {
+			return;
+		}
+
+		rule->pattern = zend_string_copy(Z_STR(option));
+		rule->check = phalcon_validation_check_regex;
+	}
+#endif
+}
+
+/**
+ * Reads the value of a field without calling getValue() when no filter, entity or override can change it
+ */
+static int phalcon_validation_fetch_value(zval *retval, zval *object, zval *attribute, int fast)
+{
+	zval values = {}, entity = {}, data = {}, filters = {}, *params[1];
+
+	if (fast) {
+		phalcon_read_property(&values, object, SL("_values"), PH_READONLY);
+		if (Z_TYPE(values) == IS_ARRAY && phalcon_array_isset_fetch(retval, &values, attribute, PH_COPY)) {
+			return SUCCESS;
+		}
+
+		phalcon_read_property(&entity, object, SL("_entity"), PH_READONLY);
+		phalcon_read_property(&data, object, SL("_data"), PH_READONLY);
+		phalcon_read_property(&filters, object, SL("_filters"), PH_READONLY);
+
+		if (Z_TYPE(entity) != IS_OBJECT && Z_TYPE(data) == IS_ARRAY && (Z_TYPE(filters) != IS_ARRAY || !phalcon_array_isset(&filters, attribute))) {
+			if (!phalcon_array_isset_fetch(retval, &data, attribute, PH_COPY)) {
+				ZVAL_NULL(retval);
+			}
+			return SUCCESS;
+		}
+	}
+
+	params[0] = attribute;
+	return phalcon_call_method(retval, object, "getvalue", 1, params);
+}
+
 /**
  * Phalcon\Validation constructor
  *
@@ -242,6 +540,7 @@ PHP_METHOD(Phalcon_Validation, __construct){
 PHP_METHOD(Phalcon_Validation, validate){
 
 	zval *data = NULL, *entity = NULL, validators = {}, allow_empty = {}, messages = {}, status = {}, *scope;
+	phalcon_validation_object *intern;
 
 	phalcon_fetch_params(0, 0, 2, &data, &entity);
 
@@ -293,47 +592,83 @@ PHP_METHOD(Phalcon_Validation, validate){
 		phalcon_update_property(getThis(), SL("_data"), data);
 	}
 
-	ZEND_HASH_FOREACH_VAL(Z_ARRVAL(validators), scope) {
-		zval attribute = {}, validator = {}, attribute_validators = {}, *attribute_validator, must_cancel = {};
-		if (Z_TYPE_P(scope) != IS_ARRAY) {
-			PHALCON_THROW_EXCEPTION_STR(phalcon_validation_exception_ce, "The validator scope is not valid");
-			return;
-		}
+	intern = phalcon_validation_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->rules) {
+		zval value = {}, must_cancel = {};
+		phalcon_validation_rule *rule;
+		uint32_t i;
 
-		phalcon_array_fetch_long(&attribute, scope, 0, PH_NOISY|PH_READONLY);
-		phalcon_array_fetch_long(&validator, scope, 1, PH_NOISY|PH_READONLY);
+		for (i = 0; i < intern->num_rules; i++) {
+			rule = &intern->rules[i];
 
-		if (Z_TYPE(validator) != IS_ARRAY) {
-			array_init_size(&attribute_validators, 1);
-			phalcon_array_append(&attribute_validators, &validator, PH_COPY);
-		} else {
-			ZVAL_COPY(&attribute_validators, &validator);
-		}
+			if (rule->check) {
+				int passed;
 
-		ZEND_HASH_FOREACH_VAL(Z_ARRVAL(attribute_validators), attribute_validator) {
-			if (Z_TYPE_P(attribute_validator) != IS_OBJECT) {
-				PHALCON_THROW_EXCEPTION_STR(phalcon_validation_exception_ce, "One of the validators is not valid");
-				return;
-			}
+				RETURN_ON_FAILURE(phalcon_validation_fetch_value(&value, getThis(), &rule->attribute, intern->fast_value));
+				passed = rule->check(rule, &value, rule->allow_empty >= 0 ? rule->allow_empty : zend_is_true(&allow_empty));
+				zval_ptr_dtor(&value);
 
-			PHALCON_CALL_METHOD(&status, attribute_validator, "validate", getThis(), &attribute, &allow_empty);
+				if (passed) {
+					continue;
+				}
+			}
 
 			/**
-			 * Check if the validation must be canceled if this validator fails
+			 * The validator builds the messages, only failing values get here
 			 */
+			PHALCON_CALL_METHOD(&status, &rule->validator, "validate", getThis(), &rule->attribute, &allow_empty);
 			if (PHALCON_IS_FALSE(&status)) {
-				RETURN_ON_FAILURE(phalcon_validation_validator_getoption_helper(&must_cancel, Z_OBJCE_P(attribute_validator), attribute_validator, "cancelOnFail"));
-
+				RETURN_ON_FAILURE(phalcon_validation_validator_getoption_helper(&must_cancel, Z_OBJCE(rule->validator), &rule->validator, "cancelOnFail"));
 				if (zend_is_true(&must_cancel)) {
+					zval_ptr_dtor(&must_cancel);
 					break;
 				}
+				zval_ptr_dtor(&must_cancel);
 			}
-		} ZEND_HASH_FOREACH_END();
-		zval_ptr_dtor(&attribute_validators);
-		if (zend_is_true(&must_cancel)) {
-			break;
 		}
-	} ZEND_HASH_FOREACH_END();
+	} else {
+		ZEND_HASH_FOREACH_VAL(Z_ARRVAL(validators), scope) {
+			zval attribute = {}, validator = {}, attribute_validators = {}, *attribute_validator, must_cancel = {};
+			if (Z_TYPE_P(scope) != IS_ARRAY) {
+				PHALCON_THROW_EXCEPTION_STR(phalcon_validation_exception_ce, "The validator scope is not valid");
+				return;
+			}
+
+			phalcon_array_fetch_long(&attribute, scope, 0, PH_NOISY|PH_READONLY);
+			phalcon_array_fetch_long(&validator, scope, 1, PH_NOISY|PH_READONLY);
+
+			if (Z_TYPE(validator) != IS_ARRAY) {
+				array_init_size(&attribute_validators, 1);
+				phalcon_array_append(&attribute_validators, &validator, PH_COPY);
+			} else {
+				ZVAL_COPY(&attribute_validators, &validator);
+			}
+
+			ZEND_HASH_FOREACH_VAL(Z_ARRVAL(attribute_validators), attribute_validator) {
+				if (Z_TYPE_P(attribute_validator) != IS_OBJECT) {
+					PHALCON_THROW_EXCEPTION_STR(phalcon_validation_exception_ce, "One of the validators is not valid");
+					return;
+				}
+
+				PHALCON_CALL_METHOD(&status, attribute_validator, "validate", getThis(), &attribute, &allow_empty);
+
+				/**
+				 * Check if the validation must be canceled if this validator fails
+				 */
+				if (PHALCON_IS_FALSE(&status)) {
+					RETURN_ON_FAILURE(phalcon_validation_validator_getoption_helper(&must_cancel, Z_OBJCE_P(attribute_validator), attribute_validator, "cancelOnFail"));
+
+					if (zend_is_true(&must_cancel)) {
+						break;
+					}
+				}
+			} ZEND_HASH_FOREACH_END();
+			zval_ptr_dtor(&attribute_validators);
+			if (zend_is_true(&must_cancel)) {
+				break;
+			}
+		} ZEND_HASH_FOREACH_END();
+	}
 
 	/**
 	 * Get the messages generated by the validators
@@ -364,6 +699,9 @@ PHP_METHOD(Phalcon_Validation, add){
 		return;
 	}
 
+	/* The compiled plan no longer matches the validators */
+	phalcon_validation_free_rules(phalcon_validation_object_from_obj(Z_OBJ_P(getThis())));
+
 	if (Z_TYPE_P(_validator) == IS_STRING) {
 		array_init_size(&validator, 1);
 		phalcon_array_append(&validator, _validator, PH_COPY);
@@ -435,6 +773,97 @@ PHP_METHOD(Phalcon_Validation, add){
 	RETURN_THIS();
 }
 
+static void phalcon_validation_add_rule(phalcon_validation_object *intern, zval *attribute, zval *validator)
+{
+	phalcon_validation_rule *rule = &intern->rules[intern->num_rules++];
+
+	ZVAL_COPY(&rule->attribute, attribute);
+	ZVAL_COPY(&rule->validator, validator);
+
+	phalcon_validation_compile_rule(rule);
+}
+
+/**
+ * Builds a validation plan from the added validators. PresenceOf, StringLength, Numericality,
+ * InclusionIn and Regex are checked natively with their options parsed once, the validators
+ * are only called to build the messages when a value does not pass. Adding validators
+ * discards the plan, options changed on the validators are not seen until compile() is called again
+ *
+ *<code>
+ * $validation = new Phalcon\Validation();
+ * $validation->add('name', new Phalcon\Validation\Validator\PresenceOf())
+ *            ->add('age', new Phalcon\Validation\Validator\Numericality())
+ *            ->compile();
+ *
+ * foreach ($payloads as $payload) {
+ *     $messages = $validation->validate($payload);
+ * }
+ *</code>
+ *
+ * @return Phalcon\Validation
+ */
+PHP_METHOD(Phalcon_Validation, compile){
+
+	zval validators = {}, *scope, *attribute_validator;
+	phalcon_validation_object *intern = phalcon_validation_object_from_obj(Z_OBJ_P(getThis()));
+	zend_function *fbc;
+	uint32_t num_rules = 0;
+
+	phalcon_validation_free_rules(intern);
+
+	phalcon_read_property(&validators, getThis(), SL("_validators"), PH_READONLY);
+	if (Z_TYPE(validators) != IS_ARRAY) {
+		PHALCON_THROW_EXCEPTION_STR(phalcon_validation_exception_ce, "There are no validators to validate");
+		return;
+	}
+
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL(validators), scope) {
+		zval validator = {};
+		if (Z_TYPE_P(scope) != IS_ARRAY || !phalcon_array_isset_fetch_long(&validator, scope, 1, PH_READONLY)) {
+			PHALCON_THROW_EXCEPTION_STR(phalcon_validation_exception_ce, "The validator scope is not valid");
+			return;
+		}
+
+		num_rules += Z_TYPE(validator) == IS_ARRAY ? zend_hash_num_elements(Z_ARRVAL(validator)) : 1;
+	} ZEND_HASH_FOREACH_END();
+
+	intern->rules = ecalloc(num_rules ? num_rules : 1, sizeof(phalcon_validation_rule));
+
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL(validators), scope) {
+		zval attribute = {}, validator = {};
+
+		phalcon_array_fetch_long(&attribute, scope, 0, PH_NOISY|PH_READONLY);
+		phalcon_array_fetch_long(&validator, scope, 1, PH_NOISY|PH_READONLY);
+
+		if (Z_TYPE(validator) != IS_ARRAY) {
+			if (Z_TYPE(validator) != IS_OBJECT) {
+				phalcon_validation_free_rules(intern);
+				PHALCON_THROW_EXCEPTION_STR(phalcon_validation_exception_ce, "One of the validators is not valid");
+				return;
+			}
+			phalcon_validation_add_rule(intern, &attribute, &validator);
+			continue;
+		}
+
+		ZEND_HASH_FOREACH_VAL(Z_ARRVAL(validator), attribute_validator) {
+			if (Z_TYPE_P(attribute_validator) != IS_OBJECT) {
+				phalcon_validation_free_rules(intern);
+				PHALCON_THROW_EXCEPTION_STR(phalcon_validation_exception_ce, "One of the validators is not valid");
+				return;
+			}
+			phalcon_validation_add_rule(intern, &attribute, attribute_validator);
+		} ZEND_HASH_FOREACH_END();
+	} ZEND_HASH_FOREACH_END();
+
+	/**
+	 * Values are read directly from the data unless getValue() is overridden
+	 */
+	fbc = zend_hash_str_find_ptr(&Z_OBJCE_P(getThis())->function_table, SL("getvalue"));
+	intern->fast_value = fbc && fbc->common.scope == phalcon_validation_ce;
+
+	RETURN_THIS();
+}
+
 /**
  * Adds filters to the field
  *
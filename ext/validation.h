@@ -22,6 +22,34 @@
 
 #include "php_phalcon.h"
 
+typedef struct _phalcon_validation_rule phalcon_validation_rule;
+
+typedef int (*phalcon_validation_check_t)(phalcon_validation_rule *rule, zval *value, int allow_empty);
+
+struct _phalcon_validation_rule {
+	zval attribute;
+	zval validator;
+	phalcon_validation_check_t check;
+	int allow_empty;
+	int has_min;
+	int has_max;
+	zend_long min;
+	zend_long max;
+	HashTable *domain;
+	zend_string *pattern;
+};
+
+typedef struct {
+	phalcon_validation_rule *rules;
+	uint32_t num_rules;
+	int fast_value;
+	zend_object std;
+} phalcon_validation_object;
+
+static inline phalcon_validation_object *phalcon_validation_object_from_obj(zend_object *obj) {
+	return (phalcon_validation_object*)((char*)(obj) - XtOffsetOf(phalcon_validation_object, std));
+}
+
 extern zend_class_entry *phalcon_validation_ce;
 
 PHALCON_INIT_CLASS(Phalcon_Validation);
@@ -99,8 +99,7 @@ static int phalcon_websocket_client_callback(struct lws *wsi, enum lws_callback_
 	phalcon_websocket_connection_object * connection_object;
 	zval *connection = user;
 	zval retval = {}, obj = {};
-	int n, return_code = 0, flag = 0;
-	zend_string *text;
+	int return_code = 0, flag = 0;
 
 	ZVAL_OBJ(&obj, &intern->std);
 
@@ -166,24 +165,10 @@ static int phalcon_websocket_client_callback(struct lws *wsi, enum lws_callback_
 				break;
 			}
 
-			while (connection_object->read_ptr != connection_object->write_ptr) {
-				text = connection_object->buf[connection_object->read_ptr];
-				n = lws_write(wsi, (unsigned char *)ZSTR_VAL(text), ZSTR_LEN(text), LWS_WRITE_TEXT);
-
-				if (n < 0) {
-					lwsl_err("Write to socket %lu failed with code %d\n", connection_object->id, n);
-					return 1;
-				}
-				if (n < (int) text->len) {
-					// TODO Implements partial write
-					connection_object->buf[connection_object->read_ptr] = NULL;
-					connection_object->read_ptr = (connection_object->read_ptr + 1) % PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE;
-					lwsl_err("Partial write\n");
-					return -1;
-				}
-
-				connection_object->buf[connection_object->read_ptr] = NULL;
-				connection_object->read_ptr = (connection_object->read_ptr + 1) % PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE;
+			// Client frames have to be masked, lws_write() frames each payload itself
+			if (phalcon_websocket_connection_flush(connection_object, 0) < 0) {
+				lwsl_err("Write to socket %lu failed\n", connection_object->id);
+				return 1;
 			}
 
 			break;
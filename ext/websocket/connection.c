@@ -35,47 +35,205 @@ PHP_METHOD(Phalcon_Websocket_Connection, sendJson);
 PHP_METHOD(Phalcon_Websocket_Connection, isConnected);
 PHP_METHOD(Phalcon_Websocket_Connection, getUid);
 PHP_METHOD(Phalcon_Websocket_Connection, disconnect);
+PHP_METHOD(Phalcon_Websocket_Connection, getBufferedAmount);
+PHP_METHOD(Phalcon_Websocket_Connection, setWatermarks);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_connection_send, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, binary, _IS_BOOL, 0)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_connection_sendjson, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, payload, 0, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_connection_setwatermarks, 0, 0, 2)
+	ZEND_ARG_TYPE_INFO(0, high, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, low, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
 const zend_function_entry phalcon_websocket_connection_method_entry[] = {
 	PHP_ME(Phalcon_Websocket_Connection, send, arginfo_phalcon_websocket_connection_send, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Websocket_Connection, sendJson, arginfo_phalcon_websocket_connection_sendjson, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Websocket_Connection, isConnected, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Websocket_Connection, getUid, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Websocket_Connection, disconnect, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Websocket_Connection, getBufferedAmount, NULL, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Websocket_Connection, setWatermarks, arginfo_phalcon_websocket_connection_setwatermarks, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
-int phalcon_websocket_connection_write(phalcon_websocket_connection_object *conn, zend_string *text) {
+phalcon_websocket_frame *phalcon_websocket_frame_create(const char *payload, size_t len, unsigned char opcode) {
+	phalcon_websocket_frame *frame;
+	unsigned char *p;
+
+	frame = emalloc(sizeof(phalcon_websocket_frame) + PHALCON_WEBSOCKET_FRAME_PRE + len);
+	frame->refcount = 1;
+	frame->opcode = opcode;
+	frame->len = len;
+
+	if (len) {
+		memcpy(frame->data + PHALCON_WEBSOCKET_FRAME_PRE, payload, len);
+	}
+
+	// Server frames are never masked, so the header is the same for every recipient
+	if (len < 126) {
+		frame->start = PHALCON_WEBSOCKET_FRAME_PRE - 2;
+		p = frame->data + frame->start;
+		p[1] = (unsigned char) len;
+	} else if (len < 65536) {
+		frame->start = PHALCON_WEBSOCKET_FRAME_PRE - 4;
+		p = frame->data + frame->start;
+		p[1] = 126;
+		p[2] = (unsigned char) (len >> 8);
+		p[3] = (unsigned char) len;
+	} else {
+		int i;
+
+		frame->start = PHALCON_WEBSOCKET_FRAME_PRE - 10;
+		p = frame->data + frame->start;
+		p[1] = 127;
+		for (i = 0; i < 8; i++) {
+			p[9 - i] = (unsigned char) ((uint64_t) len >> (8 * i));
+		}
+	}
+	p[0] = 0x80 | opcode;
+
+	return frame;
+}
+
+void phalcon_websocket_frame_release(phalcon_websocket_frame *frame) {
+	if (--frame->refcount == 0) {
+		efree(frame);
+	}
+}
+
+static void phalcon_websocket_connection_shift(phalcon_websocket_connection_object *conn) {
+	phalcon_websocket_frame_release(conn->queue[conn->queue_head]);
+	conn->queue[conn->queue_head] = NULL;
+	conn->queue_head = (conn->queue_head + 1) % conn->queue_size;
+	conn->queue_count--;
+	conn->queue_offset = 0;
+}
+
+/**
+ * Queues a frame without copying it, returns the payload length or -1 when
+ * the client is gone or the queue is above the high watermark
+ */
+int phalcon_websocket_connection_enqueue(phalcon_websocket_connection_object *conn, phalcon_websocket_frame *frame) {
+	uint32_t i;
+
 	if (!conn->connected) {
-		php_error_docref(NULL, E_WARNING, "Client is disconnected\n");
 		return -1;
 	}
-	if (((conn->write_ptr + 1) % PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE) == conn->read_ptr) {
-		php_error_docref(NULL, E_WARNING, "Write buffer is full\n");
+	if (conn->high_watermark && conn->buffered >= conn->high_watermark) {
+		conn->paused = 1;
 		return -1;
 	}
 
-	zend_string_addref(text);
-	conn->buf[conn->write_ptr] = text;
-	conn->write_ptr = (conn->write_ptr + 1) % PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE;
+	if (conn->queue_count == conn->queue_size) {
+		uint32_t size = conn->queue_size ? conn->queue_size * 2 : PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE;
+
+		conn->queue = safe_erealloc(conn->queue, size, sizeof(phalcon_websocket_frame *), 0);
+
+		// Unwrap the ring so it stays contiguous from the head
+		for (i = 0; i < conn->queue_head; i++) {
+			conn->queue[conn->queue_size + i] = conn->queue[i];
+		}
+		conn->queue_size = size;
+	}
+
+	frame->refcount++;
+	conn->queue[(conn->queue_head + conn->queue_count) % conn->queue_size] = frame;
+	conn->queue_count++;
+	conn->buffered += PHALCON_WEBSOCKET_FRAME_PRE + frame->len - frame->start;
+
+	if (conn->high_watermark && conn->buffered >= conn->high_watermark) {
+		conn->paused = 1;
+	}
 
 	lws_callback_on_writable(conn->wsi);
 
-	return text->len;
+	return frame->len;
+}
+
+int phalcon_websocket_connection_write(phalcon_websocket_connection_object *conn, zend_string *text, unsigned char opcode) {
+	phalcon_websocket_frame *frame;
+	int n;
+
+	if (!conn->connected) {
+		php_error_docref(NULL, E_WARNING, "Client is disconnected\n");
+		return -1;
+	}
+
+	frame = phalcon_websocket_frame_create(ZSTR_VAL(text), ZSTR_LEN(text), opcode);
+	n = phalcon_websocket_connection_enqueue(conn, frame);
+	phalcon_websocket_frame_release(frame);
+
+	return n;
+}
+
+/**
+ * Writes queued frames until the socket would block. Framed writes send the
+ * prebuilt header and payload as raw bytes, so a short write resumes from the
+ * offset on the next writeable callback. Otherwise lws_write() frames (and masks)
+ * each payload itself, as a client must.
+ */
+int phalcon_websocket_connection_flush(phalcon_websocket_connection_object *conn, zend_bool framed) {
+	phalcon_websocket_frame *frame;
+	size_t left;
+	int n;
+
+	while (conn->queue_count && !lws_send_pipe_choked(conn->wsi)) {
+		frame = conn->queue[conn->queue_head];
+
+		if (framed) {
+			left = PHALCON_WEBSOCKET_FRAME_PRE + frame->len - frame->start - conn->queue_offset;
+			n = lws_write(conn->wsi, frame->data + frame->start + conn->queue_offset, left, LWS_WRITE_RAW);
+		} else {
+			left = PHALCON_WEBSOCKET_FRAME_PRE + frame->len - frame->start;
+			n = lws_write(conn->wsi, frame->data + PHALCON_WEBSOCKET_FRAME_PRE, frame->len,
+				frame->opcode == PHALCON_WEBSOCKET_OPCODE_BINARY ? LWS_WRITE_BINARY : LWS_WRITE_TEXT);
+			if (n >= 0) {
+				n = (int) left;
+			}
+		}
+
+		if (n < 0) {
+			return -1;
+		}
+
+		conn->buffered -= n;
+		if ((size_t) n < left) {
+			conn->queue_offset += n;
+			break;
+		}
+
+		phalcon_websocket_connection_shift(conn);
+	}
+
+	if (conn->queue_count) {
+		lws_callback_on_writable(conn->wsi);
+	}
+
+	return 0;
+}
+
+/**
+ * Returns 1 once a paused connection has drained under its low watermark
+ */
+zend_bool phalcon_websocket_connection_drained(phalcon_websocket_connection_object *conn) {
+	if (conn->paused && conn->buffered <= conn->low_watermark) {
+		conn->paused = 0;
+		return 1;
+	}
+	return 0;
 }
 
 void phalcon_websocket_connection_close(phalcon_websocket_connection_object *conn, zend_string *reason) {
 	conn->connected = 0;
 	printf("Send close to %lu\n", conn->id);
-	lws_close_reason(conn->wsi, LWS_CLOSE_STATUS_NORMAL, (unsigned char *)reason->val, reason->len);
+	lws_close_reason(conn->wsi, LWS_CLOSE_STATUS_NORMAL, reason ? (unsigned char *)ZSTR_VAL(reason) : NULL, reason ? ZSTR_LEN(reason) : 0);
 	lws_callback_on_writable(conn->wsi);
 }
 
@@ -91,8 +249,16 @@ zend_object* phalcon_websocket_connection_object_create_handler(zend_class_entry
 
 	intern->connected = 0;
 	intern->wsi = NULL;
-	intern->read_ptr = 0;
-	intern->write_ptr = 0;
+	intern->queue = NULL;
+	intern->queue_head = 0;
+	intern->queue_count = 0;
+	intern->queue_size = 0;
+	intern->queue_offset = 0;
+	intern->buffered = 0;
+	intern->high_watermark = PHALCON_WEBSOCKET_HIGH_WATERMARK;
+	intern->low_watermark = PHALCON_WEBSOCKET_LOW_WATERMARK;
+	intern->paused = 0;
+	ZVAL_UNDEF(&intern->topics);
 
 	return &intern->std;
 }
@@ -101,14 +267,13 @@ void phalcon_websocket_connection_object_free_handler(zend_object *object)
 {
 	phalcon_websocket_connection_object *intern;
 	intern = phalcon_websocket_connection_object_from_obj(object);
-	while (intern->read_ptr != intern->write_ptr) {
-		zend_string_delref(intern->buf[intern->read_ptr]);
-		if (zend_string_refcount(intern->buf[intern->read_ptr]) < 1) {
-			zend_string_free(intern->buf[intern->read_ptr]);
-		}
-
-		intern->read_ptr = (intern->read_ptr + 1) % PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE;
+	while (intern->queue_count) {
+		phalcon_websocket_connection_shift(intern);
+	}
+	if (intern->queue) {
+		efree(intern->queue);
 	}
+	zval_ptr_dtor(&intern->topics);
 
 	zend_object_std_dtor(object);
 }
@@ -124,21 +289,25 @@ PHALCON_INIT_CLASS(Phalcon_Websocket_Connection){
 }
 
 /**
- * Send data to the client
+ * Send data to the client as a text frame, or a binary frame when $binary is true.
+ * Returns false when the client is disconnected or
+ * the write queue is above its high watermark (wait for Server::ON_DRAIN)
  */
 PHP_METHOD(Phalcon_Websocket_Connection, send)
 {
 	phalcon_websocket_connection_object *intern;
 	zend_string *text;
+	zend_bool binary = 0;
 	int n;
 
-	ZEND_PARSE_PARAMETERS_START(1, 1);
+	ZEND_PARSE_PARAMETERS_START(1, 2);
 		Z_PARAM_STR(text)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_BOOL(binary)
 	ZEND_PARSE_PARAMETERS_END();
 
 	intern = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(getThis()));
-	n = phalcon_websocket_connection_write(intern, text);
-	efree(text);
+	n = phalcon_websocket_connection_write(intern, text, binary ? PHALCON_WEBSOCKET_OPCODE_BINARY : PHALCON_WEBSOCKET_OPCODE_TEXT);
 	if (-1 == n) {
 		RETURN_FALSE;
 	}
@@ -160,7 +329,8 @@ PHP_METHOD(Phalcon_Websocket_Connection, sendJson)
 
 	intern = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(getThis()));
 	RETURN_ON_FAILURE(phalcon_json_encode(&text, val, 0));
-	n = phalcon_websocket_connection_write(intern, Z_STR(text));
+	n = phalcon_websocket_connection_write(intern, Z_STR(text), PHALCON_WEBSOCKET_OPCODE_TEXT);
+	zval_ptr_dtor(&text);
 	if (-1 == n) {
 		RETURN_FALSE;
 	}
@@ -197,7 +367,7 @@ PHP_METHOD(Phalcon_Websocket_Connection, getUid)
 PHP_METHOD(Phalcon_Websocket_Connection, disconnect)
 {
 	phalcon_websocket_connection_object *intern;
-	zend_string *reason;
+	zend_string *reason = NULL;
 
 	ZEND_PARSE_PARAMETERS_START(0, 1);
 		Z_PARAM_OPTIONAL
@@ -207,3 +377,44 @@ PHP_METHOD(Phalcon_Websocket_Connection, disconnect)
 	intern = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(getThis()));
 	phalcon_websocket_connection_close(intern, reason);
 }
+
+/**
+ * Get the number of bytes queued but not yet written to the socket
+ */
+PHP_METHOD(Phalcon_Websocket_Connection, getBufferedAmount)
+{
+	phalcon_websocket_connection_object *intern;
+
+	intern = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(getThis()));
+
+	RETURN_LONG(intern->buffered);
+}
+
+/**
+ * Set the write queue watermarks in bytes, writes are refused above the high one
+ * and Server::ON_DRAIN fires once the queue falls under the low one, 0 disables the limit
+ */
+PHP_METHOD(Phalcon_Websocket_Connection, setWatermarks)
+{
+	phalcon_websocket_connection_object *intern;
+	zend_long high, low;
+
+	ZEND_PARSE_PARAMETERS_START(2, 2);
+		Z_PARAM_LONG(high)
+		Z_PARAM_LONG(low)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (high < 0 || low < 0 || (high && low > high)) {
+		php_error_docref(NULL, E_WARNING, "The low watermark must be between 0 and the high watermark");
+		RETURN_FALSE;
+	}
+
+	intern = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(getThis()));
+	intern->high_watermark = high;
+	intern->low_watermark = low;
+	if (!high) {
+		intern->paused = 0;
+	}
+
+	RETURN_TRUE;
+}
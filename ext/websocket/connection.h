@@ -27,7 +27,36 @@
 #include <libwebsockets.h>
 
 #define PHALCON_WEBSOCKET_FREQUENCY 0.2
-#define PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE 30
+#define PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE 32
+
+#define PHALCON_WEBSOCKET_HIGH_WATERMARK (1024 * 1024)
+#define PHALCON_WEBSOCKET_LOW_WATERMARK (256 * 1024)
+
+#define PHALCON_WEBSOCKET_OPCODE_TEXT 0x1
+#define PHALCON_WEBSOCKET_OPCODE_BINARY 0x2
+
+#ifndef LWS_PRE
+# define LWS_PRE LWS_SEND_BUFFER_PRE_PADDING
+#endif
+
+// Room for the longest frame header (10 bytes) and for lws_write() in front of the payload
+#define PHALCON_WEBSOCKET_FRAME_PRE (LWS_PRE > 10 ? LWS_PRE : 10)
+
+/**
+ * A message framed once and shared by every connection it is queued on,
+ * the header is written right before the payload so the whole frame is contiguous
+ */
+typedef struct _phalcon_websocket_frame {
+	uint32_t refcount;
+	unsigned char opcode;
+
+	// Offset of the frame header in data
+	size_t start;
+
+	// Payload length, the payload starts at PHALCON_WEBSOCKET_FRAME_PRE
+	size_t len;
+	unsigned char data[1];
+} phalcon_websocket_frame;
 
 typedef struct _phalcon_websocket_connection_object {
 	// ID (unique on server)
@@ -36,10 +65,22 @@ typedef struct _phalcon_websocket_connection_object {
 	// Connection state (Connected/Disconnected)
 	zend_bool connected;
 
-	// Write buffer
-	zend_string *buf[PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE];
-	unsigned int read_ptr;
-	unsigned int write_ptr;
+	// Write queue, the head frame may be partially written up to queue_offset
+	phalcon_websocket_frame **queue;
+	uint32_t queue_head;
+	uint32_t queue_count;
+	uint32_t queue_size;
+	size_t queue_offset;
+
+	// Bytes waiting in the queue, writes are refused above the high watermark
+	// until it falls back under the low one
+	size_t buffered;
+	size_t high_watermark;
+	size_t low_watermark;
+	zend_bool paused;
+
+	// Topics subscribed on the server, as keys
+	zval topics;
 
 	// LibWebSockets context
 	struct lws *wsi;
@@ -50,7 +91,13 @@ static inline phalcon_websocket_connection_object *phalcon_websocket_connection_
 	return (phalcon_websocket_connection_object*)((char*)(obj) - XtOffsetOf(phalcon_websocket_connection_object, std));
 }
 
-int phalcon_websocket_connection_write(phalcon_websocket_connection_object *conn, zend_string *text);
+phalcon_websocket_frame *phalcon_websocket_frame_create(const char *payload, size_t len, unsigned char opcode);
+void phalcon_websocket_frame_release(phalcon_websocket_frame *frame);
+
+int phalcon_websocket_connection_enqueue(phalcon_websocket_connection_object *conn, phalcon_websocket_frame *frame);
+int phalcon_websocket_connection_write(phalcon_websocket_connection_object *conn, zend_string *text, unsigned char opcode);
+int phalcon_websocket_connection_flush(phalcon_websocket_connection_object *conn, zend_bool framed);
+zend_bool phalcon_websocket_connection_drained(phalcon_websocket_connection_object *conn);
 void phalcon_websocket_connection_close(phalcon_websocket_connection_object *conn, zend_string *reason);
 
 extern zend_class_entry *phalcon_websocket_connection_ce;
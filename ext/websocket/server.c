@@ -40,10 +40,16 @@
  * $server->on(Phalcon\Websocket\Server::ON_CLOSE, function($server){
  *     echo 'Close'.PHP_EOL;
  * });
- * $server->on(Phalcon\Websocket\Server::ON_DATA, function($server, $conn, $data){
- *     echo 'Data'.PHP_EOL;
+ * $server->on(Phalcon\Websocket\Server::ON_DATA, function($server, $conn, $data, $binary){
+ *     $server->subscribe($conn->getUid(), $data);
+ * });
+ * $server->on(Phalcon\Websocket\Server::ON_DRAIN, function($server, $conn){
+ *     echo 'Drain'.PHP_EOL;
  * });
  * $server->run();
+ *
+ * // elsewhere, e.g. on tick
+ * $server->publish('quotes', $payload);
  *<／code>
  */
 zend_class_entry *phalcon_websocket_server_ce;
@@ -54,6 +60,11 @@ PHP_METHOD(Phalcon_Websocket_Server, serviceFd);
 PHP_METHOD(Phalcon_Websocket_Server, run);
 PHP_METHOD(Phalcon_Websocket_Server, stop);
 PHP_METHOD(Phalcon_Websocket_Server, broadcast);
+PHP_METHOD(Phalcon_Websocket_Server, setWatermarks);
+PHP_METHOD(Phalcon_Websocket_Server, setCompression);
+PHP_METHOD(Phalcon_Websocket_Server, subscribe);
+PHP_METHOD(Phalcon_Websocket_Server, unsubscribe);
+PHP_METHOD(Phalcon_Websocket_Server, publish);
 PHP_METHOD(Phalcon_Websocket_Server, on);
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_server___construct, 0, 0, 0)
@@ -72,6 +83,32 @@ ZEND_END_ARG_INFO()
 ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_server_broadcast, 0, 0, 1)
 	ZEND_ARG_TYPE_INFO(0, text, IS_STRING, 0)
 	ZEND_ARG_TYPE_INFO(0, ignored, IS_LONG, 1)
+	ZEND_ARG_TYPE_INFO(0, binary, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_server_setwatermarks, 0, 0, 2)
+	ZEND_ARG_TYPE_INFO(0, high, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, low, IS_LONG, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_server_setcompression, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, compression, _IS_BOOL, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_server_subscribe, 0, 0, 2)
+	ZEND_ARG_TYPE_INFO(0, id, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, topic, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_server_unsubscribe, 0, 0, 1)
+	ZEND_ARG_TYPE_INFO(0, id, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, topic, IS_STRING, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_phalcon_websocket_server_publish, 0, 0, 2)
+	ZEND_ARG_TYPE_INFO(0, topic, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, data, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, binary, _IS_BOOL, 0)
 ZEND_END_ARG_INFO()
 
 #if PHP_VERSION_ID >= 70200
@@ -94,16 +131,49 @@ static const zend_function_entry phalcon_websocket_server_method_entry[] = {
 	PHP_ME(Phalcon_Websocket_Server, stop, NULL, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Websocket_Server, on, arginfo_phalcon_websocket_server_on, ZEND_ACC_PUBLIC)
 	PHP_ME(Phalcon_Websocket_Server, broadcast, arginfo_phalcon_websocket_server_broadcast, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Websocket_Server, setWatermarks, arginfo_phalcon_websocket_server_setwatermarks, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Websocket_Server, setCompression, arginfo_phalcon_websocket_server_setcompression, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Websocket_Server, subscribe, arginfo_phalcon_websocket_server_subscribe, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Websocket_Server, unsubscribe, arginfo_phalcon_websocket_server_unsubscribe, ZEND_ACC_PUBLIC)
+	PHP_ME(Phalcon_Websocket_Server, publish, arginfo_phalcon_websocket_server_publish, ZEND_ACC_PUBLIC)
 	PHP_FE_END
 };
 
+static void phalcon_websocket_server_unsubscribe_from(phalcon_websocket_server_object *intern, zend_ulong id, zend_string *topic)
+{
+	zval *subscribers;
+
+	subscribers = zend_hash_find(Z_ARRVAL(intern->topics), topic);
+	if (subscribers) {
+		zend_hash_index_del(Z_ARRVAL_P(subscribers), id);
+		if (!zend_hash_num_elements(Z_ARRVAL_P(subscribers))) {
+			zend_hash_del(Z_ARRVAL(intern->topics), topic);
+		}
+	}
+}
+
+static void phalcon_websocket_server_unsubscribe_all(phalcon_websocket_server_object *intern, phalcon_websocket_connection_object *conn)
+{
+	zend_string *topic;
+
+	if (Z_TYPE(conn->topics) != IS_ARRAY) {
+		return;
+	}
+
+	ZEND_HASH_FOREACH_STR_KEY(Z_ARRVAL(conn->topics), topic) {
+		phalcon_websocket_server_unsubscribe_from(intern, conn->id, topic);
+	} ZEND_HASH_FOREACH_END();
+
+	zval_ptr_dtor(&conn->topics);
+	ZVAL_UNDEF(&conn->topics);
+}
+
 static int phalcon_websocket_server_callback(struct lws *wsi, enum lws_callback_reasons reason, void *user, void *in, size_t len)
 {
 	phalcon_websocket_server_object *intern = (phalcon_websocket_server_object*)lws_context_user(lws_get_context(wsi));
 	phalcon_websocket_connection_object *connection_object;
 	zval *connection = user, retval = {}, obj = {};
-	int n, return_code = 0, flag = 0;
-	zend_string *text;
+	int return_code = 0, flag = 0;
 	struct lws_pollargs *pa = in;
 
 	ZVAL_OBJ(&obj, &intern->std);
@@ -153,6 +223,8 @@ static int phalcon_websocket_server_callback(struct lws *wsi, enum lws_callback_
 			connection_object = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(connection));
 			connection_object->id = ++intern->next_id;
 			connection_object->wsi = wsi;
+			connection_object->high_watermark = intern->high_watermark;
+			connection_object->low_watermark = intern->low_watermark;
 
 			add_index_zval(&intern->connections, connection_object->id, connection);
 
@@ -169,9 +241,10 @@ static int phalcon_websocket_server_callback(struct lws *wsi, enum lws_callback_
 		case LWS_CALLBACK_RECEIVE:
 			lwsl_notice("Receive data.\n");
 			if (Z_TYPE(intern->callbacks[PHP_CB_SERVER_DATA]) != IS_NULL) {
-				zval data = {};
+				zval data = {}, binary = {};
 				ZVAL_STRINGL(&data, in, len);
-				PHALCON_CALL_USER_FUNC_FLAG(flag, &retval, &intern->callbacks[PHP_CB_SERVER_DATA], &obj, connection, &data);
+				ZVAL_BOOL(&binary, lws_frame_is_binary(wsi));
+				PHALCON_CALL_USER_FUNC_FLAG(flag, &retval, &intern->callbacks[PHP_CB_SERVER_DATA], &obj, connection, &data, &binary);
 				if (SUCCESS != flag) {
 					php_error_docref(NULL, E_WARNING, "Unable to call data callback");
 				}
@@ -195,31 +268,18 @@ static int phalcon_websocket_server_callback(struct lws *wsi, enum lws_callback_
 				break;
 			}
 
-			while (connection_object->read_ptr != connection_object->write_ptr) {
-				text = connection_object->buf[connection_object->read_ptr];
-				n = lws_write(wsi, (unsigned char *)ZSTR_VAL(text), ZSTR_LEN(text), LWS_WRITE_TEXT);
-
-				if (n < 0) {
-					lwsl_err("Write to socket %lu failed with code %d\n", connection_object->id, n);
-					return 1;
-				}
-				if (n < (int) text->len) {
-					// TODO Implements partial write
-					connection_object->buf[connection_object->read_ptr] = NULL;
-					connection_object->read_ptr = (connection_object->read_ptr + 1) % PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE;
-					lwsl_err("Partial write\n");
-					return -1;
-				}
+			// Prebuilt frames cannot go through the deflate extension, lws_write() compresses per connection
+			if (phalcon_websocket_connection_flush(connection_object, !intern->compression) < 0) {
+				lwsl_err("Write to socket %lu failed\n", connection_object->id);
+				return -1;
+			}
 
-				// Cleanup
-				connection_object->buf[connection_object->read_ptr] = NULL;
-				connection_object->read_ptr = (connection_object->read_ptr + 1) % PHALCON_WEBSOCKET_CONNECTION_BUFFER_SIZE;
-				zend_string_delref(text);
-				if (zend_string_refcount(text) < 1) {
-					zend_string_free(text);
+			if (phalcon_websocket_connection_drained(connection_object) && Z_TYPE(intern->callbacks[PHP_CB_SERVER_DRAIN]) != IS_NULL) {
+				PHALCON_CALL_USER_FUNC_FLAG(flag, NULL, &intern->callbacks[PHP_CB_SERVER_DRAIN], &obj, connection);
+				if (SUCCESS != flag) {
+					php_error_docref(NULL, E_WARNING, "Unable to call drain callback");
 				}
 			}
-
 			break;
 
 		case LWS_CALLBACK_CLOSED:
@@ -227,7 +287,11 @@ static int phalcon_websocket_server_callback(struct lws *wsi, enum lws_callback_
 			connection_object = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(connection));
 			connection_object->connected = 0;
 
-			// Drop from active connections
+			// The connections table may hold the last reference, keep the object until the close callback returned
+			Z_ADDREF_P(connection);
+
+			// Drop from topics and active connections
+			phalcon_websocket_server_unsubscribe_all(intern, connection_object);
 			zend_hash_index_del(Z_ARRVAL(intern->connections), connection_object->id);
 
 			if (Z_TYPE(intern->callbacks[PHP_CB_SERVER_CLOSE]) == IS_CALLABLE) {
@@ -236,7 +300,8 @@ static int phalcon_websocket_server_callback(struct lws *wsi, enum lws_callback_
 					php_error_docref(NULL, E_WARNING, "Unable to call close callback");
 				}
 			}
-			Z_TRY_DELREF_P(connection);
+			zval_ptr_dtor(connection);
+			ZVAL_UNDEF(connection);
 			break;
 
 		case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
@@ -266,6 +331,17 @@ static int phalcon_websocket_server_callback(struct lws *wsi, enum lws_callback_
 	return intern->exit_request == 1 ? -1 : return_code;
 }
 
+#ifndef LWS_WITHOUT_EXTENSIONS
+static const struct lws_extension extensions[] = {
+	{
+		"permessage-deflate",
+		lws_extension_callback_pm_deflate,
+		"permessage-deflate; client_no_context_takeover; client_max_window_bits"
+	},
+	{ NULL, NULL, NULL }
+};
+#endif
+
 static struct lws_protocols protocols[] = {
 	{
 		"phalcon",
@@ -307,6 +383,12 @@ zend_object* phalcon_websocket_server_object_create_handler(zend_class_entry *ce
 	intern->next_id = 0;
 	array_init(&intern->connections);
 
+	array_init(&intern->topics);
+	intern->compression = 0;
+
+	intern->high_watermark = PHALCON_WEBSOCKET_HIGH_WATERMARK;
+	intern->low_watermark = PHALCON_WEBSOCKET_LOW_WATERMARK;
+
 	return &intern->std;
 }
 
@@ -337,6 +419,7 @@ void phalcon_websocket_server_object_free_handler(zend_object *object)
 	FREE_HASHTABLE(intern->eventloop_sockets);
 	intern->eventloop_sockets = NULL;
 
+	zval_ptr_dtor(&intern->topics);
 	zval_ptr_dtor(&intern->connections);
 	zend_object_std_dtor(object);
 }
@@ -381,6 +464,7 @@ PHALCON_INIT_CLASS(Phalcon_Websocket_Server){
 	zend_declare_class_constant_long(phalcon_websocket_server_ce, SL("ON_CLOSE"), PHP_CB_SERVER_CLOSE);
 	zend_declare_class_constant_long(phalcon_websocket_server_ce, SL("ON_DATA"), PHP_CB_SERVER_DATA);
 	zend_declare_class_constant_long(phalcon_websocket_server_ce, SL("ON_TICK"), PHP_CB_SERVER_TICK);
+	zend_declare_class_constant_long(phalcon_websocket_server_ce, SL("ON_DRAIN"), PHP_CB_SERVER_DRAIN);
 
 	return SUCCESS;
 }
@@ -494,6 +578,9 @@ PHP_METHOD(Phalcon_Websocket_Server, run)
 
 	// Start WebSocket
 	intern = phalcon_websocket_server_object_from_obj(Z_OBJ_P(getThis()));
+#ifndef LWS_WITHOUT_EXTENSIONS
+	intern->info.extensions = intern->compression ? extensions : NULL;
+#endif
 	intern->context = lws_create_context(&intern->info);
 	if (intern->context == NULL) {
         RETURN_FALSE;
@@ -529,7 +616,7 @@ PHP_METHOD(Phalcon_Websocket_Server, run)
 	// Disconnect users
 	text = zend_string_init(ZEND_STRL("Server terminated"), 0);
 	ZEND_HASH_FOREACH(Z_ARR(intern->connections), 0);
-		conn = (phalcon_websocket_connection_object *) Z_OBJ_P(_z);
+		conn = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(_z));
 		phalcon_websocket_connection_close(conn, text);
 		zval_delref_p(_z);
 		zend_hash_index_del(Z_ARR(intern->connections), _p->h);
@@ -553,31 +640,229 @@ PHP_METHOD(Phalcon_Websocket_Server, stop)
 }
 
 /**
- * Broadcast a message to all connected clients
+ * Broadcast a text (or binary) message to all connected clients, the frame is built once and
+ * shared by every write queue. Returns the number of clients it was queued for,
+ * clients above their high watermark are skipped
  */
 PHP_METHOD(Phalcon_Websocket_Server, broadcast)
 {
 	phalcon_websocket_server_object *intern;
-	zend_string *str;
 	phalcon_websocket_connection_object *conn;
-	long ignoredId = -1;
+	phalcon_websocket_frame *frame;
+	zend_string *str;
+	zval *connection;
+	zend_long ignoredId = -1, count = 0;
+	zend_bool ignored_null = 1, binary = 0;
 
-	ZEND_PARSE_PARAMETERS_START(1, 2)
+	ZEND_PARSE_PARAMETERS_START(1, 3)
 		Z_PARAM_STR(str)
 		Z_PARAM_OPTIONAL
-		Z_PARAM_LONG(ignoredId)
+		Z_PARAM_LONG_EX(ignoredId, ignored_null, 1, 0)
+		Z_PARAM_BOOL(binary)
 	ZEND_PARSE_PARAMETERS_END();
 
+	if (ignored_null) {
+		ignoredId = -1;
+	}
+
 	intern = phalcon_websocket_server_object_from_obj(Z_OBJ_P(getThis()));
-	ZEND_HASH_FOREACH(Z_ARR(intern->connections), 0);
-		// TODO Test return? Interrupt if a write fail?
-		conn = (phalcon_websocket_connection_object *) Z_OBJ_P(_z);
-		if (conn->id == ignoredId) {
+
+	frame = phalcon_websocket_frame_create(ZSTR_VAL(str), ZSTR_LEN(str), binary ? PHALCON_WEBSOCKET_OPCODE_BINARY : PHALCON_WEBSOCKET_OPCODE_TEXT);
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL(intern->connections), connection) {
+		conn = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(connection));
+		if (ignoredId >= 0 && conn->id == (zend_ulong) ignoredId) {
 			continue;
 		}
-		phalcon_websocket_connection_write(conn, str);
-	ZEND_HASH_FOREACH_END();
-	efree(str);
+		if (phalcon_websocket_connection_enqueue(conn, frame) >= 0) {
+			count++;
+		}
+	} ZEND_HASH_FOREACH_END();
+	phalcon_websocket_frame_release(frame);
+
+	RETURN_LONG(count);
+}
+
+/**
+ * Set the write queue watermarks in bytes for all connections,
+ * see Phalcon\Websocket\Connection::setWatermarks()
+ */
+PHP_METHOD(Phalcon_Websocket_Server, setWatermarks)
+{
+	phalcon_websocket_server_object *intern;
+	phalcon_websocket_connection_object *conn;
+	zval *connection;
+	zend_long high, low;
+
+	ZEND_PARSE_PARAMETERS_START(2, 2)
+		Z_PARAM_LONG(high)
+		Z_PARAM_LONG(low)
+	ZEND_PARSE_PARAMETERS_END();
+
+	if (high < 0 || low < 0 || (high && low > high)) {
+		php_error_docref(NULL, E_WARNING, "The low watermark must be between 0 and the high watermark");
+		RETURN_FALSE;
+	}
+
+	intern = phalcon_websocket_server_object_from_obj(Z_OBJ_P(getThis()));
+	intern->high_watermark = high;
+	intern->low_watermark = low;
+
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL(intern->connections), connection) {
+		conn = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(connection));
+		conn->high_watermark = high;
+		conn->low_watermark = low;
+		if (!high) {
+			conn->paused = 0;
+		}
+	} ZEND_HASH_FOREACH_END();
+
+	RETURN_TRUE;
+}
+
+/**
+ * Negotiate permessage-deflate with clients, must be called before run().
+ * Compressed messages are framed per connection instead of shared
+ */
+PHP_METHOD(Phalcon_Websocket_Server, setCompression)
+{
+	phalcon_websocket_server_object *intern;
+	zend_bool compression;
+
+	ZEND_PARSE_PARAMETERS_START(1, 1)
+		Z_PARAM_BOOL(compression)
+	ZEND_PARSE_PARAMETERS_END();
+
+#ifdef LWS_WITHOUT_EXTENSIONS
+	if (compression) {
+		php_error_docref(NULL, E_WARNING, "libwebsockets was built without extensions support");
+		RETURN_FALSE;
+	}
+#endif
+
+	intern = phalcon_websocket_server_object_from_obj(Z_OBJ_P(getThis()));
+	if (intern->context) {
+		php_error_docref(NULL, E_WARNING, "Compression cannot be changed while the server is running");
+		RETURN_FALSE;
+	}
+
+	intern->compression = compression;
+	RETURN_TRUE;
+}
+
+/**
+ * Subscribe a connection to a topic
+ */
+PHP_METHOD(Phalcon_Websocket_Server, subscribe)
+{
+	phalcon_websocket_server_object *intern;
+	phalcon_websocket_connection_object *conn;
+	zval *connection, *subscribers, set = {};
+	zend_string *topic;
+	zend_long id;
+
+	ZEND_PARSE_PARAMETERS_START(2, 2)
+		Z_PARAM_LONG(id)
+		Z_PARAM_STR(topic)
+	ZEND_PARSE_PARAMETERS_END();
+
+	intern = phalcon_websocket_server_object_from_obj(Z_OBJ_P(getThis()));
+
+	if ((connection = zend_hash_index_find(Z_ARRVAL(intern->connections), id)) == NULL) {
+		RETURN_FALSE;
+	}
+	conn = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(connection));
+
+	if ((subscribers = zend_hash_find(Z_ARRVAL(intern->topics), topic)) == NULL) {
+		array_init(&set);
+		subscribers = zend_hash_update(Z_ARRVAL(intern->topics), topic, &set);
+	}
+
+	if (zend_hash_index_add(Z_ARRVAL_P(subscribers), id, connection)) {
+		Z_ADDREF_P(connection);
+	}
+
+	if (Z_TYPE(conn->topics) != IS_ARRAY) {
+		array_init(&conn->topics);
+	}
+	zend_hash_add_empty_element(Z_ARRVAL(conn->topics), topic);
+
+	RETURN_TRUE;
+}
+
+/**
+ * Unsubscribe a connection from a topic, or from all its topics
+ */
+PHP_METHOD(Phalcon_Websocket_Server, unsubscribe)
+{
+	phalcon_websocket_server_object *intern;
+	phalcon_websocket_connection_object *conn;
+	zval *connection;
+	zend_string *topic = NULL;
+	zend_long id;
+
+	ZEND_PARSE_PARAMETERS_START(1, 2)
+		Z_PARAM_LONG(id)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_STR_EX(topic, 1, 0)
+	ZEND_PARSE_PARAMETERS_END();
+
+	intern = phalcon_websocket_server_object_from_obj(Z_OBJ_P(getThis()));
+
+	if ((connection = zend_hash_index_find(Z_ARRVAL(intern->connections), id)) == NULL) {
+		RETURN_FALSE;
+	}
+	conn = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(connection));
+
+	if (!topic) {
+		phalcon_websocket_server_unsubscribe_all(intern, conn);
+		RETURN_TRUE;
+	}
+
+	if (Z_TYPE(conn->topics) != IS_ARRAY || zend_hash_del(Z_ARRVAL(conn->topics), topic) != SUCCESS) {
+		RETURN_FALSE;
+	}
+	phalcon_websocket_server_unsubscribe_from(intern, conn->id, topic);
+
+	RETURN_TRUE;
+}
+
+/**
+ * Publish a message to the subscribers of a topic, the frame is built once
+ * for all of them. Returns the number of clients it was queued for
+ */
+PHP_METHOD(Phalcon_Websocket_Server, publish)
+{
+	phalcon_websocket_server_object *intern;
+	phalcon_websocket_connection_object *conn;
+	phalcon_websocket_frame *frame;
+	zend_string *topic, *data;
+	zval *subscribers, *connection;
+	zend_bool binary = 0;
+	zend_long count = 0;
+
+	ZEND_PARSE_PARAMETERS_START(2, 3)
+		Z_PARAM_STR(topic)
+		Z_PARAM_STR(data)
+		Z_PARAM_OPTIONAL
+		Z_PARAM_BOOL(binary)
+	ZEND_PARSE_PARAMETERS_END();
+
+	intern = phalcon_websocket_server_object_from_obj(Z_OBJ_P(getThis()));
+
+	if ((subscribers = zend_hash_find(Z_ARRVAL(intern->topics), topic)) == NULL) {
+		RETURN_LONG(0);
+	}
+
+	frame = phalcon_websocket_frame_create(ZSTR_VAL(data), ZSTR_LEN(data), binary ? PHALCON_WEBSOCKET_OPCODE_BINARY : PHALCON_WEBSOCKET_OPCODE_TEXT);
+	ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(subscribers), connection) {
+		conn = phalcon_websocket_connection_object_from_obj(Z_OBJ_P(connection));
+		if (phalcon_websocket_connection_enqueue(conn, frame) >= 0) {
+			count++;
+		}
+	} ZEND_HASH_FOREACH_END();
+	phalcon_websocket_frame_release(frame);
+
+	RETURN_LONG(count);
 }
 
 /**
@@ -34,6 +34,7 @@ enum php_server_callbacks {
 
 	PHP_CB_SERVER_TICK,
 	PHP_CB_SERVER_ERROR,
+	PHP_CB_SERVER_DRAIN,
 	PHP_CB_SERVER_COUNT
 };
 
@@ -52,6 +53,16 @@ typedef struct _phalcon_websocket_server_object {
 	zend_ulong next_id;
 	zval connections;
 
+	// Subscribers by topic, each an array of connections keyed by ID
+	zval topics;
+
+	// Negotiate permessage-deflate with clients
+	zend_bool compression;
+
+	// Write queue watermarks given to new connections
+	size_t high_watermark;
+	size_t low_watermark;
+
 	zend_bool exit_request;
 	zend_object std;
 } phalcon_websocket_server_object;
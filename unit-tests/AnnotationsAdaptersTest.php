@@ -156,4 +156,47 @@ class AnnotationsAdaptersTest extends PHPUnit\Framework\TestCase
 		$this->assertEquals(get_class($property), 'Phalcon\Annotations\Collection');
 		$this->assertEquals($property->count(), 4);
 	}
+
+	public function testYacAdapter()
+	{
+		if (!class_exists('Phalcon\Annotations\Adapter\Yac')) {
+			$this->markTestSkipped('Class `Phalcon\Annotations\Adapter\Yac` is not exists');
+			return;
+		}
+		if (!ini_get('phalcon.cache.enable_yac_cli')) {
+			$this->markTestSkipped('Warning: phalcon.cache.enable_yac_cli is not enbale');
+			return;
+		}
+
+		$adapter = new Phalcon\Annotations\Adapter\Yac(array('prefix' => 'unit-' . getmypid()));
+		$this->assertNull($adapter->read('TestClass'));
+
+		$classAnnotations = $adapter->get('TestClass');
+		$this->assertTrue(is_object($classAnnotations));
+		$this->assertEquals(get_class($classAnnotations), 'Phalcon\Annotations\Reflection');
+		$this->assertEquals(get_class($classAnnotations->getClassAnnotations()), 'Phalcon\Annotations\Collection');
+
+		// A fresh adapter has no in-process copy, so this must come from the shared memory
+		$adapter = new Phalcon\Annotations\Adapter\Yac(array('prefix' => 'unit-' . getmypid()));
+
+		$cached = $adapter->read('TestClass');
+		$this->assertTrue(is_object($cached));
+		$this->assertEquals(get_class($cached), 'Phalcon\Annotations\Reflection');
+		$this->assertEquals($cached->getReflectionData(), $classAnnotations->getReflectionData());
+
+		$classAnnotations = $adapter->get('TestClass');
+		$this->assertTrue(is_object($classAnnotations));
+		$this->assertEquals(get_class($classAnnotations), 'Phalcon\Annotations\Reflection');
+		$this->assertEquals(get_class($classAnnotations->getClassAnnotations()), 'Phalcon\Annotations\Collection');
+
+		$classAnnotations = $adapter->get('User\TestClassNs');
+		$this->assertTrue(is_object($classAnnotations));
+		$this->assertEquals(get_class($classAnnotations), 'Phalcon\Annotations\Reflection');
+		$this->assertEquals(get_class($classAnnotations->getClassAnnotations()), 'Phalcon\Annotations\Collection');
+
+		$property = $adapter->getProperty('TestClass', 'testProp1');
+		$this->assertTrue(is_object($property));
+		$this->assertEquals(get_class($property), 'Phalcon\Annotations\Collection');
+		$this->assertEquals($property->count(), 4);
+	}
 }
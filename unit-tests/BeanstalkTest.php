@@ -93,4 +93,80 @@ class BeanstalkTest extends PHPUnit\Framework\TestCase
 
 		$this->assertTrue($job->delete());
 	}
+
+	public function testPutManyReserveMany()
+	{
+		$queue = new Phalcon\Queue\Beanstalk();
+		try {
+			@$queue->connect();
+		}
+		catch (Exception $e) {
+			$this->markTestSkipped($e->getMessage());
+			return;
+		}
+
+		$this->assertTrue($queue->choose('beanstalk-many') !== false);
+		$this->assertTrue($queue->watch('beanstalk-many') !== false);
+
+		$jobs = array();
+		for ($i = 0; $i < 1000; $i++) {
+			$jobs['job' . $i] = array('n' => $i);
+		}
+
+		$ids = $queue->putMany($jobs);
+
+		$this->assertEquals(array_keys($jobs), array_keys($ids));
+		foreach ($ids as $id) {
+			$this->assertTrue($id !== false);
+		}
+
+		$reserved = $queue->reserveMany(1000, 1);
+		$this->assertCount(1000, $reserved);
+
+		foreach ($reserved as $i => $job) {
+			$this->assertEquals(array('n' => $i), $job->getBody());
+			$this->assertTrue($job->delete());
+		}
+
+		$this->assertEquals(array(), $queue->reserveMany(10, 0));
+	}
+
+	public function testReserveAsync()
+	{
+		$queue = new Phalcon\Queue\Beanstalk();
+		try {
+			@$queue->connect();
+		}
+		catch (Exception $e) {
+			$this->markTestSkipped($e->getMessage());
+			return;
+		}
+
+		$this->assertTrue($queue->choose('beanstalk-async') !== false);
+		$this->assertTrue($queue->watch('beanstalk-async') !== false);
+
+		$this->assertNull($queue->poll());
+		$this->assertTrue($queue->reserveAsync(1));
+
+		$read = array($queue->getConnection());
+		$write = $except = null;
+		stream_select($read, $write, $except, 2);
+
+		// TIMED_OUT, the tube is empty
+		$this->assertFalse($queue->poll());
+
+		$this->assertTrue($queue->put('async') !== false);
+		$this->assertTrue($queue->reserveAsync(1));
+
+		$job = null;
+		for ($i = 0; $i < 100 && $job === null; $i++) {
+			$read = array($queue->getConnection());
+			stream_select($read, $write, $except, 0, 20000);
+			$job = $queue->poll();
+		}
+
+		$this->assertInstanceOf('Phalcon\Queue\Beanstalk\Job', $job);
+		$this->assertEquals('async', $job->getBody());
+		$this->assertTrue($job->delete());
+	}
 }
@@ -1443,6 +1443,71 @@ class CacheTest extends PHPUnit\Framework\TestCase
 		$this->assertEquals($cache->get($key), NULL);
 	}
 
+	public function testShmCache()
+	{
+		if (!class_exists('Phalcon\Cache\Backend\Shm')) {
+			$this->markTestSkipped('Class `Phalcon\Cache\Backend\Shm` is not exists');
+			return false;
+		}
+		if (!ini_get('phalcon.cache.enable_yac_cli')) {
+			$this->markTestSkipped('Warning: phalcon.cache.enable_yac_cli is not enbale');
+			return false;
+		}
+
+		$frontCache = new Phalcon\Cache\Frontend\None();
+		$cache = new Phalcon\Cache\Backend\Shm($frontCache, array(
+			'prefix' => 'shm'
+		));
+
+		$this->assertTrue($cache->flush());
+
+		$data = array(1, 2, 3, 4, 5);
+		$this->assertTrue($cache->save('data', $data));
+		$this->assertEquals($cache->get('data'), $data);
+
+		$this->assertTrue($cache->save('int', 100));
+		$this->assertSame($cache->get('int'), 100);
+		$this->assertEquals($cache->increment('int', 10), 110);
+		$this->assertEquals($cache->decrement('int'), 109);
+
+		$this->assertTrue($cache->save('string', 'sure, nothing interesting'));
+		$this->assertSame($cache->get('string'), 'sure, nothing interesting');
+
+		$keys = $cache->queryKeys();
+		sort($keys);
+		$this->assertEquals($keys, array('data', 'int', 'string'));
+		$this->assertEquals($cache->queryKeys('str'), array('string'));
+
+		$this->assertTrue($cache->save('user-1', 'one', null, true, array('users', 'user-1')));
+		$this->assertTrue($cache->save('user-2', 'two', null, true, 'users'));
+		$this->assertEquals($cache->increment('user-2'), false);
+		$this->assertTrue($cache->exists('user-1'));
+		$this->assertTrue($cache->exists('user-2'));
+
+		$this->assertTrue($cache->deleteByTag('user-1'));
+		$this->assertFalse($cache->exists('user-1'));
+		$this->assertEquals($cache->get('user-2'), 'two');
+
+		$this->assertTrue($cache->deleteByTag('users'));
+		$this->assertNull($cache->get('user-2'));
+
+		$this->assertTrue($cache->save('user-2', 'again', null, true, 'users'));
+		$this->assertEquals($cache->get('user-2'), 'again');
+
+		$this->assertTrue($cache->delete('data'));
+		$this->assertFalse($cache->exists('data'));
+
+		$this->assertTrue($cache->flush());
+		$this->assertEquals($cache->queryKeys(), array());
+
+		$cache = new Phalcon\Cache\Backend\Shm(new Phalcon\Cache\Frontend\Data(), array(
+			'prefix' => 'shm'
+		));
+		$cache->save('data', $data);
+		$this->assertEquals($cache->get('data'), $data);
+		$this->assertTrue($cache->flush());
+	}
+
 	public function testWiredTiger()
 	{
 		if (!class_exists('Phalcon\Cache\Backend\Wiredtiger')) {
@@ -0,0 +1,233 @@
+<?php
+
+/*
+	+------------------------------------------------------------------------+
+	| Phalcon Framework                                                      |
+	+------------------------------------------------------------------------+
+	| Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+	+------------------------------------------------------------------------+
+	| This source file is subject to the New BSD License that is bundled     |
+	| with this package in the file docs/LICENSE.txt.                        |
+	|                                                                        |
+	| If you did not receive a copy of the license and are unable to         |
+	| obtain it through the world-wide-web, please send an email             |
+	| to license@phalconphp.com so we can send you a copy immediately.       |
+	+------------------------------------------------------------------------+
+	| Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+	|          Eduar Carvajal <eduar@phalconphp.com>                         |
+	|          ZhuZongXin <dreamsxin@qq.com>                                 |
+	+------------------------------------------------------------------------+
+*/
+
+class CoroutineTest extends PHPUnit\Framework\TestCase
+{
+	public function setUp()
+	{
+		if (!class_exists('Phalcon\Coroutine')) {
+			$this->markTestSkipped('Class `Phalcon\Coroutine` is not exists');
+		}
+	}
+
+	public function testGoWait()
+	{
+		$log = array();
+
+		$id1 = Phalcon\Coroutine::go(function () use (&$log) {
+			$log[] = 'a' . Phalcon\Coroutine::getId();
+		});
+		$id2 = Phalcon\Coroutine::go(function ($suffix) use (&$log) {
+			$log[] = 'b' . $suffix;
+		}, array('!'));
+
+		// nothing runs before wait()
+		$this->assertEquals($log, array());
+		$this->assertEquals(Phalcon\Coroutine::count(), 2);
+		$this->assertEquals(Phalcon\Coroutine::getId(), -1);
+		$this->assertGreaterThan($id1, $id2);
+
+		$this->assertTrue(Phalcon\Coroutine::wait());
+		$this->assertEquals($log, array('a' . $id1, 'b!'));
+		$this->assertEquals(Phalcon\Coroutine::count(), 0);
+	}
+
+	public function testSleep()
+	{
+		$log = array();
+
+		Phalcon\Coroutine::go(function () use (&$log) {
+			Phalcon\Coroutine::sleep(0.2);
+			$log[] = 'slow';
+		});
+		Phalcon\Coroutine::go(function () use (&$log) {
+			$log[] = 'fast';
+			Phalcon\Coroutine::sleep(0.1);
+			$log[] = 'medium';
+		});
+
+		$start = microtime(true);
+		Phalcon\Coroutine::wait();
+
+		// the sleeps overlap, they do not add up
+		$this->assertEquals($log, array('fast', 'medium', 'slow'));
+		$this->assertLessThan(0.29, microtime(true) - $start);
+	}
+
+	public function testDeepCalls()
+	{
+		$depth = function ($n) use (&$depth) {
+			if ($n == 0) {
+				Phalcon\Coroutine::sleep(0);
+				return 0;
+			}
+			$args = range(1, 8);
+			return $depth($n - 1) + count($args) - 7;
+		};
+		$results = array();
+
+		// the frames outgrow the first VM stack page of each coroutine
+		Phalcon\Coroutine::go(function () use ($depth, &$results) {
+			$results[] = $depth(5000);
+		});
+		Phalcon\Coroutine::go(function () use ($depth, &$results) {
+			$results[] = $depth(3000);
+		});
+
+		$this->assertTrue(Phalcon\Coroutine::wait());
+		sort($results);
+		$this->assertEquals($results, array(3000, 5000));
+	}
+
+	public function testException()
+	{
+		$log = array();
+
+		Phalcon\Coroutine::go(function () {
+			throw new Exception('failed in a coroutine');
+		});
+		Phalcon\Coroutine::go(function () use (&$log) {
+			$log[] = 'still runs';
+		});
+
+		try {
+			Phalcon\Coroutine::wait();
+			$this->fail('The exception was not rethrown');
+		} catch (Exception $e) {
+			$this->assertEquals($e->getMessage(), 'failed in a coroutine');
+		}
+		$this->assertEquals($log, array('still runs'));
+		$this->assertEquals(Phalcon\Coroutine::count(), 0);
+	}
+
+	public function testChannel()
+	{
+		$channel = new Phalcon\Coroutine\Channel(2);
+		$this->assertEquals($channel->getCapacity(), 2);
+
+		$log = array();
+
+		Phalcon\Coroutine::go(function () use ($channel, &$log) {
+			for ($i = 1; $i <= 4; $i++) {
+				$channel->push($i);
+				$log[] = 'push' . $i;
+			}
+			$channel->close();
+		});
+		Phalcon\Coroutine::go(function () use ($channel, &$log) {
+			while (($value = $channel->pop()) !== false) {
+				$log[] = 'pop' . $value;
+			}
+		});
+		Phalcon\Coroutine::wait();
+
+		// the producer blocks once the two slots are taken
+		$this->assertEquals(array_slice($log, 0, 2), array('push1', 'push2'));
+		$this->assertEquals(array_values(array_filter($log, function ($entry) {
+			return strpos($entry, 'pop') === 0;
+		})), array('pop1', 'pop2', 'pop3', 'pop4'));
+		$this->assertTrue($channel->isClosed());
+		$this->assertEquals($channel->length(), 0);
+		$this->assertFalse($channel->push(5, 0));
+	}
+
+	public function testChannelTimeout()
+	{
+		$channel = new Phalcon\Coroutine\Channel(1);
+		$result = array();
+
+		Phalcon\Coroutine::go(function () use ($channel, &$result) {
+			// zero does not wait
+			$result['pop0'] = $channel->pop(0);
+
+			$start = microtime(true);
+			$result['pop'] = $channel->pop(0.1);
+			$result['elapsed'] = microtime(true) - $start;
+
+			$result['push1'] = $channel->push(1, 0);
+			$result['push2'] = $channel->push(2, 0.05);
+			$result['length'] = $channel->length();
+		});
+		Phalcon\Coroutine::wait();
+
+		$this->assertFalse($result['pop0']);
+		$this->assertFalse($result['pop']);
+		$this->assertGreaterThanOrEqual(0.09, $result['elapsed']);
+		$this->assertTrue($result['push1']);
+		$this->assertFalse($result['push2']);
+		$this->assertEquals($result['length'], 1);
+	}
+
+	public function testChannelDeadlock()
+	{
+		$channel = new Phalcon\Coroutine\Channel(1);
+
+		// nobody ever pushes, the scheduler must not spin forever
+		Phalcon\Coroutine::go(function () use ($channel) {
+			$channel->pop();
+		});
+
+		try {
+			Phalcon\Coroutine::wait();
+			$this->fail('The deadlock was not detected');
+		} catch (Phalcon\Coroutine\Exception $e) {
+			$this->assertContains('Deadlock', $e->getMessage());
+		}
+		$this->assertEquals(Phalcon\Coroutine::count(), 0);
+	}
+
+	public function testSocket()
+	{
+		$port = 30000 + getmypid() % 10000;
+		$result = array();
+
+		$server = new Phalcon\Coroutine\Socket(Phalcon\Coroutine\Socket::AF_INET, Phalcon\Coroutine\Socket::SOCK_STREAM);
+		$this->assertTrue($server->bind('127.0.0.1', $port));
+		$this->assertTrue($server->listen(16));
+
+		Phalcon\Coroutine::go(function () use ($server, &$result) {
+			$conn = $server->accept(2);
+			$result['accept'] = $conn instanceof Phalcon\Coroutine\Socket;
+			$result['server-recv'] = $conn->recv(1024, 2);
+			$conn->send("pong\n");
+			$conn->close();
+			$server->close();
+		});
+		Phalcon\Coroutine::go(function () use ($port, &$result) {
+			$client = new Phalcon\Coroutine\Socket();
+			$result['connect'] = $client->connect('127.0.0.1', $port, 2);
+			$result['send'] = $client->send('ping', 2);
+			$result['client-recv'] = $client->recv(1024, 2);
+			// an empty string once the peer has closed
+			$result['eof'] = $client->recv(1024, 2);
+			$client->close();
+		});
+		Phalcon\Coroutine::wait();
+
+		$this->assertTrue($result['accept']);
+		$this->assertTrue($result['connect']);
+		$this->assertEquals($result['send'], 4);
+		$this->assertEquals($result['server-recv'], 'ping');
+		$this->assertEquals($result['client-recv'], "pong\n");
+		$this->assertEquals($result['eof'], '');
+		$this->assertEquals($server->getFd(), -1);
+	}
+}
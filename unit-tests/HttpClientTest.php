@@ -56,6 +56,26 @@ class HttpClientTest extends PHPUnit\Framework\TestCase
 		$this->assertEquals($response->getStatusCode(), 200);
 	}
 
+	public function testMulti()
+	{
+		if (!extension_loaded('curl')) {
+			$this->markTestSkipped('Warning: curl extension is not loaded');
+			return false;
+		}
+
+		$this->assertEquals(Phalcon\Http\Client::multi(array()), array());
+
+		// Nothing listens on port 1, the failure is reported in place of the response
+		$responses = Phalcon\Http\Client::multi(array(
+			'first' => 'http://127.0.0.1:1/',
+			'second' => new Phalcon\Http\Client\Adapter\Curl('http://127.0.0.1:1/'),
+		), 5);
+
+		$this->assertEquals(array_keys($responses), array('first', 'second'));
+		$this->assertInstanceOf('Phalcon\Http\Client\Exception', $responses['first']);
+		$this->assertInstanceOf('Phalcon\Http\Client\Exception', $responses['second']);
+	}
+
 	public function testStream()
 	{
 		$this->markTestSkipped("Test skipped");
@@ -67,6 +87,178 @@ class HttpClientTest extends PHPUnit\Framework\TestCase
 		$this->assertEquals($response->getStatusCode(), 200);
 	}
 
+	public function testStreamKeepAlive()
+	{
+		if (!function_exists('pcntl_fork') || !function_exists('posix_kill')) {
+			$this->markTestSkipped('Test skipped');
+			return false;
+		}
+
+		$port = 40000 + getmypid() % 10000;
+
+		$pid = pcntl_fork();
+		if ($pid == 0) {
+			$this->serve($port);
+			// skip the shutdown of PHPUnit in the forked process
+			posix_kill(getmypid(), SIGKILL);
+		}
+
+		$base = 'http://127.0.0.1:' . $port;
+
+		// wait until the server listens
+		for ($i = 0; $i < 50; $i++) {
+			if ($probe = @stream_socket_client('tcp://127.0.0.1:' . $port, $errno, $errstr, 1)) {
+				fclose($probe);
+				break;
+			}
+			usleep(100000);
+		}
+
+		// the body carries the id of the connection that served it
+		$client = new Phalcon\Http\Client\Adapter\Stream($base . '/plain');
+		$client->setKeepAlive(5);
+		$response = $client->get();
+		$this->assertEquals($response->getStatusCode(), 200);
+		list($path, $id) = explode(':', $response->getBody());
+		$this->assertEquals($path, 'plain');
+
+		// a second request reuses the pooled connection
+		$client = new Phalcon\Http\Client\Adapter\Stream($base . '/plain');
+		$client->setKeepAlive(5);
+		$this->assertEquals($client->get()->getBody(), 'plain:' . $id);
+
+		// a chunked response is decoded and leaves the connection usable
+		$client = new Phalcon\Http\Client\Adapter\Stream($base . '/chunked');
+		$client->setKeepAlive(5);
+		$this->assertEquals($client->get()->getBody(), 'chunked:' . $id);
+
+		// a user-set Connection header is sent once, as given
+		$client = new Phalcon\Http\Client\Adapter\Stream($base . '/headers');
+		$client->setKeepAlive(5);
+		$client->setHeader('Connection', 'keep-alive');
+		$this->assertEquals($client->get()->getBody(), 'host:1,connection:1');
+
+		// a redirect is followed to the final response
+		$client = new Phalcon\Http\Client\Adapter\Stream($base . '/redirect');
+		$client->setKeepAlive(5);
+		$response = $client->get();
+		$this->assertEquals($response->getStatusCode(), 200);
+		$this->assertStringStartsWith('plain:', $response->getBody());
+
+		// an endless redirect stops at max_redirects
+		$client = new Phalcon\Http\Client\Adapter\Stream($base . '/loop');
+		$client->setKeepAlive(5);
+		try {
+			$client->get();
+			$this->fail('The redirect loop was followed forever');
+		} catch (Phalcon\Http\Client\Exception $e) {
+			$this->assertContains('Redirection limit', $e->getMessage());
+		}
+
+		// an error status throws, as through the http:// wrapper
+		$client = new Phalcon\Http\Client\Adapter\Stream($base . '/missing');
+		$client->setKeepAlive(5);
+		try {
+			$client->get();
+			$this->fail('A 404 did not throw');
+		} catch (Phalcon\Http\Client\Exception $e) {
+			$this->assertContains('404', $e->getMessage());
+		}
+
+		// without keep-alive, the default, every request opens its own connection
+		$client = new Phalcon\Http\Client\Adapter\Stream($base . '/plain');
+		$first = $client->get()->getBody();
+		$client = new Phalcon\Http\Client\Adapter\Stream($base . '/plain');
+		$second = $client->get()->getBody();
+		$this->assertNotEquals($first, $second);
+		$this->assertNotEquals($first, 'plain:' . $id);
+
+		posix_kill($pid, SIGKILL);
+		pcntl_waitpid($pid, $status);
+	}
+
+	/**
+	 * A minimal HTTP/1.1 server that keeps connections open unless asked to close them
+	 */
+	protected function serve($port)
+	{
+		$server = stream_socket_server('tcp://127.0.0.1:' . $port, $errno, $errstr);
+		if (!$server) {
+			return;
+		}
+
+		$clients = array();
+		$buffers = array();
+		$ids = array();
+		$next = 0;
+
+		while (true) {
+			$read = array_merge(array($server), $clients);
+			$write = $except = null;
+			if (!stream_select($read, $write, $except, 10)) {
+				break;
+			}
+
+			foreach ($read as $sock) {
+				if ($sock === $server) {
+					$conn = stream_socket_accept($server);
+					$clients[(int) $conn] = $conn;
+					$buffers[(int) $conn] = '';
+					$ids[(int) $conn] = ++$next;
+					continue;
+				}
+
+				$key = (int) $sock;
+				$data = fread($sock, 8192);
+				if ($data === '' || $data === false) {
+					fclose($sock);
+					unset($clients[$key], $buffers[$key], $ids[$key]);
+					continue;
+				}
+				$buffers[$key] .= $data;
+
+				while (isset($buffers[$key]) && ($pos = strpos($buffers[$key], "\r\n\r\n")) !== false) {
+					$head = substr($buffers[$key], 0, $pos);
+					$buffers[$key] = substr($buffers[$key], $pos + 4);
+
+					list(, $path) = explode(' ', $head);
+					$close = stripos($head, "\r\nConnection: close") !== false;
+					$extra = $close ? "Connection: close\r\n" : '';
+
+					switch ($path) {
+						case '/plain':
+							$body = 'plain:' . $ids[$key];
+							$out = "HTTP/1.1 200 OK\r\n" . $extra . 'Content-Length: ' . strlen($body) . "\r\n\r\n" . $body;
+							break;
+						case '/chunked':
+							$out = "HTTP/1.1 200 OK\r\n" . $extra . "Transfer-Encoding: chunked\r\n\r\n"
+								. "8\r\nchunked:\r\n" . dechex(strlen($ids[$key])) . "\r\n" . $ids[$key] . "\r\n0\r\n\r\n";
+							break;
+						case '/headers':
+							$body = 'host:' . preg_match_all('/^Host:/mi', $head) . ',connection:' . preg_match_all('/^Connection:/mi', $head);
+							$out = "HTTP/1.1 200 OK\r\n" . $extra . 'Content-Length: ' . strlen($body) . "\r\n\r\n" . $body;
+							break;
+						case '/redirect':
+							$out = "HTTP/1.1 302 Found\r\n" . $extra . "Location: /plain\r\nContent-Length: 0\r\n\r\n";
+							break;
+						case '/loop':
+							$out = "HTTP/1.1 302 Found\r\n" . $extra . "Location: /loop\r\nContent-Length: 0\r\n\r\n";
+							break;
+						default:
+							$out = "HTTP/1.1 404 Not Found\r\n" . $extra . "Content-Length: 9\r\n\r\nnot found";
+							break;
+					}
+					fwrite($sock, $out);
+
+					if ($close) {
+						fclose($sock);
+						unset($clients[$key], $buffers[$key], $ids[$key]);
+					}
+				}
+			}
+		}
+	}
+
 	public function testFactory()
 	{
 		$this->markTestSkipped("Test skipped");
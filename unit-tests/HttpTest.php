@@ -23,4 +23,219 @@ HTML;
 		$this->assertTrue(isset($result['HEADERS']) && isset($result['HEADERS']['Cookie']));
 		$this->assertTrue(isset($result['QUERY_STRING']));
 	}
+
+	protected function multipart($body, $length = null)
+	{
+		return "POST /upload?id=1 HTTP/1.1\r\n"
+			. "Host: localhost\r\n"
+			. "Content-Type: multipart/form-data; boundary=AaB03x\r\n"
+			. "Content-Length: " . ($length === null ? strlen($body) : $length) . "\r\n"
+			. "\r\n" . $body;
+	}
+
+	protected function multipartBody()
+	{
+		// the first part carries bytes that look like the start of a delimiter
+		return "--AaB03x\r\n"
+			. "Content-Disposition: form-data; name=\"a\"\r\n"
+			. "\r\n"
+			. "one\r\n--AaB0\r\n--AaB03\r\nx\r\n"
+			. "--AaB03x\r\n"
+			. "Content-Disposition: form-data; name=\"b\"; filename=\"b.txt\"\r\n"
+			. "Content-Type: text/plain\r\n"
+			. "\r\n"
+			. "0123456789\r\n"
+			. "--AaB03x--\r\n";
+	}
+
+	protected function feedParts($chunks, $spill = null, $callback = null)
+	{
+		$parts = array();
+		$complete = false;
+
+		$parser = new Phalcon\Http\Parser(Phalcon\Http\Parser::TYPE_REQUEST);
+		if ($spill !== null) {
+			$parser->setSpill($spill, sys_get_temp_dir());
+		}
+		$parser->on(Phalcon\Http\Parser::ON_PART, function ($part) use (&$parts, $callback) {
+			if ($callback) {
+				$part = $callback($part);
+			}
+			$parts[] = $part;
+		});
+		$parser->on(Phalcon\Http\Parser::ON_COMPLETE, function () use (&$complete) {
+			$complete = true;
+		});
+
+		$result = true;
+		foreach ($chunks as $chunk) {
+			if ($parser->feed($chunk) === false) {
+				$result = false;
+				break;
+			}
+		}
+
+		return array($result, $parts, $complete);
+	}
+
+	protected function assertParts($parts)
+	{
+		$this->assertEquals(count($parts), 2);
+
+		$this->assertEquals($parts[0]['name'], 'a');
+		$this->assertEquals($parts[0]['data'], "one\r\n--AaB0\r\n--AaB03\r\nx");
+		$this->assertEquals($parts[0]['size'], 23);
+		$this->assertFalse(isset($parts[0]['filename']));
+
+		$this->assertEquals($parts[1]['name'], 'b');
+		$this->assertEquals($parts[1]['filename'], 'b.txt');
+		$this->assertEquals($parts[1]['type'], 'text/plain');
+		$this->assertEquals($parts[1]['headers']['Content-Type'], 'text/plain');
+		$this->assertEquals($parts[1]['headers']['Content-Disposition'], 'form-data; name="b"; filename="b.txt"');
+		$this->assertEquals($parts[1]['size'], 10);
+	}
+
+	public function testParserFeed()
+	{
+		$message = "POST /http/test?arg=value HTTP/1.1\r\n"
+			. "Host: localhost\r\n"
+			. "Cookie: name=phalcon\r\n"
+			. "Content-Length: 11\r\n"
+			. "\r\n"
+			. "hello world";
+
+		$info = null;
+		$body = '';
+		$complete = false;
+
+		$parser = new Phalcon\Http\Parser(Phalcon\Http\Parser::TYPE_REQUEST);
+		$parser->on(Phalcon\Http\Parser::ON_HEADERS, function ($headers) use (&$info) {
+			$info = $headers;
+		});
+		$parser->on(Phalcon\Http\Parser::ON_BODY, function ($chunk) use (&$body) {
+			$body .= $chunk;
+		});
+		$parser->on(Phalcon\Http\Parser::ON_COMPLETE, function () use (&$complete) {
+			$complete = true;
+		});
+
+		// headers and body split across several feed() calls
+		foreach (str_split($message, 7) as $chunk) {
+			$this->assertEquals($parser->feed($chunk), strlen($chunk));
+		}
+
+		$this->assertEquals($info['REQUEST_METHOD'], 'POST');
+		$this->assertEquals($info['QUERY_STRING'], '/http/test?arg=value');
+		$this->assertEquals($info['HEADERS']['Cookie'], 'name=phalcon');
+		$this->assertEquals($body, 'hello world');
+		$this->assertTrue($complete);
+	}
+
+	public function testParserMultipart()
+	{
+		$message = $this->multipart($this->multipartBody());
+
+		// in one go
+		list($result, $parts, $complete) = $this->feedParts(array($message));
+		$this->assertTrue($result);
+		$this->assertTrue($complete);
+		$this->assertParts($parts);
+
+		// one byte at a time
+		list($result, $parts, $complete) = $this->feedParts(str_split($message));
+		$this->assertTrue($result);
+		$this->assertTrue($complete);
+		$this->assertParts($parts);
+
+		// the second delimiter cut in the middle
+		$split = strpos($message, "\r\n--AaB03x\r\nContent-Disposition: form-data; name=\"b\"") + 6;
+		list($result, $parts, $complete) = $this->feedParts(array(substr($message, 0, $split), substr($message, $split)));
+		$this->assertTrue($result);
+		$this->assertParts($parts);
+
+		// and every other place a body may be cut at
+		$start = strpos($message, "\r\n\r\n") + 4;
+		for ($split = $start; $split < strlen($message); $split++) {
+			list($result, $parts, $complete) = $this->feedParts(array(substr($message, 0, $split), substr($message, $split)));
+			$this->assertTrue($result);
+			$this->assertTrue($complete);
+			$this->assertParts($parts);
+		}
+	}
+
+	public function testParserSpill()
+	{
+		$message = $this->multipart($this->multipartBody());
+		$test = $this;
+		$files = array();
+
+		// parts over 16 bytes go to a temporary file, the others stay in memory
+		list($result, $parts, $complete) = $this->feedParts(str_split($message, 5), 16, function ($part) use ($test, &$files) {
+			if (isset($part['tmp_name'])) {
+				$test->assertTrue(is_file($part['tmp_name']));
+				$test->assertEquals(realpath(dirname($part['tmp_name'])), realpath(sys_get_temp_dir()));
+				$part['data'] = file_get_contents($part['tmp_name']);
+				$files[] = $part['tmp_name'];
+			}
+			return $part;
+		});
+
+		$this->assertTrue($result);
+		$this->assertEquals(count($files), 1);
+		$this->assertEquals($parts[0]['data'], "one\r\n--AaB0\r\n--AaB03\r\nx");
+		$this->assertEquals($parts[1]['data'], '0123456789');
+		$this->assertFalse(isset($parts[1]['tmp_name']));
+
+		// a file the callback leaves in place is removed afterwards
+		$this->assertFalse(file_exists($files[0]));
+
+		// a file the callback moves is kept
+		$target = tempnam(sys_get_temp_dir(), 'phalcon');
+		list($result, $parts, $complete) = $this->feedParts(array($message), 0, function ($part) use ($target) {
+			if ($part['name'] == 'b') {
+				rename($part['tmp_name'], $target);
+			}
+			return $part;
+		});
+
+		$this->assertTrue($result);
+		$this->assertTrue(isset($parts[0]['tmp_name']) && isset($parts[1]['tmp_name']));
+		$this->assertFalse(file_exists($parts[0]['tmp_name']));
+		$this->assertEquals(file_get_contents($target), '0123456789');
+		unlink($target);
+	}
+
+	public function testParserMalformedMultipart()
+	{
+		// only transport padding may follow a boundary
+		$body = "--AaB03x\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\none\r\n--AaB03xZ\r\n";
+		list($result, $parts, $complete) = $this->feedParts(array($this->multipart($body)));
+		$this->assertFalse($result);
+		$this->assertFalse($complete);
+
+		// the message ends before the closing delimiter, the cut part is dropped
+		$body = $this->multipartBody();
+		$body = substr($body, 0, strpos($body, '0123456789') + 4);
+		list($result, $parts, $complete) = $this->feedParts(array($this->multipart($body)));
+		$this->assertTrue($result);
+		$this->assertTrue($complete);
+		$this->assertEquals(count($parts), 1);
+		$this->assertEquals($parts[0]['name'], 'a');
+
+		// the connection closes before Content-Length is reached
+		$body = $this->multipartBody();
+		$message = $this->multipart(substr($body, 0, 40), strlen($body));
+		list($result, $parts, $complete) = $this->feedParts(array($message, ''));
+		$this->assertFalse($result);
+		$this->assertFalse($complete);
+		$this->assertEquals(count($parts), 0);
+
+		// the temporary file of a part cut short is removed with the parser
+		$before = glob(sys_get_temp_dir() . '/php*');
+		$message = $this->multipart(substr($body, 0, strpos($body, '0123456789') + 4), strlen($body));
+		list($result, $parts, $complete) = $this->feedParts(array($message, ''), 0);
+		$this->assertFalse($result);
+		$this->assertEquals(count($parts), 1);
+		$this->assertEquals(glob(sys_get_temp_dir() . '/php*'), $before);
+	}
 }
@@ -52,4 +52,54 @@ class LoggerTest extends PHPUnit\Framework\TestCase
 		$lines = file($logfile);
 		$this->assertEquals(count($lines), 3);
 	}
+
+	public function testBufferedFileAdapter()
+	{
+		$logfile = "unit-tests/logs/file.log";
+
+		@unlink($logfile);
+
+		$logger = new \Phalcon\Logger\Adapter\File($logfile, array('buffer' => 65536));
+		$logger->log(\Phalcon\Logger::DEBUG, 'This is a message');
+		$logger->log(\Phalcon\Logger::ERROR, "This is an error");
+		$logger->error("This is another error");
+
+		clearstatcache();
+		$this->assertEquals(filesize($logfile), 0);
+
+		$this->assertTrue($logger->flush());
+
+		$lines = file($logfile);
+		$this->assertEquals(count($lines), 3);
+
+		$logger = new \Phalcon\Logger\Adapter\File($logfile, array('buffer' => 65536, 'async' => true));
+		$logger->error("This is another error");
+		$logger->close();
+
+		$lines = file($logfile);
+		$this->assertEquals(count($lines), 4);
+	}
+
+	public function testFormatters()
+	{
+		date_default_timezone_set('UTC');
+
+		$formatter = new \Phalcon\Logger\Formatter\Line('%type%|%message%|%date%|%other%', 'Y-m-d');
+		$line = $formatter->format('Hello %date%', \Phalcon\Logger::ERROR, 0, NULL);
+		$this->assertEquals($line, 'ERROR|Hello %date%|1970-01-01|%other%'.PHP_EOL);
+
+		$line = $formatter->format('Hello {name}', \Phalcon\Logger::INFO, 86400, array('name' => 'Phalcon'));
+		$this->assertEquals($line, 'INFO|Hello Phalcon|1970-01-02|%other%'.PHP_EOL);
+
+		$formatter->setFormat('[%type%] %message%');
+		$line = $formatter->format('Hello', \Phalcon\Logger::DEBUG, 0, NULL);
+		$this->assertEquals($line, '[DEBUG] Hello'.PHP_EOL);
+
+		$formatter = new \Phalcon\Logger\Formatter\Json();
+		$messages = array("plain", "quote \" slash / back \\ tab \t nl \n ctrl \x01", "unicode ünïcødé");
+		foreach ($messages as $message) {
+			$line = $formatter->format($message, \Phalcon\Logger::ERROR, 1234, NULL);
+			$this->assertEquals($line, json_encode(array('type' => 'ERROR', 'message' => $message, 'timestamp' => 1234)).PHP_EOL);
+		}
+	}
 }
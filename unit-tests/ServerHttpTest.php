@@ -0,0 +1,264 @@
+<?php
+
+/*
+	+------------------------------------------------------------------------+
+	| Phalcon Framework                                                      |
+	+------------------------------------------------------------------------+
+	| Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+	+------------------------------------------------------------------------+
+	| This source file is subject to the New BSD License that is bundled     |
+	| with this package in the file docs/LICENSE.txt.                        |
+	|                                                                        |
+	| If you did not receive a copy of the license and are unable to         |
+	| obtain it through the world-wide-web, please send an email             |
+	| to license@phalconphp.com so we can send you a copy immediately.       |
+	+------------------------------------------------------------------------+
+	| Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+	|          Eduar Carvajal <eduar@phalconphp.com>                         |
+	|          ZhuZongXin <dreamsxin@qq.com>                                 |
+	+------------------------------------------------------------------------+
+*/
+
+class ServerHttpTestResponse
+{
+	protected $_content;
+
+	public function __construct($content)
+	{
+		$this->_content = $content;
+	}
+
+	public function getContent()
+	{
+		return $this->_content;
+	}
+}
+
+class ServerHttpTestApplication
+{
+	public $server;
+
+	public function handle($url)
+	{
+		$content = array('pid' => getmypid(), 'url' => $url);
+		if ($url == '/stats') {
+			$content['stats'] = $this->server->getStats();
+		}
+		return new ServerHttpTestResponse(json_encode($content));
+	}
+}
+
+class ServerHttpTest extends PHPUnit\Framework\TestCase
+{
+	protected function request($port, $url)
+	{
+		// The server binds once its workers run, a recycled worker may reset a queued connection
+		for ($i = 0; $i < 50; $i++) {
+			$client = @stream_socket_client('tcp://127.0.0.1:' . $port, $errno, $errstr, 1);
+			if ($client) {
+				stream_set_timeout($client, 5);
+				fwrite($client, "GET " . $url . " HTTP/1.0\r\nHost: 127.0.0.1:" . $port . "\r\n\r\n");
+				$response = stream_get_contents($client);
+				fclose($client);
+				if (($pos = strpos($response, "\r\n\r\n")) !== false) {
+					return json_decode(substr($response, $pos + 4), true);
+				}
+			}
+			usleep(100000);
+		}
+
+		$this->fail('Unable to request ' . $url . ' from the server');
+	}
+
+	protected function send($port, $request)
+	{
+		for ($i = 0; $i < 50; $i++) {
+			$client = @stream_socket_client('tcp://127.0.0.1:' . $port, $errno, $errstr, 1);
+			if ($client) {
+				stream_set_timeout($client, 5);
+				fwrite($client, $request . "\r\n");
+				$response = stream_get_contents($client);
+				fclose($client);
+
+				list($head, $body) = explode("\r\n\r\n", $response, 2);
+				$lines = explode("\r\n", $head);
+				$status = (int) substr(array_shift($lines), 9, 3);
+				$headers = array();
+				foreach ($lines as $line) {
+					list($name, $value) = explode(':', $line, 2);
+					$headers[strtolower($name)] = trim($value);
+				}
+				return array($status, $headers, $body);
+			}
+			usleep(100000);
+		}
+
+		$this->fail('Unable to connect to the server: ' . $errstr);
+	}
+
+	public function testStatsName()
+	{
+		if (!class_exists('Phalcon\Server\Http')) {
+			$this->markTestSkipped('Class `Phalcon\Server\Http` is not exists');
+			return false;
+		}
+
+		foreach (array('phalcon-server', '/' . str_repeat('a', 64)) as $name) {
+			try {
+				new Phalcon\Server\Http(array('stats' => $name));
+				$this->fail('The stats name ' . $name . ' was accepted');
+			} catch (Phalcon\Server\Exception $e) {
+				$this->assertEquals($e->getMessage(), 'The stats name must start with a slash and be shorter than 64 characters');
+			}
+		}
+
+		// nothing is running under that name
+		$server = new Phalcon\Server\Http(array('stats' => '/phalcon-server-missing-' . getmypid()));
+		$this->assertFalse($server->getStats());
+	}
+
+	public function testMaxRequests()
+	{
+		if (!class_exists('Phalcon\Server\Http')) {
+			$this->markTestSkipped('Class `Phalcon\Server\Http` is not exists');
+			return false;
+		}
+		if (!function_exists('pcntl_fork') || !function_exists('posix_kill')) {
+			$this->markTestSkipped('Test skipped');
+			return false;
+		}
+
+		$port = 20000 + (getmypid() + 2) % 10000;
+		$name = '/phalcon-server-test-' . getmypid();
+
+		$pid = pcntl_fork();
+		if ($pid == 0) {
+			$application = new ServerHttpTestApplication();
+			$application->server = new Phalcon\Server\Http(array(
+				'host' => '127.0.0.1',
+				'port' => $port,
+				'worker' => 1,
+				'maxRequests' => 2,
+				'stats' => $name,
+			));
+			try {
+				$application->server->start($application);
+			} catch (Exception $e) {
+			}
+			// skip the shutdown of PHPUnit in the forked process
+			posix_kill(getmypid(), SIGKILL);
+		}
+
+		$first = $this->request($port, '/first');
+		$second = $this->request($port, '/second');
+		$this->assertEquals($first['url'], '/first');
+		$this->assertEquals($second['pid'], $first['pid']);
+
+		// the worker is replaced once it served two requests
+		usleep(200000);
+		$third = $this->request($port, '/stats');
+		$this->assertNotEquals($third['pid'], $first['pid']);
+		$this->assertEquals($third['stats']['master'], $pid);
+		$this->assertEquals(count($third['stats']['workers']), 1);
+		$this->assertEquals($third['stats']['workers'][0]['pid'], $third['pid']);
+		$this->assertEquals($third['stats']['workers'][0]['restarts'], 1);
+
+		// another process reads the same counters by name
+		usleep(100000);
+		$server = new Phalcon\Server\Http(array('stats' => $name));
+		$stats = $server->getStats();
+		$this->assertEquals($stats['master'], $pid);
+		$this->assertEquals($stats['workers'][0]['pid'], $third['pid']);
+		$this->assertEquals($stats['workers'][0]['requests'], 3);
+		$this->assertEquals($stats['workers'][0]['failures'], 0);
+
+		posix_kill($pid, SIGINT);
+		pcntl_waitpid($pid, $status);
+
+		// the master removes the counters when it stops
+		$this->assertFalse($server->getStats());
+	}
+
+	public function testStaticDir()
+	{
+		if (!class_exists('Phalcon\Server\Http')) {
+			$this->markTestSkipped('Class `Phalcon\Server\Http` is not exists');
+			return false;
+		}
+		if (!function_exists('pcntl_fork') || !function_exists('posix_kill') || !function_exists('gzencode')) {
+			$this->markTestSkipped('Test skipped');
+			return false;
+		}
+
+		$port = 20000 + (getmypid() + 3) % 10000;
+		$root = sys_get_temp_dir() . '/phalcon-static-' . getmypid();
+		$secret = $root . '-secret.txt';
+		$content = str_repeat('0123456789', 10);
+
+		@mkdir($root);
+		file_put_contents($root . '/app.js', $content);
+		file_put_contents($root . '/app.js.gz', gzencode($content));
+		file_put_contents($secret, 'secret');
+		@symlink($secret, $root . '/link.txt');
+
+		$pid = pcntl_fork();
+		if ($pid == 0) {
+			$server = new Phalcon\Server\Http(array('host' => '127.0.0.1', 'port' => $port, 'worker' => 1));
+			$server->addStaticDir('/assets', $root);
+			try {
+				$server->start(new ServerHttpTestApplication());
+			} catch (Exception $e) {
+			}
+			// skip the shutdown of PHPUnit in the forked process
+			posix_kill(getmypid(), SIGKILL);
+		}
+
+		list($status, $headers, $body) = $this->send($port, "GET /assets/app.js HTTP/1.1\r\nHost: localhost\r\n");
+		$this->assertEquals($status, 200);
+		$this->assertEquals($body, $content);
+		$this->assertEquals($headers['vary'], 'Accept-Encoding');
+		$etag = $headers['etag'];
+
+		// neither an encoded ".." nor a symlink leads out of the root
+		list($status) = $this->send($port, "GET /assets/%2e%2e/" . basename($secret) . " HTTP/1.1\r\nHost: localhost\r\n");
+		$this->assertEquals($status, 404);
+		list($status, , $body) = $this->send($port, "GET /assets/link.txt HTTP/1.1\r\nHost: localhost\r\n");
+		$this->assertEquals($status, 404);
+		$this->assertNotEquals($body, 'secret');
+
+		list($status, $headers, $body) = $this->send($port, "GET /assets/app.js HTTP/1.1\r\nHost: localhost\r\nRange: bytes=-10\r\n");
+		$this->assertEquals($status, 206);
+		$this->assertEquals($headers['content-range'], 'bytes 90-99/100');
+		$this->assertEquals($body, '0123456789');
+
+		list($status, $headers, $body) = $this->send($port, "GET /assets/app.js HTTP/1.1\r\nHost: localhost\r\nRange: bytes=95-\r\n");
+		$this->assertEquals($status, 206);
+		$this->assertEquals($headers['content-range'], 'bytes 95-99/100');
+		$this->assertEquals($body, '56789');
+
+		list($status, $headers, $body) = $this->send($port, "GET /assets/app.js HTTP/1.1\r\nHost: localhost\r\nRange: bytes=200-\r\n");
+		$this->assertEquals($status, 416);
+		$this->assertEquals($headers['content-range'], 'bytes */100');
+		$this->assertEquals($body, '');
+
+		list($status, $headers, $body) = $this->send($port, "GET /assets/app.js HTTP/1.1\r\nHost: localhost\r\nIf-None-Match: W/" . $etag . "\r\n");
+		$this->assertEquals($status, 304);
+		$this->assertEquals($headers['etag'], $etag);
+		$this->assertEquals($body, '');
+
+		// the precompressed sibling is sent as is
+		list($status, $headers, $body) = $this->send($port, "GET /assets/app.js HTTP/1.1\r\nHost: localhost\r\nAccept-Encoding: br;q=0, gzip\r\n");
+		$this->assertEquals($status, 200);
+		$this->assertEquals($headers['content-encoding'], 'gzip');
+		$this->assertEquals(gzdecode($body), $content);
+
+		posix_kill($pid, SIGINT);
+		pcntl_waitpid($pid, $status);
+
+		unlink($root . '/link.txt');
+		unlink($root . '/app.js.gz');
+		unlink($root . '/app.js');
+		rmdir($root);
+		unlink($secret);
+	}
+}
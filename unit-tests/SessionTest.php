@@ -80,4 +80,80 @@ class SessionTest extends PHPUnit\Framework\TestCase
 		$this->assertFalse($session->has('some'));
 	}
 
+	public function testSessionShm()
+	{
+		$session = new Phalcon\Session\Adapter\Shm(array(
+			'name' => '/phalcon_session_test',
+			'size' => 1048576,
+			'slotSize' => 1024,
+			'lifetime' => 60
+		));
+
+		$this->assertTrue($session->start());
+		$this->assertTrue($session->isStarted());
+
+		$session->set('some', 'value');
+
+		$this->assertEquals($session->get('some'), 'value');
+		$this->assertTrue($session->has('some'));
+		$this->assertEquals($session->get('undefined', 'my-default'), 'my-default');
+
+		// Automatically deleted after reading
+		$this->assertEquals($session->get('some', NULL, TRUE), 'value');
+		$this->assertFalse($session->has('some'));
+
+		$this->assertTrue($session->write('shm-test', 'a|s:1:"b";'));
+		$this->assertEquals($session->read('shm-test'), 'a|s:1:"b";');
+
+		// Unchanged data only refreshes the access time
+		$this->assertTrue($session->write('shm-test', 'a|s:1:"b";'));
+		$this->assertEquals($session->read('shm-test'), 'a|s:1:"b";');
+
+		$this->assertTrue($session->write('shm-test', 'a|s:1:"c";'));
+		$this->assertEquals($session->read('shm-test'), 'a|s:1:"c";');
+
+		$this->assertFalse(@$session->write('shm-test', str_repeat('x', 2048)));
+
+		$this->assertTrue($session->destroy('shm-test'));
+		$this->assertEquals($session->read('shm-test'), '');
+
+		// The same payload under a new id, as after session_regenerate_id(), is still written
+		$this->assertTrue($session->write('shm-old', 'a|s:1:"d";'));
+		$this->assertEquals($session->read('shm-old'), 'a|s:1:"d";');
+		$this->assertTrue($session->write('shm-new', 'a|s:1:"d";'));
+		$this->assertEquals($session->read('shm-new'), 'a|s:1:"d";');
+		$this->assertTrue($session->destroy('shm-old'));
+		$this->assertTrue($session->destroy('shm-new'));
+	}
+
+	public function testSessionShmFullBucket()
+	{
+		$name = 'phalcon_session_full_' . getmypid();
+
+		// A single bucket of eight slots
+		$session = new Phalcon\Session\Adapter\Shm(array(
+			'name' => '/' . $name,
+			'size' => 2176,
+			'slotSize' => 256,
+			'lifetime' => 60
+		));
+		$this->assertTrue($session->start());
+
+		for ($i = 0; $i < 8; $i++) {
+			$this->assertTrue($session->write('full-' . $i, 'a|i:' . $i . ';'));
+		}
+
+		// A live session is never evicted to make room
+		$this->assertFalse($session->write('full-8', 'a|i:8;'));
+		for ($i = 0; $i < 8; $i++) {
+			$this->assertEquals($session->read('full-' . $i), 'a|i:' . $i . ';');
+		}
+
+		$this->assertTrue($session->destroy('full-0'));
+		$this->assertTrue($session->write('full-8', 'a|i:8;'));
+		$this->assertEquals($session->read('full-8'), 'a|i:8;');
+
+		@unlink('/dev/shm/' . $name);
+		@unlink('/dev/shm/sem.' . $name);
+	}
 }
@@ -0,0 +1,115 @@
+<?php
+
+/*
+	+------------------------------------------------------------------------+
+	| Phalcon Framework                                                      |
+	+------------------------------------------------------------------------+
+	| Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+	+------------------------------------------------------------------------+
+	| This source file is subject to the New BSD License that is bundled     |
+	| with this package in the file docs/LICENSE.txt.                        |
+	|                                                                        |
+	| If you did not receive a copy of the license and are unable to         |
+	| obtain it through the world-wide-web, please send an email             |
+	| to license@phalconphp.com so we can send you a copy immediately.       |
+	+------------------------------------------------------------------------+
+	| Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+	|          Eduar Carvajal <eduar@phalconphp.com>                         |
+	|          ZhuZongXin <dreamsxin@qq.com>                                 |
+	+------------------------------------------------------------------------+
+*/
+
+class SocketServerTest extends PHPUnit\Framework\TestCase
+{
+	protected function connect($port)
+	{
+		// The server binds once its process runs the loop
+		for ($i = 0; $i < 50; $i++) {
+			$client = @stream_socket_client('tcp://127.0.0.1:' . $port, $errno, $errstr, 1);
+			if ($client) {
+				stream_set_timeout($client, 5);
+				return $client;
+			}
+			usleep(100000);
+		}
+
+		$this->fail('Unable to connect to the server: ' . $errstr);
+	}
+
+	public function testEpollLoop()
+	{
+		if (!class_exists('Phalcon\Socket\Server') || !defined('Phalcon\Socket\Server::USE_EPOLL')) {
+			$this->markTestSkipped('Class `Phalcon\Socket\Server` is not exists or has no epoll support');
+			return false;
+		}
+		if (!function_exists('pcntl_fork') || !function_exists('posix_kill')) {
+			$this->markTestSkipped('Test skipped');
+			return false;
+		}
+
+		$port = 20000 + getmypid() % 10000;
+
+		$pid = pcntl_fork();
+		if ($pid == 0) {
+			$server = new Phalcon\Socket\Server('127.0.0.1', $port);
+			$server->setOption(SOL_SOCKET, SO_REUSEADDR, 1);
+			$server->setEvent(Phalcon\Socket\Server::USE_EPOLL);
+			$server->setIdleTimeout(1);
+			try {
+				$server->run(
+					function ($client) {
+						$client->write("hello\n");
+					},
+					function ($client, $data) use ($server) {
+						if ($data === 'quit') {
+							$server->disconnect($client->getSocketId());
+							return;
+						}
+						// at most maxlen (1024) bytes are handed over per call
+						$client->write(strlen($data) . "\n");
+					}
+				);
+			} catch (Exception $e) {
+			}
+			// skip the shutdown of PHPUnit in the forked process
+			posix_kill(getmypid(), SIGKILL);
+		}
+
+		// accept and recv
+		$client = $this->connect($port);
+		$this->assertEquals(fgets($client), "hello\n");
+		fwrite($client, 'ping');
+		$this->assertEquals(fgets($client), "4\n");
+
+		// a burst larger than maxlen is split, nothing is lost
+		fwrite($client, str_repeat('x', 65536));
+		$total = 0;
+		while ($total < 65536 && ($line = fgets($client)) !== false) {
+			$this->assertLessThanOrEqual(1024, (int) $line);
+			$total += (int) $line;
+		}
+		$this->assertEquals($total, 65536);
+
+		// disconnect from a callback releases the connection
+		fwrite($client, 'quit');
+		$this->assertEquals(fread($client, 10), '');
+		$this->assertTrue(feof($client));
+		fclose($client);
+
+		// the released slot is reused by the next connection
+		$client = $this->connect($port);
+		$this->assertEquals(fgets($client), "hello\n");
+		fwrite($client, 'pong');
+		$this->assertEquals(fgets($client), "4\n");
+
+		// idle expiry closes a quiet connection
+		$start = microtime(true);
+		$this->assertEquals(fread($client, 10), '');
+		$this->assertTrue(feof($client));
+		$this->assertLessThan(4, microtime(true) - $start);
+		fclose($client);
+
+		posix_kill($pid, SIGKILL);
+		pcntl_waitpid($pid, $status);
+	}
+}
@@ -21,6 +21,14 @@
 
 class StorageBloomfilterTest extends PHPUnit\Framework\TestCase
 {
+	public function tearDown()
+	{
+		// shm_open() segments and their semaphores outlive the process
+		$name = 'phalcon-bloom-'.getmypid();
+		@unlink('/dev/shm/'.$name);
+		@unlink('/dev/shm/sem.'.$name);
+	}
+
 	public function testNormal()
 	{
 		if (!class_exists('Phalcon\Storage\Bloomfilter')) {
@@ -38,4 +46,91 @@ class StorageBloomfilterTest extends PHPUnit\Framework\TestCase
 		$filter = new Phalcon\Storage\Bloomfilter('unit-tests/cache/bloomfilter.bin');
 		$this->assertTrue($filter->check("Phalcon7"));
 	}
+
+	public function testBlocked()
+	{
+		if (!class_exists('Phalcon\Storage\Bloomfilter\Blocked')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Bloomfilter\Blocked` is not exists');
+			return false;
+		}
+
+		$filter = new Phalcon\Storage\Bloomfilter\Blocked();
+		$this->assertFalse($filter->check("Phalcon7"));
+		$this->assertTrue($filter->add("Phalcon7"));
+		$this->assertTrue($filter->check("Phalcon7"));
+		$this->assertEquals(count($filter), 1);
+		$this->assertFalse($filter->save());
+
+		for ($i = 0; $i < 1000; $i++) {
+			$filter->add('key'.$i);
+		}
+		for ($i = 0; $i < 1000; $i++) {
+			$this->assertTrue($filter->check('key'.$i));
+		}
+
+		$file = 'unit-tests/cache/bloomfilter-blocked.bin';
+		@unlink($file);
+
+		$filter = new Phalcon\Storage\Bloomfilter\Blocked($file, 0, 1000, 0.001);
+		$this->assertTrue($filter->add("Phalcon7"));
+
+		// a second mapping sees the bit without any save or load
+		$other = new Phalcon\Storage\Bloomfilter\Blocked($file);
+		$this->assertTrue($other->check("Phalcon7"));
+		$this->assertTrue($filter->save());
+
+		$this->assertTrue($other->reset());
+		$this->assertFalse($filter->check("Phalcon7"));
+		$this->assertEquals(count($filter), 0);
+		unset($filter, $other);
+		@unlink($file);
+
+		$name = '/phalcon-bloom-'.getmypid();
+		$filter = new Phalcon\Storage\Bloomfilter\Blocked($name, 0, 1000, 0.001, Phalcon\Storage\Bloomfilter\Blocked::STORAGE_SHM);
+		$this->assertTrue($filter->add("Phalcon7"));
+
+		$other = new Phalcon\Storage\Bloomfilter\Blocked($name, 0, 1000, 0.001, Phalcon\Storage\Bloomfilter\Blocked::STORAGE_SHM);
+		$this->assertTrue($other->check("Phalcon7"));
+		$this->assertTrue($other->reset());
+		$this->assertFalse($filter->check("Phalcon7"));
+	}
+
+	public function testCountingMany()
+	{
+		if (!class_exists('Phalcon\Storage\Bloomfilter\Counting')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Bloomfilter\Counting` is not exists');
+			return false;
+		}
+
+		$types = array(Phalcon\Storage\Bloomfilter\Counting::TYPE_COUNTING, Phalcon\Storage\Bloomfilter\Counting::TYPE_CUCKOO);
+		foreach ($types as $type) {
+			$file = 'unit-tests/cache/bloomfilter-counting-'.$type.'.bin';
+			@unlink($file);
+
+			$filter = new Phalcon\Storage\Bloomfilter\Counting($file, 100000, 0.001, $type);
+
+			$values = array();
+			for ($i = 0; $i < 20; $i++) {
+				$values[] = 'id'.$i;
+			}
+
+			$bitmap = $filter->addMany($values);
+			$this->assertEquals(strlen($bitmap), 3);
+			$this->assertEquals($bitmap, "\xff\xff\x0f");
+
+			$bitmap = $filter->checkMany(array('id0', 'missing', 'id19'));
+			$this->assertEquals(ord($bitmap[0]) & 1, 1);
+			$this->assertEquals(ord($bitmap[0]) >> 1 & 1, 0);
+			$this->assertEquals(ord($bitmap[0]) >> 2 & 1, 1);
+
+			$this->assertTrue($filter->remove('id0'));
+			$this->assertFalse($filter->check('id0'));
+			$this->assertTrue($filter->check('id1'));
+			$this->assertTrue($filter->save());
+
+			$this->assertEquals($filter->checkMany(array()), '');
+			unset($filter);
+			@unlink($file);
+		}
+	}
 }
@@ -33,4 +33,196 @@ class StorageBtreeTest extends PHPUnit\Framework\TestCase
 		$this->assertTrue($btree->delete("key1"));
 		$this->assertEquals($btree->get("key1"), "");
 	}
+
+	public function testBulk()
+	{
+		if (!class_exists('Phalcon\Storage\Btree')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Btree` is not exists');
+			return false;
+		}
+		@unlink('unit-tests/cache/tree-bulk.db');
+		$btree = new Phalcon\Storage\Btree('unit-tests/cache/tree-bulk.db');
+
+		$data = array();
+		for ($i = 999; $i >= 0; $i--) {
+			$data[sprintf('key%04d', $i)] = 'value' . $i;
+		}
+		$this->assertTrue($btree->setMany($data));
+		$this->assertEquals($btree->get('key0500'), 'value500');
+
+		$range = array();
+		foreach ($btree->range('key0100', 'key0104') as $key => $value) {
+			$range[$key] = $value;
+		}
+		$this->assertEquals($range, array(
+			'key0100' => 'value100',
+			'key0101' => 'value101',
+			'key0102' => 'value102',
+			'key0103' => 'value103',
+			'key0104' => 'value104',
+		));
+
+		$this->assertEquals(iterator_count($btree->range()), 1000);
+		$this->assertEquals(iterator_count($btree->range('key0990')), 10);
+
+		$this->assertTrue($btree->sync());
+		$this->assertTrue($btree->compact());
+		$this->assertEquals($btree->get('key0999'), 'value999');
+	}
+
+	public function testCompression()
+	{
+		if (!class_exists('Phalcon\Storage\Btree')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Btree` is not exists');
+			return false;
+		}
+		@unlink('unit-tests/cache/tree-plain.db');
+		@unlink('unit-tests/cache/tree-packed.db');
+
+		$codec = NULL;
+		foreach (array(Phalcon\Storage\Btree::COMPRESSION_LZ4, Phalcon\Storage\Btree::COMPRESSION_ZSTD) as $candidate) {
+			try {
+				new Phalcon\Storage\Btree('unit-tests/cache/tree-packed.db', $candidate);
+				$codec = $candidate;
+				break;
+			} catch (Phalcon\Storage\Exception $e) {
+			}
+		}
+		if ($codec === NULL) {
+			$this->markTestSkipped('Neither lz4 nor zstd is available in this build');
+			return false;
+		}
+		@unlink('unit-tests/cache/tree-packed.db');
+
+		$value = str_repeat('phalcon btree page ', 200);
+
+		$plain = new Phalcon\Storage\Btree('unit-tests/cache/tree-plain.db', Phalcon\Storage\Btree::COMPRESSION_NONE);
+		$packed = new Phalcon\Storage\Btree('unit-tests/cache/tree-packed.db', $codec);
+		for ($i = 0; $i < 100; $i++) {
+			$this->assertTrue($plain->set('key' . $i, $value . $i));
+			$this->assertTrue($packed->set('key' . $i, $value . $i));
+		}
+		for ($i = 0; $i < 100; $i++) {
+			$this->assertEquals($packed->get('key' . $i), $value . $i);
+		}
+		unset($plain, $packed);
+
+		clearstatcache();
+		$this->assertLessThan(filesize('unit-tests/cache/tree-plain.db') / 2, filesize('unit-tests/cache/tree-packed.db'));
+
+		$packed = new Phalcon\Storage\Btree('unit-tests/cache/tree-packed.db', $codec);
+		for ($i = 0; $i < 100; $i++) {
+			$this->assertEquals($packed->get('key' . $i), $value . $i);
+		}
+		unset($packed);
+
+		// Frames carry their codec, the file can be reopened with another one
+		$btree = new Phalcon\Storage\Btree('unit-tests/cache/tree-packed.db', Phalcon\Storage\Btree::COMPRESSION_NONE);
+		$this->assertEquals($btree->get('key42'), $value . '42');
+		$this->assertTrue($btree->set('key100', $value));
+		$this->assertEquals($btree->get('key100'), $value);
+		$this->assertEquals($btree->get('key99'), $value . '99');
+	}
+
+	public function testCorruptedFrame()
+	{
+		if (!class_exists('Phalcon\Storage\Btree')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Btree` is not exists');
+			return false;
+		}
+		$file = 'unit-tests/cache/tree-corrupt.db';
+		$marker = 'phalcon-corrupted-frame-marker';
+
+		// Stored frames keep the value bytes as is, which makes them easy to find
+		@unlink($file);
+		$btree = new Phalcon\Storage\Btree($file, Phalcon\Storage\Btree::COMPRESSION_NONE);
+		$this->assertTrue($btree->set('key', $marker));
+		$this->assertTrue($btree->set('other', 'value'));
+		unset($btree);
+
+		$data = file_get_contents($file);
+		$pos = strpos($data, $marker);
+		$this->assertTrue($pos !== false);
+
+		// A flipped payload byte fails the checksum
+		$bytes = $data;
+		$bytes[$pos] = chr(ord($bytes[$pos]) ^ 0xff);
+		file_put_contents($file, $bytes);
+
+		$btree = new Phalcon\Storage\Btree($file, Phalcon\Storage\Btree::COMPRESSION_NONE, array('cacheSize' => 0));
+		$this->assertNull($btree->get('key'));
+		$this->assertEquals($btree->get('other'), 'value');
+		unset($btree);
+
+		// A huge uncompressed length is rejected before anything is allocated from it,
+		// the frame header sits before the 16 bytes linking the previous value
+		$bytes = $data;
+		$header = $pos - 16 - 16;
+		$bytes = substr_replace($bytes, pack('J', PHP_INT_MAX), $header + 8, 8);
+		file_put_contents($file, $bytes);
+
+		$btree = new Phalcon\Storage\Btree($file, Phalcon\Storage\Btree::COMPRESSION_NONE, array('cacheSize' => 0));
+		$this->assertNull($btree->get('key'));
+		$this->assertEquals($btree->get('other'), 'value');
+	}
+
+	public function testCacheAndMmap()
+	{
+		if (!class_exists('Phalcon\Storage\Btree')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Btree` is not exists');
+			return false;
+		}
+		@unlink('unit-tests/cache/tree-mmap.db');
+
+		$btree = new Phalcon\Storage\Btree('unit-tests/cache/tree-mmap.db', NULL, array('cacheSize' => 65536, 'mmap' => true));
+		for ($i = 0; $i < 500; $i++) {
+			$this->assertTrue($btree->set('key' . $i, 'value' . $i));
+		}
+		for ($i = 0; $i < 500; $i++) {
+			$this->assertEquals($btree->get('key' . $i), 'value' . $i);
+		}
+
+		// Compaction replaces the file under the cache and the mapping
+		$this->assertTrue($btree->compact());
+		$this->assertEquals($btree->get('key250'), 'value250');
+		$this->assertTrue($btree->set('key250', 'updated'));
+		$this->assertEquals($btree->get('key250'), 'updated');
+		unset($btree);
+
+		$btree = new Phalcon\Storage\Btree('unit-tests/cache/tree-mmap.db', NULL, array('cacheSize' => 0));
+		$this->assertEquals($btree->get('key250'), 'updated');
+		$this->assertEquals($btree->get('key499'), 'value499');
+	}
+
+	public function testIteratorAcrossWrites()
+	{
+		if (!class_exists('Phalcon\Storage\Btree')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Btree` is not exists');
+			return false;
+		}
+		@unlink('unit-tests/cache/tree-iterator.db');
+
+		$btree = new Phalcon\Storage\Btree('unit-tests/cache/tree-iterator.db');
+		$data = array();
+		for ($i = 0; $i < 100; $i++) {
+			$data[sprintf('key%04d', $i)] = 'value' . $i;
+		}
+		$this->assertTrue($btree->setMany($data));
+
+		$keys = array();
+		foreach ($btree->range('key0010', 'key0019') as $key => $value) {
+			$this->assertEquals($data[$key], $value);
+			$keys[] = $key;
+
+			if ($key == 'key0012') {
+				// Value offsets of the loaded leaf point into the file replaced here
+				$this->assertTrue($btree->compact());
+			} elseif ($key == 'key0014') {
+				$this->assertTrue($btree->delete('key0015'));
+				$this->assertTrue($btree->set('key0016', 'changed'));
+				$data['key0016'] = 'changed';
+			}
+		}
+		$this->assertEquals($keys, array('key0010', 'key0011', 'key0012', 'key0013', 'key0014', 'key0016', 'key0017', 'key0018', 'key0019'));
+	}
 }
@@ -43,4 +43,32 @@ class StorageDatrieTest extends PHPUnit\Framework\TestCase
 		$ret = $datrie->search($str, true);
 		$this->assertEquals($ret, array(array(6, 4)));
 	}
+
+	public function testAhoCorasick()
+	{
+		if (!class_exists('Phalcon\Storage\Datrie')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Datrie` is not exists');
+			return false;
+		}
+		@unlink('unit-tests/cache/datrie-ac.db');
+		$datrie = new Phalcon\Storage\Datrie('unit-tests/cache/datrie-ac.db');
+
+		foreach (array('he', 'she', 'his', 'hers') as $i => $word) {
+			$this->assertTrue($datrie->add($word, $i));
+		}
+		$this->assertEquals($datrie->search('ushers', true), array(array(1, 3), array(2, 2), array(2, 4)));
+		$this->assertEquals($datrie->search('ushers'), array(array(1, 3)));
+		$this->assertFalse($datrie->search('abc', true));
+
+		$this->assertTrue($datrie->add('敏感', 10));
+		$this->assertEquals($datrie->search('一些敏感内容', true), array(array(6, 6)));
+		$this->assertEquals($datrie->search('一些敏感内容', true, true), array(array(2, 2)));
+		$this->assertTrue($datrie->save());
+		unset($datrie);
+
+		// The automaton is saved along with the trie
+		$datrie = new Phalcon\Storage\Datrie('unit-tests/cache/datrie-ac.db');
+		$this->assertEquals($datrie->query('敏感'), 10);
+		$this->assertEquals($datrie->search('his 敏感', true, true), array(array(0, 3), array(4, 2)));
+	}
 }
@@ -48,4 +48,49 @@ class StorageLeveldbTest extends PHPUnit\Framework\TestCase
 		}
 		$this->assertEquals($ret, ['key2' => 'value2', 'key3' => 'value3']);
 	}
+
+	public function testIteratorRange()
+	{
+		if (!class_exists('Phalcon\Storage\Leveldb')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Leveldb` is not exists');
+			return false;
+		}
+
+		$db = new Phalcon\Storage\Leveldb('unit-tests/cache/leveldb');
+		foreach (['0:a', 'idx:a', 'idx:b', 'idx:c', 'idy:a'] as $key) {
+			$this->assertTrue($db->put($key, $key));
+		}
+
+		$this->assertEquals(iterator_to_array($db->iterator(['prefix' => 'idx:'])), ['idx:a' => 'idx:a', 'idx:b' => 'idx:b', 'idx:c' => 'idx:c']);
+		$this->assertEquals(iterator_to_array($db->iterator(['prefix' => 'idx:', 'keysOnly' => true, 'reverse' => true]), false), ['idx:c', 'idx:b', 'idx:a']);
+		$this->assertEquals(iterator_to_array($db->iterator(['start' => 'idx:b', 'end' => 'idy:a', 'keysOnly' => true]), false), ['idx:b', 'idx:c']);
+		$this->assertEquals(iterator_to_array($db->iterator(['prefix' => 'idx:', 'limit' => 2, 'keysOnly' => true]), false), ['idx:a', 'idx:b']);
+		$this->assertEquals(iterator_to_array($db->iterator(['prefix' => '0'])), ['0:a' => '0:a']);
+	}
+
+	public function testBatching()
+	{
+		if (!class_exists('Phalcon\Storage\Leveldb')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Leveldb` is not exists');
+			return false;
+		}
+
+		$db = new Phalcon\Storage\Leveldb('unit-tests/cache/leveldb', ['batch_size' => 3]);
+		$this->assertTrue($db->put('batch1', 'value1'));
+		$this->assertTrue($db->put('batch2', 'value2'));
+		$this->assertEquals($db->pending(), 2);
+		$this->assertTrue($db->delete('batch2'));
+		$this->assertEquals($db->pending(), 0);
+		$this->assertTrue($db->put('batch3', 'value3'));
+		$this->assertEquals($db->get('batch3'), 'value3');
+		$this->assertEquals($db->pending(), 0);
+		$this->assertFalse($db->get('batch2'));
+
+		$this->assertTrue($db->setBatching(100));
+		$this->assertTrue($db->put('batch4', 'value4'));
+		$this->assertTrue($db->flush(true));
+		$this->assertEquals($db->pending(), 0);
+		$this->assertTrue($db->setBatching(0));
+		$this->assertEquals($db->get('batch4'), 'value4');
+	}
 }
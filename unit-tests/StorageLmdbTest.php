@@ -42,4 +42,68 @@ class StorageLmdbTest extends PHPUnit\Framework\TestCase
 		$this->assertEquals($ret, ['key1' => 'value1', 'key2' => 'value2']);
 		$db->commit();
 	}
+
+	public function testViews()
+	{
+		if (!class_exists('Phalcon\Storage\Lmdb\View')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Lmdb\View` is not exists');
+			return false;
+		}
+		$db = new Phalcon\Storage\Lmdb('unit-tests/cache/lmdb');
+		$db->begin();
+		$this->assertTrue($db->put('view1', 'value1'));
+		$this->assertTrue($db->put('view2', ['a' => 1]));
+		try {
+			$db->view('view1');
+			$this->assertTrue(false);
+		} catch (Phalcon\Storage\Exception $e) {
+			$this->assertTrue(true);
+		}
+		$db->commit();
+
+		$db->begin(Phalcon\Storage\Lmdb::RDONLY);
+		$view = $db->view('view1');
+		$this->assertInstanceOf('Phalcon\Storage\Lmdb\View', $view);
+		$this->assertTrue($view->isValid());
+		$this->assertEquals($view->unserialize(), 'value1');
+		$this->assertTrue($view->equals(serialize('value1')));
+		$this->assertEquals($view->length(), strlen(serialize('value1')));
+		$this->assertFalse($db->view('missing'));
+
+		$this->assertEquals($db->getMany(['view2', 'missing', 'view1']), ['view1' => 'value1', 'view2' => ['a' => 1]]);
+		$views = $db->getMany(['view2', 'view1'], true);
+		$this->assertEquals($views['view2']->unserialize(), ['a' => 1]);
+		$all = $db->getAll(true);
+		$this->assertEquals((string) $all['view1'], serialize('value1'));
+		$db->reset();
+
+		$this->assertFalse($view->isValid());
+		try {
+			$view->unserialize();
+			$this->assertTrue(false);
+		} catch (Phalcon\Storage\Exception $e) {
+			$this->assertTrue(true);
+		}
+	}
+
+	public function testCursorRange()
+	{
+		if (!class_exists('Phalcon\Storage\Lmdb')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Lmdb` is not exists');
+			return false;
+		}
+		$db = new Phalcon\Storage\Lmdb('unit-tests/cache/lmdb');
+		$db->begin();
+		foreach (['0:a', 'idx:a', 'idx:b', 'idx:c', 'idy:a'] as $key) {
+			$this->assertTrue($db->put($key, $key));
+		}
+
+		$this->assertEquals(iterator_to_array($db->cursor(['prefix' => 'idx:'])), ['idx:a' => 'idx:a', 'idx:b' => 'idx:b', 'idx:c' => 'idx:c']);
+		$this->assertEquals(iterator_to_array($db->cursor(['prefix' => 'idx:', 'keysOnly' => true, 'reverse' => true]), false), ['idx:c', 'idx:b', 'idx:a']);
+		$this->assertEquals(iterator_to_array($db->cursor(['start' => 'idx:b', 'end' => 'idy:a', 'keysOnly' => true]), false), ['idx:b', 'idx:c']);
+		$this->assertEquals(iterator_to_array($db->cursor(['prefix' => 'idx:', 'limit' => 2, 'keysOnly' => true]), false), ['idx:a', 'idx:b']);
+		$this->assertEquals(iterator_to_array($db->cursor(['prefix' => '0'])), ['0:a' => '0:a']);
+		$this->assertEquals(iterator_to_array($db->cursor(['prefix' => 'none:'])), []);
+		$db->commit();
+	}
 }
@@ -57,4 +57,27 @@ class StorageWiredtigerTest extends PHPUnit\Framework\TestCase
 		$this->assertEquals($cursor->get(array(1, "key1")), array("val1", "val2"));
 		$this->assertEquals($cursor->get(array(2, "key2")), array("val2", "val3"));
 	}
+
+	public function testBatching()
+	{
+		if (!class_exists('Phalcon\Storage\Wiredtiger')) {
+			$this->markTestSkipped('Class `Phalcon\Storage\Wiredtiger` is not exists');
+			return false;
+		}
+		$db = new Phalcon\Storage\Wiredtiger('unit-tests/cache/wiredtiger');
+		$this->assertTrue($db->create('table:phalcon_batch'));
+		$this->assertTrue($db->setBatching(3));
+		$cursor = $db->open('table:phalcon_batch');
+		$this->assertTrue($cursor->set("key1", "value1"));
+		$this->assertTrue($cursor->set("key2", "value2"));
+		$this->assertEquals($db->pending(), 2);
+		$this->assertEquals($cursor->get("key1"), "value1");
+		$this->assertTrue($cursor->set("key3", "value3"));
+		$this->assertEquals($db->pending(), 0);
+		$this->assertTrue($cursor->delete("key3"));
+		$this->assertEquals($db->pending(), 1);
+		$this->assertTrue($db->flush());
+		$this->assertEquals($db->pending(), 0);
+		$this->assertEquals($cursor->get("key3"), NULL);
+	}
 }
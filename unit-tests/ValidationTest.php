@@ -929,6 +929,54 @@ class ValidationTest extends PHPUnit\Framework\TestCase
 		$this->assertEquals($messages, $expectedMessages);
 	}
 
+	public function testValidationCompile()
+	{
+		$validation = new Phalcon\Validation();
+
+		$validation
+			->add('name', new PresenceOf(array(
+				'message' => 'The name is required'
+			)))
+			->add('name', new StringLength(array(
+				'max' => 5,
+				'messageMaximum' => 'The name is too long'
+			)))
+			->add('age', new Phalcon\Validation\Validator\Numericality(array(
+				'message' => 'The age is not numeric'
+			)))
+			->add('type', new InclusionIn(array(
+				'domain' => array('a', 'b', 1),
+				'message' => 'The type is invalid'
+			)))
+			->add('code', new Regex(array(
+				'pattern' => '/[A-Z]{3}/',
+				'message' => 'The code is invalid'
+			)));
+
+		$this->assertSame($validation->compile(), $validation);
+
+		$messages = $validation->validate(array('name' => 'peter', 'age' => '12', 'type' => '1', 'code' => 'ABC'));
+		$this->assertEquals(count($messages), 0);
+
+		$messages = $validation->validate(array('name' => 'peter parker', 'age' => 'x', 'type' => 'c', 'code' => 'ABCD'));
+		$this->assertEquals(count($messages), 4);
+		$this->assertEquals($messages[0]->getMessage(), 'The name is too long');
+		$this->assertEquals($messages[1]->getMessage(), 'The age is not numeric');
+		$this->assertEquals($messages[2]->getMessage(), 'The type is invalid');
+		$this->assertEquals($messages[3]->getMessage(), 'The code is invalid');
+
+		// Adding a validator drops the compiled plan
+		$validation->add('email', new PresenceOf(array(
+			'message' => 'The email is required',
+			'cancelOnFail' => true
+		)))->compile();
+
+		$messages = $validation->validate(array('name' => '', 'age' => '1', 'type' => 'a', 'code' => 'XYZ'));
+		$this->assertEquals(count($messages), 2);
+		$this->assertEquals($messages[0]->getMessage(), 'The name is required');
+		$this->assertEquals($messages[1]->getMessage(), 'The email is required');
+	}
+
 	public function testValidationFiltering()
 	{
 
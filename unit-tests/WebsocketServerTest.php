@@ -0,0 +1,95 @@
+<?php
+
+/*
+	+------------------------------------------------------------------------+
+	| Phalcon Framework                                                      |
+	+------------------------------------------------------------------------+
+	| Copyright (c) 2011-2014 Phalcon Team (http://www.phalconphp.com)       |
+	+------------------------------------------------------------------------+
+	| This source file is subject to the New BSD License that is bundled     |
+	| with this package in the file docs/LICENSE.txt.                        |
+	|                                                                        |
+	| If you did not receive a copy of the license and are unable to         |
+	| obtain it through the world-wide-web, please send an email             |
+	| to license@phalconphp.com so we can send you a copy immediately.       |
+	+------------------------------------------------------------------------+
+	| Authors: Andres Gutierrez <andres@phalconphp.com>                      |
+	|          Eduar Carvajal <eduar@phalconphp.com>                         |
+	|          ZhuZongXin <dreamsxin@qq.com>                                 |
+	+------------------------------------------------------------------------+
+*/
+
+class WebsocketServerTest extends PHPUnit\Framework\TestCase
+{
+	protected function connect($port)
+	{
+		// The server binds once its process runs the loop
+		for ($i = 0; $i < 50; $i++) {
+			$client = @stream_socket_client('tcp://127.0.0.1:' . $port, $errno, $errstr, 1);
+			if ($client) {
+				stream_set_timeout($client, 5);
+				fwrite($client, "GET / HTTP/1.1\r\nHost: 127.0.0.1:" . $port . "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+					. "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+				while (($line = fgets($client)) !== false && $line !== "\r\n");
+				$this->assertNotFalse($line);
+				return $client;
+			}
+			usleep(100000);
+		}
+
+		$this->fail('Unable to connect to the server: ' . $errstr);
+	}
+
+	protected function readFrame($client)
+	{
+		// server frames are not masked, the test payloads are shorter than 126 bytes
+		$header = fread($client, 2);
+		$this->assertEquals(strlen($header), 2);
+		return fread($client, ord($header[1]) & 0x7f);
+	}
+
+	public function testPublishAfterClose()
+	{
+		if (!class_exists('Phalcon\Websocket\Server')) {
+			$this->markTestSkipped('Class `Phalcon\Websocket\Server` is not exists');
+			return false;
+		}
+		if (!function_exists('pcntl_fork') || !function_exists('posix_kill')) {
+			$this->markTestSkipped('Test skipped');
+			return false;
+		}
+
+		$port = 20000 + (getmypid() + 1) % 10000;
+
+		$pid = pcntl_fork();
+		if ($pid == 0) {
+			$server = new Phalcon\Websocket\Server($port);
+			$server->on(Phalcon\Websocket\Server::ON_ACCEPT, function ($server, $connection) {
+				$server->subscribe($connection->getUid(), 'news');
+			});
+			$server->on(Phalcon\Websocket\Server::ON_CLOSE, function ($server, $connection) {
+				// the closed connection is already gone from its topics
+				$count = $server->publish('news', 'closed ' . $connection->getUid() . ($connection->isConnected() ? '' : ' disconnected'));
+				$server->publish('news', 'delivered ' . $count);
+			});
+			try {
+				$server->run();
+			} catch (Exception $e) {
+			}
+			// skip the shutdown of PHPUnit in the forked process
+			posix_kill(getmypid(), SIGKILL);
+		}
+
+		$first = $this->connect($port);
+		$second = $this->connect($port);
+		usleep(200000);
+
+		fclose($first);
+		$this->assertEquals($this->readFrame($second), 'closed 1 disconnected');
+		$this->assertEquals($this->readFrame($second), 'delivered 1');
+		fclose($second);
+
+		posix_kill($pid, SIGKILL);
+		pcntl_waitpid($pid, $status);
+	}
+}